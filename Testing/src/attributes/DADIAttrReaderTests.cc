@@ -0,0 +1,277 @@
+/**
+ * @file DADIAttrReaderTests.cc
+ * @brief This file implements the libdadi tests for the attributes reader
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "dadi/AttrReader.hh"
+#include "dadi/detail/Binary.hh"
+#include "dadi/Exception/Attributes.hh"
+
+namespace {
+// records events as text
+class Recorder : public dadi::AttrHandler {
+public:
+  virtual void
+  beginNode(const std::string& key) {
+    events << "(" << key;
+  }
+  virtual void
+  value(const std::string& data) {
+    events << "=" << data;
+  }
+  virtual void
+  endNode() {
+    events << ")";
+  }
+
+  std::ostringstream events;
+};
+
+std::string
+record(const std::string& data, int format,
+       int flags = dadi::READ_DEFAULT) {
+  Recorder recorder;
+  std::istringstream iss(data);
+  dadi::readAttr(iss, recorder, format, flags);
+  return recorder.events.str();
+}
+
+// whole document read through the reader
+dadi::ConfigStore
+readAll(const std::string& data, int format,
+        int flags = dadi::READ_DEFAULT) {
+  dadi::ConfigStore tree;
+  dadi::AttrSelector selector(tree, std::vector<std::string>(1, ""));
+  dadi::readAttr(data.data(), data.size(), selector, format, flags);
+  return tree;
+}
+
+dadi::ConfigStore
+select(const std::string& data, int format, const char *prefix1,
+       const char *prefix2 = NULL) {
+  std::vector<std::string> prefixes(1, prefix1);
+  if (prefix2) {
+    prefixes.push_back(prefix2);
+  }
+  dadi::ConfigStore tree;
+  dadi::AttrSelector selector(tree, prefixes);
+  std::istringstream iss(data);
+  dadi::readAttr(iss, selector, format);
+  return tree;
+}
+
+const char *xmlDocument =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<!DOCTYPE diet [<!ELEMENT diet ANY>]>\n"
+  "<diet version='3.0' name=\"a &amp; b\">\n"
+  "  <!-- the agents -->\n"
+  "  <agent>  master\n  agent </agent>\n"
+  "  <agent kind=\"local\"/>\n"
+  "  <note>1 &lt; 2 &#x41;&#66; &unknown; &amp</note>\n"
+  "  <raw><![CDATA[<kept> & raw]]></raw>\n"
+  "  text <empty></empty> after\n"
+  "</diet>\n";
+
+const char *jsonDocument =
+  "\xef\xbb\xbf{\n"
+  "  \"diet\": {\n"
+  "    \"version\": \"3.0\", \"count\": -12.5e+3,\n"
+  "    \"flags\": [true, false, null, 0],\n"
+  "    \"empty\": {}, \"none\": [], \"blank\": \"\",\n"
+  "    \"escaped\": \"q\\\"b\\\\s\\/\\n\\u00e9\\ud83d\\ude00\",\n"
+  "    \"nested\": [[1, 2], {\"a\": \"b\"}],\n"
+  "    \"dup\": 1, \"dup\": 2\n"
+  "  }\n"
+  "}\n";
+
+const char *infoDocument =
+  "; a comment\n"
+  "diet 3.0 {\n"
+  "  \"quoted key\" \"quoted \\\"data\\\"\"\n"
+  "  long \"first \" \\\n"
+  "       \"second\" ; comment\n"
+  "  agent master\n"
+  "  agent\n"
+  "  {\n"
+  "    name local { }\n"
+  "  }\n"
+  "  escaped a\\tb\n"
+  "}\n"
+  "last";
+
+const char *iniDocument =
+  "top = level\n"
+  "# comment\n"
+  "[empty]\n"
+  "[diet]\n"
+  "  version = 3.0  \n"
+  "name=\n"
+  "; comment\n"
+  "[ agent ]\n"
+  "kind = master = yes\n"
+  "[empty]\n";
+}
+
+BOOST_AUTO_TEST_SUITE(AttrReaderTests)
+
+BOOST_AUTO_TEST_CASE(events_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader events");
+  BOOST_REQUIRE_EQUAL(record("{\"a\": {\"b\": \"1\", \"c\": [2, {}]}}",
+                             dadi::FORMAT_JSON),
+                      "(a(b=1)(c(=2)()))");
+  BOOST_REQUIRE_EQUAL(record("\"root\"", dadi::FORMAT_JSON), "=root");
+  BOOST_REQUIRE_EQUAL(record("a 1 {\n b\n}\nc", dadi::FORMAT_INFO),
+                      "(a=1(b))(c)");
+  BOOST_REQUIRE_EQUAL(record("a = 1\n[s]\nb = 2", dadi::FORMAT_INI),
+                      "(a=1)(s(b=2))");
+  // xml text is reported when the element is closed
+  BOOST_REQUIRE_EQUAL(record("<a x='1'> t <b/> u </a>", dadi::FORMAT_XML,
+                             dadi::READ_TRIM_WHITESPACE),
+                      "(a(<xmlattr>(x=1))(b)=tu)");
+  BOOST_REQUIRE_EQUAL(record("<a> t <b/> u </a>", dadi::FORMAT_XML),
+                      "(a(b)= t  u )");
+}
+
+BOOST_AUTO_TEST_CASE(xml_parity_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader matches read_xml");
+  using boost::property_tree::xml_parser::trim_whitespace;
+  const int flags[] = {0, trim_whitespace};
+  for (std::size_t i = 0; i < 2; ++i) {
+    dadi::ConfigStore expected;
+    std::istringstream iss(xmlDocument);
+    boost::property_tree::read_xml(iss, expected, flags[i]);
+    BOOST_REQUIRE(expected ==
+                  readAll(xmlDocument, dadi::FORMAT_XML,
+                          flags[i] ? dadi::READ_TRIM_WHITESPACE :
+                          dadi::READ_DEFAULT));
+  }
+  BOOST_REQUIRE_EQUAL(readAll(xmlDocument, dadi::FORMAT_XML,
+                              dadi::READ_TRIM_WHITESPACE)
+                      .get<std::string>("diet.note"),
+                      "1 < 2 AB &unknown; &amp");
+}
+
+BOOST_AUTO_TEST_CASE(json_parity_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader matches read_json");
+  dadi::ConfigStore expected;
+  std::istringstream iss(jsonDocument);
+  boost::property_tree::read_json(iss, expected);
+  BOOST_REQUIRE(expected == readAll(jsonDocument, dadi::FORMAT_JSON));
+  BOOST_REQUIRE_EQUAL(readAll(jsonDocument, dadi::FORMAT_JSON)
+                      .get<std::string>("diet.escaped"),
+                      "q\"b\\s/\n\xc3\xa9\xf0\x9f\x98\x80");
+}
+
+BOOST_AUTO_TEST_CASE(info_parity_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader matches read_info");
+  dadi::ConfigStore expected;
+  std::istringstream iss(infoDocument);
+  boost::property_tree::read_info(iss, expected);
+  BOOST_REQUIRE(expected == readAll(infoDocument, dadi::FORMAT_INFO));
+  BOOST_REQUIRE_EQUAL(readAll(infoDocument, dadi::FORMAT_INFO)
+                      .get<std::string>("diet.long"), "first second");
+
+  // included nodes are siblings of the directive
+  const char *name = "DADIAttrReaderTests.info";
+  {
+    std::ofstream ofs(name);
+    ofs << "included yes\n";
+  }
+  std::string data = std::string("a {\n#include \"") + name + "\"\n}\n";
+  BOOST_REQUIRE_EQUAL(record(data, dadi::FORMAT_INFO), "(a(included=yes))");
+  std::remove(name);
+  BOOST_REQUIRE_THROW(record(data, dadi::FORMAT_INFO),
+                      dadi::ParsingAttributeError);
+}
+
+BOOST_AUTO_TEST_CASE(ini_parity_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader matches read_ini");
+  dadi::ConfigStore expected;
+  std::istringstream iss(iniDocument);
+  boost::property_tree::read_ini(iss, expected);
+  BOOST_REQUIRE(expected == readAll(iniDocument, dadi::FORMAT_INI));
+}
+
+BOOST_AUTO_TEST_CASE(binary_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader on binary documents");
+  dadi::ConfigStore tree = readAll(infoDocument, dadi::FORMAT_INFO);
+  std::string data;
+  dadi::detail::writeBinary(data, tree);
+  BOOST_REQUIRE(tree == readAll(data, dadi::FORMAT_BINARY));
+  // recognized whatever the format, from memory or from a stream
+  BOOST_REQUIRE(tree == readAll(data, dadi::FORMAT_XML));
+  BOOST_REQUIRE_EQUAL(record(data, dadi::FORMAT_JSON),
+                      record(infoDocument, dadi::FORMAT_INFO));
+  BOOST_REQUIRE_THROW(readAll(data.substr(0, data.size() - 1),
+                              dadi::FORMAT_BINARY),
+                      dadi::ParsingAttributeError);
+}
+
+BOOST_AUTO_TEST_CASE(errors_test) {
+  BOOST_TEST_MESSAGE("# Attributes reader rejects invalid documents");
+  const char *xml[] = {"<a>", "<a><b></a>", "text", "<a x=1/>",
+                       "<a>&#xffffffff;</a>", "<a><!-- a </a>", "<>"};
+  for (std::size_t i = 0; i < sizeof(xml) / sizeof(xml[0]); ++i) {
+    BOOST_CHECK_THROW(record(xml[i], dadi::FORMAT_XML),
+                      dadi::ParsingAttributeError);
+  }
+  const char *json[] = {"", "{", "{\"a\" 1}", "[1,]", "[1] 2", "tru",
+                        "\"\\x\"", "01", "-", "1.", "\"\\ud800\"",
+                        "{\"a\": [1}"};
+  for (std::size_t i = 0; i < sizeof(json) / sizeof(json[0]); ++i) {
+    BOOST_CHECK_THROW(record(json[i], dadi::FORMAT_JSON),
+                      dadi::ParsingAttributeError);
+  }
+  const char *info[] = {"a {", "}", "{", "a \"b", "a \"b\" \\\nc",
+                        "a b\\q", "#unknown", "a \"b\" \\ c"};
+  for (std::size_t i = 0; i < sizeof(info) / sizeof(info[0]); ++i) {
+    BOOST_CHECK_THROW(record(info[i], dadi::FORMAT_INFO),
+                      dadi::ParsingAttributeError);
+  }
+  const char *ini[] = {"[a", "a", "=b", "a=1\na=2", "[a]\nb=1\n[a]",
+                       "a=1\n[a]"};
+  for (std::size_t i = 0; i < sizeof(ini) / sizeof(ini[0]); ++i) {
+    BOOST_CHECK_THROW(record(ini[i], dadi::FORMAT_INI),
+                      dadi::ParsingAttributeError);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(selector_test) {
+  BOOST_TEST_MESSAGE("# Attributes selector");
+  // selected subtrees are complete, their ancestors have no value
+  dadi::ConfigStore tree = select(infoDocument, dadi::FORMAT_INFO,
+                                  "diet.agent", "last");
+  BOOST_REQUIRE_EQUAL(tree.size(), 2);
+  const dadi::ConfigStore& diet = tree.get_child("diet");
+  BOOST_REQUIRE_EQUAL(diet.data(), "");
+  BOOST_REQUIRE_EQUAL(diet.size(), 2);
+  BOOST_REQUIRE_EQUAL(diet.count("agent"), 2);
+  BOOST_REQUIRE_EQUAL(diet.get<std::string>("agent"), "master");
+  BOOST_REQUIRE_EQUAL(diet.back().second.get<std::string>("name"), "local");
+  BOOST_REQUIRE(tree.get_child_optional("last"));
+
+  // nothing is created when nothing matches
+  BOOST_REQUIRE(select(infoDocument, dadi::FORMAT_INFO, "diet.none").empty());
+  BOOST_REQUIRE(select(infoDocument, dadi::FORMAT_INFO, "agent").empty());
+
+  // overlapping paths select a subtree once
+  BOOST_REQUIRE(select(jsonDocument, dadi::FORMAT_JSON, "diet", "diet.flags")
+                == readAll(jsonDocument, dadi::FORMAT_JSON));
+  BOOST_REQUIRE_EQUAL(select(jsonDocument, dadi::FORMAT_JSON, "diet.nested.")
+                      .get_child("diet.nested").size(), 2);
+  BOOST_REQUIRE_EQUAL(select(xmlDocument, dadi::FORMAT_XML,
+                             "diet.<xmlattr>.version")
+                      .get<std::string>("diet.<xmlattr>.version"), "3.0");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -361,6 +361,94 @@ BOOST_AUTO_TEST_CASE(attr_load_attr_bad_format) {
 }
 
 
+BOOST_AUTO_TEST_CASE(attr_binary_format) {
+  BOOST_TEST_MESSAGE("# Attributes binary format");
+  dadi::Attributes attr;
+  attr.putAttr("string", "toto");
+  attr.putAttr("int", -1);
+  attr.putAttr("empty", "");
+  attr.addAttr("holy.character", "Arthur");
+  attr.addAttr("holy.character", "Patsy");
+  attr.putAttr("holy.character.horse", "coconut");
+  attr.putAttr("binary", std::string("a\0b", 3));
+
+  std::string data = dadi::str(attr, dadi::FORMAT_BINARY);
+  dadi::Attributes copy(data, dadi::FORMAT_BINARY);
+  BOOST_REQUIRE(attr == copy);
+  BOOST_REQUIRE_EQUAL(copy.getAttr<std::string>("binary").size(), 3);
+
+  // binary data is recognized whatever the requested format
+  dadi::Attributes other;
+  other.loadAttr(data);
+  BOOST_REQUIRE(attr == other);
+  other = dadi::Attributes();
+  other.loadAttr(data.data(), data.size(), dadi::FORMAT_INFO);
+  BOOST_REQUIRE(attr == other);
+
+  // buffers are reused
+  std::string buffer("garbage");
+  attr.saveAttr(buffer, dadi::FORMAT_BINARY);
+  BOOST_REQUIRE_EQUAL(buffer, data);
+  dadi::Attributes text;
+  text.putAttr("holy.grail", "lost");
+  text.saveAttr(buffer, dadi::FORMAT_JSON);
+  BOOST_REQUIRE_EQUAL(buffer, dadi::str(text, dadi::FORMAT_JSON));
+  other.loadAttr(buffer.data(), buffer.size(), dadi::FORMAT_JSON);
+  BOOST_REQUIRE(text == other);
+  other.loadAttr(data.data(), data.size(), dadi::FORMAT_XML);
+
+  // truncated or corrupted documents are rejected, attributes are kept
+  for (std::size_t size = 0; size < data.size(); ++size) {
+    BOOST_REQUIRE_THROW(other.loadAttr(data.substr(0, size),
+                                       dadi::FORMAT_BINARY),
+                        dadi::ParsingAttributeError);
+  }
+  BOOST_REQUIRE_THROW(other.loadAttr(data + "x"),
+                      dadi::ParsingAttributeError);
+  BOOST_REQUIRE(attr == other);
+}
+
+BOOST_AUTO_TEST_CASE(attr_load_selected) {
+  BOOST_TEST_MESSAGE("# Attributes selective load");
+  dadi::Attributes attr;
+  attr.putAttr("holy.grail", "lost");
+  attr.addAttr("holy.character", "Arthur");
+  attr.addAttr("holy.character", "Patsy");
+  attr.putAttr("holy.character.horse", "coconut");
+  attr.putAttr("spam", "eggs");
+
+  std::vector<std::string> prefixes(1, "holy.character");
+  const int formats[] = {dadi::FORMAT_XML, dadi::FORMAT_INFO,
+                         dadi::FORMAT_BINARY};
+  for (std::size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+    std::istringstream iss(dadi::str(attr, formats[i]));
+    dadi::Attributes selected;
+    selected.loadAttr(iss, prefixes, formats[i]);
+    BOOST_REQUIRE_EQUAL(selected.getAttr<std::string>("holy.character"),
+                        "Arthur");
+    BOOST_REQUIRE_EQUAL(
+      selected.getAttr<std::string>("holy.character.horse"), "coconut");
+    BOOST_REQUIRE_EQUAL(selected.getAttrList<std::vector<std::string> >(
+                          "holy.character").size(), 2);
+    BOOST_REQUIRE_THROW(selected.getAttr<std::string>("holy.grail"),
+                        dadi::UnknownAttributeError);
+    BOOST_REQUIRE_THROW(selected.getAttr<std::string>("spam"),
+                        dadi::UnknownAttributeError);
+  }
+
+  // the whole document, loaded the same way as loadAttr
+  std::istringstream xml(dadi::str(attr, dadi::FORMAT_XML));
+  dadi::Attributes all;
+  all.loadAttr(xml, std::vector<std::string>(1, ""));
+  BOOST_REQUIRE(attr == all);
+
+  // invalid documents leave attributes unchanged
+  std::istringstream bad("<holy><grail>");
+  BOOST_REQUIRE_THROW(all.loadAttr(bad, prefixes),
+                      dadi::ParsingAttributeError);
+  BOOST_REQUIRE(attr == all);
+}
+
 BOOST_AUTO_TEST_CASE(attr_equal_operator) {
   BOOST_TEST_MESSAGE("# Attributes equal operator");
   dadi::Attributes attr1;
@@ -403,6 +491,57 @@ BOOST_AUTO_TEST_CASE(attr_merge) {
   BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy.grail"), "lost");
 }
 
+BOOST_AUTO_TEST_CASE(attr_merge_duplicates) {
+  BOOST_TEST_MESSAGE("# Attributes merge does not duplicate leaves");
+  dadi::Attributes attr1;
+  attr1.putAttr("int", 1);
+  attr1.addAttr("list.metric", 1);
+  attr1.addAttr("list.metric", 2);
+
+  dadi::Attributes attr2;
+  attr2.putAttr("int", 1);
+  attr2.putAttr("other", 2);
+  attr2.addAttr("list.metric", 2);
+  attr2.addAttr("list.metric", 3);
+  attr2.addAttr("list.metric", 3);
+
+  attr1.merge(attr2);
+  dadi::Attributes attr3(attr1);
+  BOOST_REQUIRE_EQUAL(
+    attr1.getAttrList<std::vector<int> >("list.metric").size(), 3);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>("other"), 2);
+  BOOST_REQUIRE_EQUAL(attr2.getAttrList<std::vector<int> >(
+                        "list.metric").size(), 3);
+
+  // merging again changes nothing
+  attr1.merge(attr2);
+  BOOST_REQUIRE(attr1 == attr3);
+  attr1.merge(attr1);
+  BOOST_REQUIRE(attr1 == attr3);
+}
+
+BOOST_AUTO_TEST_CASE(attr_splice) {
+  BOOST_TEST_MESSAGE("# Attributes splice");
+  dadi::Attributes attr1;
+  attr1.putAttr("holy.grail", "lost");
+  attr1.addAttr("holy.character", "Arthur");
+
+  dadi::Attributes attr2;
+  attr2.addAttr("holy.character", "Arthur");
+  attr2.addAttr("holy.character", "Patsy");
+  attr2.putAttr("holy.castle", "arggghhh");
+
+  dadi::Attributes merged(attr1);
+  dadi::Attributes copy(attr2);
+  merged.merge(copy);
+  attr1.splice(attr2);
+  BOOST_REQUIRE(attr1 == merged);
+  BOOST_REQUIRE(attr2 == dadi::Attributes());
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy.castle"), "arggghhh");
+  BOOST_REQUIRE_EQUAL(attr1.getAttrList<std::vector<std::string> >(
+                        "holy.character").size(), 2);
+}
+
 
 
 BOOST_AUTO_TEST_CASE(attr_str) {
@@ -513,4 +652,54 @@ BOOST_AUTO_TEST_CASE(getAttrList_exception_invalid_attr_nothrow_2) {
 }
 
 
+BOOST_AUTO_TEST_CASE(attrPath_get_put) {
+  BOOST_TEST_MESSAGE("# Get and put attributes through precompiled paths");
+  const dadi::AttrPath size("rotate.size");
+  dadi::Attributes attr;
+  BOOST_REQUIRE_THROW(attr.getAttr<int>(size), dadi::UnknownAttributeError);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size, 4), 4);
+
+  attr.putAttr(size, 1024);
+  BOOST_REQUIRE_EQUAL(size.str(), "rotate.size");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size), 1024);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>("rotate.size"), 1024);
+  attr.putAttr("rotate.size", "big");
+  BOOST_REQUIRE_THROW(attr.getAttr<int>(size), dadi::InvalidAttributeError);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size, 4), 4);
+
+  // the first of duplicated nodes is used, as with string paths
+  attr.addAttr("rotate.size", 2048);
+  attr.putAttr(size, "small");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("rotate.size"), "small");
+  BOOST_REQUIRE_EQUAL(
+    attr.getAttrList<std::vector<std::string> >("rotate.size").size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(attrPath_cached) {
+  BOOST_TEST_MESSAGE("# Cached precompiled paths follow structure changes");
+  const dadi::AttrPath path("metric.ram.total", true);
+  dadi::Attributes attr1;
+  attr1.putAttr(path, 1);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>(path), 1);
+  attr1.putAttr(path, 2);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>("metric.ram.total"), 2);
+
+  // another instance, even a copy, has its own nodes
+  dadi::Attributes attr2(attr1);
+  attr2.putAttr(path, 3);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>(path), 2);
+  BOOST_REQUIRE_EQUAL(attr2.getAttr<int>(path), 3);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>("metric.ram.total"), 2);
+
+  attr1.swap(attr2);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>(path), 3);
+  attr1.loadAttr("<metric><ram><total>5</total></ram></metric>");
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>(path), 5);
+  attr1 = dadi::Attributes();
+  BOOST_REQUIRE_THROW(attr1.getAttr<int>(path), dadi::UnknownAttributeError);
+  attr1.putAttr("metric.ram.total", 6);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>(path), 6);
+}
+
+
 BOOST_AUTO_TEST_SUITE_END()
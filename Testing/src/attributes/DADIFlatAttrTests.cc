@@ -0,0 +1,344 @@
+/**
+ * @file DADIFlatAttrTests.cc
+ * @brief This file implements the libdadi tests for the flat attributes
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/test/unit_test.hpp>
+#include "dadi/Attributes.hh"
+#include "dadi/FlatAttributes.hh"
+#include "dadi/Exception/Attributes.hh"
+
+namespace {
+// the same values, put in both backends
+template<class Attr>
+void
+fill(Attr& attr) {
+  attr.putAttr("string", "toto");
+  attr.putAttr("int", 1);
+  attr.putAttr("negative", -42);
+  attr.putAttr("long", 1LL << 40);
+  attr.putAttr("unsigned", 18446744073709551615ULL);
+  attr.putAttr("float", 1.2f);
+  attr.putAttr("double", 1.2);
+  attr.putAttr("bool", true);
+  attr.putAttr("char", 'x');
+  attr.putAttr("nested.leaf.value", 3);
+  attr.addAttr("nested.list", "a");
+  attr.addAttr("nested.list", "b");
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FlatAttributesTests)
+
+BOOST_AUTO_TEST_CASE(getAttr_ok) {
+  BOOST_TEST_MESSAGE("# Get flat attribute normal call");
+  dadi::FlatAttributes attr;
+  attr.putAttr<std::string>("/tmp", "toto");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("/tmp"), "toto");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("/tmp", ""), "toto");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("/none", "titi"), "titi");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>("/tmp", 7), 7);
+
+  attr.putAttr("/tmp", 1);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>("/tmp"), 1);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("/tmp"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(getAttr_exceptions) {
+  BOOST_TEST_MESSAGE("# Get unknown and invalid flat attributes");
+  dadi::FlatAttributes attr;
+  BOOST_REQUIRE_THROW(attr.getAttr<std::string>("toto"),
+                      dadi::UnknownAttributeError);
+  BOOST_REQUIRE_THROW(attr.getAttr<std::string>("toto.titi"),
+                      dadi::UnknownAttributeError);
+  attr.putAttr<std::string>("toto", "toto");
+  BOOST_REQUIRE_THROW(attr.getAttr<int>("toto"),
+                      dadi::InvalidAttributeError);
+  attr.putAttr<std::string>("toto", "1");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>("toto"), 1);
+  // integers too large for the requested type are invalid
+  attr.putAttr("toto", 1LL << 40);
+  BOOST_REQUIRE_THROW(attr.getAttr<int>("toto"),
+                      dadi::InvalidAttributeError);
+  attr.putAttr("toto", -1);
+  BOOST_REQUIRE_THROW(attr.getAttr<unsigned int>("toto"),
+                      dadi::InvalidAttributeError);
+}
+
+BOOST_AUTO_TEST_CASE(conversion_test) {
+  BOOST_TEST_MESSAGE("# Flat attributes convert values as Attributes");
+  dadi::Attributes attr;
+  dadi::FlatAttributes flat;
+  fill(attr);
+  fill(flat);
+
+  const char *paths[] = {
+    "string", "int", "negative", "long", "unsigned", "float", "double",
+    "bool", "char", "nested.leaf.value", "nested.list"
+  };
+  for (std::size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+    BOOST_TEST_MESSAGE(paths[i]);
+    BOOST_CHECK_EQUAL(flat.getAttr<std::string>(paths[i]),
+                      attr.getAttr<std::string>(paths[i]));
+    BOOST_CHECK_EQUAL(flat.getAttr<double>(paths[i], -1.0),
+                      attr.getAttr<double>(paths[i], -1.0));
+    BOOST_CHECK_EQUAL(flat.getAttr<int>(paths[i], -1),
+                      attr.getAttr<int>(paths[i], -1));
+    BOOST_CHECK_EQUAL(flat.getAttr<bool>(paths[i], false),
+                      attr.getAttr<bool>(paths[i], false));
+  }
+  BOOST_CHECK_EQUAL(flat.getAttr<boost::uint64_t>("unsigned"),
+                    18446744073709551615ULL);
+  BOOST_CHECK_EQUAL(flat.getAttr<char>("char"), 'x');
+
+  for (int format = dadi::FORMAT_XML; format <= dadi::FORMAT_INFO; ++format) {
+    if (dadi::FORMAT_INI == format) {
+      // ini does not support nesting beyond one level
+      continue;
+    }
+    BOOST_CHECK_EQUAL(dadi::str(flat, format), dadi::str(attr, format));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(path_test) {
+  BOOST_TEST_MESSAGE("# Flat attributes precompiled paths");
+  const dadi::FlatAttributes::Path size("rotate.size");
+  const dadi::FlatAttributes::Path none("rotate.none");
+  dadi::FlatAttributes attr;
+  BOOST_REQUIRE_THROW(attr.getAttr<int>(size), dadi::UnknownAttributeError);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size, 4), 4);
+
+  attr.putAttr(size, 1024);
+  attr.putAttr("rotate.mode", "size");
+  BOOST_REQUIRE_EQUAL(size.str(), "rotate.size");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size), 1024);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>("rotate.size"), 1024);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>(
+                        dadi::FlatAttributes::Path("rotate.mode")), "size");
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(none, 2), 2);
+
+  // the same path updates the same node
+  attr.putAttr("rotate.size", 2048);
+  BOOST_REQUIRE_EQUAL(attr.getAttr<int>(size), 2048);
+  BOOST_REQUIRE_EQUAL(attr.getAttrList<std::vector<int> >(
+                        "rotate.size").size(), 1U);
+
+  // keys are interned by each instance, paths work with any of them
+  dadi::FlatAttributes other;
+  other.putAttr("rotate.mode", "time");
+  BOOST_REQUIRE_EQUAL(other.getAttr<int>(size, 8), 8);
+  other.putAttr(size, 512);
+  BOOST_REQUIRE_EQUAL(other.getAttr<int>(size), 512);
+  BOOST_REQUIRE_EQUAL(other.getAttr<int>("rotate.size"), 512);
+  other = attr;
+  BOOST_REQUIRE_EQUAL(other.getAttr<int>(size), 2048);
+}
+
+BOOST_AUTO_TEST_CASE(copy_compare_test) {
+  BOOST_TEST_MESSAGE("# Flat attributes copy and comparison");
+  dadi::FlatAttributes attr1;
+  fill(attr1);
+  dadi::FlatAttributes attr2(attr1);
+  BOOST_REQUIRE(attr1 == attr2);
+
+  // values are compared as strings
+  attr2.putAttr("int", "1");
+  BOOST_REQUIRE(attr1 == attr2);
+  attr2.putAttr("int", 2);
+  BOOST_REQUIRE(attr1 != attr2);
+
+  dadi::FlatAttributes attr3;
+  attr3 = attr1;
+  BOOST_REQUIRE(attr1 == attr3);
+  attr3.addAttr("nested.list", "c");
+  BOOST_REQUIRE(attr1 != attr3);
+
+  attr3.swap(attr2);
+  BOOST_REQUIRE_EQUAL(attr3.getAttr<int>("int"), 2);
+  BOOST_REQUIRE_EQUAL(attr2.getAttrList<std::vector<std::string> >(
+                        "nested.list").size(), 3U);
+}
+
+BOOST_AUTO_TEST_CASE(load_save_test) {
+  BOOST_TEST_MESSAGE("# Flat attributes serialization");
+  dadi::FlatAttributes attr;
+  attr.putAttr("section.string", "toto");
+  attr.putAttr("section.int", 1);
+  attr.putAttr("other.bool", true);
+
+  for (int format = dadi::FORMAT_XML; format <= dadi::FORMAT_INFO; ++format) {
+    dadi::FlatAttributes copy(attr.saveAttr(format), format);
+    BOOST_CHECK(copy == attr);
+    BOOST_CHECK_EQUAL(copy.getAttr<int>("section.int"), 1);
+    BOOST_CHECK_EQUAL(copy.getAttr<bool>("other.bool"), true);
+  }
+
+  dadi::Attributes ref;
+  ref.loadAttr(attr.saveAttr(dadi::FORMAT_INFO), dadi::FORMAT_INFO);
+  BOOST_CHECK_EQUAL(dadi::str(ref, dadi::FORMAT_JSON),
+                    dadi::str(attr, dadi::FORMAT_JSON));
+
+  BOOST_REQUIRE_THROW(attr.loadAttr("<toto>", dadi::FORMAT_XML),
+                      dadi::ParsingAttributeError);
+  // a failed load leaves attributes untouched
+  BOOST_REQUIRE_EQUAL(attr.getAttr<std::string>("section.string"), "toto");
+}
+
+BOOST_AUTO_TEST_CASE(binary_test) {
+  BOOST_TEST_MESSAGE("# Flat attributes binary format");
+  dadi::Attributes attr;
+  dadi::FlatAttributes flat;
+  fill(attr);
+  fill(flat);
+
+  // values keep their type
+  std::string data;
+  flat.saveAttr(data, dadi::FORMAT_BINARY);
+  dadi::FlatAttributes copy(data, dadi::FORMAT_BINARY);
+  BOOST_REQUIRE(copy == flat);
+  BOOST_CHECK_EQUAL(dadi::str(copy, dadi::FORMAT_XML),
+                    dadi::str(flat, dadi::FORMAT_XML));
+  BOOST_CHECK_EQUAL(copy.getAttr<float>("float"), 1.2f);
+  BOOST_CHECK_EQUAL(copy.getAttr<double>("double"), 1.2);
+  BOOST_CHECK_EQUAL(copy.getAttr<long long>("long"), 1LL << 40);
+
+  // both backends read each other documents
+  dadi::Attributes fromFlat(data);
+  BOOST_REQUIRE(fromFlat == attr);
+  copy = dadi::FlatAttributes();
+  const std::string fromAttr = dadi::str(attr, dadi::FORMAT_BINARY);
+  copy.loadAttr(fromAttr.data(), fromAttr.size(), dadi::FORMAT_XML);
+  BOOST_REQUIRE(copy == flat);
+
+  BOOST_REQUIRE_THROW(copy.loadAttr(data.substr(0, data.size() - 1)),
+                      dadi::ParsingAttributeError);
+  BOOST_REQUIRE(copy == flat);
+}
+
+BOOST_AUTO_TEST_CASE(attr_str) {
+  BOOST_TEST_MESSAGE("# Flat attributes str");
+  dadi::FlatAttributes attr1;
+  attr1.putAttr("string", "toto");
+  attr1.putAttr("int", 1);
+  attr1.putAttr("float", 1.2);
+  std::string xml;
+  xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+  xml += "<string>toto</string>\n<int>1</int>\n<float>1.2</float>\n";
+  BOOST_CHECK_EQUAL(dadi::str(attr1, dadi::FORMAT_XML), xml);
+}
+
+BOOST_AUTO_TEST_CASE(attr_merge) {
+  BOOST_TEST_MESSAGE("# Flat attributes merge");
+  dadi::FlatAttributes attr1;
+  attr1.putAttr("string", "toto");
+  attr1.putAttr("int", 1);
+  attr1.putAttr("float", 1.2);
+  attr1.addAttr("holy", "god");
+  attr1.addAttr("holy.character", "Patsy");
+  attr1.addAttr("holy.character", "Robin");
+  attr1.addAttr("holy.weapon", "sword");
+
+  dadi::FlatAttributes attr2;
+  attr2.putAttr("float", 1.2);
+  attr2.putAttr("int2", 2);
+  attr2.putAttr("holy.grail", "lost");
+  attr2.addAttr("holy.character", "Arthur");
+  attr2.addAttr("holy.character", "Lancelot");
+  attr2.addAttr("holy.character", "Patsy");
+  attr2.addAttr("holy.castle", "arggghhh");
+
+  dadi::Attributes tree1(attr1.saveAttr());
+  attr1.merge(attr2);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<int>("int2"), 2);
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy"), "god");
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy.castle"), "arggghhh");
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy.weapon"), "sword");
+  BOOST_REQUIRE_EQUAL(attr1.getAttr<std::string>("holy.grail"), "lost");
+  BOOST_REQUIRE_EQUAL(attr1.getAttrList<std::vector<std::string> >(
+                        "holy.character").size(), 4U);
+  BOOST_REQUIRE_EQUAL(attr1.getAttrList<std::vector<double> >(
+                        "float").size(), 1U);
+
+  // merging twice adds nothing
+  dadi::FlatAttributes attr3(attr1);
+  attr1.merge(attr2);
+  BOOST_REQUIRE(attr1 == attr3);
+
+  // same result as Attributes
+  dadi::Attributes tree2(attr2.saveAttr());
+  tree1.merge(tree2);
+  BOOST_REQUIRE_EQUAL(dadi::str(tree1), dadi::str(attr1));
+}
+
+/* getAttrList tests */
+BOOST_AUTO_TEST_CASE(getAttrList_test) {
+  BOOST_TEST_MESSAGE("# Get flat attribute lists");
+  dadi::FlatAttributes attr;
+  BOOST_REQUIRE_THROW(attr.getAttrList<std::vector<std::string> >("toto"),
+                      dadi::UnknownAttributeError);
+  BOOST_REQUIRE_THROW(attr.getAttrList<std::vector<std::string> >("toto.uu"),
+                      dadi::UnknownAttributeError);
+
+  attr.addAttr<std::string>("toto.uu.titi", "toto1");
+  attr.addAttr<std::string>("toto.uu.titi", "toto2");
+  attr.addAttr<std::string>("toto.uu.tata", "toto3");
+  attr.addAttr("toto.int", 1);
+  attr.addAttr("toto.int", "2");
+  attr.addAttr("toto.int", "three");
+
+  std::vector<std::string> listAttr =
+    attr.getAttrList<std::vector<std::string> >("toto.uu");
+  BOOST_REQUIRE_EQUAL(listAttr.size(), 1U);
+  BOOST_CHECK(listAttr[0].empty());
+
+  listAttr = attr.getAttrList<std::vector<std::string> >("toto.uu.titi");
+  BOOST_REQUIRE_EQUAL(listAttr.size(), 2U);
+  BOOST_CHECK_EQUAL(listAttr[0], "toto1");
+  BOOST_CHECK_EQUAL(listAttr[1], "toto2");
+
+  BOOST_REQUIRE_EQUAL(attr.getAttrList<std::vector<std::string> >(
+                        "toto.int").size(), 3U);
+  BOOST_REQUIRE_THROW(attr.getAttrList<std::vector<int> >("toto.int"),
+                      dadi::InvalidAttributeError);
+  BOOST_REQUIRE_EQUAL(attr.getAttrList<std::vector<int> >("toto.uu.none")
+                      .size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(string_slot_reuse_test) {
+  dadi::FlatAttributes attr;
+  attr.putAttr<std::string>("toto.titi", "first");
+  attr.putAttr<std::string>("toto.tata", "second");
+  BOOST_REQUIRE_EQUAL(attr.stringSlots(), 2U);
+
+  for (int i = 0; i < 100; ++i) {
+    attr.putAttr("toto.titi", i);
+    attr.putAttr("toto.titi", 0.5);
+    attr.putAttr("toto.titi", true);
+    attr.putAttr<std::string>("toto.titi", "value");
+  }
+  BOOST_CHECK_EQUAL(attr.stringSlots(), 2U);
+  BOOST_CHECK_EQUAL(attr.getAttr<std::string>("toto.titi"), "value");
+  BOOST_CHECK_EQUAL(attr.getAttr<std::string>("toto.tata"), "second");
+
+  // a slot freed by one node is taken by the next string stored
+  attr.putAttr("toto.titi", 1);
+  attr.putAttr<std::string>("toto.tutu", "third");
+  BOOST_CHECK_EQUAL(attr.stringSlots(), 2U);
+  BOOST_CHECK_EQUAL(attr.getAttr<int>("toto.titi"), 1);
+  BOOST_CHECK_EQUAL(attr.getAttr<std::string>("toto.tutu"), "third");
+
+  dadi::FlatAttributes copy(attr);
+  BOOST_CHECK_EQUAL(copy.stringSlots(), 2U);
+  BOOST_CHECK(copy == attr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// THE END
@@ -135,6 +135,39 @@ BOOST_AUTO_TEST_CASE(load_bad_config_file_test) {
   config.clear();
 }
 
+BOOST_AUTO_TEST_CASE(load_selected_config_file_test) {
+  BOOST_TEST_MESSAGE("[config Loader] LOAD SELECTED CONFIG BEGIN");
+  dadi::Config& config = dadi::Config::instance();
+  boost::filesystem::path configFilePath(TESTFILESOUTPUTPATH);
+  configFilePath /= "cfg";
+  configFilePath /= "infoConfigFile.cfg";
+
+  std::vector<std::string> prefixes;
+  prefixes.push_back("diet.core.users");
+  prefixes.push_back("diet.dagda.tempMemSize");
+  {
+    std::ifstream ifs(configFilePath.native().c_str());
+    config.load(ifs, prefixes);
+  }
+  BOOST_CHECK_EQUAL(config.get<int>("diet.dagda.tempMemSize"), 10000);
+  BOOST_CHECK_EQUAL(config.get<std::string>("diet.core.users.user"), "paco");
+  BOOST_CHECK_EQUAL(config.get<int>("diet.core.users.user.quotas"), 2000);
+  BOOST_CHECK_THROW(config.get<int>("diet.dagda.tempFileSize"),
+                    dadi::UnknownParameterError);
+  BOOST_CHECK_THROW(config.get<std::string>("diet.core.Groups.group"),
+                    dadi::UnknownParameterError);
+
+  // a bad source leaves the config unchanged
+  {
+    std::istringstream iss("diet\n{\n version 3.0\n");
+    BOOST_REQUIRE_THROW(config.load(iss, prefixes),
+                        dadi::ParsingAttributeError);
+  }
+  BOOST_CHECK_EQUAL(config.get<int>("diet.dagda.tempMemSize"), 10000);
+
+  config.clear();
+}
+
 
 
 // test  save member function
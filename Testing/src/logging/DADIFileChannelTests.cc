@@ -7,7 +7,10 @@
  *
  */
 
+#include <ctime>
 #include <iostream>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -16,14 +19,21 @@
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/copy.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/thread.hpp>
+#include "dadi/Logging/ArchiveStrategy.hh"
+#include "dadi/Logging/BinaryFileChannel.hh"
+#include "dadi/Logging/Compressor.hh"
 #include "dadi/Logging/FileChannel.hh"
 #include "dadi/Logging/Logger.hh"
 #include "dadi/Logging/Message.hh"
+#include "dadi/Logging/MessageQueue.hh"
+#include "dadi/Logging/PurgeStrategy.hh"
 #include "dadi/Config.hh"
 #include "dadi/Options.hh"
+#include "dadi/Exception/Attributes.hh"
 
 namespace bfs = boost::filesystem;  // an alias for boost filesystem namespace
 
@@ -34,6 +44,88 @@ static const std::string MSGSTR =
 
 namespace {
 typedef boost::scoped_ptr<dadi::FileChannel> FChannelPtr;
+
+// functor: store batches consumed by a dadi::MessageQueue
+class Collector {
+public:
+  explicit Collector(std::vector<dadi::Message>& msgs) : msgs_(msgs) {}
+
+  void
+  operator()(const dadi::MessageQueue::Batch& batch) {
+    msgs_.insert(msgs_.end(), batch.begin(), batch.end());
+  }
+
+private:
+  std::vector<dadi::Message>& msgs_;
+};
+
+// functor: store files processed by a dadi::Compressor
+class Recorder {
+public:
+  Recorder(std::vector<std::string>& paths, boost::mutex& mutex)
+    : paths_(paths), mutex_(mutex) {}
+
+  void
+  operator()(const std::string& path) {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    paths_.push_back(path);
+  }
+
+private:
+  std::vector<std::string>& paths_;
+  boost::mutex& mutex_;
+};
+
+// file channel whose writer blocks in encode(), channel locked, until released
+class StalledFileChannel : public dadi::FileChannel {
+public:
+  explicit StalledFileChannel(const std::string& path)
+    : dadi::FileChannel(path), stalled_(false), released_(false) {}
+
+  void
+  waitStalled() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (!stalled_) {
+      cond_.wait(lock);
+    }
+  }
+
+  void
+  release() {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    released_ = true;
+    cond_.notify_all();
+  }
+
+protected:
+  virtual void
+  encode(const dadi::Message& msg, std::string& out) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      stalled_ = true;
+      cond_.notify_all();
+      while (!released_) {
+        cond_.wait(lock);
+      }
+    }
+    dadi::FileChannel::encode(msg, out);
+  }
+
+private:
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool stalled_;
+  bool released_;
+};
+
+// log messages through a channel
+void
+logMessages(dadi::FileChannel& channel, const dadi::Message& msg,
+            unsigned int count) {
+  for (unsigned int i = 0; i < count; ++i) {
+    channel.log(msg);
+  }
+}
 }
 
 BOOST_AUTO_TEST_SUITE(FileChannelTests)
@@ -113,10 +205,10 @@ BOOST_AUTO_TEST_CASE(path_to_directory_test) {
 
   FChannelPtr myFileC(new dadi::FileChannel(tmpDir.native()));
 
-  // FIXME: when dadi::FileChannel::open will throw an exception
-  // re-enable this test (with the proper exception type
   // Check that open throws an exception
-  // BOOST_REQUIRE_THROW( myFileC->open(), std::exception)
+  BOOST_REQUIRE_THROW(myFileC->open(), dadi::Error);
+  // and keeps failing (nothing half opened)
+  BOOST_REQUIRE_THROW(myFileC->open(), dadi::Error);
   // Delete working file
   bfs::remove_all(tmpDir);
 }
@@ -782,6 +874,688 @@ BOOST_AUTO_TEST_CASE(archive_methods_test) {
 
 
 
+BOOST_AUTO_TEST_CASE(async_mode_test) {
+  BOOST_TEST_MESSAGE("#Async mode test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const unsigned int count = 1000;
+
+  // Create working file
+  bfs::path tmpFile = bfs::temp_directory_path();
+  tmpFile /= "%%%%-%%%%-%%%%-%%%%";
+  tmpFile = bfs::unique_path(tmpFile);
+  BOOST_TEST_MESSAGE("tmp file = " + tmpFile.native());
+
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("async", "true");
+    myFileC->putAttr("async.queue_size", 16);
+
+    for (unsigned int i = 0; i < count; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+
+    // close must drain pending messages
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(),
+                        count * (msgToLog.size() + 1));
+  }
+
+  bfs::remove_all(tmpFile);
+}
+
+BOOST_AUTO_TEST_CASE(async_stalled_writer_test) {
+  BOOST_TEST_MESSAGE("#Async mode with a stalled writer test#");
+
+  dadi::Message myMsg(SRCSTR, MSGSTR, dadi::Message::PRIO_DEBUG);
+
+  bfs::path tmpFile = bfs::temp_directory_path();
+  tmpFile /= "%%%%-%%%%-%%%%-%%%%";
+  tmpFile = bfs::unique_path(tmpFile);
+
+  {
+    StalledFileChannel channel(tmpFile.native());
+    channel.putAttr("async", "true");
+    channel.putAttr("async.queue_size", 16);
+
+    // the writer picks the first message and blocks while writing it
+    channel.log(myMsg);
+    channel.waitStalled();
+
+    // log() only enqueues: it does not wait for the writer
+    boost::thread producer(boost::bind(&logMessages, boost::ref(channel),
+                                       boost::cref(myMsg), 8));
+    bool returned =
+      producer.timed_join(boost::posix_time::seconds(5));
+    channel.release();
+    producer.join();
+    BOOST_REQUIRE(returned);
+
+    channel.close();
+    BOOST_REQUIRE_EQUAL(channel.getSize(), 9 * (MSGSTR.size() + 1));
+  }
+
+  bfs::remove_all(tmpFile);
+}
+
+BOOST_AUTO_TEST_CASE(flush_policies_test) {
+  BOOST_TEST_MESSAGE("#Flush policies test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const long lineSize = msgToLog.size() + 1;
+
+  // Create working file
+  bfs::path tmpFile = bfs::temp_directory_path();
+  tmpFile /= "%%%%-%%%%-%%%%-%%%%";
+  tmpFile = bfs::unique_path(tmpFile);
+  BOOST_TEST_MESSAGE("tmp file = " + tmpFile.native());
+
+  // lines are written once enough bytes are buffered
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("flush", "bytes:" +
+                     boost::lexical_cast<std::string>(3 * lineSize));
+    myFileC->putAttr("fsync", "on-rotate");
+
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), 0);
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), 3 * lineSize);
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    BOOST_REQUIRE_NO_THROW(myFileC->flush());
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), 4 * lineSize);
+  }
+  bfs::remove_all(tmpFile);
+
+  // lines are written only when buffer is full or on close
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("flush", "never");
+    myFileC->putAttr("buffer_size", 10 * lineSize);
+
+    for (unsigned int i = 0; i < 9; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), 0);
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), 10 * lineSize);
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+  }
+  // destructor writes pending lines
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile), 11 * lineSize);
+  bfs::remove_all(tmpFile);
+
+  // idle channels are flushed by a background thread
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("flush", "ms:20");
+    myFileC->putAttr("fsync", "interval");
+    myFileC->putAttr("fsync.interval", 20);
+    myFileC->putAttr("async", "true");
+
+    BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    for (unsigned int i = 0; i < 100 && !myFileC->getSize(); ++i) {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    BOOST_REQUIRE_EQUAL(myFileC->getSize(), lineSize);
+  }
+  bfs::remove_all(tmpFile);
+
+  // invalid values
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("flush", "bytes:lots");
+    BOOST_REQUIRE_THROW(myFileC->open(), dadi::InvalidAttributeError);
+  }
+  bfs::remove_all(tmpFile);
+}
+
+BOOST_AUTO_TEST_CASE(rotate_strategies_schedule_test) {
+  BOOST_TEST_MESSAGE("#Rotate strategies schedule test#");
+  using boost::posix_time::duration_from_string;
+  // 2011-03-14 15:09:26 UTC (monday)
+  const boost::int64_t now = 1300115366LL * 1000000000LL + 123;
+  const boost::int64_t hour = 3600LL * 1000000000LL;
+  const boost::int64_t midnight = 1300060800LL * 1000000000LL;
+
+  dadi::RotateBySizeStrategy bySize("1k");
+  BOOST_REQUIRE_EQUAL(bySize.getMaxSize(), 1024);
+  BOOST_REQUIRE_EQUAL(bySize.getNextRotation(now), -1);
+
+  dadi::RotateByIntervalStrategy byInterval(duration_from_string("01:00:00"));
+  BOOST_REQUIRE_EQUAL(byInterval.getMaxSize(), -1);
+  BOOST_REQUIRE_EQUAL(byInterval.getNextRotation(now), now - 123 + hour);
+
+  // everyday at noon: tomorrow
+  // local time by default
+  dadi::RotateByTimeStrategy daily(duration_from_string("12:00:00"));
+  daily.setUtc();
+  BOOST_REQUIRE_EQUAL(daily.getNextRotation(now), midnight + 36 * hour);
+  // exactly on the boundary: fires once, next one is the day after
+  BOOST_REQUIRE_EQUAL(daily.getNextRotation(midnight + 36 * hour),
+                      midnight + 60 * hour);
+  // setLocal() kept its historical meaning: true selects UTC
+  dadi::RotateByTimeStrategy legacy(duration_from_string("12:00:00"));
+  legacy.setLocal(true);
+  BOOST_REQUIRE_EQUAL(legacy.getNextRotation(now), midnight + 36 * hour);
+
+  // mondays at 16:00: today, at noon: next week
+  dadi::RotateByTimeStrategy monday4pm(duration_from_string("16:00:00"), 1);
+  monday4pm.setUtc();
+  BOOST_REQUIRE_EQUAL(monday4pm.getNextRotation(now), midnight + 16 * hour);
+  dadi::RotateByTimeStrategy mondayNoon(duration_from_string("12:00:00"), 1);
+  mondayNoon.setUtc();
+  BOOST_REQUIRE_EQUAL(mondayNoon.getNextRotation(now),
+                      midnight + (7 * 24 + 12) * hour);
+  // sundays at midnight
+  dadi::RotateByTimeStrategy sunday(duration_from_string("00:00:00"), 0);
+  sunday.setUtc();
+  BOOST_REQUIRE_EQUAL(sunday.getNextRotation(now), midnight + 6 * 24 * hour);
+}
+
+BOOST_AUTO_TEST_CASE(rotate_buffered_test) {
+  BOOST_TEST_MESSAGE("#Rotate with buffered lines test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const long lineSize = msgToLog.size() + 1;
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.log";
+
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("archive", "number");
+    myFileC->putAttr("rotate", "size");
+    myFileC->putAttr("rotate.size",
+                     boost::lexical_cast<std::string>(2 * lineSize));
+    myFileC->putAttr("flush", "never");
+
+    // archives get their buffered lines, even though nothing was flushed
+    for (unsigned int i = 0; i < 5; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+  }
+
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile.native() + ".0"), 2 * lineSize);
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile.native() + ".1"), 2 * lineSize);
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile), lineSize);
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".2"));
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(archive_compression_test) {
+  BOOST_TEST_MESSAGE("#Archive background compression test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const long lineSize = msgToLog.size() + 1;
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.log";
+
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("archive", "number");
+    myFileC->putAttr("archive.compression", "gzip");
+    myFileC->putAttr("archive.workers", "2");
+    myFileC->putAttr("rotate", "size");
+    myFileC->putAttr("rotate.size",
+                     boost::lexical_cast<std::string>(2 * lineSize));
+
+    for (unsigned int i = 0; i < 5; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+  }
+
+  // compressed archives replace plain ones
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".0.gz"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".1.gz"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".0"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".1"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".2.gz"));
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile), lineSize);
+  // no staging nor temporary file left behind
+  BOOST_REQUIRE_EQUAL(std::distance(bfs::directory_iterator(tmpDir),
+                                    bfs::directory_iterator()), 3);
+
+  {
+    boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+    in.push(boost::iostreams::gzip_decompressor());
+    in.push(boost::iostreams::file_source(tmpFile.native() + ".0.gz",
+                                          std::ios_base::binary));
+    std::stringstream content;
+    BOOST_REQUIRE_NO_THROW(boost::iostreams::copy(in, content));
+    BOOST_REQUIRE_EQUAL(content.str(), msgToLog + "\n" + msgToLog + "\n");
+  }
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(archive_generation_test) {
+  BOOST_TEST_MESSAGE("#Archive by generation test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const long lineSize = msgToLog.size() + 1;
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.log";
+
+  // archives left by a previous run
+  bfs::ofstream(tmpFile.native() + ".3") << MSGSTR;
+  bfs::ofstream(tmpFile.native() + ".7.gz") << MSGSTR;
+  bfs::ofstream(tmpFile.native() + "s") << MSGSTR;
+
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("archive", "generation");
+    myFileC->putAttr("archive.compression", "gzip");
+    myFileC->putAttr("archive.workers", "2");
+    myFileC->putAttr("rotate", "size");
+    myFileC->putAttr("rotate.size",
+                     boost::lexical_cast<std::string>(2 * lineSize));
+    myFileC->putAttr("purge", "count");
+    myFileC->putAttr("purge.count", "3");
+
+    for (unsigned int i = 0; i < 5; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+  }
+
+  // generations follow the newest existing one, oldest is purged
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".3"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".7.gz"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".8.gz"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".9.gz"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".0.gz"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + "s"));
+  BOOST_REQUIRE_EQUAL(bfs::file_size(tmpFile), lineSize);
+
+  dadi::ArchiveByGenerationStrategy strategy;
+  strategy.setSuffix(".gz");
+  bfs::ofstream(tmpFile) << MSGSTR;
+  BOOST_REQUIRE_EQUAL(strategy.archive(tmpFile.native()),
+                      tmpFile.native() + ".10");
+  BOOST_REQUIRE_EQUAL(strategy.getNextGeneration(), 11);
+  BOOST_REQUIRE(!strategy.hasRenamed());
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(purge_strategies_test) {
+  BOOST_TEST_MESSAGE("#Purge strategies test#");
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.log";
+  const std::string content(100, 'x');
+  std::time_t now = std::time(NULL);
+
+  // archives 0 (oldest) to 4 (newest), one hour apart
+  for (unsigned int i = 0; i < 5; ++i) {
+    const std::string& archive =
+      tmpFile.native() + "." + boost::lexical_cast<std::string>(i);
+    bfs::ofstream(archive) << content;
+    bfs::last_write_time(archive, now - (5 - i) * 3600);
+  }
+  bfs::ofstream(tmpFile.native() + ".5.gz.tmp") << content;
+  bfs::ofstream(tmpFile.native() + ".rotating.42") << content;
+  // unrelated file, older than any archive
+  bfs::ofstream(tmpFile.native() + ".foo") << content;
+  bfs::last_write_time(tmpFile.native() + ".foo", now - 24 * 3600);
+
+  dadi::ArchiveIndex index;
+  index.load(tmpFile.native());
+  BOOST_REQUIRE_EQUAL(index.getCount(), 5);
+  BOOST_REQUIRE_EQUAL(index.getTotalSize(), 500);
+  BOOST_REQUIRE_EQUAL(index.getOldest().path, tmpFile.native() + ".0");
+
+  // newest archives are kept
+  {
+    dadi::PurgeByAgeStrategy strategy(boost::posix_time::minutes(210));
+    strategy.purge(tmpFile.native());
+  }
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".0"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".1"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".2"));
+
+  {
+    dadi::PurgeBySizeStrategy strategy("250");
+    BOOST_REQUIRE_EQUAL(strategy.getMaxSize(), 250);
+    strategy.purge(tmpFile.native());
+    BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".2"));
+    BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".3"));
+
+    // new archives are indexed without scanning the directory again
+    bfs::ofstream(tmpFile.native() + ".6") << content;
+    strategy.add(tmpFile.native() + ".6");
+    strategy.purge(tmpFile.native());
+    BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".3"));
+    BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".4"));
+    BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".6"));
+  }
+  BOOST_REQUIRE_EQUAL(dadi::PurgeBySizeStrategy("2k").getMaxSize(), 2048);
+
+  {
+    dadi::PurgeByCountStrategy strategy(1);
+    strategy.purge(tmpFile.native());
+  }
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".4"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".6"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".5.gz.tmp"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".rotating.42"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".foo"));
+
+  // archives sharing a modification time are sorted by name
+  bfs::remove_all(tmpDir);
+  bfs::create_directory(tmpDir);
+  for (unsigned int i = 0; i < 3; ++i) {
+    const std::string& archive =
+      tmpFile.native() + "." + boost::lexical_cast<std::string>(i) + ".gz";
+    bfs::ofstream(archive) << content;
+    bfs::last_write_time(archive, now);
+  }
+  {
+    dadi::ArchiveByNumberStrategy archiver;
+    archiver.setSuffix(".gz");
+    dadi::PurgeByCountStrategy strategy(2);
+    strategy.setPattern(archiver.getPattern());
+    strategy.purge(tmpFile.native());
+  }
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".0.gz"));
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".1.gz"));
+  BOOST_REQUIRE(!bfs::exists(tmpFile.native() + ".2.gz"));
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(purge_by_size_channel_test) {
+  BOOST_TEST_MESSAGE("#Purge by size channel test#");
+
+  std::string source(SRCSTR);
+  std::string msgToLog(MSGSTR);
+  dadi::Message myMsg =
+    dadi::Message(source, msgToLog, dadi::Message::PRIO_DEBUG);
+  const long lineSize = msgToLog.size() + 1;
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.log";
+
+  {
+    FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+    myFileC->putAttr("archive", "timestamp");
+    myFileC->putAttr("rotate", "size");
+    myFileC->putAttr("rotate.size", boost::lexical_cast<std::string>(lineSize));
+    myFileC->putAttr("purge", "size");
+    myFileC->putAttr("purge.size",
+                     boost::lexical_cast<std::string>(2 * lineSize));
+    // not an archive, never purged
+    bfs::ofstream(tmpFile.native() + ".foo") << msgToLog;
+
+    for (unsigned int i = 0; i < 5; ++i) {
+      BOOST_REQUIRE_NO_THROW(myFileC->log(myMsg));
+    }
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+  }
+
+  // two archives fit, the log file is empty after the last rotation
+  unsigned int archives = 0;
+  bfs::directory_iterator it(tmpDir), end;
+  for (; it != end; ++it) {
+    if (it->path() != tmpFile && it->path().extension() != ".foo") {
+      ++archives;
+      BOOST_REQUIRE_EQUAL(bfs::file_size(it->path()), lineSize);
+    }
+  }
+  BOOST_REQUIRE_EQUAL(archives, 2);
+  BOOST_REQUIRE(bfs::exists(tmpFile.native() + ".foo"));
+  bfs::remove_all(tmpDir);
+
+  // bad purge size
+  bfs::create_directory(tmpDir);
+  FChannelPtr myFileC(new dadi::FileChannel(tmpFile.native()));
+  myFileC->putAttr("archive", "number");
+  myFileC->putAttr("purge", "size");
+  myFileC->putAttr("purge.size", "lots");
+  BOOST_REQUIRE_THROW(myFileC->open(), dadi::InvalidAttributeError);
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(compressor_test) {
+  BOOST_TEST_MESSAGE("#Compressor test#");
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+
+  BOOST_REQUIRE(dadi::Compressor::isAvailable(dadi::Compressor::FORMAT_GZIP));
+  BOOST_REQUIRE(!dadi::Compressor::isAvailable(dadi::Compressor::FORMAT_NONE));
+  BOOST_REQUIRE_EQUAL(
+    dadi::Compressor::getExtension(dadi::Compressor::FORMAT_BZIP2), ".bz2");
+
+  int format = dadi::Compressor::FORMAT_BZIP2;
+  if (dadi::Compressor::isAvailable(dadi::Compressor::FORMAT_ZSTD)) {
+    format = dadi::Compressor::FORMAT_ZSTD;
+  }
+
+  std::vector<std::string> done;
+  boost::mutex doneMutex;
+  {
+    dadi::Compressor compressor(format, dadi::Compressor::DEFAULT_LEVEL, 2);
+    for (unsigned int i = 0; i < 4; ++i) {
+      bfs::path file = tmpDir / ("file." + boost::lexical_cast<std::string>(i));
+      bfs::ofstream(file) << MSGSTR;
+      compressor.compress(file.native(), Recorder(done, doneMutex));
+    }
+    compressor.wait();
+    BOOST_REQUIRE_EQUAL(compressor.getPending(), 0);
+    BOOST_REQUIRE_EQUAL(done.size(), 4);
+  }
+
+  for (unsigned int i = 0; i < 4; ++i) {
+    bfs::path file = tmpDir / ("file." + boost::lexical_cast<std::string>(i));
+    BOOST_REQUIRE(!bfs::exists(file));
+    BOOST_REQUIRE(bfs::exists(file.native() +
+                              dadi::Compressor::getExtension(format)));
+  }
+  bfs::remove_all(tmpDir);
+}
+
+BOOST_AUTO_TEST_CASE(async_overflow_policies_test) {
+  BOOST_TEST_MESSAGE("#Async overflow policies test#");
+
+  std::vector<dadi::Message> received;
+  Collector consumer(received);
+  dadi::Message debug(SRCSTR, "debug", dadi::Message::PRIO_DEBUG);
+  dadi::Message info(SRCSTR, "info", dadi::Message::PRIO_INFORMATION);
+  dadi::Message error(SRCSTR, "error", dadi::Message::PRIO_ERROR);
+
+  // writer is not started yet so the queue fills up
+  {
+    dadi::MessageQueue queue(consumer, 2,
+                             dadi::MessageQueue::OVERFLOW_DROP_NEWEST);
+    BOOST_REQUIRE(queue.push(info));
+    BOOST_REQUIRE(queue.push(debug));
+    BOOST_REQUIRE(!queue.push(error));
+    BOOST_REQUIRE_EQUAL(queue.getDropped(), 1);
+    queue.start();
+    queue.stop();
+  }
+  BOOST_REQUIRE_EQUAL(received.size(), 2);
+  BOOST_REQUIRE_EQUAL(received[0].getText(), "info");
+  BOOST_REQUIRE_EQUAL(received[1].getText(), "debug");
+
+  received.clear();
+  {
+    dadi::MessageQueue queue(consumer, 2,
+                             dadi::MessageQueue::OVERFLOW_DROP_LOWEST);
+    BOOST_REQUIRE(queue.push(info));
+    BOOST_REQUIRE(queue.push(debug));
+    // evicts debug, error is enqueued
+    BOOST_REQUIRE(queue.push(error));
+    // lower than anything queued: dropped
+    BOOST_REQUIRE(!queue.push(debug));
+    BOOST_REQUIRE_EQUAL(queue.getDropped(), 1);
+    BOOST_REQUIRE_EQUAL(queue.getEvicted(), 1);
+    BOOST_REQUIRE_EQUAL(queue.getSize(), 2);
+    queue.start();
+    queue.flush();
+  }
+  BOOST_REQUIRE_EQUAL(received.size(), 2);
+  BOOST_REQUIRE_EQUAL(received[0].getText(), "info");
+  BOOST_REQUIRE_EQUAL(received[1].getText(), "error");
+
+  // evictions keep the push order of the remaining messages
+  received.clear();
+  {
+    dadi::MessageQueue queue(consumer, 3,
+                             dadi::MessageQueue::OVERFLOW_DROP_LOWEST);
+    dadi::Message debug2(SRCSTR, "debug2", dadi::Message::PRIO_DEBUG);
+    BOOST_REQUIRE(queue.push(debug));
+    BOOST_REQUIRE(queue.push(info));
+    BOOST_REQUIRE(queue.push(debug2));
+    BOOST_REQUIRE(queue.push(error));
+    BOOST_REQUIRE_EQUAL(queue.getEvicted(), 1);
+    queue.start();
+    queue.flush();
+  }
+  BOOST_REQUIRE_EQUAL(received.size(), 3);
+  BOOST_REQUIRE_EQUAL(received[0].getText(), "info");
+  BOOST_REQUIRE_EQUAL(received[1].getText(), "debug2");
+  BOOST_REQUIRE_EQUAL(received[2].getText(), "error");
+
+  // nothing drains a stopped queue
+  received.clear();
+  {
+    dadi::MessageQueue queue(consumer, 2,
+                             dadi::MessageQueue::OVERFLOW_BLOCK);
+    queue.start();
+    queue.stop();
+    BOOST_REQUIRE(!queue.push(info));
+    BOOST_REQUIRE_EQUAL(queue.getDropped(), 1);
+    BOOST_REQUIRE_EQUAL(queue.getSize(), 0);
+  }
+  BOOST_REQUIRE(received.empty());
+}
+
+BOOST_AUTO_TEST_CASE(binary_channel_test) {
+  BOOST_TEST_MESSAGE("#Binary file channel test#");
+
+  bfs::path tmpDir = bfs::temp_directory_path();
+  tmpDir /= "%%%%-%%%%-%%%%-%%%%";
+  tmpDir = bfs::unique_path(tmpDir);
+  bfs::create_directory(tmpDir);
+  bfs::path tmpFile = tmpDir / "tmpFile.bin";
+
+  std::vector<dadi::Message> logged;
+  {
+    FChannelPtr myFileC(new dadi::BinaryFileChannel(tmpFile.native()));
+    myFileC->putAttr("archive", "generation");
+    myFileC->putAttr("rotate", "size");
+    myFileC->putAttr("rotate.size", "256");
+
+    for (int i = 0; i < 20; ++i) {
+      dadi::Message msg((i % 2) ? SRCSTR : "Arthur", MSGSTR,
+                        dadi::Message::PRIO_WARNING, __FILE__, i);
+      if (i % 3) {
+        msg["knight"] = boost::lexical_cast<std::string>(i);
+      }
+      if (0 == i % 5) {
+        // copied filenames may reuse the address of a previous one
+        msg.setFile(std::string((i % 10) ? "grail" : "holy") + ".cc");
+      }
+      logged.push_back(msg);
+      BOOST_REQUIRE_NO_THROW(myFileC->log(msg));
+    }
+    BOOST_REQUIRE_NO_THROW(myFileC->close());
+  }
+
+  // every file decodes on its own
+  std::vector<std::string> files;
+  for (unsigned int i = 0; bfs::exists(tmpFile.native() + "." +
+                                       boost::lexical_cast<std::string>(i));
+       ++i) {
+    files.push_back(tmpFile.native() + "." +
+                    boost::lexical_cast<std::string>(i));
+  }
+  BOOST_REQUIRE(files.size() > 1);
+  files.push_back(tmpFile.native());
+
+  std::vector<dadi::Message> decoded;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    bfs::ifstream in(files[i], std::ios::binary);
+    dadi::BinaryLogReader reader(in);
+    dadi::Message msg;
+    while (reader.next(msg)) {
+      decoded.push_back(msg);
+    }
+    BOOST_REQUIRE(!reader.isTruncated());
+  }
+
+  BOOST_REQUIRE_EQUAL(decoded.size(), logged.size());
+  for (std::size_t i = 0; i < logged.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(decoded[i].getSource(), logged[i].getSource());
+    BOOST_REQUIRE_EQUAL(decoded[i].getText(), logged[i].getText());
+    BOOST_REQUIRE_EQUAL(decoded[i].getPriority(), logged[i].getPriority());
+    BOOST_REQUIRE_EQUAL(decoded[i].getTime().wall,
+                        logged[i].getTime().wall);
+    BOOST_REQUIRE_EQUAL(decoded[i].getFile(), logged[i].getFile());
+    BOOST_REQUIRE_EQUAL(decoded[i].getLine(), logged[i].getLine());
+    BOOST_REQUIRE(decoded[i].getTags() == logged[i].getTags());
+  }
+
+  // a crash while writing leaves a truncated record (the live file may
+  // only hold the preamble if the last message triggered a rotation)
+  bfs::resize_file(files[0], bfs::file_size(files[0]) - 1);
+  {
+    bfs::ifstream in(files[0], std::ios::binary);
+    dadi::BinaryLogReader reader(in);
+    dadi::Message msg;
+    while (reader.next(msg)) {}
+    BOOST_REQUIRE(reader.isTruncated());
+  }
+
+  // text files are rejected
+  bfs::ofstream(tmpFile) << MSGSTR;
+  {
+    bfs::ifstream in(tmpFile, std::ios::binary);
+    dadi::BinaryLogReader reader(in);
+    dadi::Message msg;
+    BOOST_REQUIRE_THROW(reader.next(msg), dadi::Error);
+  }
+
+  bfs::remove_all(tmpDir);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 // THE END
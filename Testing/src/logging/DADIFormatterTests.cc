@@ -0,0 +1,91 @@
+/**
+ * @file DADIFormatterTests.cc
+ * @brief This file implements the libdadi tests for message formatter
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ */
+
+#include <sstream>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "dadi/Logging/ConsoleChannel.hh"
+#include "dadi/Logging/Formatter.hh"
+#include "dadi/Logging/Message.hh"
+
+namespace {
+/* 2011-03-14 15:09:26.535897932 UTC */
+dadi::Timestamp
+piDay() {
+  dadi::Timestamp ts;
+  ts.wall = 1300115366535897932LL;
+  ts.monotonic = 42;
+  return ts;
+}
+
+std::string
+render(const std::string& pattern, const dadi::Message& msg) {
+  std::string out;
+  dadi::Formatter(pattern).format(msg, out);
+  return out;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(FormatterTests)
+
+BOOST_AUTO_TEST_CASE(default_pattern_test) {
+  BOOST_TEST_MESSAGE("#Default pattern test#");
+  dadi::Formatter formatter;
+  BOOST_REQUIRE_EQUAL(formatter.getPattern(), "%m");
+  BOOST_REQUIRE(formatter.isTextOnly());
+
+  formatter.setPattern("%m!");
+  BOOST_REQUIRE(!formatter.isTextOnly());
+}
+
+BOOST_AUTO_TEST_CASE(conversions_test) {
+  BOOST_TEST_MESSAGE("#Pattern conversions test#");
+  dadi::Message msg("Knights", "Ni!", dadi::Message::PRIO_WARNING,
+                    "shrubbery.cc", 42);
+  msg.setTime(piDay());
+  msg["quest"] = "grail";
+
+  BOOST_REQUIRE_EQUAL(render("%T %p [%s] %m (%f:%l)", msg),
+                      "2011-03-14 15:09:26.535897 WARNING [Knights] Ni! "
+                      "(shrubbery.cc:42)");
+  BOOST_REQUIRE_EQUAL(render("%t|%N", msg), "1300115366|42");
+  BOOST_REQUIRE_EQUAL(render("%X{quest}/%X{colour}", msg), "grail/");
+  // literals, escaped and unknown conversions
+  BOOST_REQUIRE_EQUAL(render("100%% %q %X{x %", msg), "100% %q %X{x %");
+  BOOST_REQUIRE_EQUAL(render("", msg), "");
+}
+
+BOOST_AUTO_TEST_CASE(append_test) {
+  BOOST_TEST_MESSAGE("#Formatter appends to buffer test#");
+  dadi::Message msg("", "Ni!", dadi::Message::PRIO_DEBUG);
+  dadi::Formatter formatter("<%p>%m");
+
+  std::string out("Knights: ");
+  formatter.format(msg, out);
+  formatter.format(msg, out);
+  BOOST_REQUIRE_EQUAL(out, "Knights: <DEBUG>Ni!<DEBUG>Ni!");
+}
+
+BOOST_AUTO_TEST_CASE(channel_pattern_test) {
+  BOOST_TEST_MESSAGE("#Channel pattern attribute test#");
+  std::stringstream oss;
+  dadi::ConsoleChannel channel(oss);
+  dadi::Message msg("Arthur", "Ni!", dadi::Message::PRIO_ERROR);
+
+  channel.log(msg);
+  BOOST_REQUIRE_EQUAL(oss.str(), "Ni!\n");
+
+  channel.putAttr("pattern", "%p [%s] %m");
+  channel.open();
+  channel.log(msg);
+  BOOST_REQUIRE_EQUAL(oss.str(), "Ni!\nERROR [Arthur] Ni!\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// THE END
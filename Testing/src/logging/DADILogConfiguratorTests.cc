@@ -0,0 +1,192 @@
+/**
+ * @file DADILogConfiguratorTests.cc
+ * @brief This file implements the libdadi tests for logging configuration
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ */
+
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include "dadi/Logging/LogConfigurator.hh"
+#include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Config.hh"
+#include "dadi/Exception/All.hh"
+
+namespace bfs = boost::filesystem;  // an alias for boost filesystem namespace
+namespace {
+// temporary directory removed at the end of the test
+struct TempDir {
+  TempDir() : path(bfs::temp_directory_path() / bfs::unique_path()) {
+    bfs::create_directory(path);
+  }
+
+  ~TempDir() {
+    bfs::remove_all(path);
+  }
+
+  std::string
+  file(const std::string& name) const {
+    return (path / name).string();
+  }
+
+  bfs::path path;
+};
+
+// logger names contain dots: use another path separator
+dadi::ConfigStore::path_type
+key(const std::string& path) {
+  return dadi::ConfigStore::path_type(path, '/');
+}
+
+std::string
+readFile(const std::string& path) {
+  bfs::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  return line;
+}
+
+// replace a file the way editors do
+void
+writeFile(const TempDir& dir, const std::string& name,
+          const std::string& content) {
+  bfs::ofstream(dir.path / "tmp") << content;
+  bfs::rename(dir.path / "tmp", dir.path / name);
+}
+
+bool
+waitGeneration(const dadi::LogConfigurator& configurator,
+               unsigned long generation) {
+  for (int i = 0; i < 500; ++i) {
+    if (configurator.getGeneration() >= generation) {
+      return true;
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  }
+  return false;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(LogConfiguratorTests)
+
+BOOST_AUTO_TEST_CASE(configure_test) {
+  BOOST_TEST_MESSAGE("#Logging configuration diff test#");
+  TempDir dir;
+  dadi::ConfigStore section;
+  section.put("channels.main.type", "file");
+  section.put("channels.main.path", dir.file("main.log"));
+  section.put("channels.main.pattern", "%p: %m");
+  section.put("channels.quiet.type", "null");
+  section.put(key("loggers/conf/level"), "debug");
+  section.put(key("loggers/conf/channel"), "main");
+  section.put(key("loggers/conf.child/level"), "error");
+  section.put(key("loggers/conf.child/channel"), "quiet");
+
+  dadi::LogConfigurator configurator;
+  configurator.configure(section);
+  BOOST_REQUIRE_EQUAL(configurator.getGeneration(), 1U);
+  dadi::LoggerPtr parent = dadi::Logger::getLogger("conf");
+  dadi::LoggerPtr child = dadi::Logger::getLogger("conf.child");
+  dadi::ChannelPtr main = configurator.getChannel("main");
+  dadi::ChannelPtr quiet = configurator.getChannel("quiet");
+  BOOST_REQUIRE(main);
+  BOOST_REQUIRE_EQUAL(parent->getChannel(), main);
+  BOOST_REQUIRE_EQUAL(parent->getLevel(), dadi::Message::PRIO_DEBUG);
+  BOOST_REQUIRE_EQUAL(child->getChannel(), quiet);
+  BOOST_REQUIRE_EQUAL(child->getLevel(), dadi::Message::PRIO_ERROR);
+
+  parent->log(dadi::Message("conf", "spam", dadi::Message::PRIO_DEBUG));
+  parent->flush();
+  BOOST_REQUIRE_EQUAL(readFile(dir.file("main.log")), "DEBUG: spam");
+
+  // unchanged channels are kept
+  configurator.configure(section);
+  BOOST_REQUIRE_EQUAL(configurator.getChannel("main"), main);
+  BOOST_REQUIRE_EQUAL(configurator.getChannel("quiet"), quiet);
+
+  // only the modified channel is replaced, dropped values are inherited
+  section.put("channels.main.pattern", "%m");
+  section.get_child("loggers").erase("conf.child");
+  configurator.configure(section);
+  BOOST_REQUIRE(configurator.getChannel("main") != main);
+  BOOST_REQUIRE_EQUAL(configurator.getChannel("quiet"), quiet);
+  BOOST_REQUIRE_EQUAL(child->getChannel(), configurator.getChannel("main"));
+  BOOST_REQUIRE_EQUAL(child->getLevel(), dadi::Message::PRIO_DEBUG);
+
+  // an invalid section changes nothing
+  dadi::ConfigStore invalid(section);
+  invalid.put(key("loggers/conf/channel"), "nowhere");
+  BOOST_REQUIRE_THROW(configurator.configure(invalid),
+                      dadi::InvalidParameterError);
+  invalid = section;
+  invalid.put("channels.main.type", "carrier pigeon");
+  BOOST_REQUIRE_THROW(configurator.configure(invalid),
+                      dadi::InvalidParameterError);
+  invalid = section;
+  invalid.put(key("loggers/conf/level"), "verbose");
+  BOOST_REQUIRE_THROW(configurator.configure(invalid),
+                      dadi::InvalidParameterError);
+  BOOST_REQUIRE_EQUAL(configurator.getGeneration(), 3U);
+  BOOST_REQUIRE_EQUAL(parent->getChannel(), configurator.getChannel("main"));
+  BOOST_REQUIRE_EQUAL(parent->getLevel(), dadi::Message::PRIO_DEBUG);
+
+  // an empty section hands loggers back to their ancestors
+  configurator.configure(dadi::ConfigStore());
+  BOOST_REQUIRE_EQUAL(parent->getChannel(),
+                      dadi::Logger::getRootLogger()->getChannel());
+  BOOST_REQUIRE_EQUAL(parent->getLevel(),
+                      dadi::Logger::getRootLogger()->getLevel());
+}
+
+BOOST_AUTO_TEST_CASE(watch_test) {
+  BOOST_TEST_MESSAGE("#Logging configuration file watching test#");
+  TempDir dir;
+  const std::string conf = dir.file("logging.info");
+  const std::string channels =
+    "logging { channels { main { type file\npath \"" +
+    dir.file("watch.log") + "\" } }\n";
+  writeFile(dir, "logging.info", channels +
+            "loggers { watched { level warning\nchannel main } } }\n");
+
+  dadi::Config::instance().put("watch_test.kept", "yes");
+  dadi::LogConfigurator configurator;
+  configurator.watch(conf);
+  dadi::LoggerPtr logger = dadi::Logger::getLogger("watched");
+  dadi::ChannelPtr main = configurator.getChannel("main");
+  BOOST_REQUIRE_EQUAL(logger->getLevel(), dadi::Message::PRIO_WARNING);
+  BOOST_REQUIRE_EQUAL(logger->getChannel(), main);
+
+  writeFile(dir, "logging.info", channels +
+            "loggers { watched { level error\nchannel main } } }\n");
+  BOOST_REQUIRE(waitGeneration(configurator, 2));
+  BOOST_REQUIRE_EQUAL(logger->getLevel(), dadi::Message::PRIO_ERROR);
+  BOOST_REQUIRE_EQUAL(logger->getChannel(), main);
+  // the Config store is left alone
+  BOOST_REQUIRE_EQUAL(
+    dadi::Config::instance().get<std::string>("watch_test.kept"), "yes");
+
+  // other files of the directory are ignored, a broken file is not applied
+  bfs::ofstream(dir.path / "other.info") << "logging { }\n";
+  writeFile(dir, "logging.info", "logging { loggers {\n");
+  boost::this_thread::sleep(boost::posix_time::milliseconds(500));
+  BOOST_REQUIRE_EQUAL(configurator.getGeneration(), 2U);
+  BOOST_REQUIRE_EQUAL(logger->getLevel(), dadi::Message::PRIO_ERROR);
+
+  configurator.unwatch();
+  writeFile(dir, "logging.info", channels +
+            "loggers { watched { level debug } } }\n");
+  boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+  BOOST_REQUIRE_EQUAL(configurator.getGeneration(), 2U);
+
+  BOOST_REQUIRE_THROW(configurator.watch(dir.file("missing.info")),
+                      dadi::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// THE END
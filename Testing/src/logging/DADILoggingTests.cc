@@ -7,15 +7,19 @@
  *  |LICENSE|
  */
 
+#include <unistd.h>
 #include <iostream>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/test/unit_test.hpp>
 #include "dadi/Logging/ConsoleChannel.hh"
 #include "dadi/Logging/FileChannel.hh"
 #include "dadi/Logging/NullChannel.hh"
 #include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Macros.hh"
 #include "dadi/Logging/Message.hh"
 #include "dadi/Config.hh"
 #include "dadi/Options.hh"
@@ -367,6 +371,28 @@ BOOST_AUTO_TEST_CASE(destroy_Logger_normal_call) {
   BOOST_REQUIRE(!dadi::Logger::hasLogger("destroy_logger_normal"));
 }
 
+BOOST_AUTO_TEST_CASE(destroy_Logger_released_call) {
+  BOOST_TEST_MESSAGE("#Destroy Logger released call#");
+  // lookups of many new loggers, some of them not published yet
+  for (int i = 0; i < 100; ++i) {
+    const std::string name =
+      "destroy_logger_released." + boost::lexical_cast<std::string>(i);
+    dadi::Logger::getLogger(name);
+    BOOST_REQUIRE(dadi::Logger::hasLogger(name));
+    BOOST_REQUIRE(dadi::Logger::getLogger(name));
+  }
+
+  boost::weak_ptr<dadi::Logger> weak =
+    dadi::Logger::getLogger("destroy_logger_released.0");
+  for (int i = 0; i < 100; ++i) {
+    dadi::Logger::destroyLogger(
+      "destroy_logger_released." + boost::lexical_cast<std::string>(i));
+  }
+  // snapshots cached by threads do not keep it alive
+  BOOST_REQUIRE(weak.expired());
+  BOOST_REQUIRE(!dadi::Logger::hasLogger("destroy_logger_released.0"));
+}
+
 BOOST_AUTO_TEST_CASE(shutdown_normal_call) {
   BOOST_TEST_MESSAGE("#Shutdown normal call#");
   std::stringstream oss;
@@ -438,6 +464,61 @@ BOOST_AUTO_TEST_CASE(log_on_console_normal_call) {
   BOOST_REQUIRE_EQUAL(oss.str().compare(msgToLog + "\n"), 0);
 }
 
+namespace {
+void
+logMany(dadi::ChannelPtr channel, const dadi::Message& msg, int count) {
+  for (int i = 0; i < count; ++i) {
+    channel->log(msg);
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE(log_on_console_fd_call) {
+  BOOST_TEST_MESSAGE("#ConsoleChannel test on a file descriptor#");
+  const std::string msgToLog(200, 'x');
+  dadi::Message msg("", msgToLog, dadi::Message::PRIO_WARNING);
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+  dadi::ChannelPtr cc1(
+    new dadi::ConsoleChannel(fds[1], dadi::ConsoleChannel::COLOR_ALWAYS));
+
+  // lines written concurrently are never interleaved
+  boost::thread_group writers;
+  for (int i = 0; i < 4; ++i) {
+    writers.create_thread(boost::bind(&logMany, cc1, msg, 25));
+  }
+  std::string content;
+  const std::string line = "\033[33m" + msgToLog + "\033[0m\n";
+  char buf[4096];
+  while (content.size() < 100 * line.size()) {
+    ssize_t n = ::read(fds[0], buf, sizeof(buf));
+    BOOST_REQUIRE(n > 0);
+    content.append(buf, n);
+  }
+  writers.join_all();
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  BOOST_REQUIRE_EQUAL(content.size(), 100 * line.size());
+  for (std::size_t pos = 0; pos < content.size(); pos += line.size()) {
+    BOOST_REQUIRE_EQUAL(content.compare(pos, line.size(), line), 0);
+  }
+
+  // colours are optional, not used by default
+  std::stringstream oss;
+  dadi::ConsoleChannel cc2(oss);
+  cc2.putAttr("color", "auto");
+  cc2.open();
+  BOOST_REQUIRE(!cc2.isColored());
+  cc2.log(msg);
+  BOOST_REQUIRE_EQUAL(oss.str(), msgToLog + "\n");
+  cc2.setColor(dadi::ConsoleChannel::COLOR_ALWAYS);
+  cc2.log(dadi::Message("", "error", dadi::Message::PRIO_ERROR));
+  BOOST_REQUIRE_EQUAL(oss.str(),
+                      msgToLog + "\n\033[31merror\033[0m\n");
+}
+
 BOOST_AUTO_TEST_CASE(get_with_parent_call) {
   BOOST_TEST_MESSAGE("#get with parent test#");
   std::stringstream oss;
@@ -456,6 +537,390 @@ BOOST_AUTO_TEST_CASE(get_with_parent_call) {
   BOOST_REQUIRE(mylogger3);
 }
 
+BOOST_AUTO_TEST_CASE(inherit_from_ancestors_call) {
+  BOOST_TEST_MESSAGE("#inherit level and channel from ancestors test#");
+  dadi::LoggerPtr parent = dadi::Logger::getLogger("inherit");
+  dadi::LoggerPtr child = dadi::Logger::getLogger("inherit.child");
+  dadi::LoggerPtr grandChild =
+    dadi::Logger::getLogger("inherit.child.grand");
+  dadi::LoggerPtr other = dadi::Logger::getLogger("inheritor");
+
+  // the whole subtree follows, existing loggers included
+  std::stringstream oss;
+  dadi::ChannelPtr cc1(new dadi::ConsoleChannel(oss));
+  parent->setChannel(cc1);
+  parent->setLevel(dadi::Message::PRIO_DEBUG);
+  BOOST_REQUIRE_EQUAL(grandChild->getLevel(), dadi::Message::PRIO_DEBUG);
+  BOOST_REQUIRE(grandChild->getChannel() == cc1);
+  BOOST_REQUIRE(!other->getChannel());
+  BOOST_REQUIRE_EQUAL(other->getLevel(), dadi::Message::PRIO_INFORMATION);
+
+  // explicit settings stop inheritance
+  child->setLevel(dadi::Message::PRIO_ERROR);
+  parent->setLevel(dadi::Message::PRIO_TRACE);
+  BOOST_REQUIRE_EQUAL(child->getLevel(), dadi::Message::PRIO_ERROR);
+  BOOST_REQUIRE_EQUAL(grandChild->getLevel(), dadi::Message::PRIO_ERROR);
+  child->resetLevel();
+  BOOST_REQUIRE_EQUAL(grandChild->getLevel(), dadi::Message::PRIO_TRACE);
+
+  // a logger created in between takes over its descendants
+  dadi::ChannelPtr cc2(new dadi::ConsoleChannel(oss));
+  dadi::LoggerPtr middle =
+    dadi::Logger::createLogger("inherit.child.grand.middle", cc2,
+                               dadi::Message::PRIO_WARNING);
+  dadi::LoggerPtr leaf =
+    dadi::Logger::getLogger("inherit.child.grand.middle.leaf");
+  BOOST_REQUIRE(leaf->getChannel() == cc2);
+  dadi::Logger::destroyLogger("inherit.child.grand.middle");
+  BOOST_REQUIRE(leaf->getChannel() == cc1);
+  BOOST_REQUIRE_EQUAL(leaf->getLevel(), dadi::Message::PRIO_TRACE);
+
+  // messages go through the new channel
+  DADI_LOG_INFORMATION(leaf, "ni");
+  BOOST_REQUIRE_EQUAL(oss.str(), "ni\n");
+}
+
+namespace {
+// counts channels destroyed while a thread is logging through them
+class BusyChannel : public dadi::Channel {
+public:
+  explicit BusyChannel(boost::atomic<int>& violations)
+    : violations_(violations), inside_(0) {}
+
+  ~BusyChannel() {
+    if (inside_.load()) {
+      ++violations_;
+    }
+  }
+
+  void
+  log(const dadi::Message& msg) {
+    ++inside_;
+    boost::this_thread::yield();
+    --inside_;
+  }
+
+private:
+  boost::atomic<int>& violations_;
+  boost::atomic<int> inside_;
+};
+
+void
+logMessages(dadi::LoggerPtr logger, unsigned int count) {
+  dadi::Message msg("replace_channel", "ni", dadi::Message::PRIO_INFORMATION);
+  for (unsigned int i = 0; i < count; ++i) {
+    logger->log(msg);
+  }
+}
+}
+
+BOOST_AUTO_TEST_CASE(replace_channel_call) {
+  BOOST_TEST_MESSAGE("#replace channel while logging test#");
+  boost::atomic<int> violations(0);
+  dadi::LoggerPtr logger = dadi::Logger::getLogger("replace_channel");
+  logger->setLevel(dadi::Message::PRIO_INFORMATION);
+
+  // replaced channels are released at once
+  dadi::ChannelPtr channel(new BusyChannel(violations));
+  boost::weak_ptr<dadi::Channel> previous(channel);
+  logger->setChannel(channel);
+  channel.reset();
+  logger->setChannel(dadi::ChannelPtr(new BusyChannel(violations)));
+  BOOST_REQUIRE(previous.expired());
+
+  // but not while threads log through them
+  boost::thread_group threads;
+  for (unsigned int i = 0; i < 4; ++i) {
+    threads.create_thread(boost::bind(&logMessages, logger, 20000));
+  }
+  for (unsigned int i = 0; i < 200; ++i) {
+    logger->setChannel(dadi::ChannelPtr(new BusyChannel(violations)));
+  }
+  threads.join_all();
+  logger->setChannel(dadi::ChannelPtr());
+  BOOST_REQUIRE_EQUAL(violations.load(), 0);
+}
+
+namespace {
+// looks a logger up from log(), once released
+class LookupChannel : public dadi::Channel {
+public:
+  LookupChannel() : entered_(false), released_(false) {}
+
+  void
+  log(const dadi::Message& msg) {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      entered_ = true;
+      cond_.notify_all();
+      while (!released_) {
+        cond_.wait(lock);
+      }
+    }
+    dadi::Logger::getLogger("replace_subtree.lookup");
+  }
+
+  void
+  waitEntered() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (!entered_) {
+      cond_.wait(lock);
+    }
+  }
+
+  void
+  release() {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    released_ = true;
+    cond_.notify_all();
+  }
+
+private:
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  bool entered_;
+  bool released_;
+};
+
+void
+setLoggerChannel(dadi::LoggerPtr logger, dadi::ChannelPtr channel) {
+  logger->setChannel(channel);
+}
+}
+
+BOOST_AUTO_TEST_CASE(replace_subtree_channel_call) {
+  BOOST_TEST_MESSAGE("#replace the channel of a subtree while logging test#");
+  boost::atomic<int> violations(0);
+  dadi::LoggerPtr parent = dadi::Logger::getLogger("replace_subtree");
+  parent->setLevel(dadi::Message::PRIO_INFORMATION);
+  std::vector<dadi::LoggerPtr> children;
+  for (int i = 0; i < 4; ++i) {
+    children.push_back(dadi::Logger::getLogger(
+                         "replace_subtree.child" +
+                         boost::lexical_cast<std::string>(i)));
+  }
+
+  boost::shared_ptr<LookupChannel> lookup(new LookupChannel);
+  boost::weak_ptr<dadi::Channel> previous(lookup);
+  parent->setChannel(lookup);
+  BOOST_REQUIRE(children[3]->getChannel() == lookup);
+
+  // a thread logs through the channel being replaced, and looks a logger up
+  // meanwhile: replacing does not wait with the hierarchy locked
+  boost::thread logging(boost::bind(&logMessages, children[0], 1));
+  lookup->waitEntered();
+  dadi::ChannelPtr channel(new BusyChannel(violations));
+  boost::thread replacing(boost::bind(&setLoggerChannel, parent, channel));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+  lookup->release();
+  BOOST_REQUIRE(logging.timed_join(boost::posix_time::seconds(5)));
+  BOOST_REQUIRE(replacing.timed_join(boost::posix_time::seconds(5)));
+
+  lookup.reset();
+  BOOST_REQUIRE(previous.expired());
+  for (std::size_t i = 0; i < children.size(); ++i) {
+    BOOST_REQUIRE(children[i]->getChannel() == channel);
+  }
+  parent->setChannel(dadi::ChannelPtr());
+  BOOST_REQUIRE_EQUAL(violations.load(), 0);
+}
+
+namespace {
+// increments a counter each time it is streamed
+struct Counted {
+  explicit Counted(int& count) : count_(count) {}
+  int& count_;
+};
+
+std::ostream&
+operator<<(std::ostream& os, const Counted& c) {
+  return os << ++c.count_;
+}
+
+// keeps a copy of the last logged message
+class LastMessageChannel : public dadi::Channel {
+public:
+  void
+  log(const dadi::Message& msg) {
+    last_ = msg;
+  }
+
+  dadi::Message last_;
+};
+
+// keeps a copy of every logged message
+class MessagesChannel : public dadi::Channel {
+public:
+  void
+  log(const dadi::Message& msg) {
+    messages_.push_back(msg);
+  }
+
+  std::vector<dadi::Message> messages_;
+};
+}
+
+BOOST_AUTO_TEST_CASE(log_macros_normal_call) {
+  BOOST_TEST_MESSAGE("#Log macros normal call#");
+  int count(0);
+  boost::shared_ptr<LastMessageChannel> channel(new LastMessageChannel);
+  dadi::LoggerPtr mylogger1 = dadi::Logger::getLogger("log_macros_normal");
+  BOOST_REQUIRE(mylogger1);
+  mylogger1->setChannel(channel);
+  mylogger1->setLevel(dadi::Message::PRIO_INFORMATION);
+
+  // below threshold: expression must not be evaluated
+  DADI_LOG_DEBUG(mylogger1, "count: " << Counted(count));
+  BOOST_REQUIRE_EQUAL(count, 0);
+  BOOST_REQUIRE(channel->last_.getText().empty());
+
+  int line = __LINE__ + 1;
+  DADI_LOG_WARNING(mylogger1, "count: " << Counted(count));
+  BOOST_REQUIRE_EQUAL(count, 1);
+  BOOST_REQUIRE_EQUAL(channel->last_.getText(), "count: 1");
+  BOOST_REQUIRE_EQUAL(channel->last_.getSource(), "log_macros_normal");
+  BOOST_REQUIRE_EQUAL(channel->last_.getPriority(),
+                      dadi::Message::PRIO_WARNING);
+  BOOST_REQUIRE_EQUAL(channel->last_.getFile(), __FILE__);
+  BOOST_REQUIRE_EQUAL(channel->last_.getLine(), line);
+
+  // logger and priority are evaluated once
+  int evaluated(0);
+  DADI_LOG((++evaluated, mylogger1),
+           (++evaluated, dadi::Message::PRIO_ERROR), "once");
+  BOOST_REQUIRE_EQUAL(evaluated, 2);
+  BOOST_REQUIRE_EQUAL(channel->last_.getText(), "once");
+  DADI_LOG_LIMITED((++evaluated, mylogger1),
+                   (++evaluated, dadi::Message::PRIO_ERROR), 10, 1, "limited");
+  BOOST_REQUIRE_EQUAL(evaluated, 4);
+  BOOST_REQUIRE_EQUAL(channel->last_.getText(), "limited");
+}
+
+BOOST_AUTO_TEST_CASE(log_sampling_call) {
+  BOOST_TEST_MESSAGE("#Log sampling call#");
+  int count(0);
+  boost::shared_ptr<MessagesChannel> channel(new MessagesChannel);
+  dadi::LoggerPtr mylogger1 = dadi::Logger::getLogger("log_sampling");
+  mylogger1->setChannel(channel);
+  mylogger1->setLevel(dadi::Message::PRIO_DEBUG);
+  mylogger1->setSummaryPeriod(3600000);
+  mylogger1->setSampling(dadi::Message::PRIO_DEBUG, 4);
+  BOOST_REQUIRE_EQUAL(mylogger1->getSampling(dadi::Message::PRIO_DEBUG), 4U);
+  BOOST_REQUIRE_EQUAL(mylogger1->getSampling(dadi::Message::PRIO_ERROR), 1U);
+
+  // suppressed messages are not built
+  for (int i = 0; i < 20; ++i) {
+    DADI_LOG_DEBUG(mylogger1, Counted(count));
+  }
+  DADI_LOG_ERROR(mylogger1, "not sampled");
+  BOOST_REQUIRE_EQUAL(count, 5);
+
+  // one summary per period, logged before the next message going through
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 7U);
+  BOOST_REQUIRE_EQUAL(channel->messages_[0].getText(), "1");
+  BOOST_REQUIRE_EQUAL(channel->messages_[1].getText(),
+                      "suppressed 3 messages");
+  BOOST_REQUIRE_EQUAL(channel->messages_[1].getSource(), "log_sampling");
+  BOOST_REQUIRE_EQUAL(channel->messages_[2].getText(), "2");
+  BOOST_REQUIRE_EQUAL(channel->messages_[6].getText(), "not sampled");
+
+  mylogger1->setSampling(dadi::Message::PRIO_DEBUG, 0);
+  DADI_LOG_DEBUG(mylogger1, Counted(count));
+  BOOST_REQUIRE_EQUAL(count, 6);
+}
+
+BOOST_AUTO_TEST_CASE(log_rate_limit_call) {
+  BOOST_TEST_MESSAGE("#Log rate limit call#");
+  int count(0);
+  boost::shared_ptr<MessagesChannel> channel(new MessagesChannel);
+  dadi::LoggerPtr mylogger1 = dadi::Logger::getLogger("log_rate_limit");
+  mylogger1->setChannel(channel);
+  mylogger1->setLevel(dadi::Message::PRIO_INFORMATION);
+
+  // a burst of 3, then one message every 1000 seconds
+  mylogger1->setRateLimit(0.001, 3);
+  for (int i = 0; i < 10; ++i) {
+    DADI_LOG_WARNING(mylogger1, Counted(count));
+    mylogger1->log(dadi::Message("log_rate_limit", "direct",
+                                 dadi::Message::PRIO_WARNING));
+  }
+  BOOST_REQUIRE_EQUAL(count, 2);
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 3U);
+
+  // call sites have their own limit
+  mylogger1->setRateLimit(0);
+  channel->messages_.clear();
+  int line = __LINE__ + 2;
+  for (int i = 0; i < 10; ++i) {
+    DADI_LOG_LIMITED(mylogger1, dadi::Message::PRIO_ERROR, 0.001, 2, "site");
+  }
+  // the first message going through reports what the logger suppressed,
+  // at the highest priority suppressed
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 3U);
+  BOOST_REQUIRE_EQUAL(channel->messages_[0].getText(),
+                      "suppressed 17 messages");
+  BOOST_REQUIRE_EQUAL(channel->messages_[0].getPriority(),
+                      dadi::Message::PRIO_WARNING);
+  BOOST_REQUIRE_EQUAL(channel->messages_[2].getText(), "site");
+  BOOST_REQUIRE_EQUAL(channel->messages_[2].getLine(), line);
+
+  // nothing goes through anymore: flush() reports the call site
+  mylogger1->flush();
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 4U);
+  BOOST_REQUIRE_EQUAL(channel->messages_[3].getText(),
+                      "suppressed 8 messages");
+  BOOST_REQUIRE_EQUAL(channel->messages_[3].getPriority(),
+                      dadi::Message::PRIO_ERROR);
+  BOOST_REQUIRE_EQUAL(channel->messages_[3].getLine(), line);
+  mylogger1->flush();
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 4U);
+
+  // suppressed errors are not reported as information
+  dadi::LoggerPtr mylogger2 = dadi::Logger::getLogger("log_rate_limit.storm");
+  mylogger2->setSummaryPeriod(0);
+  mylogger2->setRateLimit(0.001, 1);
+  channel->messages_.clear();
+  DADI_LOG_INFORMATION(mylogger2, "first");
+  for (int i = 0; i < 5; ++i) {
+    DADI_LOG_ERROR(mylogger2, "storm");
+  }
+  DADI_LOG_DEBUG(mylogger2, "below level");
+  mylogger2->setRateLimit(1000, 1);
+  DADI_LOG_INFORMATION(mylogger2, "next");
+  BOOST_REQUIRE_EQUAL(channel->messages_.size(), 3U);
+  BOOST_REQUIRE_EQUAL(channel->messages_[1].getText(),
+                      "suppressed 5 messages");
+  BOOST_REQUIRE_EQUAL(channel->messages_[1].getPriority(),
+                      dadi::Message::PRIO_ERROR);
+  BOOST_REQUIRE_EQUAL(channel->messages_[1].getLine(), 0);
+  BOOST_REQUIRE_EQUAL(channel->messages_[2].getText(), "next");
+}
+
+BOOST_AUTO_TEST_CASE(log_limits_config_call) {
+  BOOST_TEST_MESSAGE("#Log limits from config call#");
+  dadi::Config& config = dadi::Config::instance();
+  config.put("test.loggers.log_limits_config.rate", 100);
+  config.put("test.loggers.log_limits_config.burst", 10);
+  config.put("test.loggers.log_limits_config.sampling.Debug", 10);
+  config.put("test.loggers.log_limits_config.sampling.trace", 100);
+  dadi::Logger::loadConfig("test.loggers");
+
+  dadi::LoggerPtr mylogger1 = dadi::Logger::getLogger("log_limits_config");
+  BOOST_REQUIRE_EQUAL(mylogger1->getSampling(dadi::Message::PRIO_DEBUG), 10U);
+  BOOST_REQUIRE_EQUAL(mylogger1->getSampling(dadi::Message::PRIO_TRACE),
+                      100U);
+
+  config.put("test.loggers.log_limits_config.sampling.verbose", 10);
+  BOOST_REQUIRE_THROW(dadi::Logger::loadConfig("test.loggers"),
+                      dadi::InvalidParameterError);
+  config.put("test.loggers.log_limits_config.sampling.verbose", "often");
+  BOOST_REQUIRE_THROW(dadi::Logger::loadConfig("test.loggers"),
+                      dadi::InvalidParameterError);
+  // missing keys are ignored
+  BOOST_REQUIRE_NO_THROW(dadi::Logger::loadConfig("nowhere"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
+
 // THE END
@@ -0,0 +1,173 @@
+/**
+ * @file DADIMappedRingChannelTests.cc
+ * @brief This file implements the libdadi tests for memory-mapped ring channel
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include "dadi/Logging/MappedRingChannel.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Exception/All.hh"
+
+namespace bfs = boost::filesystem;  // an alias for boost filesystem namespace
+namespace {
+// ring file removed at the end of the test
+struct RingFile {
+  RingFile()
+    : path((bfs::temp_directory_path() / bfs::unique_path()).string()) {}
+
+  ~RingFile() {
+    bfs::remove(path);
+  }
+
+  std::vector<std::string>
+  read() const {
+    dadi::MappedRingReader reader(path);
+    std::vector<std::string> records;
+    std::string record;
+    while (reader.next(record)) {
+      records.push_back(record);
+    }
+    return records;
+  }
+
+  std::string path;
+};
+
+void
+logRange(dadi::Channel& channel, unsigned int first, unsigned int last) {
+  for (unsigned int i = first; i < last; ++i) {
+    channel.log(dadi::Message("Tim", boost::lexical_cast<std::string>(i),
+                              dadi::Message::PRIO_INFORMATION));
+  }
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MappedRingChannelTests)
+
+BOOST_AUTO_TEST_CASE(wrap_around_test) {
+  BOOST_TEST_MESSAGE("#Mapped ring wrap around test#");
+  RingFile ring;
+  {
+    dadi::MappedRingChannel channel(ring.path, 1024);
+    channel.putAttr("pattern", "%s: %m");
+    channel.open();
+    logRange(channel, 0, 500);
+    channel.close();
+  }
+
+  // only the last records are kept, in order
+  const std::vector<std::string>& records = ring.read();
+  BOOST_REQUIRE(records.size() > 10);
+  BOOST_REQUIRE(records.size() < 500);
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(records[i],
+                        "Tim: " + boost::lexical_cast<std::string>(
+                          500 - records.size() + i));
+  }
+
+  // reopening appends to the ring
+  {
+    dadi::MappedRingChannel channel(ring.path, 1024);
+    logRange(channel, 500, 501);
+  }
+  const std::vector<std::string>& more = ring.read();
+  BOOST_REQUIRE_EQUAL(more.back(), "500");
+  BOOST_REQUIRE_EQUAL(more[more.size() - 2], "Tim: 499");
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_writers_test) {
+  BOOST_TEST_MESSAGE("#Mapped ring concurrent writers test#");
+  RingFile ring;
+  dadi::MappedRingChannel channel(ring.path, 1 << 20);
+  channel.open();
+
+  boost::thread_group writers;
+  for (unsigned int i = 0; i < 4; ++i) {
+    writers.create_thread(boost::bind(&logRange, boost::ref(channel),
+                                      i * 1000, (i + 1) * 1000));
+  }
+  writers.join_all();
+
+  // every record is found once, each writer's records in order
+  dadi::MappedRingReader reader(ring.path);
+  std::set<unsigned int> seen;
+  std::vector<unsigned int> last(4, 0);
+  std::string record;
+  while (reader.next(record)) {
+    unsigned int value = boost::lexical_cast<unsigned int>(record);
+    BOOST_REQUIRE(seen.insert(value).second);
+    BOOST_REQUIRE(value >= last[value / 1000]);
+    last[value / 1000] = value;
+  }
+  BOOST_REQUIRE_EQUAL(seen.size(), 4000U);
+  BOOST_REQUIRE_EQUAL(reader.getSkipped(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(crash_test) {
+  BOOST_TEST_MESSAGE("#Mapped ring survives kill -9 test#");
+  RingFile ring;
+
+  pid_t pid = ::fork();
+  BOOST_REQUIRE(pid >= 0);
+  if (0 == pid) {
+    dadi::MappedRingChannel channel(ring.path, 4096);
+    logRange(channel, 0, 10);
+    ::kill(::getpid(), SIGKILL);
+    ::_exit(0);
+  }
+  int status;
+  BOOST_REQUIRE_EQUAL(::waitpid(pid, &status, 0), pid);
+  BOOST_REQUIRE(WIFSIGNALED(status));
+
+  const std::vector<std::string>& records = ring.read();
+  BOOST_REQUIRE_EQUAL(records.size(), 10U);
+  BOOST_REQUIRE_EQUAL(records.front(), "0");
+  BOOST_REQUIRE_EQUAL(records.back(), "9");
+
+  // an uncommitted record is skipped: clear the position of the second one
+  {
+    std::fstream file(ring.path.c_str(),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(dadi::MappedRingChannel::HEADER_SIZE +
+               dadi::MappedRingChannel::RECORD_HEADER_SIZE + 8);
+    const char zero[8] = {0};
+    file.write(zero, sizeof(zero));
+  }
+  dadi::MappedRingReader reader(ring.path);
+  std::string record;
+  BOOST_REQUIRE(reader.next(record));
+  BOOST_REQUIRE_EQUAL(record, "0");
+  BOOST_REQUIRE(reader.next(record));
+  BOOST_REQUIRE_EQUAL(record, "2");
+  BOOST_REQUIRE_EQUAL(reader.getSkipped(),
+                      dadi::MappedRingChannel::RECORD_HEADER_SIZE + 8);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_ring_test) {
+  BOOST_TEST_MESSAGE("#Mapped ring invalid file test#");
+  RingFile ring;
+  dadi::MappedRingChannel channel(ring.path, 16);
+  BOOST_REQUIRE_THROW(channel.open(), dadi::InvalidAttributeError);
+
+  bfs::ofstream(ring.path) << "What... is your favourite colour?";
+  BOOST_REQUIRE_THROW(dadi::MappedRingReader reader(ring.path), dadi::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// THE END
@@ -7,15 +7,42 @@
  *
  */
 
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <new>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/test/unit_test.hpp>
+#include "dadi/Logging/Clock.hh"
+#include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Macros.hh"
 #include "dadi/Logging/Message.hh"
+#include "dadi/Logging/NullChannel.hh"
 #include "dadi/Config.hh"
 #include "dadi/Options.hh"
 
+namespace {
+unsigned long allocations = 0;  // heap allocations count
+}
+
+// count heap allocations for the whole test program
+void *
+operator new(std::size_t size) {
+  ++allocations;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void
+operator delete(void *p) throw() {
+  std::free(p);
+}
+
 BOOST_AUTO_TEST_SUITE(MessageTests)
 
 BOOST_AUTO_TEST_CASE(default_constructor_test) {
@@ -120,6 +147,85 @@ BOOST_AUTO_TEST_CASE(attributes_test) {
   myMsg[key] = value;
   // Check attribute
   BOOST_REQUIRE_EQUAL(myMsg[key], value);
+  // update attribute
+  myMsg[key] = "African or European?";
+  BOOST_REQUIRE_EQUAL(myMsg.getTags().size(), 1);
+  BOOST_REQUIRE_EQUAL(myMsg[key], "African or European?");
+
+  // read access does not create attributes
+  const dadi::Message& constMsg = myMsg;
+  BOOST_REQUIRE(constMsg["Arthur"].empty());
+  BOOST_REQUIRE_EQUAL(constMsg.getTags().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(file_test) {
+  BOOST_TEST_MESSAGE("#Test message source code filename#");
+  dadi::Message myMsg;
+
+  // literals are not copied
+  myMsg.setFile(__FILE__);
+  BOOST_REQUIRE(myMsg.getFileName() == __FILE__);
+  BOOST_REQUIRE_EQUAL(myMsg.getFile(), __FILE__);
+
+  // std::string are copied
+  std::string file("Grail.holy");
+  myMsg.setFile(file);
+  file = "Grail.lost";
+  BOOST_REQUIRE_EQUAL(myMsg.getFile(), "Grail.holy");
+  BOOST_REQUIRE_EQUAL(std::string(myMsg.getFileName()), "Grail.holy");
+
+  // copies keep their own filename
+  dadi::Message myMsg2(myMsg);
+  myMsg.setFile(__FILE__);
+  BOOST_REQUIRE_EQUAL(myMsg2.getFile(), "Grail.holy");
+  BOOST_REQUIRE_EQUAL(myMsg.getFile(), __FILE__);
+}
+
+BOOST_AUTO_TEST_CASE(timestamp_test) {
+  BOOST_TEST_MESSAGE("#Test message timestamp#");
+  int sources[] = {dadi::Clock::SOURCE_PRECISE,
+                   dadi::Clock::SOURCE_COARSE,
+                   dadi::Clock::SOURCE_TICKER};
+  int defaultSource = dadi::Clock::getSource();
+
+  for (unsigned int i = 0; i < sizeof(sources) / sizeof(sources[0]); ++i) {
+    dadi::Clock::setSource(sources[i], 100);
+    BOOST_REQUIRE_EQUAL(dadi::Clock::getSource(), sources[i]);
+
+    long before = static_cast<long>(std::time(NULL));
+    dadi::Message myMsg("Lancelot", "Run away!",
+                        dadi::Message::PRIO_INFORMATION);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+    dadi::Message myMsg2;
+    long after = static_cast<long>(std::time(NULL));
+
+    // coarse sources may lag by a tick
+    BOOST_REQUIRE(myMsg.getTimestamp() >= before - 1);
+    BOOST_REQUIRE(myMsg2.getTimestamp() <= after);
+    BOOST_REQUIRE(myMsg2.getTime().monotonic > myMsg.getTime().monotonic);
+  }
+
+  dadi::Clock::setSource(defaultSource);
+  BOOST_REQUIRE_EQUAL(dadi::Clock::getSource(), defaultSource);
+}
+
+BOOST_AUTO_TEST_CASE(no_allocation_test) {
+  BOOST_TEST_MESSAGE("#Test steady-state logging does not allocate#");
+  dadi::LoggerPtr mylogger = dadi::Logger::getLogger("message_allocations");
+  mylogger->setChannel(dadi::ChannelPtr(new dadi::NullChannel));
+  mylogger->setLevel(dadi::Message::PRIO_DEBUG);
+
+  // warm up per-thread buffers
+  for (int i = 0; i < 1000; ++i) {
+    DADI_LOG_INFORMATION(mylogger, "iteration " << i << " of " << 1000);
+  }
+
+  unsigned long before = allocations;
+  for (int i = 0; i < 1000; ++i) {
+    DADI_LOG_INFORMATION(mylogger, "iteration " << i << " of " << 1000);
+    DADI_LOG_TRACE(mylogger, "never built " << i);
+  }
+  BOOST_REQUIRE_EQUAL(allocations - before, 0);
 }
 
 
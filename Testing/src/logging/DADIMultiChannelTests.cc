@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -19,6 +20,7 @@
 #include "dadi/Logging/MultiChannel.hh"
 #include "dadi/Logging/Logger.hh"
 #include "dadi/Logging/Message.hh"
+#include "dadi/Logging/MessageQueue.hh"
 #include "dadi/Config.hh"
 #include "dadi/Options.hh"
 
@@ -26,6 +28,40 @@ namespace bfs = boost::filesystem;  // an alias for boost filesystem namespace
 namespace {
 static const std::string temporaryFilename("crap4.log");
 typedef boost::scoped_ptr<dadi::MultiChannel> MChannelPtr;
+
+// channel that blocks until it is released
+class GatedChannel : public dadi::Channel {
+public:
+  GatedChannel() : open_(false), count_(0) {}
+
+  void
+  log(const dadi::Message& msg) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (!open_) {
+      cond_.wait(lock);
+    }
+    ++count_;
+  }
+
+  void
+  release() {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    open_ = true;
+    cond_.notify_all();
+  }
+
+  unsigned int
+  getCount() {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    return count_;
+  }
+
+private:
+  bool open_;
+  unsigned int count_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+};
 }
 
 BOOST_AUTO_TEST_SUITE(MultiChannelTests)
@@ -76,6 +112,81 @@ BOOST_AUTO_TEST_CASE(log_channels_test) {
   BOOST_REQUIRE_EQUAL(oss2.str().compare(msgToLog + "\n"), 0);
 }
 
+BOOST_AUTO_TEST_CASE(async_channels_test) {
+  BOOST_TEST_MESSAGE("#Log on queued channels test#");
+  dadi::Message myMsg("Bridgekeeper", "What... is your name?",
+                      dadi::Message::PRIO_DEBUG);
+
+  MChannelPtr myMultiC(new dadi::MultiChannel);
+  std::stringstream oss;
+  dadi::ChannelPtr myConsoleC(new dadi::ConsoleChannel(oss));
+  boost::shared_ptr<GatedChannel> gated(new GatedChannel);
+  dadi::ChannelPtr myGatedC(gated);
+  myMultiC->addChannel(myGatedC, 2,
+                       dadi::MessageQueue::OVERFLOW_DROP_NEWEST);
+  myMultiC->addChannel(myConsoleC);
+
+  // a blocked channel does not delay others
+  for (unsigned int i = 0; i < 10; ++i) {
+    myMultiC->log(myMsg);
+  }
+  dadi::MultiChannel::Statistics stats = myMultiC->getStatistics(myConsoleC);
+  BOOST_REQUIRE_EQUAL(stats.delivered, 10);
+  BOOST_REQUIRE_EQUAL(stats.dropped, 0);
+
+  gated->release();
+  myMultiC->flush();
+  stats = myMultiC->getStatistics(myGatedC);
+  // writer holds a batch (at most two messages), two are queued
+  BOOST_REQUIRE_GE(stats.dropped, 6);
+  BOOST_REQUIRE_EQUAL(stats.delivered + stats.dropped, 10);
+  BOOST_REQUIRE_EQUAL(gated->getCount(), stats.delivered);
+  BOOST_REQUIRE_GT(stats.time, 0);
+
+  myMultiC->removeChannel(myGatedC);
+  BOOST_REQUIRE_EQUAL(myMultiC->getCount(), 1);
+  stats = myMultiC->getStatistics(myGatedC);
+  BOOST_REQUIRE_EQUAL(stats.delivered, 0);
+
+  // removing a channel drains its queue
+  boost::shared_ptr<GatedChannel> gated2(new GatedChannel);
+  dadi::ChannelPtr myGatedC2(gated2);
+  myMultiC->addChannel(myGatedC2, 16);
+  for (unsigned int i = 0; i < 5; ++i) {
+    myMultiC->log(myMsg);
+  }
+  boost::thread releaser(boost::bind(&GatedChannel::release, gated2.get()));
+  myMultiC->removeChannel(myGatedC2);
+  BOOST_REQUIRE_EQUAL(gated2->getCount(), 5);
+  releaser.join();
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_add_remove_test) {
+  BOOST_TEST_MESSAGE("#Add and remove channels while logging test#");
+  dadi::Message myMsg("Bridgekeeper", "What... is your quest?",
+                      dadi::Message::PRIO_DEBUG);
+
+  MChannelPtr myMultiC(new dadi::MultiChannel);
+  dadi::ChannelPtr myNullC(new dadi::NullChannel);
+  myMultiC->addChannel(myNullC);
+
+  boost::thread_group loggers;
+  for (unsigned int i = 0; i < 4; ++i) {
+    loggers.create_thread(boost::bind(&dadi::MultiChannel::log,
+                                      myMultiC.get(), myMsg));
+  }
+  for (unsigned int i = 0; i < 100; ++i) {
+    dadi::ChannelPtr channel(new dadi::NullChannel);
+    myMultiC->addChannel(channel, 16);
+    myMultiC->log(myMsg);
+    myMultiC->removeChannel(channel);
+  }
+  loggers.join_all();
+
+  BOOST_REQUIRE_EQUAL(myMultiC->getCount(), 1);
+  BOOST_REQUIRE_EQUAL(myMultiC->getStatistics(myNullC).delivered, 104);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 // THE END
@@ -0,0 +1,171 @@
+/**
+ * @file DADISyslogChannelTests.cc
+ * @brief This file implements the libdadi tests for syslog socket channel
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @section License
+ *  |LICENSE|
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/regex.hpp>
+#include <boost/test/unit_test.hpp>
+#include "dadi/Logging/Message.hh"
+#include "dadi/Logging/SyslogChannel.hh"
+#include "dadi/Logging/SyslogSocketChannel.hh"
+#include "dadi/Exception/All.hh"
+
+namespace bfs = boost::filesystem;  // an alias for boost filesystem namespace
+namespace {
+// datagram socket standing for the syslog daemon
+class Listener {
+public:
+  Listener() : fd_(-1) {}
+
+  ~Listener() {
+    if (-1 != fd_) {
+      ::close(fd_);
+    }
+    if (!path_.empty()) {
+      ::unlink(path_.c_str());
+    }
+  }
+
+  // returns address to be used by the channel
+  std::string
+  bindUnix() {
+    path_ = (bfs::temp_directory_path() / bfs::unique_path()).string();
+    fd_ = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+    BOOST_REQUIRE_EQUAL(::bind(fd_, reinterpret_cast<sockaddr *>(&addr),
+                               sizeof(addr)), 0);
+    return "unix:" + path_;
+  }
+
+  std::string
+  bindUdp() {
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    BOOST_REQUIRE_EQUAL(::bind(fd_, reinterpret_cast<sockaddr *>(&addr),
+                               sizeof(addr)), 0);
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+    return "udp:127.0.0.1:" +
+      boost::lexical_cast<std::string>(ntohs(addr.sin_port));
+  }
+
+  std::string
+  receive() {
+    char buf[8192];
+    ssize_t res = ::recv(fd_, buf, sizeof(buf), 0);
+    BOOST_REQUIRE(res > 0);
+    return std::string(buf, res);
+  }
+
+private:
+  int fd_;
+  std::string path_;
+};
+
+const std::string pid = boost::lexical_cast<std::string>(::getpid());
+}
+
+BOOST_AUTO_TEST_SUITE(SyslogChannelTests)
+
+BOOST_AUTO_TEST_CASE(rfc5424_test) {
+  BOOST_TEST_MESSAGE("#Syslog RFC 5424 over unix socket test#");
+  Listener listener;
+  dadi::SyslogSocketChannel channel(listener.bindUnix());
+  channel.putAttr("name", "bridge");
+  channel.putAttr("hostname", "camelot");
+  unsigned int facility = dadi::SyslogChannel::SYSLOG_LOCAL0;
+  channel.putAttr("facility", facility);
+  channel.open();
+
+  dadi::Message msg("Bridgekeeper", "What... is your name?",
+                    dadi::Message::PRIO_WARNING);
+  channel.log(msg);
+  // local0 (16) * 8 + warning (4)
+  boost::regex re("<132>1 \\d{4}-\\d\\d-\\d\\dT\\d\\d:\\d\\d:\\d\\d\\.\\d{6}Z"
+                  " camelot bridge " + pid + " - - What\\.\\.\\. is your"
+                  " name\\?");
+  BOOST_REQUIRE(boost::regex_match(listener.receive(), re));
+
+  // tags become structured data
+  msg["knight"] = "Sir \"Robin\" [the brave]";
+  msg["quest"] = "grail";
+  channel.log(msg);
+  const std::string& line = listener.receive();
+  std::string::size_type pos = line.find(" - [");
+  BOOST_REQUIRE(pos != std::string::npos);
+  BOOST_REQUIRE_EQUAL(line.substr(pos + 3),
+                      "[dadi@32473 knight=\"Sir \\\"Robin\\\" [the brave\\]\""
+                      " quest=\"grail\"] What... is your name?");
+}
+
+BOOST_AUTO_TEST_CASE(rfc3164_udp_test) {
+  BOOST_TEST_MESSAGE("#Syslog RFC 3164 over udp test#");
+  Listener listener;
+  dadi::SyslogSocketChannel channel(listener.bindUdp(),
+                                    dadi::SyslogSocketChannel::FORMAT_RFC3164);
+  channel.putAttr("name", "bridge");
+  channel.putAttr("hostname", "camelot");
+  channel.open();
+
+  dadi::Message msg("Bridgekeeper", "What... is your quest?",
+                    dadi::Message::PRIO_ERROR);
+  channel.log(msg);
+  // user (1) * 8 + error (3)
+  boost::regex re("<11>[A-Z][a-z]{2} [ \\d]\\d \\d\\d:\\d\\d:\\d\\d"
+                  " camelot bridge\\[" + pid + "\\]: What\\.\\.\\. is your"
+                  " quest\\?");
+  BOOST_REQUIRE(boost::regex_match(listener.receive(), re));
+}
+
+BOOST_AUTO_TEST_CASE(async_batch_test) {
+  BOOST_TEST_MESSAGE("#Syslog asynchronous batches test#");
+  Listener listener;
+  dadi::SyslogSocketChannel channel(listener.bindUnix());
+  channel.putAttr("async", true);
+  channel.putAttr("pattern", "%s: %m");
+  channel.open();
+
+  for (unsigned int i = 0; i < 8; ++i) {
+    dadi::Message msg("Bridgekeeper", boost::lexical_cast<std::string>(i),
+                      dadi::Message::PRIO_INFORMATION);
+    channel.log(msg);
+  }
+  channel.flush();
+
+  // one datagram per message, in order
+  for (unsigned int i = 0; i < 8; ++i) {
+    const std::string& line = listener.receive();
+    const std::string& tail =
+      "Bridgekeeper: " + boost::lexical_cast<std::string>(i);
+    BOOST_REQUIRE_EQUAL(line.substr(0, 5), "<14>1");
+    BOOST_REQUIRE_EQUAL(line.substr(line.size() - tail.size()), tail);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_address_test) {
+  BOOST_TEST_MESSAGE("#Syslog invalid address test#");
+  dadi::SyslogSocketChannel channel("udp:nowhere");
+  BOOST_REQUIRE_THROW(channel.open(), dadi::InvalidAttributeError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// THE END
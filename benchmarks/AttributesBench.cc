@@ -0,0 +1,199 @@
+/**
+ * @file   AttributesBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compare Attributes with FlatAttributes: build, lookup, merge,
+ *         serialization and parsing of a set shaped like CoRI metrics
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include "dadi/Attributes.hh"
+#include "dadi/FlatAttributes.hh"
+
+namespace {
+
+typedef boost::posix_time::microsec_clock Clock;
+
+const char *metrics[] = {
+  "cpu.count", "cpu.load.one", "cpu.load.five", "cpu.load.fifteen",
+  "cpu.frequency", "cpu.cache", "memory.total", "memory.free",
+  "memory.used", "memory.swap.total", "memory.swap.free", "disk.read",
+  "disk.write", "disk.free", "network.rx.bytes", "network.tx.bytes"
+};
+const std::size_t nbMetrics = sizeof(metrics) / sizeof(metrics[0]);
+
+/* volatile sink so that results are not optimized away */
+volatile double sink;
+
+/* returns operations per second */
+double
+rate(unsigned long operations, const boost::posix_time::ptime& start) {
+  boost::posix_time::time_duration elapsed = Clock::universal_time() - start;
+  return (operations * 1000000.0) / elapsed.total_microseconds();
+}
+
+template<class Attr>
+void
+fill(Attr& attr, unsigned int hosts) {
+  for (unsigned int h = 0; h < hosts; ++h) {
+    const std::string prefix = "host" + boost::lexical_cast<std::string>(h);
+    for (std::size_t m = 0; m < nbMetrics; ++m) {
+      attr.putAttr(prefix + "." + metrics[m], 0.5 * (h + m));
+    }
+    attr.addAttr(prefix + ".tag", "compute");
+    attr.addAttr(prefix + ".tag", "gpu");
+  }
+}
+
+template<class Attr>
+double
+runBuild(unsigned int hosts, unsigned long iterations) {
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    Attr attr;
+    fill(attr, hosts);
+    sink = attr.template getAttr<double>("host0.cpu.count");
+  }
+  return rate(iterations, start);
+}
+
+template<class Attr>
+double
+runLookup(const Attr& attr, const std::vector<std::string>& paths,
+          unsigned long iterations) {
+  double sum = 0;
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    sum += attr.template getAttr<double>(paths[i % paths.size()]);
+  }
+  sink = sum;
+  return rate(iterations, start);
+}
+
+template<class Attr, class Path>
+double
+runPathLookup(const Attr& attr, const std::vector<Path>& paths,
+              unsigned long iterations) {
+  double sum = 0;
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    sum += attr.template getAttr<double>(paths[i % paths.size()]);
+  }
+  sink = sum;
+  return rate(iterations, start);
+}
+
+template<class Attr>
+double
+runMerge(const Attr& a, Attr& b, unsigned long iterations) {
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    Attr attr(a);
+    attr.merge(b);
+    sink = attr.template getAttr<double>("host0.cpu.count");
+  }
+  return rate(iterations, start);
+}
+
+template<class Attr>
+double
+runSerialize(const Attr& attr, int format, unsigned long iterations) {
+  std::string buffer;
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    attr.saveAttr(buffer, format);
+    sink = buffer.size();
+  }
+  return rate(iterations, start);
+}
+
+template<class Attr>
+double
+runParse(const Attr& attr, int format, unsigned long iterations) {
+  const std::string data = attr.saveAttr(format);
+  Attr res;
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    res.loadAttr(data.data(), data.size(), format);
+    sink = res.template getAttr<double>("host0.cpu.count");
+  }
+  return rate(iterations, start);
+}
+
+void
+report(const char *name, double before, double after) {
+  std::cout << std::left << std::setw(12) << name << std::right
+            << std::fixed << std::setprecision(0)
+            << std::setw(14) << before << std::setw(14) << after
+            << std::setprecision(2) << std::setw(10) << after / before
+            << "\n";
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned int hosts = 8;
+  unsigned long iterations = 2000;
+  if (argc > 1) {
+    hosts = boost::lexical_cast<unsigned int>(argv[1]);
+  }
+  if (argc > 2) {
+    iterations = boost::lexical_cast<unsigned long>(argv[2]);
+  }
+
+  dadi::Attributes attr, other;
+  dadi::FlatAttributes flat, flatOther;
+  fill(attr, hosts);
+  fill(flat, hosts);
+  // half of the merged set already exists
+  fill(other, hosts / 2 + hosts);
+  fill(flatOther, hosts / 2 + hosts);
+
+  std::vector<std::string> paths;
+  std::vector<dadi::AttrPath> handles;
+  std::vector<dadi::FlatAttributes::Path> compiled;
+  for (unsigned int h = 0; h < hosts; ++h) {
+    for (std::size_t m = 0; m < nbMetrics; ++m) {
+      paths.push_back("host" + boost::lexical_cast<std::string>(h) + "." +
+                      metrics[m]);
+      handles.push_back(dadi::AttrPath(paths.back(), true));
+      compiled.push_back(dadi::FlatAttributes::Path(paths.back()));
+    }
+  }
+  const unsigned long lookups = iterations * paths.size();
+
+  std::cout << hosts << " hosts, " << paths.size() << " metrics\n"
+            << std::left << std::setw(12) << "operation" << std::right
+            << std::setw(14) << "Attributes" << std::setw(14) << "Flat"
+            << std::setw(10) << "speedup" << "\n";
+  report("build", runBuild<dadi::Attributes>(hosts, iterations),
+         runBuild<dadi::FlatAttributes>(hosts, iterations));
+  report("lookup", runLookup(attr, paths, lookups),
+         runLookup(flat, paths, lookups));
+  report("lookup/path", runPathLookup(attr, handles, lookups),
+         runPathLookup(flat, compiled, lookups));
+  report("merge", runMerge(attr, other, iterations),
+         runMerge(flat, flatOther, iterations));
+  report("save/xml", runSerialize(attr, dadi::FORMAT_XML, iterations),
+         runSerialize(flat, dadi::FORMAT_XML, iterations));
+  report("save/binary", runSerialize(attr, dadi::FORMAT_BINARY, iterations),
+         runSerialize(flat, dadi::FORMAT_BINARY, iterations));
+  report("load/xml", runParse(attr, dadi::FORMAT_XML, iterations),
+         runParse(flat, dadi::FORMAT_XML, iterations));
+  report("load/binary", runParse(attr, dadi::FORMAT_BINARY, iterations),
+         runParse(flat, dadi::FORMAT_BINARY, iterations));
+  std::cout << "document size: xml " << attr.saveAttr(dadi::FORMAT_XML).size()
+            << ", binary " << attr.saveAttr(dadi::FORMAT_BINARY).size()
+            << " (flat " << flat.saveAttr(dadi::FORMAT_BINARY).size()
+            << ")\n";
+
+  return 0;
+}
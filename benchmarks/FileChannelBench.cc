@@ -0,0 +1,138 @@
+/**
+ * @file   FileChannelBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  measure FileChannel throughput and latency per flush policy, and
+ *         text against binary records
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "dadi/Logging/BinaryFileChannel.hh"
+#include "dadi/Logging/Clock.hh"
+#include "dadi/Logging/FileChannel.hh"
+#include "dadi/Logging/Message.hh"
+
+namespace bfs = boost::filesystem;
+
+namespace {
+
+struct Policy {
+  const char *flush;
+  const char *fsync;
+};
+
+const Policy policies[] = {
+  {"every", "none"},
+  {"every", "interval"},
+  {"bytes:65536", "none"},
+  {"ms:100", "none"},
+  {"ms:100", "interval"},
+  {"never", "none"},
+  {"never", "on-rotate"}
+};
+
+/* text records are rendered with a typical pattern */
+const char TEXT_PATTERN[] = "%T %p %s %f:%l %m";
+
+struct Result {
+  double rate; /**< lines per second */
+  boost::int64_t p99; /**< 99th percentile of log() latency (ns) */
+  boost::uintmax_t size; /**< file size (bytes) */
+};
+
+Result
+run(dadi::FileChannel& channel, const bfs::path& path,
+    unsigned long iterations) {
+  dadi::Message msg("bench.file",
+                    "What... is the air-speed velocity of an unladen swallow?",
+                    dadi::Message::PRIO_INFORMATION, __FILE__, __LINE__);
+  msg["id"] = "42";
+  std::vector<boost::int64_t> latencies(iterations);
+  Result result;
+
+  {
+    channel.open();
+
+    boost::int64_t start = dadi::Clock::now().monotonic;
+    for (unsigned long i = 0; i < iterations; ++i) {
+      boost::int64_t before = dadi::Clock::now().monotonic;
+      channel.log(msg);
+      latencies[i] = dadi::Clock::now().monotonic - before;
+    }
+    channel.close();
+    boost::int64_t elapsed = dadi::Clock::now().monotonic - start;
+    result.rate = (iterations * 1e9) / elapsed;
+    result.size = bfs::file_size(path);
+  }
+
+  std::vector<boost::int64_t>::iterator p99 =
+    latencies.begin() + (iterations * 99) / 100;
+  std::nth_element(latencies.begin(), p99, latencies.end());
+  result.p99 = *p99;
+
+  bfs::remove(path);
+  return result;
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned long iterations = 200000;
+  if (argc > 1) {
+    iterations = boost::lexical_cast<unsigned long>(argv[1]);
+  }
+  bfs::path path = bfs::temp_directory_path();
+  if (argc > 2) {
+    path = argv[2];
+  }
+  path /= bfs::unique_path("dadi-bench-%%%%-%%%%.log");
+
+  // latencies need the best resolution available
+  dadi::Clock::setSource(dadi::Clock::SOURCE_PRECISE);
+
+  std::cout << std::setw(14) << "flush"
+            << std::setw(12) << "fsync"
+            << std::setw(16) << "lines/s"
+            << std::setw(14) << "p99 (ns)" << "\n";
+  for (std::size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i) {
+    dadi::FileChannel channel(path.native());
+    channel.putAttr("flush", policies[i].flush);
+    channel.putAttr("fsync", policies[i].fsync);
+    Result r = run(channel, path, iterations);
+    std::cout << std::setw(14) << policies[i].flush
+              << std::setw(12) << policies[i].fsync
+              << std::setw(16) << std::fixed << std::setprecision(0) << r.rate
+              << std::setw(14) << r.p99 << "\n";
+  }
+
+  std::cout << "\n" << std::setw(26) << "records"
+            << std::setw(16) << "lines/s"
+            << std::setw(14) << "p99 (ns)"
+            << std::setw(16) << "bytes/record" << "\n";
+  for (int binary = 0; binary < 2; ++binary) {
+    boost::scoped_ptr<dadi::FileChannel> channel(
+      binary ? new dadi::BinaryFileChannel(path.native())
+      : new dadi::FileChannel(path.native()));
+    channel->putAttr("flush", "bytes:65536");
+    channel->putAttr("pattern", TEXT_PATTERN);
+    Result r = run(*channel, path, iterations);
+    std::cout << std::setw(26) << (binary ? "binary" : TEXT_PATTERN)
+              << std::setw(16) << std::fixed << std::setprecision(0) << r.rate
+              << std::setw(14) << r.p99
+              << std::setw(16) << std::setprecision(1)
+              << static_cast<double>(r.size) / iterations << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file   FormatterBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compare Formatter with boost::format on the same layout
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include "dadi/Logging/Formatter.hh"
+#include "dadi/Logging/Message.hh"
+
+namespace {
+
+typedef boost::posix_time::microsec_clock Clock;
+
+const char *priorities[] = {
+  "", "TRACE", "DEBUG", "INFORMATION", "WARNING", "ERROR", "CRITICAL", "FATAL"
+};
+
+/* volatile sink so that rendering is not optimized away */
+volatile std::size_t sink;
+
+/* returns lines per second */
+double
+runFormatter(const dadi::Message& msg, unsigned long iterations) {
+  dadi::Formatter formatter("%T %p [%s] %m (%f:%l)");
+  std::string buffer;
+
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    buffer.clear();
+    formatter.format(msg, buffer);
+    sink = buffer.size();
+  }
+  boost::posix_time::time_duration elapsed = Clock::universal_time() - start;
+
+  return (iterations * 1000000.0) / elapsed.total_microseconds();
+}
+
+double
+runBoostFormat(const dadi::Message& msg, unsigned long iterations) {
+  const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    boost::posix_time::ptime time =
+      epoch + boost::posix_time::microseconds(msg.getTime().wall / 1000);
+    std::string line =
+      (boost::format("%1% %2% [%3%] %4% (%5%:%6%)")
+       % boost::posix_time::to_iso_extended_string(time)
+       % priorities[msg.getPriority()] % msg.getSource() % msg.getText()
+       % msg.getFileName() % msg.getLine()).str();
+    sink = line.size();
+  }
+  boost::posix_time::time_duration elapsed = Clock::universal_time() - start;
+
+  return (iterations * 1000000.0) / elapsed.total_microseconds();
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned long iterations = 1000000;
+  if (argc > 1) {
+    iterations = boost::lexical_cast<unsigned long>(argv[1]);
+  }
+
+  dadi::Message msg("bench.formatter",
+                    "What... is the air-speed velocity of an unladen swallow?",
+                    dadi::Message::PRIO_INFORMATION, __FILE__, __LINE__);
+
+  double before = runBoostFormat(msg, iterations);
+  double after = runFormatter(msg, iterations);
+  std::cout << std::setw(20) << "boost::format (l/s)"
+            << std::setw(20) << "Formatter (l/s)" << "\n"
+            << std::setw(20) << std::fixed << std::setprecision(0) << before
+            << std::setw(20) << after << "\n";
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file   LoggerLookupBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  measure Logger::getLogger throughput from 1 to N threads
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "dadi/Logging/Logger.hh"
+
+namespace {
+
+typedef boost::posix_time::microsec_clock Clock;
+
+const unsigned int NB_LOGGERS = 64;
+std::vector<std::string> names;
+
+/* reference: global recursive mutex + std::map, as getLogger used to do */
+boost::recursive_mutex refMutex;
+dadi::LoggerMap refMap;
+
+dadi::LoggerPtr
+lockedLookup(const std::string& name) {
+  boost::lock_guard<boost::recursive_mutex> lock(refMutex);
+
+  dadi::LoggerMap::const_iterator it = refMap.find(name);
+  return (refMap.end() != it) ? it->second : dadi::LoggerPtr();
+}
+
+dadi::LoggerPtr
+snapshotLookup(const std::string& name) {
+  return dadi::Logger::getLogger(name);
+}
+
+void
+worker(dadi::LoggerPtr (*lookup)(const std::string&),
+       unsigned long iterations, boost::barrier& barrier) {
+  barrier.wait();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    if (!lookup(names[i % NB_LOGGERS])) {
+      std::abort();
+    }
+  }
+}
+
+/* returns lookups per second (all threads) */
+double
+run(dadi::LoggerPtr (*lookup)(const std::string&),
+    unsigned int nbThreads, unsigned long iterations) {
+  boost::barrier barrier(nbThreads + 1);
+  boost::thread_group threads;
+  for (unsigned int i = 0; i < nbThreads; ++i) {
+    threads.create_thread(boost::bind(&worker, lookup, iterations,
+                                      boost::ref(barrier)));
+  }
+
+  boost::posix_time::ptime start = Clock::universal_time();
+  barrier.wait();
+  threads.join_all();
+  boost::posix_time::time_duration elapsed = Clock::universal_time() - start;
+
+  return (static_cast<double>(nbThreads) * iterations * 1000000.0) /
+    elapsed.total_microseconds();
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned int maxThreads = boost::thread::hardware_concurrency();
+  unsigned long iterations = 1000000;
+  if (argc > 1) {
+    maxThreads = boost::lexical_cast<unsigned int>(argv[1]);
+  }
+  if (argc > 2) {
+    iterations = boost::lexical_cast<unsigned long>(argv[2]);
+  }
+  if (0 == maxThreads) {
+    maxThreads = 1;
+  }
+
+  for (unsigned int i = 0; i < NB_LOGGERS; ++i) {
+    std::string name("bench.lookup.logger");
+    name += boost::lexical_cast<std::string>(i);
+    names.push_back(name);
+    refMap[name] = dadi::Logger::getLogger(name);
+  }
+
+  std::cout << std::setw(8) << "threads"
+            << std::setw(20) << "locked map (op/s)"
+            << std::setw(20) << "getLogger (op/s)" << "\n";
+  // 1, 2, 4, ... up to maxThreads
+  std::vector<unsigned int> counts;
+  for (unsigned int n = 1; n < maxThreads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(maxThreads);
+
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    double before = run(&lockedLookup, counts[i], iterations);
+    double after = run(&snapshotLookup, counts[i], iterations);
+    std::cout << std::setw(8) << counts[i]
+              << std::setw(20) << std::fixed << std::setprecision(0) << before
+              << std::setw(20) << after << "\n";
+  }
+
+  dadi::Logger::shutdown();
+  return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file   LoggingBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  measure Logger::log throughput and latency per channel from 1 to
+ *         N threads, results are printed as JSON
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "dadi/Logging/Clock.hh"
+#include "dadi/Logging/Compressor.hh"
+#include "dadi/Logging/ConsoleChannel.hh"
+#include "dadi/Logging/FileChannel.hh"
+#include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Logging/MultiChannel.hh"
+#include "dadi/Logging/NullChannel.hh"
+
+namespace bfs = boost::filesystem;
+
+namespace {
+
+/* ConsoleChannel output */
+int devNull = -1;
+
+typedef dadi::ChannelPtr (*Factory)(const bfs::path& dir, const char *arg);
+
+dadi::ChannelPtr
+makeNull(const bfs::path&, const char *) {
+  return dadi::ChannelPtr(new dadi::NullChannel);
+}
+
+dadi::ChannelPtr
+makeConsole(const bfs::path&, const char *) {
+  return dadi::ChannelPtr(new dadi::ConsoleChannel(devNull));
+}
+
+/* arg: comma separated list of attribute=value */
+dadi::ChannelPtr
+makeFile(const bfs::path& dir, const char *arg) {
+  dadi::ChannelPtr channel(new dadi::FileChannel((dir / "bench.log").native()));
+  std::vector<std::string> attrs;
+  boost::split(attrs, arg, boost::is_any_of(","));
+  for (std::size_t i = 0; i < attrs.size(); ++i) {
+    std::string::size_type pos = attrs[i].find('=');
+    if (std::string::npos != pos) {
+      channel->putAttr(attrs[i].substr(0, pos), attrs[i].substr(pos + 1));
+    }
+  }
+  return channel;
+}
+
+/* arg: number of null channels fed */
+dadi::ChannelPtr
+makeMulti(const bfs::path&, const char *arg) {
+  boost::shared_ptr<dadi::MultiChannel> channel(new dadi::MultiChannel);
+  unsigned int count = boost::lexical_cast<unsigned int>(arg);
+  for (unsigned int i = 0; i < count; ++i) {
+    channel->addChannel(dadi::ChannelPtr(new dadi::NullChannel));
+  }
+  return channel;
+}
+
+struct Scenario {
+  const char *name;
+  Factory make;
+  const char *arg;
+};
+
+const Scenario scenarios[] = {
+  {"null", &makeNull, ""},
+  {"console", &makeConsole, ""},
+  {"file", &makeFile, ""},
+  {"file/gzip", &makeFile, "compression_mode=gzip"},
+  {"file/bzip2", &makeFile, "compression_mode=bzip2"},
+  {"file/zlib", &makeFile, "compression_mode=zlib"},
+  {"file/zstd", &makeFile, "compression_mode=zstd"},
+  {"file/async", &makeFile, "async=true"},
+  {"file/rotate-size", &makeFile,
+   "rotate=size,rotate.size=1048576,archive=number,purge=count,purge.count=4"},
+  {"file/rotate-size/gzip", &makeFile,
+   "rotate=size,rotate.size=1048576,archive=number,purge=count,purge.count=4,"
+   "archive.compression=gzip"},
+  {"file/rotate-size/zstd", &makeFile,
+   "rotate=size,rotate.size=1048576,archive=number,purge=count,purge.count=4,"
+   "archive.compression=zstd"},
+  {"file/rotate-interval", &makeFile,
+   "rotate=interval,rotate.interval=00:00:01,archive=timestamp,purge=count,"
+   "purge.count=4"},
+  {"multi/2", &makeMulti, "2"},
+  {"multi/8", &makeMulti, "8"}
+};
+
+struct Result {
+  unsigned long messages; /**< messages logged (all threads) */
+  double rate; /**< messages per second */
+  boost::int64_t p50; /**< median log() latency (ns) */
+  boost::int64_t p99; /**< 99th percentile of log() latency (ns) */
+  boost::int64_t p999; /**< 99.9th percentile of log() latency (ns) */
+};
+
+void
+worker(dadi::LoggerPtr logger, boost::int64_t *latencies,
+       unsigned long iterations, boost::barrier& barrier) {
+  dadi::Message msg("bench.logging",
+                    "What... is the air-speed velocity of an unladen swallow?",
+                    dadi::Message::PRIO_INFORMATION, __FILE__, __LINE__);
+  msg["id"] = "42";
+
+  barrier.wait();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    boost::int64_t before = dadi::Clock::now().monotonic;
+    logger->log(msg);
+    latencies[i] = dadi::Clock::now().monotonic - before;
+  }
+}
+
+boost::int64_t
+percentile(std::vector<boost::int64_t>& latencies, unsigned int permille) {
+  std::vector<boost::int64_t>::iterator it =
+    latencies.begin() + (latencies.size() * permille) / 1000;
+  std::nth_element(latencies.begin(), it, latencies.end());
+  return *it;
+}
+
+Result
+run(const Scenario& scenario, const bfs::path& base, unsigned int nbThreads,
+    unsigned long iterations) {
+  bfs::path dir = base / bfs::unique_path("dadi-bench-%%%%-%%%%");
+  bfs::create_directory(dir);
+  dadi::ChannelPtr channel = scenario.make(dir, scenario.arg);
+  dadi::LoggerPtr logger = dadi::Logger::getLogger("bench.logging");
+  logger->setChannel(channel);
+  channel->open();
+
+  std::vector<boost::int64_t> latencies(nbThreads * iterations);
+  boost::barrier barrier(nbThreads + 1);
+  boost::thread_group threads;
+  for (unsigned int i = 0; i < nbThreads; ++i) {
+    threads.create_thread(boost::bind(&worker, logger,
+                                      &latencies[i * iterations], iterations,
+                                      boost::ref(barrier)));
+  }
+
+  // pending messages are part of the measure
+  boost::int64_t start = dadi::Clock::now().monotonic;
+  barrier.wait();
+  threads.join_all();
+  channel->close();
+  boost::int64_t elapsed = dadi::Clock::now().monotonic - start;
+
+  Result result;
+  result.messages = latencies.size();
+  result.rate = (result.messages * 1e9) / elapsed;
+  result.p50 = percentile(latencies, 500);
+  result.p99 = percentile(latencies, 990);
+  result.p999 = percentile(latencies, 999);
+
+  // the channel (and its compression threads) must be gone before its files
+  logger->setChannel(dadi::ChannelPtr());
+  channel.reset();
+  bfs::remove_all(dir);
+  return result;
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned int maxThreads = boost::thread::hardware_concurrency();
+  unsigned long iterations = 50000;
+  bfs::path dir = bfs::temp_directory_path();
+  if (argc > 1) {
+    maxThreads = boost::lexical_cast<unsigned int>(argv[1]);
+  }
+  if (argc > 2) {
+    iterations = boost::lexical_cast<unsigned long>(argv[2]);
+  }
+  if (argc > 3) {
+    dir = argv[3];
+  }
+  if (0 == maxThreads) {
+    maxThreads = 1;
+  }
+
+  // latencies need the best resolution available
+  dadi::Clock::setSource(dadi::Clock::SOURCE_PRECISE);
+  devNull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+  // 1, 2, 4, ... up to maxThreads
+  std::vector<unsigned int> counts;
+  for (unsigned int n = 1; n < maxThreads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(maxThreads);
+
+  std::cout << "{\n  \"benchmark\": \"dadi-bench-logging\",\n"
+            << "  \"iterations\": " << iterations << ",\n"
+            << "  \"results\": [";
+  const char *separator = "\n";
+  for (std::size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); ++s) {
+    // unavailable formats would silently fall back to gzip
+    if (std::strstr(scenarios[s].arg, "zstd") &&
+        !dadi::Compressor::isAvailable(dadi::Compressor::FORMAT_ZSTD)) {
+      continue;
+    }
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      Result r = run(scenarios[s], dir, counts[i], iterations);
+      std::cout << separator
+                << "    {\"channel\": \"" << scenarios[s].name << "\""
+                << ", \"threads\": " << counts[i]
+                << ", \"messages\": " << r.messages
+                << ", \"rate\": " << std::fixed << std::setprecision(0)
+                << r.rate
+                << ", \"p50_ns\": " << r.p50
+                << ", \"p99_ns\": " << r.p99
+                << ", \"p999_ns\": " << r.p999 << "}";
+      std::cout.flush();
+      separator = ",\n";
+    }
+  }
+  std::cout << "\n  ]\n}\n";
+
+  ::close(devNull);
+  dadi::Logger::shutdown();
+  return 0;
+}
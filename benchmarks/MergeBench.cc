@@ -0,0 +1,116 @@
+/**
+ * @file   MergeBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  measure Attributes::merge, Attributes::splice and
+ *         FlatAttributes::merge on large trees
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include "dadi/Attributes.hh"
+#include "dadi/FlatAttributes.hh"
+
+namespace {
+
+typedef boost::posix_time::microsec_clock Clock;
+
+/* volatile sink so that results are not optimized away */
+volatile std::size_t sink;
+
+/* metrics of several hosts, as gathered by CoRI */
+template<class Attr>
+void
+fillHosts(Attr& attr, unsigned long first, unsigned long leaves) {
+  const unsigned long perHost = 16;
+  for (unsigned long i = first; i < first + leaves; ++i) {
+    attr.putAttr("diet.cori.host" +
+                 boost::lexical_cast<std::string>(i / perHost) + ".metric" +
+                 boost::lexical_cast<std::string>(i % perHost), i);
+  }
+}
+
+/* a single list of values */
+template<class Attr>
+void
+fillList(Attr& attr, unsigned long first, unsigned long leaves) {
+  for (unsigned long i = first; i < first + leaves; ++i) {
+    attr.addAttr("diet.cori.metrics.metric", i);
+  }
+}
+
+void
+apply(dadi::Attributes& res, dadi::Attributes& other, bool splice) {
+  if (splice) {
+    res.splice(other);
+  } else {
+    res.merge(other);
+  }
+}
+
+void
+apply(dadi::FlatAttributes& res, dadi::FlatAttributes& other, bool) {
+  res.merge(other);
+}
+
+/* returns milliseconds per merge */
+template<class Attr>
+double
+runMerge(void (*fill)(Attr&, unsigned long, unsigned long),
+         unsigned long leaves, unsigned long iterations, bool splice) {
+  // half of the merged leaves already exist
+  Attr a, b;
+  fill(a, 0, leaves);
+  fill(b, leaves / 2, leaves);
+
+  boost::posix_time::time_duration elapsed;
+  for (unsigned long i = 0; i < iterations; ++i) {
+    Attr res(a), other(b);
+    boost::posix_time::ptime start = Clock::universal_time();
+    apply(res, other, splice);
+    elapsed += Clock::universal_time() - start;
+    sink = res.template getAttr<std::string>("diet.cori", "").size();
+  }
+  return elapsed.total_microseconds() / (1000.0 * iterations);
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned long leaves = 10000;
+  unsigned long iterations = 10;
+  if (argc > 1) {
+    leaves = boost::lexical_cast<unsigned long>(argv[1]);
+  }
+  if (argc > 2) {
+    iterations = boost::lexical_cast<unsigned long>(argv[2]);
+  }
+
+  typedef void (*Fill)(dadi::Attributes&, unsigned long, unsigned long);
+  typedef void (*FlatFill)(dadi::FlatAttributes&, unsigned long,
+                           unsigned long);
+  const char *names[] = {"hosts", "list"};
+  const Fill fills[] = {&fillHosts, &fillList};
+  const FlatFill flatFills[] = {&fillHosts, &fillList};
+
+  std::cout << leaves << " leaves per tree (ms per merge)\n"
+            << std::left << std::setw(8) << "tree" << std::right
+            << std::setw(10) << "merge" << std::setw(10) << "splice"
+            << std::setw(10) << "flat" << "\n"
+            << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0; i < sizeof(fills) / sizeof(fills[0]); ++i) {
+    std::cout << std::left << std::setw(8) << names[i] << std::right
+              << std::setw(10) << runMerge(fills[i], leaves, iterations, false)
+              << std::setw(10) << runMerge(fills[i], leaves, iterations, true)
+              << std::setw(10)
+              << runMerge(flatFills[i], leaves, iterations, false)
+              << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file   ReaderBench.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compare full loads with selective loads of a large document
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include "dadi/Attributes.hh"
+
+namespace {
+
+typedef boost::posix_time::microsec_clock Clock;
+
+/* volatile sink so that results are not optimized away */
+volatile std::size_t sink;
+
+/* plugin metadata: a few attributes for many hosts */
+void
+fill(dadi::Attributes& attr, unsigned int hosts) {
+  for (unsigned int h = 0; h < hosts; ++h) {
+    const std::string prefix =
+      "diet.hosts.host" + boost::lexical_cast<std::string>(h);
+    attr.putAttr(prefix + ".cpu.count", h % 64);
+    attr.putAttr(prefix + ".cpu.load", 0.5 * h);
+    attr.putAttr(prefix + ".memory.total", 1024 * h);
+    attr.putAttr(prefix + ".name",
+                 "node-" + boost::lexical_cast<std::string>(h));
+    attr.addAttr(prefix + ".tag", "compute");
+    attr.addAttr(prefix + ".tag", "gpu");
+  }
+  attr.putAttr("diet.version", "3.0");
+}
+
+/* what loaders do today: read the file, then parse it */
+dadi::Attributes
+loadAll(const char *file, int format) {
+  std::ifstream ifs(file, std::ios_base::in | std::ios_base::binary);
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  return dadi::Attributes(data, format);
+}
+
+dadi::Attributes
+loadSelected(const char *file, int format,
+             const std::vector<std::string>& prefixes) {
+  std::ifstream ifs(file, std::ios_base::in | std::ios_base::binary);
+  dadi::Attributes attr;
+  attr.loadAttr(ifs, prefixes, format);
+  return attr;
+}
+
+/* returns milliseconds per load */
+double
+run(const char *file, int format, const std::vector<std::string> *prefixes,
+    unsigned long iterations) {
+  boost::posix_time::ptime start = Clock::universal_time();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    dadi::Attributes attr = prefixes ? loadSelected(file, format, *prefixes) :
+      loadAll(file, format);
+    sink = attr.getAttr<std::string>("diet.version", "").size() +
+      attr.getAttr<std::string>("diet.hosts.host1.name", "").size();
+  }
+  boost::posix_time::time_duration elapsed = Clock::universal_time() - start;
+  return elapsed.total_microseconds() / (1000.0 * iterations);
+}
+
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  unsigned int hosts = 20000;
+  unsigned long iterations = 5;
+  if (argc > 1) {
+    hosts = boost::lexical_cast<unsigned int>(argv[1]);
+  }
+  if (argc > 2) {
+    iterations = boost::lexical_cast<unsigned long>(argv[2]);
+  }
+
+  dadi::Attributes attr;
+  fill(attr, hosts);
+  std::vector<std::string> prefixes;
+  prefixes.push_back("diet.version");
+  prefixes.push_back("diet.hosts.host1");
+
+  const char *names[] = {"xml", "json", "info"};
+  const int formats[] = {dadi::FORMAT_XML, dadi::FORMAT_JSON,
+                         dadi::FORMAT_INFO};
+  const char *file = "dadi-bench-reader.tmp";
+
+  std::cout << hosts << " hosts (ms per load of "
+            << prefixes.size() << " keys)\n"
+            << std::left << std::setw(8) << "format" << std::right
+            << std::setw(12) << "size (kB)" << std::setw(10) << "full"
+            << std::setw(10) << "selected" << std::setw(10) << "speedup"
+            << "\n" << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+    const std::string data = attr.saveAttr(formats[i]);
+    {
+      std::ofstream ofs(file, std::ios_base::out | std::ios_base::binary);
+      ofs.write(data.data(), data.size());
+    }
+    double full = run(file, formats[i], NULL, iterations);
+    double selected = run(file, formats[i], &prefixes, iterations);
+    std::cout << std::left << std::setw(8) << names[i] << std::right
+              << std::setw(12) << data.size() / 1024 << std::setw(10) << full
+              << std::setw(10) << selected << std::setw(10)
+              << full / selected << "\n";
+  }
+  std::remove(file);
+  return 0;
+}
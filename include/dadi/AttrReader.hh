@@ -0,0 +1,144 @@
+/**
+ * @file   AttrReader.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  event-based (SAX-like) attributes reader and selective loader
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _ATTRREADER_HH_
+#define _ATTRREADER_HH_
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "dadi/detail/Parsers.hh"
+
+namespace dadi {
+
+/**
+ * @brief reader options
+ */
+enum ReadFlags {
+  READ_DEFAULT = 0,
+  /** xml: trim and condense text (as Attributes::loadAttr does) */
+  READ_TRIM_WHITESPACE = 1
+};
+
+/**
+ * @class AttrHandler
+ * @brief receives the nodes of a document as they are parsed
+ *
+ * The root node is implicit: the first events describe its value and
+ * children. Each child is reported by beginNode(), then its value (if
+ * any), its children and endNode(). value() is called at most once per
+ * node and never for empty values; xml text is reported when its element
+ * is closed, after the element children.
+ */
+class AttrHandler {
+public:
+  /**
+   * @brief destructor
+   */
+  virtual ~AttrHandler();
+
+  /**
+   * @brief a child of the current node begins
+   * @param key child key
+   */
+  virtual void
+  beginNode(const std::string& key) = 0;
+  /**
+   * @brief value of the current node
+   * @param data value
+   */
+  virtual void
+  value(const std::string& data) = 0;
+  /**
+   * @brief the current node ends
+   */
+  virtual void
+  endNode() = 0;
+};
+
+/**
+ * @brief parse a document, memory use does not depend on its size
+ * @param input serialized attributes
+ * @param handler events handler
+ * @param format format (binary data is always recognized, and read in
+ * memory as it is only exchanged between nodes)
+ * @param flags ReadFlags
+ * @throw dadi::ParsingAttributeError (events may already have been sent)
+ *
+ * Documents are read the way boost::property_tree readers read them.
+ */
+void
+readAttr(std::istream& input, AttrHandler& handler, int format,
+         int flags = READ_DEFAULT);
+
+/**
+ * @brief parse a document from memory, without copying the buffer
+ * @param data serialized attributes
+ * @param size data size
+ * @param handler events handler
+ * @param format format (binary data is always recognized)
+ * @param flags ReadFlags
+ * @throw dadi::ParsingAttributeError (events may already have been sent)
+ */
+void
+readAttr(const char *data, std::size_t size, AttrHandler& handler,
+         int format, int flags = READ_DEFAULT);
+
+/**
+ * @class AttrSelector
+ * @brief handler materializing only the subtrees under given paths
+ *
+ * Ancestors of selected nodes are created without their values, other
+ * nodes are skipped as they are parsed. An empty path selects the whole
+ * document.
+ */
+class AttrSelector : public AttrHandler {
+public:
+  /**
+   * @brief constructor
+   * @param tree destination (selected nodes are appended)
+   * @param prefixes paths of the subtrees to keep ('.' separated)
+   */
+  AttrSelector(ConfigStore& tree, const std::vector<std::string>& prefixes);
+
+  virtual void
+  beginNode(const std::string& key);
+  virtual void
+  value(const std::string& data);
+  virtual void
+  endNode();
+
+private:
+  /**
+   * @brief node being parsed, created lazily
+   */
+  struct Frame {
+    std::string key;
+    ConfigStore *node; /**< NULL until a selected descendant shows up */
+  };
+
+  ConfigStore&
+  materialize();
+  bool
+  candidate() const;
+  bool
+  candidate(const std::vector<std::string>& prefix, std::size_t depth) const;
+
+  std::vector<std::vector<std::string> > prefixes_; /**< split paths */
+  std::vector<Frame> frames_; /**< path from the root (root excluded) */
+  ConfigStore& root_; /**< destination */
+  std::size_t selected_; /**< depth of the selected subtree (0: none) */
+  std::size_t skipped_; /**< nesting below a node no path leads through */
+  bool all_; /**< the whole document is selected */
+};
+
+} /* namespace dadi */
+
+#endif  /* _ATTRREADER_HH_ */
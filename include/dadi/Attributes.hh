@@ -10,8 +10,10 @@
 #ifndef _ATTRIBUTES_HH_
 #define _ATTRIBUTES_HH_
 
+#include <iosfwd>
 #include <list>
 #include <string>
+#include <vector>
 #include <boost/any.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
@@ -20,6 +22,44 @@
 
 namespace dadi {
 
+class Attributes;
+
+/**
+ * @class AttrPath
+ * @brief precompiled attribute path
+ *
+ * The path is split once, lookups walk the tree key by key instead of
+ * parsing the path again. A cached path also remembers the node it last
+ * reached and skips the walk while the attributes it was used on keep the
+ * same structure. Cached paths update their cache from const accessors:
+ * they must not be shared between threads, uncached ones can.
+ */
+class AttrPath {
+public:
+  /**
+   * @brief constructor
+   * @param path attribute path (ie: "rotate.size")
+   * @param cached remember the last node reached
+   */
+  explicit AttrPath(const std::string& path, bool cached = false);
+
+  /**
+   * @brief get the path
+   * @return attribute path
+   */
+  const std::string&
+  str() const;
+
+private:
+  friend class Attributes;
+
+  std::string path_; /**< attribute path */
+  std::vector<std::string> keys_; /**< path keys */
+  bool cached_; /**< cache the last node reached */
+  mutable boost::property_tree::ptree *node_; /**< last node reached */
+  mutable unsigned long version_; /**< structure version of node_ */
+};
+
 /**
  * @class Attributes
  * @brief base class with attributes
@@ -68,6 +108,28 @@ public:
     }
   }
 
+  /**
+   * @brief get value associated to a precompiled path
+   * @param path attribute path
+   * @return expected value
+   * @throw dadi::UnknownAttributeError
+   * @throw dadi::InvalidAttributeError
+   */
+  template<typename T> T
+  getAttr(const AttrPath& path) const {
+    boost::property_tree::ptree *node = find(path);
+    if (!node) {
+      BOOST_THROW_EXCEPTION(UnknownAttributeError()
+                            << errinfo_msg("No such node (" + path.str() +
+                                           ")"));
+    }
+    try {
+      return node->get_value<T>();
+    } catch (const boost::property_tree::ptree_bad_data& e) {
+      BOOST_THROW_EXCEPTION(InvalidAttributeError() << errinfo_msg(e.what()));
+    }
+  }
+
   /**
    * @brief get the list of values associated to path and store it
    * in a sequence.
@@ -152,6 +214,19 @@ public:
     return pt.get(path, default_value);
   }
 
+  /**
+   * @brief get value associated to a precompiled path or send default value
+   *        does not throw any exception
+   * @param path path to attribute
+   * @param default_value default value to return
+   * @return expected value or default
+   */
+  template<typename T> T
+  getAttr(const AttrPath& path, T default_value) const {
+    boost::property_tree::ptree *node = find(path);
+    return node ? node->get_value(default_value) : default_value;
+  }
+
   /* modifiers */
   /**
    * @brief update a node to attributes (or create it if it doesn't exist)
@@ -161,6 +236,17 @@ public:
   template<typename T> void
   putAttr(const std::string& path, T value) {
     pt.put(path, value);
+    touch();
+  }
+
+  /**
+   * @brief update a node to attributes (or create it if it doesn't exist)
+   * @param path precompiled path to attribute
+   * @param value attribute new value
+   */
+  template<typename T> void
+  putAttr(const AttrPath& path, T value) {
+    force(path).put_value(value);
   }
 
   /**
@@ -171,15 +257,35 @@ public:
   template<typename T> void
   addAttr(const std::string& path, T value) {
     pt.add(path, value);
+    touch();
   }
 
   /**
    * @brief deserialize attributes
    * @param[in] data serialized attributes
-   * @param format XML by default
+   * @param format XML by default (binary data is always recognized)
    */
   void
   loadAttr(const std::string& data, int format = FORMAT_XML);
+  /**
+   * @brief deserialize attributes from memory, without copying the buffer
+   * @param[in] data serialized attributes
+   * @param size data size
+   * @param format format (binary data is always recognized)
+   */
+  void
+  loadAttr(const char *data, std::size_t size, int format);
+  /**
+   * @brief deserialize only the subtrees under given paths, the input is
+   * parsed as it is read so that large documents are never held in memory
+   * @param input serialized attributes
+   * @param prefixes paths of the subtrees to keep (an empty path keeps all)
+   * @param format XML by default (binary data is always recognized)
+   * @throw dadi::ParsingAttributeError (attributes are left unchanged)
+   */
+  void
+  loadAttr(std::istream& input, const std::vector<std::string>& prefixes,
+           int format = FORMAT_XML);
 
   /**
    * @brief serialize attributes
@@ -188,6 +294,13 @@ public:
    */
   std::string
   saveAttr(int format = FORMAT_XML) const;
+  /**
+   * @brief serialize attributes into a buffer (its storage is reused)
+   * @param[out] data serialized attributes (replaced)
+   * @param format XML by default
+   */
+  void
+  saveAttr(std::string& data, int format = FORMAT_XML) const;
 
   /**
    * @brief swap  attributes
@@ -220,15 +333,43 @@ public:
   bool
   operator!=(const Attributes& other) const;
   /**
-   * @brief merge 2 sets of attributes
+   * @brief merge 2 sets of attributes: leaves of other are added unless
+   * their parent already holds a leaf with the same key and value
    * @param other object to merge
-   * @return
    */
   void
   merge(Attributes& other);
+  /**
+   * @brief merge 2 sets of attributes, moving values out of other instead
+   * of copying them (see merge())
+   * @param other object to merge, left empty
+   */
+  void
+  splice(Attributes& other);
 
 private:
+  /**
+   * @brief find the node of a precompiled path
+   * @param path attribute path
+   * @return node (NULL if not found)
+   */
+  boost::property_tree::ptree *
+  find(const AttrPath& path) const;
+  /**
+   * @brief find the node of a precompiled path, creating missing ones
+   * @param path attribute path
+   * @return node
+   */
+  boost::property_tree::ptree&
+  force(const AttrPath& path);
+  /**
+   * @brief record a (possible) structure change, invalidates cached paths
+   */
+  void
+  touch();
+
   boost::property_tree::ptree pt; /**< property tree holding attributes */
+  unsigned long version_; /**< structure version, unique among instances */
 };
 
 
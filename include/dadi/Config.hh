@@ -11,9 +11,12 @@
 #ifndef _CONFIG_HH_
 #define _CONFIG_HH_
 
+#include <iterator>
 #include <string>
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
+#include "dadi/AttrReader.hh"
+#include "dadi/detail/Binary.hh"
 #include "dadi/detail/Parsers.hh"
 #include "dadi/Singleton.hh"
 #include "dadi/Exception/Parameters.hh"
@@ -38,6 +41,10 @@ public:
    * @param inputStream the source
    * @param format the source format
    * @throw ParsingAttributeError when an error occured while reading the file
+   * (the config is left unchanged)
+   *
+   * The source is parsed before the config is replaced, so that readers
+   * never see a partially loaded config.
    */
   void
   load(std::istream& inputStream, Format format = FORMAT_INFO) {
@@ -46,27 +53,57 @@ public:
     using boost::property_tree::read_xml;
     using boost::property_tree::read_info;
 
+    ConfigStore store;
     try {
       switch (format) {
       case FORMAT_JSON:
-        read_json(inputStream, store_);
+        read_json(inputStream, store);
         break;
       case FORMAT_INI:
-        read_ini(inputStream, store_);
+        read_ini(inputStream, store);
         break;
       case FORMAT_XML:
-        read_xml(inputStream, store_);
+        read_xml(inputStream, store);
         break;
+      case FORMAT_BINARY: {
+        std::string data((std::istreambuf_iterator<char>(inputStream)),
+                         std::istreambuf_iterator<char>());
+        detail::readBinary(data.data(), data.size(), store);
+        break;
+      }
       case FORMAT_INFO:
       default:
-        read_info(inputStream, store_);
+        read_info(inputStream, store);
       }
     } catch (const boost::property_tree::file_parser_error& e) {
       BOOST_THROW_EXCEPTION(ParsingAttributeError() << errinfo_msg(e.what()));
     }
+
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    store_.swap(store);
   }
 
 
+  /**
+   * @brief load the subtrees under given paths of the config, the source
+   * is parsed as it is read: other nodes are never materialized
+   * @param inputStream the source
+   * @param prefixes paths of the subtrees to keep (an empty path keeps all)
+   * @param format the source format
+   * @throw ParsingAttributeError when an error occured while reading the file
+   * (the config is left unchanged)
+   */
+  void
+  load(std::istream& inputStream, const std::vector<std::string>& prefixes,
+       Format format = FORMAT_INFO) {
+    ConfigStore store;
+    AttrSelector selector(store, prefixes);
+    readAttr(inputStream, selector, format);
+
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    store_.swap(store);
+  }
+
   /**
    * @brief save the config
    * @param output the output stream
@@ -91,6 +128,12 @@ public:
       case FORMAT_XML:
         write_xml(output, store_);
         break;
+      case FORMAT_BINARY: {
+        std::string data;
+        detail::writeBinary(data, store_);
+        output.write(data.data(), data.size());
+        break;
+      }
       case FORMAT_INFO:
       default:
         write_info(output, store_);
@@ -55,11 +55,13 @@ public:
 
   /**
    * @brief takes a Cori request and return metrics
-   * @param filter Cori request
+   * @param filter Cori request (empty: every metric listed by plugins)
+   * @param format format of the default request (FORMAT_BINARY only if
+   * every plugin parses its filter with loadAttr())
    * @return
    */
   Attributes
-  getMetrics(const std::string& filter);
+  getMetrics(const std::string& filter, int format = FORMAT_XML);
 
 private:
   std::vector<ICori *> plugins; /**< ICori plugins loaded */
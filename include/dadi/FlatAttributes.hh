@@ -0,0 +1,581 @@
+/**
+ * @file   FlatAttributes.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  attributes stored in a flat node array
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _FLATATTRIBUTES_HH_
+#define _FLATATTRIBUTES_HH_
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include "Exception/Attributes.hh"
+#include "detail/AttrValue.hh"
+#include "detail/Parsers.hh"
+
+namespace dadi {
+
+namespace detail {
+class BinaryReader;
+class BinaryWriter;
+}
+
+/**
+ * @class FlatAttributes
+ * @brief attributes with the Attributes API, without a property tree
+ *
+ * Nodes live in a single array and link to their first child and next
+ * sibling by index. Keys are interned by each instance along with their
+ * hash: a node only holds the index of its key, and the key table goes
+ * away with the attributes. Integers, numbers and booleans are stored
+ * as such, values are converted only when read as another type, exactly as
+ * Attributes (ie: boost::property_tree) would convert them.
+ */
+class FlatAttributes {
+public:
+  /**
+   * @class Path
+   * @brief precompiled attribute path
+   *
+   * Keys of the path are split and hashed once, a lookup through a Path
+   * compares hashes, and strings only when they match.
+   */
+  class Path {
+  public:
+    /**
+     * @brief constructor
+     * @param path attribute path (ie: "rotate.size")
+     */
+    explicit Path(const std::string& path);
+
+    /**
+     * @brief get the path
+     * @return attribute path
+     */
+    const std::string&
+    str() const;
+
+  private:
+    friend class FlatAttributes;
+
+    std::string path_; /**< attribute path */
+    std::vector<std::string> keys_; /**< keys */
+    std::vector<std::size_t> hashes_; /**< hashes of the keys */
+  };
+
+  /**
+   * @brief default constructor
+   */
+  FlatAttributes();
+  /**
+   * @brief constructor from serialized data
+   * @param data serialized data
+   * @param format XML by default
+   */
+  explicit FlatAttributes(const std::string& data, int format = FORMAT_XML);
+
+  /* accessors */
+  /**
+   * @brief get value associated to path
+   * @param path attribute path
+   * @return expected value
+   * @throw dadi::UnknownAttributeError
+   * @throw dadi::InvalidAttributeError
+   */
+  template<typename T> T
+  getAttr(const std::string& path) const {
+    return get<T>(find(path), path);
+  }
+  /**
+   * @brief get value associated to a precompiled path
+   * @param path attribute path
+   * @return expected value
+   * @throw dadi::UnknownAttributeError
+   * @throw dadi::InvalidAttributeError
+   */
+  template<typename T> T
+  getAttr(const Path& path) const {
+    return get<T>(find(path), path.str());
+  }
+  /**
+   * @brief get value associated to path or send default value
+   * (if attribute does not exist or is invalid)
+   * @param path path to attribute
+   * @param default_value default value to return
+   * @return expected value or default
+   */
+  template<typename T> T
+  getAttr(const std::string& path, T default_value) const {
+    return getDefault(find(path), default_value);
+  }
+  /**
+   * @brief get value associated to a precompiled path or send default value
+   * (if attribute does not exist or is invalid)
+   * @param path path to attribute
+   * @param default_value default value to return
+   * @return expected value or default
+   */
+  template<typename T> T
+  getAttr(const Path& path, T default_value) const {
+    return getDefault(find(path), default_value);
+  }
+  /**
+   * @brief get the list of values associated to path and store it
+   * in a sequence (see Attributes::getAttrList())
+   * @param path path to attribute
+   * @throw dadi::UnknownAttributeError
+   * @throw dadi::InvalidAttributeError
+   */
+  template<class Sequence>
+  Sequence
+  getAttrList(const std::string& path) const {
+    typedef typename Sequence::value_type value_type;
+    Sequence seq;
+
+    // only one key, return a sequence with one value
+    std::string::size_type pos = path.rfind('.');
+    if (std::string::npos == pos) {
+      seq.push_back(getAttr<value_type>(path));
+      return seq;
+    }
+
+    const std::string key = path.substr(0, pos);
+    const std::string subkey = path.substr(pos + 1);
+    boost::uint32_t node = find(key);
+    if (NPOS == node) {
+      throwUnknown(key);
+    }
+    for (boost::uint32_t child = nodes_[node].child; child;
+         child = nodes_[child].next) {
+      if (keys_[nodes_[child].key] == subkey) {
+        value_type value = value_type();
+        if (!decode(nodes_[child].value, value,
+                    typename detail::AttrCategory<value_type>::type())) {
+          throwInvalid(path);
+        }
+        seq.push_back(value);
+      }
+    }
+
+    return seq;
+  }
+
+  /* modifiers */
+  /**
+   * @brief update a node to attributes (or create it if it doesn't exist)
+   * @param path path to attribute
+   * @param value attribute new value
+   */
+  template<typename T> void
+  putAttr(const std::string& path, T value) {
+    encode(force(path), value, typename detail::AttrCategory<T>::type());
+  }
+  /**
+   * @brief update a node to attributes (or create it if it doesn't exist)
+   * @param path precompiled path to attribute
+   * @param value attribute new value
+   */
+  template<typename T> void
+  putAttr(const Path& path, T value) {
+    encode(force(path), value, typename detail::AttrCategory<T>::type());
+  }
+  /**
+   * @brief add a new node to attributes
+   * @param path path to attribute
+   * @param value attribute new value
+   */
+  template<typename T> void
+  addAttr(const std::string& path, T value) {
+    encode(add(path), value, typename detail::AttrCategory<T>::type());
+  }
+
+  /**
+   * @brief deserialize attributes
+   * @param[in] data serialized attributes
+   * @param format XML by default (binary data is always recognized)
+   * @throw dadi::ParsingAttributeError
+   */
+  void
+  loadAttr(const std::string& data, int format = FORMAT_XML);
+  /**
+   * @brief deserialize attributes from memory, without copying the buffer
+   * @param[in] data serialized attributes
+   * @param size data size
+   * @param format format (binary data is always recognized)
+   * @throw dadi::ParsingAttributeError
+   */
+  void
+  loadAttr(const char *data, std::size_t size, int format);
+  /**
+   * @brief serialize attributes
+   * @param format XML by default
+   * @return serialized attribute
+   * @throw dadi::ParsingAttributeError
+   */
+  std::string
+  saveAttr(int format = FORMAT_XML) const;
+  /**
+   * @brief serialize attributes into a buffer (its storage is reused),
+   * values keep their type in FORMAT_BINARY
+   * @param[out] data serialized attributes (replaced)
+   * @param format XML by default
+   * @throw dadi::ParsingAttributeError
+   */
+  void
+  saveAttr(std::string& data, int format = FORMAT_XML) const;
+  /**
+   * @brief replace attributes by a property tree
+   * @param tree property tree
+   */
+  void
+  fromTree(const ConfigStore& tree);
+  /**
+   * @brief copy attributes into a property tree
+   * @param[out] tree property tree (replaced)
+   */
+  void
+  toTree(ConfigStore& tree) const;
+
+  /**
+   * @brief swap attributes
+   * @param from another attribute
+   */
+  void
+  swap(FlatAttributes& from);
+
+  /* operators */
+  /**
+   * @brief comparison operator (values are compared as strings)
+   * @param other object object to compare
+   * @return boolean
+   */
+  bool
+  operator==(const FlatAttributes& other) const;
+  /**
+   * @brief comparison operator
+   * @param other object to compare
+   * @return boolean
+   */
+  bool
+  operator!=(const FlatAttributes& other) const;
+  /**
+   * @brief merge another set of attributes: its leaves are added unless
+   * they already exist with the same value
+   * @param other object to merge
+   */
+  void
+  merge(const FlatAttributes& other);
+
+  /**
+   * @brief number of string slots, free ones included
+   * @return slot count
+   */
+  std::size_t
+  stringSlots() const {
+    return strings_.size();
+  }
+
+private:
+  class Merger;
+  friend class Merger;
+
+  /**
+   * @struct Node
+   * @brief attribute node
+   */
+  struct Node {
+    boost::uint32_t key; /**< key index (the empty key for the root) */
+    boost::uint32_t child; /**< first child (0: none) */
+    boost::uint32_t last; /**< last child (0: none) */
+    boost::uint32_t next; /**< next sibling (0: none) */
+    detail::AttrValue value; /**< node value */
+  };
+
+  /** not found */
+  static const boost::uint32_t NPOS = 0xffffffff;
+
+  /**
+   * @brief find a node
+   * @param path attribute path (empty: root)
+   * @return node index (NPOS if not found)
+   */
+  boost::uint32_t
+  find(const std::string& path) const;
+  /**
+   * @brief find a node
+   * @param path precompiled path
+   * @return node index (NPOS if not found)
+   */
+  boost::uint32_t
+  find(const Path& path) const;
+  /**
+   * @brief find a node, creating missing ones
+   * @param path attribute path
+   * @return node index
+   */
+  boost::uint32_t
+  force(const std::string& path);
+  /**
+   * @brief find a node, creating missing ones
+   * @param path precompiled path
+   * @return node index
+   */
+  boost::uint32_t
+  force(const Path& path);
+  /**
+   * @brief add a node, creating missing parents
+   * @param path attribute path
+   * @return node index
+   */
+  boost::uint32_t
+  add(const std::string& path);
+  /**
+   * @brief add a child node
+   * @param parent parent index
+   * @param key key index
+   * @return node index
+   */
+  boost::uint32_t
+  append(boost::uint32_t parent, boost::uint32_t key);
+  /**
+   * @brief intern a key
+   * @param key key
+   * @return key index
+   */
+  boost::uint32_t
+  intern(const std::string& key);
+  /**
+   * @brief compare the key of a node with a key of a precompiled path
+   * @param node node index
+   * @param path precompiled path
+   * @param i key of the path
+   * @return true if keys are equal
+   */
+  bool
+  hasKey(boost::uint32_t node, const Path& path, std::size_t i) const;
+  /**
+   * @brief render a value as a string
+   * @param value value
+   * @return string
+   */
+  std::string
+  render(const detail::AttrValue& value) const;
+  /**
+   * @brief store a string value
+   * @param node node index
+   * @param data string
+   */
+  void
+  setString(boost::uint32_t node, const std::string& data);
+  /**
+   * @brief change the stored type of a node, freeing its string slot
+   * @param node node index
+   * @param type new type (not STRING, see setString)
+   * @return node value
+   */
+  detail::AttrValue&
+  setType(boost::uint32_t node, int type);
+  /**
+   * @brief compare two subtrees
+   * @param other other attributes
+   * @param node node index
+   * @param otherNode node index in other
+   * @return true if subtrees are equal
+   */
+  bool
+  equal(const FlatAttributes& other, boost::uint32_t node,
+        boost::uint32_t otherNode) const;
+  /**
+   * @brief copy a property tree below a node
+   * @param tree property tree
+   * @param node node index
+   */
+  void
+  fromTree(const ConfigStore& tree, boost::uint32_t node);
+  /**
+   * @brief copy a subtree into a property tree
+   * @param[out] tree property tree
+   * @param node node index
+   */
+  void
+  toTree(ConfigStore& tree, boost::uint32_t node) const;
+  /**
+   * @brief write a subtree in FORMAT_BINARY
+   * @param writer binary writer
+   * @param node node index
+   */
+  void
+  writeNode(detail::BinaryWriter& writer, boost::uint32_t node) const;
+  /**
+   * @brief read a subtree in FORMAT_BINARY
+   * @param reader binary reader
+   * @param node node index
+   */
+  void
+  readNode(detail::BinaryReader& reader, boost::uint32_t node);
+  /**
+   * @throw dadi::UnknownAttributeError
+   */
+  static void
+  throwUnknown(const std::string& path);
+  /**
+   * @throw dadi::InvalidAttributeError
+   */
+  static void
+  throwInvalid(const std::string& path);
+
+  /* read a node value, throws as Attributes::getAttr() */
+  template<typename T> T
+  get(boost::uint32_t node, const std::string& path) const {
+    if (NPOS == node) {
+      throwUnknown(path);
+    }
+    T value = T();
+    if (!decode(nodes_[node].value, value,
+                typename detail::AttrCategory<T>::type())) {
+      throwInvalid(path);
+    }
+    return value;
+  }
+
+  /* read a node value, defaults as Attributes::getAttr() */
+  template<typename T> T
+  getDefault(boost::uint32_t node, T default_value) const {
+    T value = T();
+    if ((NPOS == node) ||
+        !decode(nodes_[node].value, value,
+                typename detail::AttrCategory<T>::type())) {
+      return default_value;
+    }
+    return value;
+  }
+
+  /* typed storage, see detail::AttrCategory */
+  template<typename T> void
+  encode(boost::uint32_t node, const T& value, detail::AttrIntTag) {
+    // unsigned values beyond int64 are kept as strings
+    if (!std::numeric_limits<T>::is_signed &&
+        (static_cast<boost::uint64_t>(value) >
+         static_cast<boost::uint64_t>(
+           std::numeric_limits<boost::int64_t>::max()))) {
+      setString(node, detail::toString(value));
+      return;
+    }
+    setType(node, detail::AttrValue::INT).i =
+      static_cast<boost::int64_t>(value);
+  }
+
+  template<typename T> void
+  encode(boost::uint32_t node, const T& value, detail::AttrFloatTag) {
+    setType(node, boost::is_same<T, float>::value ?
+            detail::AttrValue::FLOAT : detail::AttrValue::DOUBLE).d = value;
+  }
+
+  template<typename T> void
+  encode(boost::uint32_t node, const T& value, detail::AttrBoolTag) {
+    setType(node, detail::AttrValue::BOOL).b = value;
+  }
+
+  template<typename T> void
+  encode(boost::uint32_t node, const T& value, detail::AttrStringTag) {
+    setString(node, value);
+  }
+
+  template<typename T> void
+  encode(boost::uint32_t node, const T& value, detail::AttrOtherTag) {
+    typename boost::property_tree::translator_between<std::string, T>::type
+      tr;
+    boost::optional<std::string> data = tr.put_value(value);
+    if (!data) {
+      throwInvalid(keys_[nodes_[node].key]);
+    }
+    setString(node, *data);
+  }
+
+  template<typename T> bool
+  decode(const detail::AttrValue& value, T& res, detail::AttrIntTag) const {
+    if (detail::AttrValue::INT == value.type) {
+      if (!detail::fits<T>(value.i)) {
+        return false;
+      }
+      res = static_cast<T>(value.i);
+      return true;
+    }
+    return detail::fromString(render(value), res);
+  }
+
+  template<typename T> bool
+  decode(const detail::AttrValue& value, T& res, detail::AttrFloatTag) const {
+    switch (value.type) {
+    case detail::AttrValue::INT:
+      res = static_cast<T>(value.i);
+      return true;
+    case detail::AttrValue::FLOAT:
+      // a float read as a double is parsed back from its rendering
+      if (!boost::is_same<T, float>::value) {
+        return detail::fromString(render(value), res);
+      }
+      res = static_cast<T>(value.d);
+      return true;
+    case detail::AttrValue::DOUBLE:
+      res = static_cast<T>(value.d);
+      return true;
+    default:
+      return detail::fromString(render(value), res);
+    }
+  }
+
+  template<typename T> bool
+  decode(const detail::AttrValue& value, T& res, detail::AttrBoolTag) const {
+    if (detail::AttrValue::BOOL == value.type) {
+      res = value.b;
+      return true;
+    }
+    return detail::fromString(render(value), res);
+  }
+
+  template<typename T> bool
+  decode(const detail::AttrValue& value, T& res,
+         detail::AttrStringTag) const {
+    if (detail::AttrValue::STRING == value.type) {
+      res = strings_[value.s];
+    } else {
+      res = render(value);
+    }
+    return true;
+  }
+
+  template<typename T> bool
+  decode(const detail::AttrValue& value, T& res, detail::AttrOtherTag) const {
+    return detail::fromString(render(value), res);
+  }
+
+  /** key indexes */
+  typedef boost::unordered_map<std::string, boost::uint32_t> KeyIndex;
+
+  std::vector<Node> nodes_; /**< nodes, the first one being the root */
+  std::vector<std::string> strings_; /**< string values */
+  std::vector<boost::uint32_t> freeStrings_; /**< free slots in strings_ */
+  std::vector<std::string> keys_; /**< keys, by index */
+  std::vector<std::size_t> hashes_; /**< hashes of the keys, by index */
+  KeyIndex keyIndex_; /**< index of each key */
+};
+
+/**
+ * @brief serialize attributes
+ * @param attr attributes
+ * @param format XML by default
+ * @return serialized attributes
+ */
+std::string
+str(const FlatAttributes& attr, int format = 0);
+
+} /* namespace dadi */
+
+#endif  /* _FLATATTRIBUTES_HH_ */
@@ -10,13 +10,20 @@
 #ifndef _LOGGING_HH_
 #define _LOGGING_HH_
 
+#include "Logging/BinaryFileChannel.hh"
 #include "Logging/Channel.hh"
-#include "Logging/Consolechannel.hh"
+#include "Logging/Clock.hh"
+#include "Logging/Compressor.hh"
+#include "Logging/ConsoleChannel.hh"
 #include "Logging/FileChannel.hh"
 #include "Logging/FileStrategy.hh"
+#include "Logging/Formatter.hh"
+#include "Logging/LogConfigurator.hh"
 #include "Logging/Logger.hh"
+#include "Logging/Macros.hh"
 #include "Logging/Message.hh"
 #include "Logging/NullChannel.hh"
+#include "Logging/RateLimiter.hh"
 
 /**
  * @example simple-logging/main.cc
@@ -13,6 +13,7 @@
 #include <string>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace dadi {
 
@@ -34,9 +35,61 @@ public:
    * @brief do the actual archiving
    * @warning must be reimplemented by implementors
    * @param path file to be archived
+   * @return archive file path
    */
-  virtual void
+  virtual std::string
   archive(const std::string& path) = 0;
+  /**
+   * @brief archive a file set aside from the log file (ie: compressed out
+   * of the logging path), existing archives are renamed as archive() does
+   * @param path log file path
+   * @param file file to archive
+   * @param suffix suffix of file (empty if it has not been compressed)
+   * @return archive file path (suffix included)
+   * @throw NotImplementedError unless reimplemented
+   */
+  virtual std::string
+  archiveFile(const std::string& path, const std::string& file,
+              const std::string& suffix);
+  /**
+   * @brief set suffix appended to archives once archived (ie: ".gz" when
+   * archives are compressed afterwards), so that existing archives are
+   * recognized
+   * @param suffix archives suffix
+   */
+  void
+  setSuffix(const std::string& suffix);
+  /**
+   * @brief get archives suffix
+   * @return archives suffix
+   */
+  const std::string&
+  getSuffix() const;
+  /**
+   * @brief check if last archiving renamed existing archives
+   * @return true if existing archives have been renamed
+   */
+  bool
+  hasRenamed() const;
+  /**
+   * @brief get regular expression matching archive names, log file name
+   * and its trailing dot excepted (named groups: "key" sorts archives from
+   * the oldest, a greater "seq" is older)
+   * @return pattern (suffix optional)
+   */
+  std::string
+  getPattern() const;
+protected:
+  /**
+   * @brief get regular expression matching archive names (no suffix)
+   * @warning must be reimplemented by implementors
+   * @return pattern
+   */
+  virtual std::string
+  getNamePattern() const = 0;
+
+  std::string suffix_; /**< suffix of existing archives */
+  bool renamed_; /**< last archiving renamed existing archives */
 };
 
 /*****************************************************************************/
@@ -58,10 +111,24 @@ public:
   /**
    * @brief archive current log file
    * @param path current log file path
+   * @return archive file path
    */
-  void
+  std::string
   archive(const std::string& path);
+  /**
+   * @brief archive a file set aside from the log file
+   * @param path current log file path
+   * @param file file to archive
+   * @param suffix suffix of file
+   * @return archive file path
+   */
+  std::string
+  archiveFile(const std::string& path, const std::string& file,
+              const std::string& suffix);
 protected:
+  std::string
+  getNamePattern() const;
+
   static const std::string pTpl_; /**< template archive filename */
 };
 
@@ -93,15 +160,96 @@ public:
   /**
    * @brief archive current log filex
    * @param path current log file path
+   * @return archive file path
    */
-  void
+  std::string
   archive(const std::string& path);
+  /**
+   * @brief archive a file set aside from the log file
+   * @param path current log file path
+   * @param file file to archive
+   * @param suffix suffix of file
+   * @return archive file path
+   */
+  std::string
+  archiveFile(const std::string& path, const std::string& file,
+              const std::string& suffix);
+protected:
+  std::string
+  getNamePattern() const;
 private:
   const std::string tpl_;
   boost::scoped_ptr<std::locale> locale_; /**< locale with custom time_facet */
   bool local_; /**< use local time or utc (utc by default) */
 };
 
+/*****************************************************************************/
+
+/**
+ * @class ArchiveByGenerationStrategy
+ * @brief implement archiving by generation strategy
+ *
+ * Archives are named <em>filename</em>.<em>generation</em>, the newest archive
+ * having the highest generation, so that archiving is a single rename.
+ * The last generation is recovered by scanning the directory once, on first
+ * archiving.
+ */
+class ArchiveByGenerationStrategy : public ArchiveStrategy {
+public:
+  /**
+   * @brief constructor
+   */
+  ArchiveByGenerationStrategy();
+  /**
+   * @brief destructor
+   */
+  ~ArchiveByGenerationStrategy();
+  /**
+   * @brief archive current log file
+   * @param path current log file path
+   * @return archive file path
+   */
+  std::string
+  archive(const std::string& path);
+  /**
+   * @brief archive a file set aside from the log file
+   * @param path current log file path
+   * @param file file to archive
+   * @param suffix suffix of file
+   * @return archive file path
+   */
+  std::string
+  archiveFile(const std::string& path, const std::string& file,
+              const std::string& suffix);
+  /**
+   * @brief get generation of next archive
+   * @return generation
+   */
+  unsigned long
+  getNextGeneration() const;
+protected:
+  std::string
+  getNamePattern() const;
+private:
+  /**
+   * @brief recover existing archives from the directory
+   * @param path current log file path
+   */
+  void
+  load(const std::string& path);
+  /**
+   * @brief build archive path
+   * @param generation archive generation
+   * @return archive path (without suffix)
+   */
+  std::string
+  getArchivePath(unsigned long generation) const;
+
+  std::string path_; /**< log file path (empty until loaded) */
+  unsigned long next_; /**< generation of next archive */
+  mutable boost::mutex mutex_; /**< mutex protecting generation */
+};
+
 } /* namespace dadi */
 
 #endif  /* _ARCHIVESTRATEGY_HH_ */
@@ -0,0 +1,159 @@
+/**
+ * @file   Logging/BinaryFileChannel.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines a file channel writing binary records, and their reader
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _BINARYFILECHANNEL_HH_
+#define _BINARYFILECHANNEL_HH_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include "dadi/Logging/FileChannel.hh"
+
+namespace dadi {
+
+class Message;
+
+/**
+ * @class BinaryFileChannel
+ * @brief FileChannel writing messages as compact binary records
+ *
+ * Messages are not formatted: their fields are written as length-prefixed
+ * records, integers being encoded as variable-length integers (LEB128) and
+ * times as deltas from the previous message. Sources, source filenames and
+ * tag keys are interned: each string is written once per log file in a
+ * dictionary record, messages refer to it by index. Every log file starts
+ * with a magic number and its own dictionary, so that archives can be
+ * decoded on their own (see BinaryLogReader and dadi-logcat).
+ *
+ * Layout (integers are varints):
+ * - file: magic ("\0DADIBL" followed by the format version), records
+ * - record: payload size, payload
+ * - string payload: REC_STRING, index, bytes
+ * - message payload: REC_MESSAGE, priority (1 byte), zigzag time delta (ns),
+ *   source index, filename index + 1 (0: empty), zigzag line, tags count,
+ *   tags (key index, value size, value bytes), text bytes
+ *
+ * properties supported: see FileChannel (pattern is ignored)
+ */
+class BinaryFileChannel : public FileChannel {
+public:
+  /**
+   * @enum RecordType
+   * @brief list record types
+   */
+  enum RecordType {
+    REC_STRING = 1, /**< dictionary entry */
+    REC_MESSAGE /**< log message */
+  };
+
+  static const char MAGIC[8]; /**< file magic number (with version) */
+
+  /**
+   * @brief default constructor
+   * @warning you need to set log file path either by using the appropriate
+   * constructor or by setting in the attributes (key: "path")
+   */
+  BinaryFileChannel();
+  /**
+   * @brief constructor
+   * @param path log file path
+   */
+  explicit BinaryFileChannel(const std::string& path);
+
+  /**
+   * @brief log message
+   * @param msg message to be logged
+   */
+  void
+  log(const Message& msg);
+protected:
+  void
+  encode(const Message& msg, std::string& out);
+  void
+  writePreamble(std::string& out);
+private:
+  /**
+   * @brief get index of a string, writing its dictionary record if needed
+   * @param str string
+   * @param out buffer receiving records
+   * @return string index
+   */
+  boost::uint32_t
+  intern(const std::string& str, std::string& out);
+
+  /** interned strings */
+  typedef boost::unordered_map<std::string, boost::uint32_t> Strings;
+  /** interned strings of the current log file */
+  Strings strings_;
+  /** filenames by address (mostly __FILE__ literals), names are compared
+   * as copied filenames may reuse an address */
+  boost::unordered_map<const char *, const Strings::value_type *> files_;
+  std::string sourceName_; /**< source of the previous message */
+  boost::int64_t lastSource_; /**< its index (-1: none) */
+  std::vector<boost::uint32_t> keys_; /**< tag keys being encoded */
+  boost::int64_t lastTime_; /**< time of the previous message (ns) */
+};
+
+/**
+ * @class BinaryLogReader
+ * @brief decodes files written by BinaryFileChannel
+ *
+ * Concatenated log files are supported: a magic number resets the
+ * dictionary. A truncated trailing record (ie: crash while writing) ends the
+ * stream.
+ */
+class BinaryLogReader {
+public:
+  /**
+   * @brief constructor
+   * @param in stream to be decoded (opened in binary mode)
+   */
+  explicit BinaryLogReader(std::istream& in);
+
+  /**
+   * @brief decode next message
+   * @param msg message receiving the decoded fields
+   * @return false at the end of the stream
+   * @throw dadi::Error if the stream is not a binary log
+   */
+  bool
+  next(Message& msg);
+  /**
+   * @brief check if the stream ended with a truncated record
+   * @return true if the last record was truncated
+   */
+  bool
+  isTruncated() const;
+private:
+  /**
+   * @brief read a varint from the stream
+   * @param value decoded value
+   * @return false at the end of the stream
+   */
+  bool
+  readVarint(boost::uint64_t& value);
+  /**
+   * @brief read and check the magic number (first byte already read)
+   */
+  void
+  readMagic();
+
+  std::istream& in_; /**< decoded stream */
+  std::vector<std::string> strings_; /**< dictionary of the current file */
+  boost::int64_t lastTime_; /**< time of the previous message (ns) */
+  std::string record_; /**< record being decoded */
+  bool magic_; /**< true if a magic number has been read */
+  bool truncated_; /**< true if the last record was truncated */
+};
+
+} /* namespace dadi */
+
+#endif  /* _BINARYFILECHANNEL_HH_ */
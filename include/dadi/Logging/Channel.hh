@@ -13,6 +13,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include "dadi/Attributes.hh"
+#include "dadi/Logging/Formatter.hh"
 
 namespace dadi {
 
@@ -21,6 +22,10 @@ class Message;
 /**
  * @class Channel
  * @brief channels abstract base class
+ *
+ * Channels render messages with a Formatter configured by the "pattern"
+ * attribute (see Formatter), compiled when the channel is opened.
+ * By default, only the message text is written.
  */
 class Channel : public dadi::Attributes {
 public:
@@ -43,6 +48,11 @@ public:
    */
   virtual void
   close();
+  /**
+   * @brief flush pending messages (does nothing by default)
+   */
+  virtual void
+  flush();
   /**
    * @brief logs message
    * @param msg Message to be logged
@@ -50,6 +60,24 @@ public:
    */
   virtual void
   log(const Message& msg) = 0;
+
+protected:
+  /**
+   * @brief compile formatter from the pattern attribute
+   */
+  void
+  setFormatter();
+  /**
+   * @brief render message
+   * @param msg Message to render
+   * @return rendered message, valid until the next call in the same thread
+   */
+  const std::string&
+  format(const Message& msg) const;
+
+  static const std::string ATTR_PATTERN; /**< attribute pattern key */
+
+  Formatter formatter_; /**< message formatter */
 };
 
 /**
@@ -0,0 +1,89 @@
+/**
+ * @file   Logging/Clock.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  cheap clock used to timestamp log messages
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _CLOCK_HH_
+#define _CLOCK_HH_
+
+#include <boost/cstdint.hpp>
+
+namespace dadi {
+
+/**
+ * @struct Timestamp
+ * @brief wall-clock and monotonic time taken at the same instant
+ */
+struct Timestamp {
+  /**
+   * @brief default constructor (epoch)
+   */
+  Timestamp() : wall(0), monotonic(0) {}
+
+  boost::int64_t wall; /**< nanoseconds since epoch (UTC) */
+  boost::int64_t monotonic; /**< nanoseconds since an unspecified point */
+};
+
+/**
+ * @class Clock
+ * @brief process-wide clock used to timestamp messages
+ *
+ * Three sources are available:
+ * - SOURCE_PRECISE: reads the system clocks on each call (best resolution)
+ * - SOURCE_COARSE: reads the kernel coarse clocks (CLOCK_REALTIME_COARSE,
+ *   a few nanoseconds per call, resolution of a scheduler tick), falls back
+ *   to SOURCE_PRECISE when unavailable
+ * - SOURCE_TICKER: returns a cached value refreshed by a background thread
+ *   at a configurable interval
+ *
+ * Timestamps are expressed in nanoseconds whatever the source resolution.
+ */
+class Clock {
+public:
+  /**
+   * @enum Source
+   * @brief clock sources
+   */
+  enum Source {
+    SOURCE_PRECISE = 0, /**< system clocks */
+    SOURCE_COARSE, /**< coarse system clocks */
+    SOURCE_TICKER /**< cached time refreshed by a thread */
+  };
+
+  static const long DEFAULT_TICK; /**< default ticker interval (us) */
+
+  /**
+   * @brief get current time
+   * @return timestamp taken from the current source
+   */
+  static Timestamp
+  now();
+  /**
+   * @brief get precise monotonic time whatever the source, to measure
+   * durations
+   * @return nanoseconds since an unspecified point
+   */
+  static boost::int64_t
+  monotonic();
+  /**
+   * @brief set clock source
+   * @param source clock source
+   * @param tick ticker refresh interval in microseconds (SOURCE_TICKER only)
+   */
+  static void
+  setSource(int source, long tick = DEFAULT_TICK);
+  /**
+   * @brief get clock source
+   * @return current clock source
+   */
+  static int
+  getSource();
+};
+
+} /* namespace dadi */
+
+#endif  /* _CLOCK_HH_ */
@@ -0,0 +1,156 @@
+/**
+ * @file   Logging/Compressor.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compresses files with a pool of background threads
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _COMPRESSOR_HH_
+#define _COMPRESSOR_HH_
+
+#include <deque>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace dadi {
+
+/**
+ * @class Compressor
+ * @brief compresses files in background threads
+ *
+ * Each file is compressed into <em>path</em><em>extension</em> (ie: .gz),
+ * then the original file is removed. zstd is only available if Boost
+ * Iostreams has been built with it (DADI_HAVE_ZSTD), gzip is used instead
+ * otherwise.
+ */
+class Compressor : public boost::noncopyable {
+public:
+  /**
+   * @enum Format
+   * @brief compression formats
+   */
+  enum Format {
+    FORMAT_NONE = 0, /**< no compression */
+    FORMAT_BZIP2, /**< bzip2 (.bz2) */
+    FORMAT_GZIP, /**< gzip (.gz) */
+    FORMAT_ZLIB, /**< zlib (.z) */
+    FORMAT_ZSTD /**< zstd (.zst) */
+  };
+
+  /**
+   * callback called from a worker once a file has been processed,
+   * with the compressed file path (or the original path on failure)
+   */
+  typedef boost::function<void (const std::string&)> Callback;
+
+  static const int DEFAULT_LEVEL; /**< format default compression level */
+
+  /**
+   * @brief constructor (starts workers)
+   * @param format compression format
+   * @param level compression level (format dependent, ie: 1-9 for gzip)
+   * @param workers number of worker threads
+   */
+  Compressor(int format, int level = DEFAULT_LEVEL, unsigned int workers = 1);
+  /**
+   * @brief destructor (waits for pending files and stops workers)
+   */
+  ~Compressor();
+
+  /**
+   * @brief compress a file in background
+   * @param path file to compress
+   * @param done callback called once file has been processed
+   */
+  void
+  compress(const std::string& path, const Callback& done = Callback());
+  /**
+   * @brief wait until every file submitted so far has been processed
+   */
+  void
+  wait();
+  /**
+   * @brief get number of files not processed yet
+   * @return pending files count
+   */
+  std::size_t
+  getPending() const;
+  /**
+   * @brief get compressed files extension
+   * @return extension (ie: ".gz")
+   */
+  const std::string&
+  getExtension() const;
+
+  /**
+   * @brief check if a format is supported
+   * @param format compression format
+   * @return true if supported
+   */
+  static bool
+  isAvailable(int format);
+  /**
+   * @brief get extension of a format
+   * @param format compression format
+   * @return extension (empty for FORMAT_NONE)
+   */
+  static std::string
+  getExtension(int format);
+  /**
+   * @brief push a compressor filter on a stream
+   * @param out stream
+   * @param format compression format
+   * @param level compression level
+   */
+  static void
+  push(boost::iostreams::filtering_ostream& out, int format,
+       int level = DEFAULT_LEVEL);
+  /**
+   * @brief compress a file, then remove it
+   * @param path file to compress
+   * @param format compression format
+   * @param level compression level
+   * @return compressed file path
+   */
+  static std::string
+  compressFile(const std::string& path, int format,
+               int level = DEFAULT_LEVEL);
+
+private:
+  /**
+   * @struct Job
+   * @brief file waiting to be compressed
+   */
+  struct Job {
+    std::string path; /**< file to compress */
+    Callback done; /**< completion callback */
+  };
+
+  /**
+   * @brief worker main loop
+   */
+  void
+  run();
+
+  int format_; /**< compression format */
+  int level_; /**< compression level */
+  std::string extension_; /**< compressed files extension */
+  std::deque<Job> jobs_; /**< pending files */
+  std::size_t active_; /**< files being compressed */
+  bool stopped_; /**< workers must exit once jobs are done */
+  mutable boost::mutex mutex_; /**< mutex protecting jobs */
+  boost::condition_variable notEmpty_; /**< signaled on compress */
+  boost::condition_variable idle_; /**< signaled when a job is done */
+  boost::thread_group workers_; /**< worker threads */
+};
+
+} /* namespace dadi */
+
+#endif  /* _COMPRESSOR_HH_ */
@@ -11,6 +11,7 @@
 #define _CONSOLECHANNEL_HH_
 
 #include <iosfwd>
+#include <string>
 #include <boost/thread/mutex.hpp>
 #include "dadi/Logging/Channel.hh"
 
@@ -20,26 +21,77 @@ class Message;
 
 /**
  * @class ConsoleChannel
- * @brief channel that logs into console (std::cout, std::cerr)
+ * @brief channel that logs into console (standard error by default)
  * or any C++ stream
- * It only write message followed by a newline (unix)
+ * It writes formatted messages followed by a newline (unix)
+ *
+ * Each message is rendered into a per-thread buffer, then written to the
+ * file descriptor with a single write(2) and without any lock, so that
+ * lines shorter than PIPE_BUF are never interleaved.
+ * C++ streams are still written under a mutex (on Windows, file
+ * descriptors 1 and 2 are written through std::cout and std::cerr).
+ *
+ * properties supported:
+ * - pattern: see Formatter
+ * - color: colour lines according to their priority with ANSI escape
+ *   codes, values allowed (never (default), always, auto (only if the file
+ *   descriptor is a terminal))
  */
 class ConsoleChannel : public Channel {
 public:
   /**
-   * @brief default constructor (by default: std::cout)
+   * @enum ColorMode
+   * @brief list supported colouring modes
+   */
+  enum ColorMode {
+    COLOR_NEVER = 0, /**< no colours */
+    COLOR_ALWAYS, /**< always colour lines */
+    COLOR_AUTO /**< colour lines if output is a terminal */
+  };
+
+  /**
+   * @brief default constructor (by default: standard error)
    */
   ConsoleChannel();
+  /**
+   * @brief constructor
+   * @param fd file descriptor (ie: 1 for standard output)
+   * @param color colouring mode
+   */
+  explicit ConsoleChannel(int fd, int color = COLOR_NEVER);
   /**
    * @brief constructor
    * @param out C++ stream
    */
   explicit ConsoleChannel(std::ostream& out);
+
+  /**
+   * @brief open channel (compiles pattern, reads colouring mode)
+   */
+  void
+  open();
   void
   log(const Message& msg);
+
+  /**
+   * @brief set colouring mode
+   * @param color colouring mode
+   */
+  void
+  setColor(int color);
+  /**
+   * @brief check if lines are coloured
+   * @return true if lines are coloured
+   */
+  bool
+  isColored() const;
+protected:
+  static const std::string ATTR_COLOR; /**< attribute color key */
 private:
-  std::ostream& out_; /**< C++ stream */
-  boost::mutex mutex_; /**< mutex protecting concurrent access */
+  std::ostream *out_; /**< C++ stream (NULL when writing to fd_) */
+  int fd_; /**< file descriptor */
+  bool color_; /**< colour lines */
+  boost::mutex mutex_; /**< mutex protecting concurrent access to out_ */
 };
 
 } /* namespace dadi */
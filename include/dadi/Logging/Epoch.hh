@@ -0,0 +1,81 @@
+/**
+ * @file   Logging/Epoch.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines epochs protecting objects read on the logging path
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _EPOCH_HH_
+#define _EPOCH_HH_
+
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace dadi {
+
+/**
+ * @class Epoch
+ * @brief lets a writer know when readers are done with replaced objects
+ *
+ * Readers hold a Guard while they use an object published through an
+ * atomic pointer; the writer publishes the new object, then calls
+ * synchronize() before releasing the old one. Guards are counted in one of
+ * two slots chosen by the parity of the epoch: synchronize() starts a new
+ * epoch, then waits for the guards of the previous one, guards taken
+ * meanwhile only see the new object.
+ *
+ * A guard costs two atomic increments, and never waits for the writer.
+ */
+class Epoch : public boost::noncopyable {
+public:
+  /**
+   * @class Guard
+   * @brief reader of the current epoch
+   */
+  class Guard : public boost::noncopyable {
+  public:
+    /**
+     * @brief enter the current epoch
+     * @param epoch epoch
+     */
+    explicit Guard(Epoch& epoch);
+    /**
+     * @brief leave the epoch
+     */
+    ~Guard();
+  private:
+    boost::atomic<unsigned long> *readers_; /**< slot counting this guard */
+  };
+
+  /**
+   * @brief constructor
+   */
+  Epoch();
+
+  /**
+   * @brief start a new epoch, wait for the guards of the previous one
+   * @warning objects must be published (sequentially consistent store)
+   * before, the caller must not hold a guard, and synchronizations of an
+   * epoch must be serialized
+   */
+  void
+  synchronize();
+  /**
+   * @brief start a new epoch on each epoch, then wait for the guards of
+   * their previous ones: one grace period for all of them
+   * @param epochs epochs (may repeat)
+   * @warning same as synchronize()
+   */
+  static void
+  synchronize(const std::vector<Epoch *>& epochs);
+private:
+  boost::atomic<unsigned long> epoch_; /**< current epoch */
+  boost::atomic<unsigned long> readers_[2]; /**< guards, by epoch parity */
+};
+
+} /* namespace dadi */
+
+#endif  /* _EPOCH_HH_ */
@@ -12,12 +12,18 @@
 
 #include <string>
 #include <map>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/regex_fwd.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "dadi/Logging/Channel.hh"
+#include "dadi/Logging/Compressor.hh"
 #include "dadi/Logging/FileStrategy.hh"
+#include "dadi/Logging/MessageQueue.hh"
 
 namespace dadi {
 
@@ -32,14 +38,39 @@ namespace dadi {
  *
  * properties supported:
  * - path: log file path **mandatory**
- * - compression_mode: values allowed (none, bzip, gzip, zlib)
- * - archive: values allowed (none, number, timestamp)
+ * - compression_mode: values allowed (none, bzip, gzip, zlib, zstd)
+ * - archive: values allowed (none, number, timestamp, generation (newest
+ *   archive has the highest number, archiving does not rename archives))
+ * - archive.compression: compress archives in background, values allowed
+ *   (none (default), bzip2, gzip, zlib, zstd)
+ * - archive.compression_level: compression level (default: format default)
+ * - archive.workers: number of compression threads (default: 1)
  * - rotate: values allowed (none, size, interval (format: HH:mm:ss))
  * - rotate.size: maximum file size (bytes)
  * - rotate.time: values allowed (utc, time)
  * - rotate.interval: (format: [day,]HH:mm:ss)
- * - purge: values allowed (none, count, age)
+ * - purge: values allowed (none, count, age, size)
  * - purge.count: maximum number of archives
+ * - purge.age: maximum archive age (format: HH:mm:ss, default: 168:00:00)
+ * - purge.size: maximum archives cumulated size (bytes, k|m|g multipliers
+ *   allowed)
+ * - async: values allowed (true, false), when enabled log() only enqueues
+ *   messages and a background thread writes them
+ * - async.queue_size: maximum number of pending messages
+ * - async.overflow: values allowed (block, drop-newest, drop-lowest)
+ * - flush: when buffered lines are written to the file, values allowed
+ *   (every (default), bytes:N (N buffered bytes), ms:N (oldest line
+ *   buffered for N milliseconds), never (buffer full))
+ * - fsync: when written data is synced to disk, values allowed
+ *   (none (default), interval, on-rotate (before rotation and on flush))
+ * - fsync.interval: delay between two fsync in milliseconds (default: 1000)
+ * - buffer_size: maximum number of buffered bytes (default: 64k)
+ *
+ * Lines are coalesced in memory and written with a single writev(2) (a
+ * write per chunk on Windows). open() throws dadi::Error if the log file
+ * can not be created.
+ * Archives are compressed out of the logging path, archives are purged once
+ * compressed.
  */
 class FileChannel : public Channel {
 public:
@@ -48,10 +79,11 @@ public:
    * @brief list supported compression mode
    */
   enum CompressionMode {
-    COMP_NONE = 0, /**< no compression */
-    COMP_BZIP2, /**< bzip2 compression */
-    COMP_GZIP, /**< gzip compression */
-    COMP_ZLIB /**< zlib compression */
+    COMP_NONE = Compressor::FORMAT_NONE, /**< no compression */
+    COMP_BZIP2 = Compressor::FORMAT_BZIP2, /**< bzip2 compression */
+    COMP_GZIP = Compressor::FORMAT_GZIP, /**< gzip compression */
+    COMP_ZLIB = Compressor::FORMAT_ZLIB, /**< zlib compression */
+    COMP_ZSTD = Compressor::FORMAT_ZSTD /**< zstd compression */
   };
 
   /**
@@ -63,7 +95,9 @@ public:
     /** archive filename pattern: <em>filename</em>>.<em>number++</em> */
     AR_NUMBER,
     /** archive filename pattern: <em>filename</em>.<em>timestamp</em> */
-    AR_TIMESTAMP
+    AR_TIMESTAMP,
+    /** archive filename pattern: <em>filename</em>.<em>generation++</em> */
+    AR_GENERATION
   };
 
   /**
@@ -85,7 +119,29 @@ public:
   enum PurgeMode {
     PURGE_NONE = 0, /**< no purging bébé */
     PURGE_COUNT, /**< purging based on archives number */
-    PURGE_AGE /**< purging based on file age */
+    PURGE_AGE, /**< purging based on file age */
+    PURGE_SIZE /**< purging based on archives cumulated size */
+  };
+
+  /**
+   * @enum FlushMode
+   * @brief list supported flush policies
+   */
+  enum FlushMode {
+    FLUSH_EVERY = 0, /**< write every line (every batch in async mode) */
+    FLUSH_BYTES, /**< write when enough bytes are buffered */
+    FLUSH_MS, /**< write when oldest buffered line is too old */
+    FLUSH_NEVER /**< write when buffer is full */
+  };
+
+  /**
+   * @enum SyncMode
+   * @brief list supported fsync policies
+   */
+  enum SyncMode {
+    SYNC_NONE = 0, /**< leave it to the system */
+    SYNC_INTERVAL, /**< fsync periodically */
+    SYNC_ON_ROTATE /**< fsync before rotation and on flush */
   };
 
   /**
@@ -114,6 +170,11 @@ public:
    */
   void
   close();
+  /**
+   * @brief flush channel (waits for pending messages in async mode)
+   */
+  void
+  flush();
   /**
    * @brief log message
    * @param msg message to be logged
@@ -144,6 +205,12 @@ protected:
   /** attribute compression.mode key */
   static const std::string ATTR_COMPRESSION_MODE;
   static const std::string ATTR_ARCHIVE; /**< attribute archive key */
+  /** attribute archive.compression key */
+  static const std::string ATTR_ARCHIVE_COMPRESSION;
+  /** attribute archive.compression_level key */
+  static const std::string ATTR_ARCHIVE_COMPRESSION_LEVEL;
+  /** attribute archive.workers key */
+  static const std::string ATTR_ARCHIVE_WORKERS;
   static const std::string ATTR_ROTATE; /**< attribute rotate key */
   static const std::string ATTR_ROTATE_SIZE; /**< attribute rotate.size key */
   static const std::string ATTR_ROTATE_TIME; /**< attribute rotate.time key */
@@ -151,6 +218,18 @@ protected:
   static const std::string ATTR_ROTATE_INTERVAL;
   static const std::string ATTR_PURGE; /**< attribute purge key */
   static const std::string ATTR_PURGE_COUNT; /**< attribute purge.count key */
+  static const std::string ATTR_PURGE_AGE; /**< attribute purge.age key */
+  static const std::string ATTR_PURGE_SIZE; /**< attribute purge.size key */
+  static const std::string ATTR_ASYNC; /**< attribute async key */
+  /** attribute async.queue_size key */
+  static const std::string ATTR_ASYNC_QUEUE_SIZE;
+  /** attribute async.overflow key */
+  static const std::string ATTR_ASYNC_OVERFLOW;
+  static const std::string ATTR_FLUSH; /**< attribute flush key */
+  static const std::string ATTR_FSYNC; /**< attribute fsync key */
+  /** attribute fsync.interval key */
+  static const std::string ATTR_FSYNC_INTERVAL;
+  static const std::string ATTR_BUFFER_SIZE; /**< attribute buffer_size key */
   // filter rotate.interval when using time rotate policy
   static const boost::regex regex1; /**< regular expression @internal */
   static std::map<std::string, int> attrMap; /**< properties map */
@@ -170,19 +249,168 @@ protected:
    */
   void
   setPurgeStrategy();
+  /**
+   * @brief set flush and fsync policies
+   */
+  void
+  setFlushPolicy();
+  /**
+   * @brief start background writer if async mode is enabled
+   */
+  void
+  setAsyncMode();
+  /**
+   * @brief open log file and push it at the end of the stream
+   */
+  void
+  openFile();
 
   /**
-   * @brief purge archives
+   * @brief buffer a line, writing it according to the flush policy
+   * @param line line to be written (without newline)
+   */
+  void
+  append(const std::string& line);
+  /**
+   * @brief write buffered lines, followed by line if any
+   * @param line line to be written (without newline) or NULL
+   */
+  void
+  commit(const std::string *line = NULL);
+  /**
+   * @brief check if buffered lines must be written
+   * @return true if flush policy requires a write
+   */
+  bool
+  mustCommit() const;
+  /**
+   * @brief fsync log file if data has been written since last sync
+   */
+  void
+  sync();
+  /**
+   * @brief flusher thread main loop (ms:N flush policy and fsync interval)
+   * @param period wake up period in milliseconds
    */
   void
-  purge();
+  runFlusher(long period);
+
+  /**
+   * @brief render a message as a record appended to out (default: formatted
+   * line followed by a newline)
+   * @param msg message to be rendered
+   * @param out buffer receiving the record
+   *
+   * Called with the channel locked, so that records may depend on what has
+   * already been written in the current log file.
+   */
+  virtual void
+  encode(const Message& msg, std::string& out);
+  /**
+   * @brief render the preamble of a new log file (default: nothing)
+   * @param out buffer receiving the preamble
+   *
+   * Called with the channel locked each time a log file is created.
+   */
+  virtual void
+  writePreamble(std::string& out);
+  /**
+   * @brief log a message rendered by encode()
+   * @param msg message to be logged
+   *
+   * Text lines are rendered before locking the channel, channels overriding
+   * encode() must log through this method instead.
+   */
+  void
+  logRecord(const Message& msg);
+  /**
+   * @brief write a batch of messages (async mode writer)
+   * @param batch messages to be written
+   */
+  void
+  write(const MessageQueue::Batch& batch);
+  /**
+   * @brief rotate log file if needed
+   *
+   * The file size is tracked in memory and compared with the rotation
+   * deadline, the file system is only checked on open, rotation, and
+   * periodically (or each time for strategies that can not be tracked).
+   */
+  void
+  rotate();
+  /**
+   * @brief reset tracked file size and rotation deadline
+   * @param now current time (nanoseconds since epoch)
+   */
+  void
+  resetRotation(boost::int64_t now);
+  /**
+   * @brief check tracked file size against the file system
+   * @param now current time (nanoseconds since epoch)
+   */
+  void
+  resyncSize(boost::int64_t now);
+  /**
+   * @brief index new archive (once compressed) then purge archives
+   * @param archive archive path
+   * @param renamed true if existing archives have been renamed
+   */
+  void
+  purge(const std::string& archive, bool renamed);
+  /**
+   * @brief archive a file set aside by rotate() once compressed, in
+   * rotation order, then purge archives (compressor threads)
+   * @param compressed compressed file (staging on failure)
+   * @param staging file set aside
+   * @param ticket rotation number
+   */
+  void
+  publish(const std::string& compressed, const std::string& staging,
+          unsigned long ticket);
 private:
+  /**
+   * @brief index new archive then purge archives
+   * @param archive archive path
+   * @param renamed true if existing archives have been renamed
+   * @warning purgeMutex_ must be held
+   */
+  void
+  purgeArchives(const std::string& archive, bool renamed);
+
   std::string path_; /**< log file path */
   boost::scoped_ptr<RotateStrategy> pRotateStrategy_; /**< rotation strategy */
   boost::scoped_ptr<ArchiveStrategy> pArchiveStrategy_; /**< archive strategy */
   boost::scoped_ptr<PurgeStrategy> pPurgeStrategy_; /**< purge strategy */
+  boost::mutex purgeMutex_; /**< serializes purges (compressor threads) */
+  unsigned long staged_; /**< files set aside by rotate() (mutex_) */
+  unsigned long published_; /**< files archived by publish() (purgeMutex_) */
+  boost::condition_variable publishable_; /**< published_ changed */
+  int archiveMode_; /**< archive mode */
   boost::iostreams::filtering_ostream out_; /**< log file stream */
   boost::mutex mutex_; /**< mutex protecting concurrent access */
+  int fd_; /**< log file descriptor */
+  bool compressed_; /**< true if output goes through a compressor */
+  std::string buffer_; /**< lines not yet written */
+  std::size_t bufferSize_; /**< maximum number of buffered bytes */
+  int flushMode_; /**< flush policy */
+  std::size_t flushBytes_; /**< buffered bytes threshold */
+  long flushMs_; /**< buffered lines maximum age (ms) */
+  int syncMode_; /**< fsync policy */
+  long syncMs_; /**< fsync interval (ms) */
+  boost::int64_t pendingSince_; /**< oldest buffered line (monotonic ns) */
+  boost::int64_t lastSync_; /**< last fsync (monotonic ns) */
+  bool dirty_; /**< data written since last fsync */
+  boost::scoped_ptr<boost::thread> flusher_; /**< flusher thread */
+  long written_; /**< tracked file size (bytes, buffered lines included) */
+  long maxSize_; /**< rotation size threshold (-1: none) */
+  boost::int64_t deadline_; /**< next rotation (ns since epoch, -1: none) */
+  boost::int64_t resyncAt_; /**< next file size check (ns since epoch) */
+  /** channel state, set once open() is done (pQueue_ is then set) */
+  boost::atomic<bool> open_;
+  /** archives compressor, declared after strategies used by its callbacks */
+  boost::scoped_ptr<Compressor> pCompressor_;
+  /** pending messages (async mode only), declared last to be stopped first */
+  boost::scoped_ptr<MessageQueue> pQueue_;
 };
 
 } /* namespace dadi */
@@ -0,0 +1,120 @@
+/**
+ * @file   Logging/Formatter.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines message formatter
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _FORMATTER_HH_
+#define _FORMATTER_HH_
+
+#include <string>
+#include <vector>
+
+namespace dadi {
+
+class Message;
+
+/**
+ * @class Formatter
+ * @brief renders messages according to a pattern
+ *
+ * The pattern is parsed once into a list of segments, then each message is
+ * appended to a caller-provided buffer without iostreams.
+ * Supported conversions:
+ * - %%m message text
+ * - %%p priority (ie: INFORMATION)
+ * - %%s message source
+ * - %%f source code filename
+ * - %%l source code line number
+ * - %%T wall-clock time (UTC): YYYY-MM-DD HH:MM:SS.uuuuuu
+ * - %%t wall-clock time in seconds since epoch
+ * - %%N monotonic time in nanoseconds
+ * - %%X{key} value of tag key
+ * - %%%% a single %
+ *
+ * Unknown conversions are kept verbatim.
+ */
+class Formatter {
+public:
+  static const std::string DEFAULT_PATTERN; /**< default pattern ("%m") */
+
+  /**
+   * @brief constructor
+   * @param pattern formatting pattern
+   */
+  explicit Formatter(const std::string& pattern = DEFAULT_PATTERN);
+
+  /**
+   * @brief set and compile pattern
+   * @param pattern formatting pattern
+   */
+  void
+  setPattern(const std::string& pattern);
+  /**
+   * @brief get pattern
+   * @return formatting pattern
+   */
+  const std::string&
+  getPattern() const;
+  /**
+   * @brief check if pattern renders message text only
+   * @return true if pattern is "%m"
+   */
+  bool
+  isTextOnly() const;
+
+  /**
+   * @brief render message
+   * @param msg message to render
+   * @param out buffer the rendered message is appended to
+   */
+  void
+  format(const Message& msg, std::string& out) const;
+
+private:
+  /**
+   * @enum SegmentType
+   * @brief type of pattern segments
+   */
+  enum SegmentType {
+    SEG_LITERAL = 0, /**< literal string */
+    SEG_TEXT, /**< message text */
+    SEG_PRIORITY, /**< priority */
+    SEG_SOURCE, /**< message source */
+    SEG_FILE, /**< source code filename */
+    SEG_LINE, /**< source code line number */
+    SEG_TIME, /**< formatted wall-clock time */
+    SEG_EPOCH, /**< seconds since epoch */
+    SEG_MONOTONIC, /**< monotonic nanoseconds */
+    SEG_TAG /**< tag value */
+  };
+
+  /**
+   * @struct Segment
+   * @brief compiled pattern element
+   */
+  struct Segment {
+    Segment(SegmentType t, const std::string& v) : type(t), value(v) {}
+
+    SegmentType type; /**< segment type */
+    std::string value; /**< literal string or tag key */
+  };
+
+  /**
+   * @brief add a segment, merging consecutive literals
+   * @param type segment type
+   * @param value literal string or tag key
+   */
+  void
+  addSegment(SegmentType type, const std::string& value = std::string());
+
+  std::string pattern_; /**< formatting pattern */
+  std::vector<Segment> segments_; /**< compiled pattern */
+};
+
+} /* namespace dadi */
+
+#endif  /* _FORMATTER_HH_ */
@@ -0,0 +1,203 @@
+/**
+ * @file   Logging/LogConfigurator.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines a declarative logging configuration reloaded at runtime
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _LOGCONFIGURATOR_HH_
+#define _LOGCONFIGURATOR_HH_
+
+#include <map>
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "dadi/detail/Parsers.hh"
+#include "dadi/Logging/Channel.hh"
+
+namespace dadi {
+
+/**
+ * @class LogConfigurator
+ * @brief builds loggers and channels from a Config section
+ *
+ * The section holds two lists:
+ * - channels: children named after the channel, with a "type" (console,
+ *   file, binary_file, null, multi, and on POSIX systems syslog,
+ *   syslog_socket, mapped_ring); other children are copied as channel
+ *   attributes (ie: pattern, path, rotate, rotate.size, archive, purge).
+ *   multi channels forward to the channels listed before them with
+ *   "channel" keys.
+ * - loggers: children named after the logger ("root" being the root
+ *   logger), with an optional "level", an optional "channel" name, and the
+ *   limits read by Logger::loadConfig().
+ * @verbatim
+   logging {
+     channels {
+       main {
+         type file
+         path app.log
+         pattern "%d %p %s: %m"
+       }
+     }
+     loggers {
+       root {
+         level warning
+         channel main
+       }
+     }
+   }
+   @endverbatim
+ *
+ * Applying a section is a diff against the previous one: channels whose
+ * type and attributes did not change are kept as they are, new or modified
+ * ones are created and opened before any logger is touched, so that an
+ * invalid section leaves logging unchanged. Loggers are then switched to
+ * their new channel (Logger::setChannel() never blocks the logging path,
+ * replaced channels are flushed and released once no thread logs through
+ * them), and levels or channels dropped from the section are inherited
+ * again from ancestors.
+ *
+ * watch() applies the logging section of a configuration file each time
+ * the file is written (on Linux, through inotify). The Config store is
+ * left alone.
+ */
+class LogConfigurator : public boost::noncopyable {
+public:
+  /**
+   * @brief constructor
+   * @param key configuration key of the logging section
+   */
+  explicit LogConfigurator(const std::string& key = "logging");
+  /**
+   * @brief destructor (stops watching)
+   */
+  ~LogConfigurator();
+
+  /**
+   * @brief apply the logging section of the Config store
+   * @throw InvalidParameterError if the section is invalid (logging is left
+   * unchanged then, as when a new channel fails to open)
+   */
+  void
+  configure();
+  /**
+   * @brief apply a logging section
+   * @param section logging section
+   * @throw InvalidParameterError if the section is invalid (logging is left
+   * unchanged then, as when a new channel fails to open)
+   */
+  void
+  configure(const ConfigStore& section);
+  /**
+   * @brief apply the logging section of a configuration file, and apply it
+   * again each time the file changes
+   * @param path configuration file
+   * @param format configuration file format
+   * @throw ParsingAttributeError if the file cannot be parsed
+   * @throw InvalidParameterError if the logging section is invalid
+   * @throw Error if the file cannot be watched
+   *
+   * Errors met while reloading are logged by the root logger, the previous
+   * configuration being kept.
+   */
+  void
+  watch(const std::string& path, Format format = FORMAT_INFO);
+  /**
+   * @brief stop watching the configuration file
+   */
+  void
+  unwatch();
+
+  /**
+   * @brief get a configured channel
+   * @param name channel name
+   * @return channel (empty if not configured)
+   */
+  ChannelPtr
+  getChannel(const std::string& name) const;
+  /**
+   * @brief get the number of configurations applied
+   * @return configurations applied successfully
+   */
+  unsigned long
+  getGeneration() const;
+
+  /**
+   * @brief create a channel from its type name
+   * @param type channel type (see LogConfigurator)
+   * @return new channel
+   * @throw InvalidParameterError if type is unknown
+   */
+  static ChannelPtr
+  createChannel(const std::string& type);
+
+private:
+  /**
+   * @struct ChannelEntry
+   * @brief configured channel
+   */
+  struct ChannelEntry {
+    std::string type; /**< channel type */
+    ConfigStore attrs; /**< channel attributes */
+    ChannelPtr channel; /**< channel instance */
+  };
+  /** configured channels by name */
+  typedef std::map<std::string, ChannelEntry> ChannelMap;
+  /**
+   * @struct LoggerEntry
+   * @brief configured logger
+   */
+  struct LoggerEntry {
+    int level; /**< level (-1: not configured) */
+    std::string channel; /**< channel name (empty: not configured) */
+  };
+  /** configured loggers by configuration name */
+  typedef std::map<std::string, LoggerEntry> LoggerEntries;
+
+  /**
+   * @brief build channels, reusing the unchanged ones
+   * @param section channels list
+   * @param[out] channels channels to be applied
+   */
+  void
+  buildChannels(const ConfigStore& section, ChannelMap& channels) const;
+  /**
+   * @brief read the logging section of the watched file
+   * @return logging section (empty if missing)
+   * @throw ParsingAttributeError if the file cannot be parsed
+   * @throw Error if the file cannot be read
+   */
+  ConfigStore
+  readFile() const;
+  /**
+   * @brief reload the configuration file
+   */
+  void
+  reload();
+  /**
+   * @brief watcher thread main loop
+   * @param fd inotify descriptor
+   */
+  void
+  run(int fd);
+
+  std::string key_; /**< logging section key */
+  mutable boost::mutex mutex_; /**< serializes reconfigurations */
+  ChannelMap channels_; /**< channels currently configured */
+  LoggerEntries loggers_; /**< loggers currently configured */
+  boost::atomic<unsigned long> generation_; /**< configurations applied */
+  std::string path_; /**< watched file */
+  Format format_; /**< watched file format */
+  int pipe_[2]; /**< wakes the watcher thread up */
+  boost::scoped_ptr<boost::thread> thread_; /**< watcher thread */
+};
+
+} /* namespace dadi */
+
+#endif  /* _LOGCONFIGURATOR_HH_ */
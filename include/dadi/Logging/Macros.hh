@@ -0,0 +1,153 @@
+/**
+ * @file   Logging/Macros.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  logging macros that skip message construction when disabled
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _LOGGING_MACROS_HH_
+#define _LOGGING_MACROS_HH_
+
+#include <ostream>
+#include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Logging/MessageStream.hh"
+
+/**
+ * @defgroup LoggingMacros logging macros
+ * Usage:
+ * @code
+ * DADI_LOG_DEBUG(logger, "received " << n << " bytes from " << peer);
+ * @endcode
+ * The stream expression is only evaluated, and the Message only built,
+ * if the logger will effectively log it. Source file and line are
+ * recorded in the Message, which is built in per-thread buffers (see
+ * MessageStream).
+ *
+ * Sampling and rate limits of the logger are applied before the Message
+ * is built (see Logger::admit()); DADI_LOG_LIMITED() additionally limits
+ * the rate of its own call site.
+ *
+ * Calls with a priority lower than DADI_LOG_MIN_LEVEL are removed at
+ * compile time. By default, DADI_LOG_MIN_LEVEL is DADI_LOG_LEVEL_TRACE,
+ * or DADI_LOG_LEVEL_INFORMATION when NDEBUG is defined; it may be set
+ * on the command line (ie: -DDADI_LOG_MIN_LEVEL=4).
+ * @{
+ */
+
+/* numeric values of dadi::Message::Priority usable by the preprocessor */
+#define DADI_LOG_LEVEL_TRACE 1
+#define DADI_LOG_LEVEL_DEBUG 2
+#define DADI_LOG_LEVEL_INFORMATION 3
+#define DADI_LOG_LEVEL_WARNING 4
+#define DADI_LOG_LEVEL_ERROR 5
+#define DADI_LOG_LEVEL_CRITICAL 6
+#define DADI_LOG_LEVEL_FATAL 7
+
+#ifndef DADI_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define DADI_LOG_MIN_LEVEL DADI_LOG_LEVEL_INFORMATION
+#else
+#define DADI_LOG_MIN_LEVEL DADI_LOG_LEVEL_TRACE
+#endif
+#endif
+
+/**
+ * @brief log a message built from a stream expression
+ * @param logger LoggerPtr (or Logger*), evaluated once
+ * @param prio dadi::Message::Priority, evaluated once
+ * @param expr stream expression
+ */
+#define DADI_LOG(logger, prio, expr)                                    \
+  do {                                                                  \
+    ::dadi::Logger& dadi_log_l_ = *(logger);                            \
+    const ::dadi::Message::Priority dadi_log_p_ = (prio);               \
+    if (dadi_log_l_.is(dadi_log_p_) && dadi_log_l_.admit(dadi_log_p_)) { \
+      ::dadi::MessageStream dadi_log_ms_(dadi_log_l_.getName(),         \
+                                         dadi_log_p_,                   \
+                                         __FILE__, __LINE__);           \
+      dadi_log_ms_.stream() << expr;                                    \
+      dadi_log_l_.logAdmitted(dadi_log_ms_.message());                  \
+    }                                                                   \
+  } while (0)
+
+/**
+ * @brief log a message built from a stream expression, limiting the rate
+ * of this call site
+ * @param logger LoggerPtr (or Logger*), evaluated once
+ * @param prio dadi::Message::Priority, evaluated once
+ * @param rate messages per second
+ * @param burst messages allowed at once
+ * @param expr stream expression
+ */
+#define DADI_LOG_LIMITED(logger, prio, rate, burst, expr)               \
+  do {                                                                  \
+    ::dadi::Logger& dadi_log_l_ = *(logger);                            \
+    const ::dadi::Message::Priority dadi_log_p_ = (prio);               \
+    if (dadi_log_l_.is(dadi_log_p_)) {                                  \
+      static ::dadi::RateLimiter dadi_log_rl_(rate, burst);             \
+      if (dadi_log_l_.admit(dadi_log_p_, dadi_log_rl_,                  \
+                            __FILE__, __LINE__)) {                      \
+        ::dadi::MessageStream dadi_log_ms_(dadi_log_l_.getName(),       \
+                                           dadi_log_p_,                 \
+                                           __FILE__, __LINE__);         \
+        dadi_log_ms_.stream() << expr;                                  \
+        dadi_log_l_.logAdmitted(dadi_log_ms_.message());                \
+      }                                                                 \
+    }                                                                   \
+  } while (0)
+
+/** @brief discarded logging call */
+#define DADI_LOG_NOTHING(logger, expr) do {} while (0)
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_TRACE
+#define DADI_LOG_TRACE(logger, expr)                    \
+  DADI_LOG(logger, ::dadi::Message::PRIO_TRACE, expr)
+#else
+#define DADI_LOG_TRACE(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_DEBUG
+#define DADI_LOG_DEBUG(logger, expr)                    \
+  DADI_LOG(logger, ::dadi::Message::PRIO_DEBUG, expr)
+#else
+#define DADI_LOG_DEBUG(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_INFORMATION
+#define DADI_LOG_INFORMATION(logger, expr)                      \
+  DADI_LOG(logger, ::dadi::Message::PRIO_INFORMATION, expr)
+#else
+#define DADI_LOG_INFORMATION(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_WARNING
+#define DADI_LOG_WARNING(logger, expr)                          \
+  DADI_LOG(logger, ::dadi::Message::PRIO_WARNING, expr)
+#else
+#define DADI_LOG_WARNING(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_ERROR
+#define DADI_LOG_ERROR(logger, expr)                    \
+  DADI_LOG(logger, ::dadi::Message::PRIO_ERROR, expr)
+#else
+#define DADI_LOG_ERROR(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+#if DADI_LOG_MIN_LEVEL <= DADI_LOG_LEVEL_CRITICAL
+#define DADI_LOG_CRITICAL(logger, expr)                         \
+  DADI_LOG(logger, ::dadi::Message::PRIO_CRITICAL, expr)
+#else
+#define DADI_LOG_CRITICAL(logger, expr) DADI_LOG_NOTHING(logger, expr)
+#endif
+
+/* fatal messages are never compiled out */
+#define DADI_LOG_FATAL(logger, expr)                    \
+  DADI_LOG(logger, ::dadi::Message::PRIO_FATAL, expr)
+
+/** @} */
+
+#endif  /* _LOGGING_MACROS_HH_ */
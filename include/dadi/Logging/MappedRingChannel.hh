@@ -0,0 +1,165 @@
+/**
+ * @file   Logging/MappedRingChannel.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines a channel writing into a memory-mapped ring buffer
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _MAPPEDRINGCHANNEL_HH_
+#define _MAPPEDRINGCHANNEL_HH_
+
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include "dadi/Logging/Channel.hh"
+
+namespace dadi {
+
+class Message;
+
+/**
+ * @class MappedRingChannel
+ * @brief Channel keeping the last messages in a memory-mapped file
+ *
+ * The log file is a fixed-size circular buffer shared with the kernel page
+ * cache: logging a message is a memory copy, neither write() nor fsync()
+ * are called, yet records survive a crash of the process (kill -9
+ * included). They are lost if the system itself crashes before the pages
+ * are written back (see flush()).
+ *
+ * Writers reserve space by incrementing the head counter stored in the
+ * file header (atomic fetch-add, no lock), then copy their record and
+ * commit it by storing its position in its header. Records left
+ * uncommitted by a crash are skipped by MappedRingReader. Reopening an
+ * existing ring of the same size appends to it.
+ *
+ * Layout (native byte order):
+ * - header (64 bytes): magic ("DADIRNG" followed by the format version),
+ *   capacity (size of the data area), head (bytes reserved since creation)
+ * - data: records aligned on 8 bytes, wrapping around at the end
+ * - record: position (bytes since creation, commit marker), payload size
+ *   (32 bits), check (32 bits), payload (formatted message)
+ *
+ * properties supported:
+ * - pattern: see Formatter
+ * - path: ring file path
+ * - size: size of the data area in bytes (default: 4194304), rounded up to
+ *   a multiple of 8; records bigger than a quarter of it are truncated
+ */
+class MappedRingChannel : public Channel {
+public:
+  static const char MAGIC[8]; /**< file magic number (with version) */
+  static const std::size_t HEADER_SIZE = 64; /**< file header size */
+  static const std::size_t RECORD_HEADER_SIZE = 16; /**< record header size */
+  static const std::size_t DEFAULT_SIZE = 4194304; /**< default data size */
+
+  /**
+   * @brief default constructor
+   * @warning you need to set ring file path either by using the appropriate
+   * constructor or by setting in the attributes (key: "path")
+   */
+  MappedRingChannel();
+  /**
+   * @brief constructor
+   * @param path ring file path
+   * @param size size of the data area in bytes
+   */
+  explicit MappedRingChannel(const std::string& path,
+                             std::size_t size = DEFAULT_SIZE);
+  /**
+   * @brief destructor (unmaps the ring)
+   */
+  ~MappedRingChannel();
+
+  /**
+   * @brief open channel (creates and maps the ring file)
+   */
+  void
+  open();
+  /**
+   * @brief close channel
+   */
+  void
+  close();
+  /**
+   * @brief schedule write back of the ring (msync(MS_ASYNC))
+   */
+  void
+  flush();
+  /**
+   * @brief logs message
+   * @param msg Message to log
+   */
+  void
+  log(const Message& msg);
+
+protected:
+  static const std::string ATTR_PATH; /**< attribute path key */
+  static const std::string ATTR_SIZE; /**< attribute size key */
+
+private:
+  std::string path_; /**< ring file path */
+  std::size_t size_; /**< requested size of the data area */
+  char *map_; /**< mapped file */
+  std::size_t mapSize_; /**< mapped size */
+  char *data_; /**< data area */
+  boost::uint64_t capacity_; /**< size of the data area */
+  std::size_t maxPayload_; /**< bigger payloads are truncated */
+  boost::atomic<bool> open_; /**< channel state (open/closed) */
+  boost::mutex mutex_; /**< serializes open() */
+};
+
+/**
+ * @class MappedRingReader
+ * @brief reconstructs the records of a ring written by MappedRingChannel
+ *
+ * Records are returned from the oldest to the newest one still present.
+ * The ring is read at once, reading a ring while it is being written is
+ * supported but records committed afterwards are ignored.
+ */
+class MappedRingReader {
+public:
+  /**
+   * @brief constructor
+   * @param path ring file path
+   * @throw dadi::Error if the file can not be read or is not a ring
+   */
+  explicit MappedRingReader(const std::string& path);
+
+  /**
+   * @brief get next record
+   * @param record record payload
+   * @return false when there are no more records
+   */
+  bool
+  next(std::string& record);
+  /**
+   * @brief count bytes skipped (uncommitted or partially overwritten)
+   * @return number of bytes that did not belong to a valid record
+   */
+  boost::uint64_t
+  getSkipped() const;
+
+private:
+  /**
+   * @brief copy bytes out of the data area, wrapping around
+   * @param pos position since creation
+   * @param dst destination
+   * @param size number of bytes
+   */
+  void
+  copy(boost::uint64_t pos, char *dst, std::size_t size) const;
+
+  std::vector<char> data_; /**< data area */
+  boost::uint64_t pos_; /**< position of the next record */
+  boost::uint64_t head_; /**< end of the last reserved record */
+  boost::uint64_t skipped_; /**< bytes skipped so far */
+};
+
+} /* namespace dadi */
+
+#endif  /* _MAPPEDRINGCHANNEL_HH_ */
@@ -12,15 +12,30 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
+#include "dadi/Logging/Clock.hh"
 
 namespace dadi {
 
 /** map of std::string/std::strings hold properties */
 typedef std::map<std::string, std::string> StringMap;
+/** message tag (key, value) */
+typedef std::pair<std::string, std::string> Tag;
+/** message tags, kept in insertion order */
+typedef std::vector<Tag> Tags;
 
 /**
  * @class Message
  * @brief log message
+ *
+ * Messages are timestamped at construction with the current Clock time.
+ * Source code filenames given as C strings must have static storage (ie:
+ * __FILE__), they are kept as a pointer; those given as std::string are
+ * copied in the Message.
+ * Tags are stored in a small flat vector. Assigning to an existing Message
+ * reuses its buffers, so that a recycled Message (see MessageStream) does
+ * not allocate memory in steady state.
  */
 class Message {
 public:
@@ -64,6 +79,19 @@ public:
           Priority prio,
           const std::string& file,
           int line);
+  /**
+   * @brief constructor
+   * @param src source
+   * @param txt message
+   * @param prio priority
+   * @param file source file name (static storage, ie: __FILE__)
+   * @param line source file line
+   */
+  Message(const std::string& src,
+          const std::string& txt,
+          Priority prio,
+          const char *file,
+          int line);
 
   /**
    * @brief set log message source
@@ -106,16 +134,28 @@ public:
 
   /**
    * @brief set log message timestamp
-   * @param timestamp
+   * @param timestamp seconds since epoch
    */
   void
   setTimestamp(long timestamp);
   /**
    * @brief get log message timestamp
-   * @return timestamp
+   * @return seconds since epoch
    */
   long
   getTimestamp() const;
+  /**
+   * @brief set log message time
+   * @param time wall-clock and monotonic time
+   */
+  void
+  setTime(const Timestamp& time);
+  /**
+   * @brief get log message time (nanoseconds resolution)
+   * @return wall-clock and monotonic time
+   */
+  const Timestamp&
+  getTime() const;
 
   /**
    * @brief set source code filename
@@ -123,12 +163,27 @@ public:
    */
   void
   setFile(const std::string& filename);
+  /**
+   * @brief set source code filename
+   * @param filename source code filename (static storage, ie: __FILE__)
+   */
+  void
+  setFile(const char *filename);
   /**
    * @brief get source code filename
    * @return source code filename
+   * @warning a static filename is copied in the Message on first call, so
+   * threads sharing a Message should use getFileName()
    */
   const std::string&
   getFile() const;
+  /**
+   * @brief get source code filename without copying it
+   * @return source code filename (valid as long as the Message is not
+   * changed)
+   */
+  const char *
+  getFileName() const;
 
   /**
    * @brief set source code line number
@@ -153,19 +208,31 @@ public:
   /**
    * @brief get attribute (read access)
    * @param key
-   * @return attribute value
+   * @return attribute value (empty if attribute does not exist)
    */
   const std::string&
   operator[](const std::string& key) const;
+  /**
+   * @brief get all attributes
+   * @return attributes in insertion order
+   */
+  const Tags&
+  getTags() const;
+  /**
+   * @brief remove all attributes
+   */
+  void
+  clearTags();
 
 private:
   std::string src_; /**< log message source */
   std::string txt_; /**< log message test */
   Priority prio_; /**< log message priority */
-  long timestamp_; /**< log message timestamp */
-  std::string file_; /**< source code filename */
+  Timestamp time_; /**< log message time */
+  const char *file_; /**< static source code filename (or NULL) */
+  mutable std::string fileName_; /**< source code filename copy */
   int line_; /**< source code line number */
-  mutable StringMap tags_; /**< FileChannel properties map */
+  Tags tags_; /**< message attributes */
 };
 
 } /* namespace dadi */
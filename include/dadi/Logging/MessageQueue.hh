@@ -0,0 +1,161 @@
+/**
+ * @file   Logging/MessageQueue.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  bounded message queue drained by a background thread
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _MESSAGEQUEUE_HH_
+#define _MESSAGEQUEUE_HH_
+
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "dadi/Logging/Message.hh"
+
+namespace dadi {
+
+/**
+ * @class MessageQueue
+ * @brief bounded multiple producers/single consumer queue of messages
+ *
+ * Producers enqueue messages with push() while a dedicated writer thread
+ * drains them by batches and hands each batch to a consumer callback.
+ * When the queue is full, the overflow policy decides whether producers
+ * wait, or which message is discarded. Messages pushed once the queue is
+ * stopped are rejected.
+ */
+class MessageQueue : public boost::noncopyable {
+public:
+  /**
+   * @enum OverflowPolicy
+   * @brief behaviour of push() when the queue is full
+   */
+  enum OverflowPolicy {
+    OVERFLOW_BLOCK = 0, /**< wait until the writer makes room */
+    OVERFLOW_DROP_NEWEST, /**< discard the message being pushed */
+    /** discard the oldest message with the lowest priority */
+    OVERFLOW_DROP_LOWEST
+  };
+
+  /** batch of messages handed to the consumer */
+  typedef std::deque<Message> Batch;
+  /** consumer callback called from the writer thread */
+  typedef boost::function<void (const Batch&)> Consumer;
+
+  static const std::size_t DEFAULT_CAPACITY; /**< default queue capacity */
+
+  /**
+   * @brief constructor
+   * @param consumer callback processing batches of messages
+   * @param capacity maximum number of pending messages
+   * @param policy overflow policy
+   */
+  MessageQueue(const Consumer& consumer,
+               std::size_t capacity = DEFAULT_CAPACITY,
+               int policy = OVERFLOW_BLOCK);
+  /**
+   * @brief destructor (drains the queue and stops the writer thread)
+   */
+  ~MessageQueue();
+
+  /**
+   * @brief start the writer thread (does nothing if already started)
+   */
+  void
+  start();
+  /**
+   * @brief drain pending messages and stop the writer thread, later
+   * messages are rejected until the queue is started again
+   */
+  void
+  stop();
+  /**
+   * @brief enqueue a message
+   * @param msg message to enqueue
+   * @return false if msg has been dropped (queue full or stopped)
+   */
+  bool
+  push(const Message& msg);
+  /**
+   * @brief wait until every message pushed so far has been consumed
+   * @warning returns immediately if the writer thread is not running
+   */
+  void
+  flush();
+
+  /**
+   * @brief get queue capacity
+   * @return maximum number of pending messages
+   */
+  std::size_t
+  getCapacity() const;
+  /**
+   * @brief get number of pending messages
+   * @return number of messages not yet handed to the consumer
+   */
+  std::size_t
+  getSize() const;
+  /**
+   * @brief get number of messages rejected by push()
+   * @return dropped messages count
+   */
+  unsigned long
+  getDropped() const;
+  /**
+   * @brief get number of queued messages discarded to make room for more
+   * important ones (OVERFLOW_DROP_LOWEST)
+   * @return evicted messages count
+   */
+  unsigned long
+  getEvicted() const;
+
+private:
+  /**
+   * @brief writer thread main loop
+   */
+  void
+  run();
+  /**
+   * @brief discard the oldest pending message of the lowest priority
+   * @param priority priority of the message to make room for
+   * @return false if no pending message has a lower priority
+   */
+  bool
+  evict(int priority);
+
+  /** lanes of OVERFLOW_DROP_LOWEST (one per priority) */
+  static const int LANES = Message::PRIO_FATAL + 1;
+
+  Consumer consumer_; /**< batch consumer */
+  std::size_t capacity_; /**< maximum number of pending messages */
+  int policy_; /**< overflow policy */
+  Batch queue_; /**< pending messages (except OVERFLOW_DROP_LOWEST) */
+  /* OVERFLOW_DROP_LOWEST keeps one FIFO per priority so that evicting
+   * is O(1), order_ records the push order across lanes */
+  Batch lanes_[LANES]; /**< pending messages by priority */
+  std::deque<unsigned char> order_; /**< lane of each pushed message */
+  std::size_t skipped_[LANES]; /**< evicted messages still in order_ */
+  std::size_t size_; /**< number of pending messages */
+  unsigned long pushed_; /**< number of messages enqueued */
+  unsigned long processed_; /**< number of messages consumed or evicted */
+  unsigned long dropped_; /**< number of messages rejected */
+  unsigned long evicted_; /**< number of messages evicted */
+  bool running_; /**< writer thread state */
+  bool stopped_; /**< stop() called, push() rejects messages */
+  mutable boost::mutex mutex_; /**< mutex protecting the queue */
+  boost::condition_variable notEmpty_; /**< signaled on push */
+  boost::condition_variable notFull_; /**< signaled when room is made */
+  boost::condition_variable drained_; /**< signaled after each batch */
+  boost::scoped_ptr<boost::thread> thread_; /**< writer thread */
+};
+
+} /* namespace dadi */
+
+#endif  /* _MESSAGEQUEUE_HH_ */
@@ -0,0 +1,69 @@
+/**
+ * @file   Logging/MessageStream.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  per-thread reusable message builder
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _MESSAGESTREAM_HH_
+#define _MESSAGESTREAM_HH_
+
+#include <iosfwd>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include "dadi/Logging/Message.hh"
+
+namespace dadi {
+
+/**
+ * @class MessageStream
+ * @brief builds a Message from a stream expression using per-thread buffers
+ *
+ * Each thread owns a small stack of (Message, stream) pairs that are
+ * recycled across logging calls: once their buffers have grown to the
+ * size of the messages logged, building a Message does not allocate.
+ * A MessageStream holds one level of that stack for its lifetime, so that
+ * a channel may itself log while a message is being built.
+ * This class is meant to be used by logging macros (see Macros.hh).
+ */
+class MessageStream : public boost::noncopyable {
+public:
+  /**
+   * @brief constructor
+   * @param src source
+   * @param prio priority
+   * @param file source file name (static storage, ie: __FILE__)
+   * @param line source file line
+   */
+  MessageStream(const std::string& src,
+                Message::Priority prio,
+                const char *file,
+                int line);
+  /**
+   * @brief destructor (releases the level)
+   */
+  ~MessageStream();
+
+  /**
+   * @brief get stream used to format message text
+   * @return output stream
+   */
+  std::ostream&
+  stream();
+  /**
+   * @brief get formatted message
+   * @return message (valid until this object is destroyed)
+   */
+  const Message&
+  message();
+
+  struct Level; /**< @internal per-thread buffers */
+private:
+  Level *level_; /**< per-thread buffers in use */
+};
+
+} /* namespace dadi */
+
+#endif  /* _MESSAGESTREAM_HH_ */
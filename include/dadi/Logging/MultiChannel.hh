@@ -11,32 +11,53 @@
 #ifndef _MULTICHANNEL_HH_
 #define _MULTICHANNEL_HH_
 
-#include <list>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 #include "dadi/Logging/Channel.hh"
+#include "dadi/Logging/Epoch.hh"
+#include "dadi/Logging/MessageQueue.hh"
 
 namespace dadi {
 
 class Message;
 
-/**
- * @typedef Channels
- * @brief list of channels
- */
-typedef std::list<ChannelPtr> Channels;
-
 /**
  * @class MultiChannel
  * @brief redirects log messages to multiple channels
+ *
+ * The list of channels is an immutable snapshot replaced on each
+ * addChannel()/removeChannel(), so log() never waits for them nor for other
+ * loggers (see Epoch). A channel may be given its own queue and writer
+ * thread, so that a slow channel only delays itself.
  */
 class MultiChannel : public Channel {
 public:
+  /**
+   * @struct Statistics
+   * @brief per-channel counters
+   */
+  struct Statistics {
+    /**
+     * @brief default constructor
+     */
+    Statistics() : delivered(0), dropped(0), time(0) {}
+
+    unsigned long delivered; /**< messages logged by the channel */
+    unsigned long dropped; /**< messages dropped by its queue */
+    boost::uint64_t time; /**< time spent in the channel (ns) */
+  };
+
   /**
    * @brief constructor
    */
   MultiChannel();
   /**
-   * @brief destructor
+   * @brief destructor (drains channels queues)
    */
   virtual ~MultiChannel();
 
@@ -44,17 +65,32 @@ public:
   open();
   void
   close();
+  /**
+   * @brief flush every registered channel (waits for queued messages)
+   */
+  void
+  flush();
   void
   log(const Message& msg);
 
   /**
-   * @brief add a new channel
+   * @brief add a new channel, messages are logged synchronously
    * @param channel channel to be added
    */
   void
   addChannel(ChannelPtr channel);
   /**
-   * @brief remove a channel
+   * @brief add a new channel with its own queue and writer thread
+   * @param channel channel to be added
+   * @param capacity maximum number of pending messages
+   * @param policy overflow policy (see MessageQueue::OverflowPolicy)
+   */
+  void
+  addChannel(ChannelPtr channel, std::size_t capacity,
+             int policy = MessageQueue::OVERFLOW_BLOCK);
+  /**
+   * @brief remove a channel, once no thread logs through it (its pending
+   * messages are logged before it returns)
    * @param channel channel to be removed
    */
   void
@@ -65,9 +101,74 @@ public:
    */
   int
   getCount() const;
+  /**
+   * @brief get counters of a channel
+   * @param channel registered channel
+   * @return counters (zeroes if channel is not registered)
+   */
+  Statistics
+  getStatistics(ChannelPtr channel) const;
 private:
-  Channels channels_; /**< channels */
-  boost::mutex mutex_; /**< mutex that protects concurrent access */
+  /**
+   * @class Sink
+   * @brief registered channel with its queue and counters
+   */
+  class Sink : public boost::noncopyable {
+  public:
+    /**
+     * @brief constructor
+     * @param channel channel
+     */
+    explicit Sink(ChannelPtr channel);
+    /**
+     * @brief destructor (drains the queue)
+     */
+    ~Sink();
+
+    /**
+     * @brief log message, or enqueue it if the channel has a queue
+     * @param msg message to be logged
+     */
+    void
+    log(const Message& msg);
+    /**
+     * @brief log a batch of messages (queue consumer)
+     * @param batch messages to be logged
+     */
+    void
+    write(const MessageQueue::Batch& batch);
+    /**
+     * @brief wait for queued messages, then flush the channel
+     */
+    void
+    flush();
+
+    ChannelPtr channel; /**< channel */
+    boost::atomic<unsigned long> delivered; /**< messages logged */
+    boost::atomic<unsigned long> dropped; /**< messages dropped */
+    boost::atomic<boost::uint64_t> time; /**< time spent logging (ns) */
+    /** pending messages (optional), declared last to be stopped first */
+    boost::scoped_ptr<MessageQueue> queue;
+  };
+
+  typedef boost::shared_ptr<Sink> SinkPtr;
+  /** immutable list of sinks */
+  typedef std::vector<SinkPtr> Sinks;
+  typedef boost::shared_ptr<const Sinks> SinksPtr;
+
+  /**
+   * @brief publish a new list of sinks, wait for the threads logging
+   * through the current one
+   * @param sinks list replacing the current one
+   * @warning mutex_ must be held
+   */
+  void
+  publish(const SinksPtr& sinks);
+
+  SinksPtr sinks_; /**< current list (mutex_ held) */
+  boost::atomic<const Sinks *> pSinks_; /**< current list (log path) */
+  Epoch epoch_; /**< guards pSinks_ */
+  mutable boost::mutex mutex_; /**< serializes updates of the list */
 };
 
 
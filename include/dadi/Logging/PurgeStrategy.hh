@@ -10,15 +10,130 @@
 #ifndef _PURGESTRATEGY_HH_
 #define _PURGESTRATEGY_HH_
 
+#include <deque>
 #include <string>
-#include <vector>
-#include <boost/format.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/regex_fwd.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace dadi {
 
+/**
+ * @class ArchiveIndex
+ * @brief in-memory list of archives with their size and modification time
+ *
+ * The index is built with a single directory scan, then updated each time
+ * an archive is added or removed, so that purging does not touch the file
+ * system metadata.
+ */
+class ArchiveIndex {
+public:
+  /**
+   * @struct Entry
+   * @brief indexed archive
+   */
+  struct Entry {
+    std::string path; /**< archive path */
+    boost::uintmax_t size; /**< archive size (bytes) */
+    boost::int64_t mtime; /**< last modification (ns since epoch) */
+    std::string key; /**< sort key (ascending) */
+    long seq; /**< sequence number, the greater the older (-1: none) */
+  };
+
+  /**
+   * @brief constructor (empty, not loaded)
+   */
+  ArchiveIndex();
+
+  /**
+   * @brief set regular expression matching archive names, log file name
+   * and its trailing dot excepted (see ArchiveStrategy::getPattern())
+   * @param pattern pattern (default: numbered archives, any extension)
+   */
+  void
+  setPattern(const std::string& pattern);
+  /**
+   * @brief index archives linked to a log file
+   * (<em>basename</em>.<em>pattern</em>, partially compressed files excepted)
+   * @param basename log file (path)
+   */
+  void
+  load(const std::string& basename);
+  /**
+   * @brief forget indexed archives, next purge will reload them
+   */
+  void
+  invalidate();
+  /**
+   * @brief check if archives have been indexed
+   * @return true if loaded
+   */
+  bool
+  isLoaded() const;
+  /**
+   * @brief index a new archive (newest)
+   * @param path archive path
+   */
+  void
+  add(const std::string& path);
+  /**
+   * @brief remove oldest archive from the file system and the index
+   */
+  void
+  removeOldest();
+  /**
+   * @brief get number of archives
+   * @return number of archives
+   */
+  std::size_t
+  getCount() const;
+  /**
+   * @brief get archives cumulated size
+   * @return size (bytes)
+   */
+  boost::uintmax_t
+  getTotalSize() const;
+  /**
+   * @brief get oldest archive
+   * @warning index must not be empty
+   * @return oldest archive
+   */
+  const Entry&
+  getOldest() const;
+
+  /**
+   * @brief get file size and modification time
+   * @param[in] path file path
+   * @param[out] entry entry filled with file information
+   * @return false if file does not exist
+   */
+  static bool
+  stat(const std::string& path, Entry& entry);
+private:
+  /**
+   * @brief match archive name against pattern
+   * @param[in] regArchive compiled pattern
+   * @param[in] name archive file name
+   * @param[out] entry entry filled with key and sequence number
+   * @return true if name matches
+   */
+  bool
+  match(const boost::regex& regArchive, const std::string& name,
+        Entry& entry) const;
+
+  /** archive names pattern, compiled once by setPattern() */
+  boost::shared_ptr<const boost::regex> regArchive_;
+  std::string prefix_; /**< log file name followed by a dot */
+  std::deque<Entry> entries_; /**< archives, oldest first */
+  boost::uintmax_t totalSize_; /**< archives cumulated size */
+  bool loaded_; /**< true once the directory has been scanned */
+};
+
+/*****************************************************************************/
+
 /**
  * @class PurgeStrategy
  * @brief Base class to purge strategies
@@ -40,22 +155,39 @@ public:
    */
   virtual void
   purge(const std::string& path) = 0;
-protected:
   /**
-   * @brief list all archive files linked to log file
-   * @param[in] basename log file (path)
-   * @param[out] paths archived files
+   * @brief index existing archives (done on first purge otherwise)
+   * @param path log file (path)
    */
   void
-  list(const std::string& basename, std::vector<std::string>& paths);
+  load(const std::string& path);
   /**
-   * @brief sort archives to ease
-   * @warning needs to be reimplemented (does nothing by default)
-   * @param paths files to be sorted
+   * @brief set archive names pattern (see ArchiveIndex::setPattern())
+   * @param pattern pattern
    */
-  virtual void
-  sort(std::vector<std::string>& paths);
-  static boost::format regexTpl; /**< regex template to filter archives */
+  void
+  setPattern(const std::string& pattern);
+  /**
+   * @brief notify the strategy that a new archive has been created
+   * @param archive archive path
+   */
+  void
+  add(const std::string& archive);
+  /**
+   * @brief notify the strategy that existing archives have been renamed
+   */
+  void
+  invalidate();
+protected:
+  /**
+   * @brief get archives index, loading it if needed
+   * @param path log file (path)
+   * @return archives index
+   */
+  ArchiveIndex&
+  getIndex(const std::string& path);
+
+  ArchiveIndex index_; /**< archives index */
 };
 
 /*****************************************************************************/
@@ -78,18 +210,78 @@ public:
 
   /**
    * @brief purge archived files
-   * @warning must be reimplemented by implementors
    * @param path file (path) to be purged
    */
   void
   purge(const std::string& path);
-protected:
-  void
-  sort(std::vector<std::string>& paths);
 private:
   unsigned int count_; /**< number of archiches to keep */
 };
 
+/*****************************************************************************/
+
+/**
+ * @class PurgeByAgeStrategy
+ * @brief delete archives older than a given age
+ */
+class PurgeByAgeStrategy : public PurgeStrategy {
+public:
+  /**
+   * @brief constructor
+   * @param age maximum archive age
+   */
+  explicit PurgeByAgeStrategy(const boost::posix_time::time_duration& age);
+  /**
+   * @brief destructor
+   */
+  ~PurgeByAgeStrategy();
+
+  /**
+   * @brief purge archived files
+   * @param path file (path) to be purged
+   */
+  void
+  purge(const std::string& path);
+private:
+  boost::int64_t age_; /**< maximum archive age (ns) */
+};
+
+/*****************************************************************************/
+
+/**
+ * @class PurgeBySizeStrategy
+ * @brief ensure a maximum archives cumulated size and delete oldest
+ */
+class PurgeBySizeStrategy : public PurgeStrategy {
+public:
+  /**
+   * @brief constructor
+   * @param size archives size threshold (in bytes, must be an integer value)
+   * @note By default the size is in bytes, but one can enter a multiplier:
+   * m|k|g, respectively for MB, kB and GB.
+   */
+  explicit PurgeBySizeStrategy(const std::string& size);
+  /**
+   * @brief destructor
+   */
+  ~PurgeBySizeStrategy();
+
+  /**
+   * @brief purge archived files
+   * @param path file (path) to be purged
+   */
+  void
+  purge(const std::string& path);
+  /**
+   * @brief get size threshold
+   * @return maximum archives cumulated size (bytes)
+   */
+  boost::uintmax_t
+  getMaxSize() const;
+private:
+  boost::uintmax_t size_; /**< size (bytes) threshold */
+};
+
 } /* namespace dadi */
 
 #endif  /* _PURGESTRATEGY_HH_ */
@@ -0,0 +1,147 @@
+/**
+ * @file   Logging/RateLimiter.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines a lock-free token bucket used to rate limit log messages
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _RATELIMITER_HH_
+#define _RATELIMITER_HH_
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include "dadi/Logging/Message.hh"
+
+namespace dadi {
+
+/**
+ * @class RateLimiter
+ * @brief token bucket deciding whether a message may be logged
+ *
+ * The bucket is implemented as a generic cell rate algorithm: a single
+ * atomic timestamp (the theoretical arrival time of the next message) is
+ * compared to the current time, so that a message being suppressed costs
+ * an atomic load, and a message going through a compare-and-swap.
+ * Suppressed messages are counted per priority until a summary is taken,
+ * which is reported at the highest priority suppressed.
+ *
+ * Loggers own one (see Logger::setRateLimit()), call sites get their own
+ * through DADI_LOG_LIMITED().
+ */
+class RateLimiter : public boost::noncopyable {
+public:
+  /**
+   * @brief constructor
+   * @param rate messages per second (0: unlimited)
+   * @param burst messages allowed at once
+   */
+  explicit RateLimiter(double rate = 0.0, unsigned long burst = 1);
+
+  /**
+   * @brief set limits (resets the bucket)
+   * @param rate messages per second (0: unlimited)
+   * @param burst messages allowed at once (at least 1)
+   */
+  void
+  setRate(double rate, unsigned long burst = 1);
+  /**
+   * @brief check if messages are limited
+   * @return true if a rate has been set
+   */
+  bool
+  isEnabled() const;
+
+  /**
+   * @brief take a token
+   * @param now monotonic time (ns)
+   * @return true if the message may be logged (suppressed messages are
+   * not counted, see suppress())
+   */
+  bool
+  allow(boost::int64_t now);
+  /**
+   * @brief count a suppressed message
+   * @param priority message priority
+   */
+  void
+  suppress(int priority);
+  /**
+   * @brief take the number of suppressed messages if a summary is due
+   * @param now monotonic time (ns)
+   * @param period minimum interval between summaries (ns)
+   * @param[out] priority highest priority suppressed
+   * @return messages suppressed since the last summary (0: no summary due)
+   */
+  unsigned long
+  takeSuppressed(boost::int64_t now, boost::int64_t period, int& priority);
+  /**
+   * @brief take the number of suppressed messages, summary due or not
+   * @param[out] priority highest priority suppressed
+   * @return messages suppressed since the last summary
+   */
+  unsigned long
+  takeSuppressed(int& priority);
+  /**
+   * @brief mark the limiter as registered to a logger (see Logger::flush())
+   * @return true the first time only
+   */
+  bool
+  enlist();
+
+private:
+  /** counted priorities */
+  static const int PRIORITIES =
+    Message::PRIO_FATAL - Message::PRIO_TRACE + 1;
+
+  boost::atomic<boost::int64_t> interval_; /**< ns per message (0: none) */
+  boost::atomic<boost::int64_t> tolerance_; /**< burst allowance (ns) */
+  boost::atomic<boost::int64_t> tat_; /**< theoretical arrival time */
+  /** pending suppressed counts, by priority */
+  boost::atomic<unsigned long> suppressed_[PRIORITIES];
+  boost::atomic<boost::int64_t> nextSummary_; /**< earliest next summary */
+  boost::atomic<bool> enlisted_; /**< registered to a logger */
+};
+
+// inlined as it runs for every limited message
+inline bool
+RateLimiter::allow(boost::int64_t now) {
+  const boost::int64_t interval = interval_.load(boost::memory_order_relaxed);
+  if (!interval) {
+    return true;
+  }
+
+  const boost::int64_t tolerance =
+    tolerance_.load(boost::memory_order_relaxed);
+  boost::int64_t tat = tat_.load(boost::memory_order_relaxed);
+  for (;;) {
+    const boost::int64_t base = (tat > now) ? tat : now;
+    if (base - now > tolerance) {
+      return false;
+    }
+    if (tat_.compare_exchange_weak(tat, base + interval,
+                                   boost::memory_order_relaxed)) {
+      return true;
+    }
+  }
+}
+
+inline void
+RateLimiter::suppress(int priority) {
+  // out of range priorities are counted with the nearest one
+  int i = priority - Message::PRIO_TRACE;
+  i = (0 > i) ? 0 : ((PRIORITIES <= i) ? PRIORITIES - 1 : i);
+  suppressed_[i].fetch_add(1, boost::memory_order_relaxed);
+}
+
+inline bool
+RateLimiter::enlist() {
+  return !enlisted_.load(boost::memory_order_relaxed) &&
+    !enlisted_.exchange(true, boost::memory_order_relaxed);
+}
+
+} /* namespace dadi */
+
+#endif  /* _RATELIMITER_HH_ */
@@ -11,6 +11,7 @@
 #define _ROTATESTRATEGY_HH_
 
 #include <string>
+#include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
@@ -39,6 +40,24 @@ public:
    */
   virtual bool
   mustRotate(const std::string& path) = 0;
+  /**
+   * @brief get size threshold, so that callers may track the file size
+   * instead of calling mustRotate
+   * @return maximum file size (bytes), or -1 if size does not matter
+   */
+  virtual long
+  getMaxSize() const;
+  /**
+   * @brief get next rotation time, so that callers may compare it with
+   * the current time instead of calling mustRotate
+   * @param now current time (nanoseconds since epoch)
+   * @return next rotation time (nanoseconds since epoch), or -1 if time
+   * does not matter
+   * @note if both getMaxSize and getNextRotation return -1, callers must
+   * rely on mustRotate
+   */
+  virtual boost::int64_t
+  getNextRotation(boost::int64_t now) const;
 };
 
 /**
@@ -66,6 +85,12 @@ public:
    */
   bool
   mustRotate(const std::string& path);
+  /**
+   * @brief get size threshold
+   * @return maximum file size (bytes)
+   */
+  long
+  getMaxSize() const;
 private:
   long size_; /**< size (bytes) threshold */
 };
@@ -93,6 +118,13 @@ public:
    */
   bool
   mustRotate(const std::string& path);
+  /**
+   * @brief get next rotation time
+   * @param now current time, counted from (nanoseconds since epoch)
+   * @return now (truncated to the second) + interval
+   */
+  boost::int64_t
+  getNextRotation(boost::int64_t now) const;
 private:
   boost::posix_time::time_duration td_; /**< time interval between rotation */
   boost::posix_time::ptime last_; /**< last rotation time (UTC) */
@@ -105,7 +137,7 @@ private:
 class RotateByTimeStrategy : public RotateStrategy {
 public:
   /**
-   * @brief constructor (by default use utc)
+   * @brief constructor (by default use local time)
    * @param td time of rotation
    * @param day weekday of rotation (default: everyday)
    */
@@ -123,18 +155,33 @@ public:
    */
   bool
   mustRotate(const std::string& path);
+  /**
+   * @brief get next scheduled rotation strictly after now
+   * @param now current time (nanoseconds since epoch)
+   * @return next rotation time (nanoseconds since epoch)
+   */
+  boost::int64_t
+  getNextRotation(boost::int64_t now) const;
+  /**
+   * @brief use utc or local time (local time by default)
+   * @param utc true to schedule rotations in UTC
+   */
+  void
+  setUtc(bool utc = true);
   /**
    * @brief use local time or utc
-   * @param utc
+   * @param utc true to schedule rotations in UTC
+   * @deprecated despite its name, selects UTC: use setUtc()
    */
   void
   setLocal(bool utc = true);
 private:
   static const unsigned int EVERYDAY;
   static const boost::posix_time::time_duration MIDNIGHT;
-  boost::posix_time::time_duration td_;
-  unsigned int day_;
-  bool utc_;
+  boost::posix_time::time_duration td_; /**< time of rotation */
+  bool utc_; /**< true if time of rotation is UTC */
+  unsigned int day_; /**< weekday of rotation */
+  boost::int64_t next_; /**< next rotation (ns since epoch, -1: unknown) */
 };
 
 } /* namespace dadi */
@@ -0,0 +1,168 @@
+/**
+ * @file   Logging/SyslogSocketChannel.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines syslog channel writing directly to the syslog socket
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#ifndef _SYSLOGSOCKETCHANNEL_HH_
+#define _SYSLOGSOCKETCHANNEL_HH_
+
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "dadi/Logging/Channel.hh"
+#include "dadi/Logging/MessageQueue.hh"
+
+namespace dadi {
+
+class Message;
+
+/**
+ * @class SyslogSocketChannel
+ * @brief Channel that sends RFC 5424 or RFC 3164 messages to a syslog socket
+ *
+ * Unlike SyslogChannel, it does not rely on openlog()/syslog(): each
+ * channel has its own identity (name, facility, hostname), and the
+ * constant part of the header is rendered once when the channel is opened.
+ * Messages are rendered into a per-thread buffer and sent as one datagram
+ * without any lock. Message tags are sent as RFC 5424 structured data.
+ * In asynchronous mode, batches of messages are sent with a single
+ * system call when the platform supports it (sendmmsg).
+ *
+ * properties supported:
+ * - pattern: see Formatter
+ * - address: unix:path (default: unix:/dev/log) or udp:host:port
+ * - format: rfc5424 (default) or rfc3164
+ * - name: application name (default: process name)
+ * - facility: syslog facility (see SyslogChannel::Facility)
+ * - hostname: host name (default: gethostname())
+ * - sd_id: structured data identifier of tags (default: dadi@32473)
+ * - max_size: maximum size of a datagram (default: 8192)
+ * - async: log messages from a background thread (default: false)
+ * - async.queue_size: maximum number of pending messages (default: 8192)
+ * - async.overflow: behaviour when the queue is full, values allowed
+ *   (block (default), drop-newest, drop-lowest)
+ */
+class SyslogSocketChannel : public Channel {
+public:
+  /**
+   * @enum Format
+   * @brief list supported message formats
+   */
+  enum Format {
+    FORMAT_RFC5424 = 0, /**< IETF syslog protocol */
+    FORMAT_RFC3164 /**< BSD syslog protocol */
+  };
+
+  /**
+   * @brief default constructor
+   */
+  SyslogSocketChannel();
+  /**
+   * @brief constructor
+   * @param address unix:path or udp:host:port
+   * @param format message format
+   */
+  explicit SyslogSocketChannel(const std::string& address,
+                               int format = FORMAT_RFC5424);
+  /**
+   * @brief destructor (sends pending messages)
+   */
+  ~SyslogSocketChannel();
+
+  /**
+   * @brief open channel (connects socket, renders header)
+   */
+  void
+  open();
+  /**
+   * @brief close channel
+   */
+  void
+  close();
+  /**
+   * @brief wait for pending messages
+   */
+  void
+  flush();
+  /**
+   * @brief logs message
+   * @param msg Message to log
+   */
+  void
+  log(const Message& msg);
+
+protected:
+  /**
+   * @brief get syslog severity of a message
+   * @param msg Message to log
+   * @return severity (0: emergency, 7: debug)
+   */
+  static int
+  getSeverity(const Message& msg);
+
+  static const std::string ATTR_ADDRESS;  /**< attribute address key */
+  static const std::string ATTR_FORMAT;  /**< attribute format key */
+  static const std::string ATTR_NAME;  /**< attribute name key */
+  static const std::string ATTR_FACILITY;  /**< attribute facility key */
+  static const std::string ATTR_HOSTNAME;  /**< attribute hostname key */
+  static const std::string ATTR_SD_ID;  /**< attribute sd_id key */
+  static const std::string ATTR_MAX_SIZE;  /**< attribute max_size key */
+  static const std::string ATTR_ASYNC; /**< attribute async key */
+  /** attribute async.queue_size key */
+  static const std::string ATTR_ASYNC_QUEUE_SIZE;
+  /** attribute async.overflow key */
+  static const std::string ATTR_ASYNC_OVERFLOW;
+
+private:
+  /**
+   * @brief resolve address and connect socket
+   */
+  void
+  connect();
+  /**
+   * @brief render message into out
+   * @param msg Message to render
+   * @param out output buffer
+   */
+  void
+  render(const Message& msg, std::string& out) const;
+  /**
+   * @brief send one datagram (reconnects once if the server went away)
+   * @param data datagram
+   * @param size datagram size
+   */
+  void
+  send(const char *data, std::size_t size);
+  /**
+   * @brief send a batch of messages (queue consumer)
+   * @param batch messages to be sent
+   */
+  void
+  write(const MessageQueue::Batch& batch);
+
+  std::string address_; /**< unix:path or udp:host:port */
+  int format_; /**< message format */
+  int facility_; /**< syslog facility */
+  std::size_t maxSize_; /**< maximum size of a datagram */
+  std::vector<std::string> pri_; /**< "<PRI>" (RFC 3164) or "<PRI>1 " */
+  std::string header_; /**< constant part of the header */
+  std::string sdId_; /**< structured data identifier */
+  int fd_; /**< connected datagram socket */
+  struct sockaddr_storage addr_; /**< server address */
+  socklen_t addrLen_; /**< server address length */
+  boost::atomic<bool> open_; /**< channel state (open/closed) */
+  boost::mutex mutex_; /**< serializes open() and reconnections */
+  std::string batch_; /**< rendered batch (writer thread only) */
+  boost::scoped_ptr<MessageQueue> pQueue_; /**< pending messages (async) */
+};
+
+} /* namespace dadi */
+
+#endif  /* _SYSLOGSOCKETCHANNEL_HH_ */
@@ -0,0 +1,157 @@
+/**
+ * @file   detail/AttrValue.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  typed scalar values stored by FlatAttributes
+ * @section License
+ *  |LICENSE|
+ *
+ */
+
+#ifndef _ATTRVALUE_HH_
+#define _ATTRVALUE_HH_
+
+#include <limits>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/utility/enable_if.hpp>
+
+namespace dadi {
+namespace detail {
+
+/**
+ * @struct AttrValue
+ * @brief scalar value, strings are stored apart (see FlatAttributes)
+ */
+struct AttrValue {
+  /**
+   * @enum Type
+   * @brief stored type
+   */
+  enum Type {
+    NONE = 0, /**< no value (empty string) */
+    INT, /**< signed integer */
+    FLOAT, /**< single precision number (rendered as such) */
+    DOUBLE, /**< double precision number */
+    BOOL, /**< boolean */
+    STRING /**< string, index in the strings pool */
+  };
+
+  AttrValue() : type(NONE), i(0) {}
+
+  int type; /**< stored type */
+  union {
+    boost::int64_t i; /**< INT value */
+    double d; /**< FLOAT and DOUBLE value */
+    bool b; /**< BOOL value */
+    boost::uint32_t s; /**< STRING index */
+  };
+};
+
+/* categories, select how a C++ type is stored */
+struct AttrIntTag {};
+struct AttrFloatTag {};
+struct AttrBoolTag {};
+struct AttrStringTag {};
+struct AttrOtherTag {}; /**< converted to a string as by ptree */
+
+/**
+ * @struct AttrCategory
+ * @brief category of T (characters are strings for ptree)
+ */
+template<typename T, typename Enable = void>
+struct AttrCategory {
+  typedef AttrOtherTag type;
+};
+
+template<typename T>
+struct AttrCategory<T, typename boost::enable_if_c<
+                         boost::is_integral<T>::value &&
+                         !boost::is_same<T, bool>::value &&
+                         !boost::is_same<T, char>::value &&
+                         !boost::is_same<T, signed char>::value &&
+                         !boost::is_same<T, unsigned char>::value &&
+                         !boost::is_same<T, wchar_t>::value>::type> {
+  typedef AttrIntTag type;
+};
+
+template<>
+struct AttrCategory<float> {
+  typedef AttrFloatTag type;
+};
+
+template<>
+struct AttrCategory<double> {
+  typedef AttrFloatTag type;
+};
+
+template<>
+struct AttrCategory<bool> {
+  typedef AttrBoolTag type;
+};
+
+template<>
+struct AttrCategory<std::string> {
+  typedef AttrStringTag type;
+};
+
+template<>
+struct AttrCategory<const char *> {
+  typedef AttrStringTag type;
+};
+
+template<>
+struct AttrCategory<char *> {
+  typedef AttrStringTag type;
+};
+
+/**
+ * @brief render a value as ptree would
+ * @param value value
+ * @return string (empty if it cannot be rendered)
+ */
+template<typename T> std::string
+toString(const T& value) {
+  typename boost::property_tree::translator_between<std::string, T>::type tr;
+  boost::optional<std::string> res = tr.put_value(value);
+  return res ? *res : std::string();
+}
+
+/**
+ * @brief parse a value as ptree would
+ * @param data string
+ * @param[out] value parsed value
+ * @return false if data is not a valid T
+ */
+template<typename T> bool
+fromString(const std::string& data, T& value) {
+  typename boost::property_tree::translator_between<std::string, T>::type tr;
+  boost::optional<T> res = tr.get_value(data);
+  if (!res) {
+    return false;
+  }
+  value = *res;
+  return true;
+}
+
+/**
+ * @brief check that an integer fits in T
+ * @param value integer
+ * @return true if T can hold value
+ */
+template<typename T> bool
+fits(boost::int64_t value) {
+  if (value < 0) {
+    return std::numeric_limits<T>::is_signed &&
+      (value >= static_cast<boost::int64_t>(std::numeric_limits<T>::min()));
+  }
+  return static_cast<boost::uint64_t>(value) <=
+    static_cast<boost::uint64_t>(std::numeric_limits<T>::max());
+}
+
+} /* namespace detail */
+} /* namespace dadi */
+
+#endif  /* _ATTRVALUE_HH_ */
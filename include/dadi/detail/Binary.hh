@@ -0,0 +1,215 @@
+/**
+ * @file   detail/Binary.hh
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compact binary encoding of attributes (FORMAT_BINARY)
+ * @section License
+ *  |LICENSE|
+ *
+ */
+
+#ifndef _BINARY_HH_
+#define _BINARY_HH_
+
+#include <cstddef>
+#include <string>
+#include <boost/cstdint.hpp>
+#include "dadi/detail/Parsers.hh"
+
+namespace dadi {
+namespace detail {
+
+/*
+ * encoding (integers are unsigned LEB128 varints):
+ *   document := magic node
+ *   node     := tag value count (key node)*
+ *   key      := length bytes
+ * tags are AttrValue types, values are:
+ *   NONE: nothing, STRING: length bytes, INT: zigzag varint,
+ *   FLOAT and DOUBLE: IEEE 754 double (little endian), BOOL: one byte
+ * magic begins with a NUL byte so that it is never valid text
+ */
+
+/** binary document prefix (format version included) */
+extern const char BINARY_MAGIC[4];
+
+/**
+ * @brief check whether data is a binary document
+ * @param data serialized data
+ * @param size data size
+ * @return true if data starts with the binary magic
+ */
+bool
+isBinary(const char *data, std::size_t size);
+
+/**
+ * @class BinaryWriter
+ * @brief append a binary document to a buffer, nodes are written in
+ * preorder: value, children count then each key and child
+ */
+class BinaryWriter {
+public:
+  /**
+   * @brief constructor, writes the magic
+   * @param out buffer (appended)
+   */
+  explicit BinaryWriter(std::string& out);
+
+  /**
+   * @brief write an empty value
+   */
+  void
+  none();
+  /**
+   * @brief write a string value (empty strings are written as none)
+   * @param data value
+   */
+  void
+  string(const std::string& data);
+  /**
+   * @brief write an integer value
+   * @param value value
+   */
+  void
+  integer(boost::int64_t value);
+  /**
+   * @brief write a number value
+   * @param value value
+   * @param single rendered as a float
+   */
+  void
+  number(double value, bool single);
+  /**
+   * @brief write a boolean value
+   * @param value value
+   */
+  void
+  boolean(bool value);
+  /**
+   * @brief write the children count of the current node
+   * @param count children count
+   */
+  void
+  count(std::size_t count);
+  /**
+   * @brief write the key of the next child
+   * @param key key
+   */
+  void
+  key(const std::string& key);
+
+private:
+  void
+  varint(boost::uint64_t value);
+
+  std::string& out_; /**< buffer */
+};
+
+/**
+ * @class BinaryReader
+ * @brief read a binary document from memory, strings are returned as
+ * views on the buffer
+ */
+class BinaryReader {
+public:
+  /**
+   * @brief constructor, checks the magic
+   * @param data buffer (must outlive the reader)
+   * @param size buffer size
+   * @throw dadi::ParsingAttributeError
+   */
+  BinaryReader(const char *data, std::size_t size);
+
+  /**
+   * @brief read the tag of the next value
+   * @return AttrValue type
+   * @throw dadi::ParsingAttributeError
+   */
+  int
+  tag();
+  /**
+   * @brief read a STRING value or a key
+   * @param[out] data string start
+   * @param[out] size string size
+   * @throw dadi::ParsingAttributeError
+   */
+  void
+  string(const char *& data, std::size_t& size);
+  /**
+   * @brief read an INT value
+   * @return value
+   * @throw dadi::ParsingAttributeError
+   */
+  boost::int64_t
+  integer();
+  /**
+   * @brief read a FLOAT or DOUBLE value
+   * @return value
+   * @throw dadi::ParsingAttributeError
+   */
+  double
+  number();
+  /**
+   * @brief read a BOOL value
+   * @return value
+   * @throw dadi::ParsingAttributeError
+   */
+  bool
+  boolean();
+  /**
+   * @brief read a children count
+   * @return count
+   * @throw dadi::ParsingAttributeError
+   */
+  std::size_t
+  count();
+  /**
+   * @brief enter a child node
+   * @throw dadi::ParsingAttributeError if nodes are nested too deeply
+   */
+  void
+  enter();
+  /**
+   * @brief leave a child node
+   */
+  void
+  leave();
+  /**
+   * @brief check that the whole buffer was read
+   * @throw dadi::ParsingAttributeError
+   */
+  void
+  finish() const;
+
+private:
+  boost::uint64_t
+  varint();
+  void
+  need(std::size_t size) const;
+
+  const char *pos_; /**< read position */
+  const char *end_; /**< buffer end */
+  unsigned int depth_; /**< current nesting */
+};
+
+/**
+ * @brief serialize a property tree
+ * @param[out] out buffer (appended)
+ * @param tree property tree
+ */
+void
+writeBinary(std::string& out, const ConfigStore& tree);
+
+/**
+ * @brief deserialize a property tree
+ * @param data buffer
+ * @param size buffer size
+ * @param[out] tree property tree (replaced)
+ * @throw dadi::ParsingAttributeError
+ */
+void
+readBinary(const char *data, std::size_t size, ConfigStore& tree);
+
+} /* namespace detail */
+} /* namespace dadi */
+
+#endif  /* _BINARY_HH_ */
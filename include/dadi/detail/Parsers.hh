@@ -22,13 +22,14 @@
 namespace dadi {
 
 /**
- * @brief allowed formats (xml, ini, json, info)
+ * @brief allowed formats (xml, ini, json, info, binary)
  */
 enum Format {
   FORMAT_XML = 0,
   FORMAT_INI,
   FORMAT_JSON,
-  FORMAT_INFO
+  FORMAT_INFO,
+  FORMAT_BINARY /**< compact, for attributes exchanged between nodes */
 };
 
 /**
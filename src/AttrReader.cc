@@ -0,0 +1,1185 @@
+/**
+ * @file   AttrReader.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  event-based (SAX-like) attributes reader and selective loader
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/AttrReader.hh"
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/unordered_set.hpp>
+#include "dadi/detail/AttrValue.hh"
+#include "dadi/detail/Binary.hh"
+#include "dadi/Exception/Attributes.hh"
+
+namespace dadi {
+
+namespace {
+typedef std::char_traits<char> Traits;
+
+// #include nesting allowed in info documents (as read_info)
+const int MAX_INCLUDE_DEPTH(100);
+
+/*
+ * character source over a stream buffer, counts lines for error reports
+ * (one character of lookahead is all the parsers need)
+ */
+class Input {
+public:
+  Input(std::streambuf *buf, const std::string& name)
+    : buf_(buf), name_(name), line_(1) {}
+
+  int
+  peek() {
+    return buf_->sgetc();
+  }
+
+  int
+  get() {
+    int c = buf_->sbumpc();
+    if ('\n' == c) {
+      ++line_;
+    }
+    return c;
+  }
+
+  bool
+  eof() {
+    return Traits::eq_int_type(peek(), Traits::eof());
+  }
+
+  // consume c if it is next
+  bool
+  accept(char c) {
+    if (peek() != Traits::to_int_type(c)) {
+      return false;
+    }
+    get();
+    return true;
+  }
+
+  // consume word as long as it matches, true if it matched entirely
+  bool
+  accept(const char *word) {
+    for (; *word; ++word) {
+      if (!accept(*word)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // read a line without its end of line, false when the input is exhausted
+  bool
+  line(std::string& line) {
+    line.clear();
+    for (;;) {
+      int c = get();
+      if (Traits::eq_int_type(c, Traits::eof())) {
+        return false;
+      } else if ('\n' == c) {
+        return true;
+      }
+      line.push_back(Traits::to_char_type(c));
+    }
+  }
+
+  void
+  fail(const std::string& reason) const {
+    BOOST_THROW_EXCEPTION(ParsingAttributeError()
+                          << errinfo_msg(name_ + "(" +
+                                         boost::lexical_cast<std::string>(line_)
+                                         + "): " + reason));
+  }
+
+private:
+  std::streambuf *buf_;
+  std::string name_; /**< reported in errors */
+  unsigned long line_;
+};
+
+// line-based formats (info, ini)
+bool
+isSpace(int c) {
+  return (' ' == c) || ('\t' == c) || ('\n' == c) || ('\r' == c) ||
+    ('\v' == c) || ('\f' == c);
+}
+
+// xml and json
+bool
+isBlank(int c) {
+  return (' ' == c) || ('\t' == c) || ('\n' == c) || ('\r' == c);
+}
+
+void
+skipSpaces(Input& in) {
+  while (isBlank(in.peek())) {
+    in.get();
+  }
+}
+
+// append code point as utf-8
+void
+appendUtf8(std::string& out, unsigned long code) {
+  if (code < 0x80) {
+    out.push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out.push_back(static_cast<char>(0xc0 | (code >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  } else if (code < 0x10000) {
+    out.push_back(static_cast<char>(0xe0 | (code >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  } else {
+    out.push_back(static_cast<char>(0xf0 | (code >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+  }
+}
+
+int
+hexDigit(int c) {
+  if (('0' <= c) && (c <= '9')) {
+    return c - '0';
+  } else if (('a' <= c) && (c <= 'f')) {
+    return c - 'a' + 10;
+  } else if (('A' <= c) && (c <= 'F')) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void
+skipBom(Input& in) {
+  if (in.accept('\xef') && !in.accept("\xbb\xbf")) {
+    in.fail("invalid byte order mark");
+  }
+}
+
+void
+emitValue(AttrHandler& handler, const std::string& data) {
+  if (!data.empty()) {
+    handler.value(data);
+  }
+}
+
+
+/*
+ * xml, as read_xml (rapidxml): comments are reported as <xmlcomment>
+ * children, attributes as children of <xmlattr>, text and CDATA are
+ * concatenated into the element value
+ */
+class XmlParser {
+public:
+  XmlParser(Input& in, AttrHandler& handler, bool trim)
+    : in_(in), handler_(handler), trim_(trim) {}
+
+  void
+  parse() {
+    skipBom(in_);
+    for (;;) {
+      skipSpaces(in_);
+      if (in_.eof()) {
+        break;
+      } else if (!in_.accept('<')) {
+        in_.fail("expected <");
+      }
+      node();
+    }
+    emitValue(handler_, root_);
+  }
+
+private:
+  // after '<': markup or element
+  void
+  node() {
+    if (in_.accept('?')) {
+      // declaration and processing instructions are skipped
+      skipPast("?>");
+    } else if (in_.accept('!')) {
+      if (in_.accept('-')) {
+        if (!in_.accept('-')) {
+          skipPast(">");
+          return;
+        }
+        std::string comment;
+        readUntil("-->", comment);
+        handler_.beginNode("<xmlcomment>");
+        emitValue(handler_, comment);
+        handler_.endNode();
+      } else if (in_.accept('[')) {
+        if (!in_.accept("CDATA[")) {
+          skipPast(">");
+          return;
+        }
+        readUntil("]]>", texts_.empty() ? root_ : texts_.back());
+      } else if (in_.accept("DOCTYPE") && isBlank(in_.peek())) {
+        doctype();
+      } else {
+        skipPast(">");
+      }
+    } else {
+      element();
+    }
+  }
+
+  void
+  element() {
+    std::string name;
+    while (!in_.eof() && !isBlank(in_.peek()) && ('/' != in_.peek()) &&
+           ('>' != in_.peek()) && ('?' != in_.peek())) {
+      name.push_back(Traits::to_char_type(in_.get()));
+    }
+    if (name.empty()) {
+      in_.fail("expected element name");
+    }
+    handler_.beginNode(name);
+    attributes();
+    if (in_.accept('/')) {
+      if (!in_.accept('>')) {
+        in_.fail("expected >");
+      }
+      handler_.endNode();
+    } else if (in_.accept('>')) {
+      texts_.push_back(std::string());
+      contents();
+    } else {
+      in_.fail("expected >");
+    }
+  }
+
+  void
+  attributes() {
+    bool any = false;
+    std::string name, value;
+    for (;;) {
+      skipSpaces(in_);
+      int c = in_.peek();
+      if (in_.eof() || ('/' == c) || ('<' == c) || ('>' == c) ||
+          ('=' == c) || ('?' == c) || ('!' == c)) {
+        break;
+      }
+      name.clear();
+      while (!in_.eof() && !isBlank(c) && ('/' != c) && ('<' != c) &&
+             ('>' != c) && ('=' != c) && ('?' != c) && ('!' != c)) {
+        name.push_back(Traits::to_char_type(in_.get()));
+        c = in_.peek();
+      }
+      skipSpaces(in_);
+      if (!in_.accept('=')) {
+        in_.fail("expected =");
+      }
+      skipSpaces(in_);
+      int quote = in_.get();
+      if (('"' != quote) && ('\'' != quote)) {
+        in_.fail("expected ' or \"");
+      }
+      value.clear();
+      while (!in_.accept(Traits::to_char_type(quote))) {
+        if (in_.eof()) {
+          in_.fail("unexpected end of data");
+        }
+        character(value, false);
+      }
+      if (!any) {
+        handler_.beginNode("<xmlattr>");
+        any = true;
+      }
+      handler_.beginNode(name);
+      emitValue(handler_, value);
+      handler_.endNode();
+    }
+    if (any) {
+      handler_.endNode();
+    }
+  }
+
+  // element contents up to its closing tag
+  void
+  contents() {
+    const std::size_t depth = texts_.size();
+    while (texts_.size() >= depth) {
+      std::string& text = texts_.back();
+      if (trim_) {
+        skipSpaces(in_);
+      }
+      if (in_.eof()) {
+        in_.fail("unexpected end of data");
+      } else if (in_.accept('<')) {
+        if (in_.accept('/')) {
+          close();
+        } else {
+          node();
+        }
+      } else {
+        data(text);
+      }
+    }
+  }
+
+  // closing tag (its name is not checked, as read_xml)
+  void
+  close() {
+    while (!in_.eof() && !isBlank(in_.peek()) && ('/' != in_.peek()) &&
+           ('>' != in_.peek()) && ('?' != in_.peek())) {
+      in_.get();
+    }
+    skipSpaces(in_);
+    if (!in_.accept('>')) {
+      in_.fail("expected >");
+    }
+    emitValue(handler_, texts_.back());
+    texts_.pop_back();
+    handler_.endNode();
+  }
+
+  // text up to the next markup
+  void
+  data(std::string& text) {
+    const std::string::size_type start = text.size();
+    while (!in_.eof() && ('<' != in_.peek())) {
+      character(text, trim_);
+    }
+    if (trim_ && (text.size() > start) && (' ' == text[text.size() - 1])) {
+      text.erase(text.size() - 1);
+    }
+  }
+
+  // one character or entity, spaces are condensed when normalizing
+  void
+  character(std::string& out, bool normalize) {
+    int c = in_.get();
+    if (normalize && isBlank(c)) {
+      out.push_back(' ');
+      skipSpaces(in_);
+    } else if ('&' == c) {
+      entity(out);
+    } else {
+      out.push_back(Traits::to_char_type(c));
+    }
+  }
+
+  // after '&', unknown entities are kept as they are
+  void
+  entity(std::string& out) {
+    if (in_.accept('#')) {
+      unsigned long code = 0;
+      if (in_.accept('x')) {
+        for (int d = hexDigit(in_.peek()); d >= 0; d = hexDigit(in_.peek())) {
+          code = code * 16 + d;
+          in_.get();
+          if (code > 0x10ffff) {
+            in_.fail("invalid numeric character entity");
+          }
+        }
+      } else {
+        while (('0' <= in_.peek()) && (in_.peek() <= '9')) {
+          code = code * 10 + (in_.get() - '0');
+          if (code > 0x10ffff) {
+            in_.fail("invalid numeric character entity");
+          }
+        }
+      }
+      if (!in_.accept(';')) {
+        in_.fail("expected ;");
+      }
+      appendUtf8(out, code);
+      return;
+    }
+
+    std::string name;
+    while ((name.size() < 4) &&
+           ((('a' <= in_.peek()) && (in_.peek() <= 'z')))) {
+      name.push_back(Traits::to_char_type(in_.get()));
+    }
+    if (';' == in_.peek()) {
+      const char *names[] = {"amp", "apos", "quot", "lt", "gt"};
+      const char chars[] = {'&', '\'', '"', '<', '>'};
+      for (std::size_t i = 0; i < sizeof(chars); ++i) {
+        if (name == names[i]) {
+          in_.get();
+          out.push_back(chars[i]);
+          return;
+        }
+      }
+    }
+    out.push_back('&');
+    out.append(name);
+  }
+
+  // raw text up to end (consumed)
+  void
+  readUntil(const char *end, std::string& out) {
+    const std::size_t size = Traits::length(end);
+    std::string::size_type start = out.size();
+    for (;;) {
+      if (in_.eof()) {
+        in_.fail("unexpected end of data");
+      }
+      out.push_back(Traits::to_char_type(in_.get()));
+      if ((out.size() - start >= size) &&
+          (0 == out.compare(out.size() - size, size, end))) {
+        out.erase(out.size() - size);
+        return;
+      }
+    }
+  }
+
+  void
+  skipPast(const char *end) {
+    std::string skipped;
+    readUntil(end, skipped);
+  }
+
+  // internal subset brackets may contain '>'
+  void
+  doctype() {
+    int depth = 0;
+    for (;;) {
+      int c = in_.get();
+      if (Traits::eq_int_type(c, Traits::eof())) {
+        in_.fail("unexpected end of data");
+      } else if ('[' == c) {
+        ++depth;
+      } else if (']' == c) {
+        --depth;
+      } else if (('>' == c) && (depth <= 0)) {
+        return;
+      }
+    }
+  }
+
+  Input& in_;
+  AttrHandler& handler_;
+  bool trim_; /**< trim and condense text */
+  std::vector<std::string> texts_; /**< text of the open elements */
+  std::string root_; /**< text outside of any element */
+};
+
+
+/*
+ * json, as read_json: every value is a string, arrays items have an
+ * empty key
+ */
+class JsonParser {
+public:
+  JsonParser(Input& in, AttrHandler& handler)
+    : in_(in), handler_(handler) {}
+
+  void
+  parse() {
+    skipBom(in_);
+    // containers being parsed
+    std::vector<char> open;
+    for (;;) {
+      // a value
+      skipSpaces(in_);
+      if (in_.accept('{')) {
+        skipSpaces(in_);
+        if (!in_.accept('}')) {
+          open.push_back('}');
+          member();
+          continue;
+        }
+      } else if (in_.accept('[')) {
+        skipSpaces(in_);
+        if (!in_.accept(']')) {
+          open.push_back(']');
+          handler_.beginNode("");
+          continue;
+        }
+      } else {
+        scalar();
+      }
+
+      // closes the containers it completes
+      for (;;) {
+        skipSpaces(in_);
+        if (open.empty()) {
+          if (!in_.eof()) {
+            in_.fail("garbage after data");
+          }
+          return;
+        }
+        handler_.endNode();
+        if (in_.accept(',')) {
+          if ('}' == open.back()) {
+            skipSpaces(in_);
+            member();
+          } else {
+            handler_.beginNode("");
+          }
+          break;
+        } else if (in_.accept(open.back())) {
+          open.pop_back();
+        } else {
+          in_.fail(('}' == open.back()) ? "expected ',' or '}'" :
+                   "expected ',' or ']'");
+        }
+      }
+    }
+  }
+
+private:
+  // "key": (the value follows)
+  void
+  member() {
+    if (!in_.accept('"')) {
+      in_.fail("expected key string");
+    }
+    std::string key;
+    string(key);
+    skipSpaces(in_);
+    if (!in_.accept(':')) {
+      in_.fail("expected ':'");
+    }
+    handler_.beginNode(key);
+  }
+
+  void
+  scalar() {
+    std::string data;
+    if (in_.accept('"')) {
+      string(data);
+    } else if (in_.accept('t')) {
+      literal("rue");
+      data = "true";
+    } else if (in_.accept('f')) {
+      literal("alse");
+      data = "false";
+    } else if (in_.accept('n')) {
+      literal("ull");
+      data = "null";
+    } else {
+      number(data);
+    }
+    emitValue(handler_, data);
+  }
+
+  void
+  literal(const char *rest) {
+    if (!in_.accept(rest)) {
+      in_.fail("expected value");
+    }
+  }
+
+  // numbers are kept as written
+  void
+  number(std::string& data) {
+    if (in_.accept('-')) {
+      data.push_back('-');
+    }
+    if (in_.accept('0')) {
+      data.push_back('0');
+    } else if (!digits(data)) {
+      in_.fail(data.empty() ? "expected value" : "expected digits after -");
+    }
+    if (in_.accept('.')) {
+      data.push_back('.');
+      if (!digits(data)) {
+        in_.fail("need at least one digit after '.'");
+      }
+    }
+    if (('e' == in_.peek()) || ('E' == in_.peek())) {
+      data.push_back(Traits::to_char_type(in_.get()));
+      if (in_.accept('+')) {
+        data.push_back('+');
+      } else if (in_.accept('-')) {
+        data.push_back('-');
+      }
+      if (!digits(data)) {
+        in_.fail("need at least one digit in exponent");
+      }
+    }
+  }
+
+  bool
+  digits(std::string& data) {
+    bool any = false;
+    while (('0' <= in_.peek()) && (in_.peek() <= '9')) {
+      data.push_back(Traits::to_char_type(in_.get()));
+      any = true;
+    }
+    return any;
+  }
+
+  // after the opening quote
+  void
+  string(std::string& out) {
+    for (;;) {
+      int c = in_.get();
+      if (Traits::eq_int_type(c, Traits::eof())) {
+        in_.fail("unterminated string");
+      } else if ('"' == c) {
+        return;
+      } else if ('\\' == c) {
+        escape(out);
+      } else if (static_cast<unsigned int>(c) < 0x20) {
+        in_.fail("invalid code sequence");
+      } else {
+        out.push_back(Traits::to_char_type(c));
+      }
+    }
+  }
+
+  void
+  escape(std::string& out) {
+    int c = in_.get();
+    switch (c) {
+    case '"': out.push_back('"'); break;
+    case '\\': out.push_back('\\'); break;
+    case '/': out.push_back('/'); break;
+    case 'b': out.push_back('\b'); break;
+    case 'f': out.push_back('\f'); break;
+    case 'n': out.push_back('\n'); break;
+    case 'r': out.push_back('\r'); break;
+    case 't': out.push_back('\t'); break;
+    case 'u': {
+      unsigned long code = codeUnit();
+      if ((0xdc00 <= code) && (code <= 0xdfff)) {
+        in_.fail("invalid codepoint, stray low surrogate");
+      } else if ((0xd800 <= code) && (code <= 0xdbff)) {
+        if (!in_.accept("\\u")) {
+          in_.fail("invalid codepoint, stray high surrogate");
+        }
+        unsigned long low = codeUnit();
+        if ((low < 0xdc00) || (0xdfff < low)) {
+          in_.fail("expected low surrogate after high surrogate");
+        }
+        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+      }
+      appendUtf8(out, code);
+      break;
+    }
+    default:
+      in_.fail("invalid escape sequence");
+    }
+  }
+
+  unsigned long
+  codeUnit() {
+    unsigned long code = 0;
+    for (int i = 0; i < 4; ++i) {
+      int d = hexDigit(in_.get());
+      if (d < 0) {
+        in_.fail("invalid escape sequence");
+      }
+      code = code * 16 + d;
+    }
+    return code;
+  }
+
+  Input& in_;
+  AttrHandler& handler_;
+};
+
+
+/*
+ * info, as read_info: read line by line, a node is closed when its
+ * next sibling begins or its parent is closed
+ */
+class InfoParser {
+public:
+  InfoParser(Input& in, AttrHandler& handler, int includes)
+    : in_(in), handler_(handler), includes_(includes), depth_(0),
+      open_(false), pending_(false) {}
+
+  void
+  parse() {
+    enum { KEY, DATA, DATA_CONT } state = KEY;
+    std::string line;
+    bool more = true;
+    while (more) {
+      more = in_.line(line);
+      const char *text = line.c_str();
+      skip(text);
+      if ('#' == *text) {
+        ++text;
+        directive(text);
+        continue;
+      }
+
+      for (;;) {
+        skip(text);
+        if (('\0' == *text) || (';' == *text)) {
+          if (DATA == state) {
+            state = KEY;
+          }
+          break;
+        }
+        if (DATA_CONT == state) {
+          if ('"' != *text) {
+            fail("expected \" after \\ in previous line");
+          }
+          bool cont;
+          data_ += quoted(text, &cont);
+          state = cont ? DATA_CONT : KEY;
+        } else if ('{' == *text) {
+          if ((KEY == state) && !open_) {
+            fail("unexpected {");
+          }
+          flush();
+          ++depth_;
+          open_ = false;
+          ++text;
+          state = KEY;
+        } else if ('}' == *text) {
+          if (0 == depth_) {
+            fail("unmatched }");
+          }
+          close();
+          handler_.endNode();
+          --depth_;
+          ++text;
+          state = KEY;
+        } else if (KEY == state) {
+          std::string key = ('"' == *text) ? quoted(text, NULL) : word(text);
+          close();
+          handler_.beginNode(key);
+          open_ = true;
+          state = DATA;
+        } else {
+          bool cont = false;
+          data_ = ('"' == *text) ? quoted(text, &cont) : word(text);
+          pending_ = true;
+          state = cont ? DATA_CONT : KEY;
+        }
+      }
+    }
+    if (0 != depth_) {
+      fail("unmatched {");
+    }
+    close();
+  }
+
+private:
+  // #include "file": its nodes are siblings of the current node
+  void
+  directive(const char *& text) {
+    if ("include" != word(text)) {
+      fail("unknown directive");
+    }
+    if (includes_ > MAX_INCLUDE_DEPTH) {
+      fail("include depth too large, probably recursive include");
+    }
+    skip(text);
+    std::string name = quoted(text, NULL);
+    skip(text);
+    if ('\0' != *text) {
+      fail("expected end of line");
+    }
+
+    std::ifstream file(name.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!file.good()) {
+      fail("cannot open include file " + name);
+    }
+    close();
+    Input in(file.rdbuf(), name);
+    InfoParser(in, handler_, includes_ + 1).parse();
+  }
+
+  void
+  flush() {
+    if (pending_) {
+      emitValue(handler_, data_);
+      pending_ = false;
+    }
+  }
+
+  // ends the last node, unless it has children
+  void
+  close() {
+    flush();
+    if (open_) {
+      handler_.endNode();
+      open_ = false;
+    }
+  }
+
+  static bool
+  space(char c) {
+    return (c >= 0) && isSpace(c);
+  }
+
+  static void
+  skip(const char *& text) {
+    while (space(*text)) {
+      ++text;
+    }
+  }
+
+  std::string
+  word(const char *& text) {
+    skip(text);
+    const char *start = text;
+    while (('\0' != *text) && (';' != *text) && !space(*text)) {
+      ++text;
+    }
+    return unescape(start, text);
+  }
+
+  // "string" followed by an optional \ when cont is allowed
+  std::string
+  quoted(const char *& text, bool *cont) {
+    skip(text);
+    if ('"' != *text) {
+      fail("expected \"");
+    }
+    const char *start = ++text;
+    bool escaped = false;
+    while (('\0' != *text) && (escaped || ('"' != *text))) {
+      escaped = !escaped && ('\\' == *text);
+      ++text;
+    }
+    if ('"' != *text) {
+      fail("unexpected end of line");
+    }
+    std::string result = unescape(start, text++);
+    skip(text);
+    if ('\\' == *text) {
+      if (!cont) {
+        fail("unexpected \\");
+      }
+      ++text;
+      skip(text);
+      if (('\0' != *text) && (';' != *text)) {
+        fail("expected end of line after \\");
+      }
+      *cont = true;
+    } else if (cont) {
+      *cont = false;
+    }
+    return result;
+  }
+
+  std::string
+  unescape(const char *begin, const char *end) {
+    std::string result;
+    for (; begin != end; ++begin) {
+      if ('\\' != *begin) {
+        result.push_back(*begin);
+        continue;
+      }
+      if (++begin == end) {
+        fail("character expected after backslash");
+      }
+      const char *escapes = "0abfnrtv\"'\\";
+      const char *chars = "\0\a\b\f\n\r\t\v\"'\\";
+      const char *found = Traits::find(escapes, 11, *begin);
+      if (!found) {
+        fail("unknown escape sequence");
+      }
+      result.push_back(chars[found - escapes]);
+    }
+    return result;
+  }
+
+  void
+  fail(const std::string& reason) const {
+    in_.fail(reason);
+  }
+
+  Input& in_;
+  AttrHandler& handler_;
+  int includes_; /**< #include nesting */
+  std::size_t depth_; /**< open braces */
+  bool open_; /**< last node begun and not ended */
+  bool pending_; /**< data_ not reported yet */
+  std::string data_; /**< value of the last node */
+};
+
+
+/*
+ * ini, as read_ini: sections are reported on their first key (empty
+ * sections are dropped), duplicate sections and keys are rejected
+ */
+void
+parseIni(Input& in, AttrHandler& handler) {
+  boost::unordered_set<std::string> names; // top level
+  boost::unordered_set<std::string> keys; // current section
+  std::string section;
+  bool inSection = false;
+  bool begun = false;
+  std::string line;
+  bool more = true;
+  while (more) {
+    more = in.line(line);
+    std::string::size_type first = 0, last = line.size();
+    while ((first < last) && isSpace(line[first])) {
+      ++first;
+    }
+    while ((last > first) && isSpace(line[last - 1])) {
+      --last;
+    }
+    if ((first == last) || (';' == line[first]) || ('#' == line[first])) {
+      continue;
+    }
+    line = line.substr(first, last - first);
+
+    if ('[' == line[0]) {
+      if (begun) {
+        handler.endNode();
+      } else if (inSection) {
+        names.erase(section);
+      }
+      std::string::size_type end = line.find(']');
+      if (std::string::npos == end) {
+        in.fail("unmatched '['");
+      }
+      section = line.substr(1, end - 1);
+      std::string::size_type start = section.find_first_not_of(" \t\n\r\v\f");
+      section.erase(0, std::min(start, section.size()));
+      section.erase(section.find_last_not_of(" \t\n\r\v\f") + 1);
+      if (!names.insert(section).second) {
+        in.fail("duplicate section name");
+      }
+      keys.clear();
+      inSection = true;
+      begun = false;
+      continue;
+    }
+
+    std::string::size_type eq = line.find('=');
+    if (std::string::npos == eq) {
+      in.fail("'=' character not found in line");
+    } else if (0 == eq) {
+      in.fail("key expected");
+    }
+    std::string key = line.substr(0, eq);
+    key.erase(key.find_last_not_of(" \t\n\r\v\f") + 1);
+    std::string data = line.substr(eq + 1);
+    data.erase(0, std::min(data.find_first_not_of(" \t\n\r\v\f"),
+                           data.size()));
+    if (!(inSection ? keys : names).insert(key).second) {
+      in.fail("duplicate key name");
+    }
+    if (inSection && !begun) {
+      handler.beginNode(section);
+      begun = true;
+    }
+    handler.beginNode(key);
+    emitValue(handler, data);
+    handler.endNode();
+  }
+  if (begun) {
+    handler.endNode();
+  }
+}
+
+
+// binary documents are decoded in memory
+void
+parseBinaryNode(detail::BinaryReader& reader, AttrHandler& handler) {
+  const char *data;
+  std::size_t size;
+  switch (reader.tag()) {
+  case detail::AttrValue::NONE:
+    break;
+  case detail::AttrValue::STRING:
+    reader.string(data, size);
+    emitValue(handler, std::string(data, size));
+    break;
+  case detail::AttrValue::INT:
+    handler.value(detail::toString(reader.integer()));
+    break;
+  case detail::AttrValue::FLOAT:
+    handler.value(detail::toString(static_cast<float>(reader.number())));
+    break;
+  case detail::AttrValue::DOUBLE:
+    handler.value(detail::toString(reader.number()));
+    break;
+  case detail::AttrValue::BOOL:
+    handler.value(detail::toString(reader.boolean()));
+    break;
+  }
+
+  std::size_t count = reader.count();
+  for (std::size_t i = 0; i < count; ++i) {
+    reader.string(data, size);
+    handler.beginNode(std::string(data, size));
+    reader.enter();
+    parseBinaryNode(reader, handler);
+    reader.leave();
+    handler.endNode();
+  }
+}
+
+void
+parseBinary(const char *data, std::size_t size, AttrHandler& handler) {
+  detail::BinaryReader reader(data, size);
+  parseBinaryNode(reader, handler);
+  reader.finish();
+}
+
+std::vector<std::string>
+split(const std::string& path) {
+  std::vector<std::string> keys;
+  if (path.empty()) {
+    return keys;
+  }
+  std::string::size_type pos = 0;
+  for (;;) {
+    std::string::size_type sep = path.find('.', pos);
+    keys.push_back(path.substr(pos, sep - pos));
+    if (std::string::npos == sep) {
+      break;
+    }
+    pos = sep + 1;
+  }
+  return keys;
+}
+} /* namespace */
+
+AttrHandler::~AttrHandler() {}
+
+void
+readAttr(std::istream& input, AttrHandler& handler, int format, int flags) {
+  // binary data starts with a NUL byte, never valid text
+  if ((FORMAT_BINARY == format) ||
+      (input.peek() == Traits::to_int_type('\0'))) {
+    std::string data((std::istreambuf_iterator<char>(input)),
+                     std::istreambuf_iterator<char>());
+    parseBinary(data.data(), data.size(), handler);
+    return;
+  }
+
+  Input in(input.rdbuf(), "<unspecified file>");
+  switch (format) {
+  case FORMAT_JSON:
+    JsonParser(in, handler).parse();
+    break;
+  case FORMAT_INI:
+    parseIni(in, handler);
+    break;
+  case FORMAT_INFO:
+    InfoParser(in, handler, 0).parse();
+    break;
+  case FORMAT_XML:
+  default:
+    XmlParser(in, handler, flags & READ_TRIM_WHITESPACE).parse();
+  }
+}
+
+void
+readAttr(const char *data, std::size_t size, AttrHandler& handler,
+         int format, int flags) {
+  if ((FORMAT_BINARY == format) || detail::isBinary(data, size)) {
+    parseBinary(data, size, handler);
+    return;
+  }
+  boost::iostreams::stream<boost::iostreams::array_source> ss(data, size);
+  readAttr(ss, handler, format, flags);
+}
+
+AttrSelector::AttrSelector(ConfigStore& tree,
+                           const std::vector<std::string>& prefixes)
+  : root_(tree), selected_(0), skipped_(0), all_(false) {
+  for (std::vector<std::string>::const_iterator it = prefixes.begin();
+       it != prefixes.end(); ++it) {
+    prefixes_.push_back(split(*it));
+    all_ = all_ || prefixes_.back().empty();
+  }
+}
+
+void
+AttrSelector::beginNode(const std::string& key) {
+  if (skipped_) {
+    ++skipped_;
+    return;
+  }
+
+  Frame frame = {key, NULL};
+  frames_.push_back(frame);
+  if (all_ || selected_) {
+    materialize();
+    return;
+  }
+  for (std::size_t i = 0; i < prefixes_.size(); ++i) {
+    const std::vector<std::string>& prefix = prefixes_[i];
+    if ((prefix.size() == frames_.size()) && (prefix.back() == key) &&
+        candidate(prefix, frames_.size() - 1)) {
+      selected_ = frames_.size();
+      materialize();
+      return;
+    }
+  }
+  if (!candidate()) {
+    // no selected path goes through this node
+    frames_.pop_back();
+    skipped_ = 1;
+  }
+}
+
+void
+AttrSelector::value(const std::string& data) {
+  if (skipped_) {
+    return;
+  }
+  if (frames_.empty()) {
+    if (all_) {
+      root_.data() = data;
+    }
+  } else if (frames_.back().node && (all_ || selected_)) {
+    frames_.back().node->data() = data;
+  }
+}
+
+void
+AttrSelector::endNode() {
+  if (skipped_) {
+    --skipped_;
+    return;
+  }
+  frames_.pop_back();
+  if (frames_.size() < selected_) {
+    selected_ = 0;
+  }
+}
+
+ConfigStore&
+AttrSelector::materialize() {
+  std::size_t i = frames_.size();
+  while ((i > 0) && !frames_[i - 1].node) {
+    --i;
+  }
+  for (; i < frames_.size(); ++i) {
+    ConfigStore& parent = (0 == i) ? root_ : *frames_[i - 1].node;
+    frames_[i].node =
+      &parent.push_back(ConfigStore::value_type(frames_[i].key,
+                                                ConfigStore()))->second;
+  }
+  return *frames_.back().node;
+}
+
+bool
+AttrSelector::candidate() const {
+  for (std::size_t i = 0; i < prefixes_.size(); ++i) {
+    if ((prefixes_[i].size() > frames_.size()) &&
+        candidate(prefixes_[i], frames_.size())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+AttrSelector::candidate(const std::vector<std::string>& prefix,
+                        std::size_t depth) const {
+  for (std::size_t i = 0; i < depth; ++i) {
+    if (prefix[i] != frames_[i].key) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} /* namespace dadi */
@@ -8,17 +8,53 @@
  */
 
 #include "dadi/Attributes.hh"
+#include "dadi/AttrReader.hh"
+#include "dadi/detail/Binary.hh"
 #include <list>
 #include <sstream>
 #include <string>
-#include <boost/format.hpp>
-#include <boost/algorithm/string/erase.hpp>
+#include <boost/atomic.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 
 namespace dadi {
 
-Attributes::Attributes() {}
+namespace {
+// structure versions are never reused, 0 is never issued
+boost::atomic<unsigned long> versions(0);
+}
+
+AttrPath::AttrPath(const std::string& path, bool cached)
+  : path_(path), cached_(cached), node_(NULL), version_(0) {
+  if (path.empty()) {
+    return;
+  }
+  std::string::size_type pos = 0;
+  for (;;) {
+    std::string::size_type sep = path.find('.', pos);
+    keys_.push_back(path.substr(pos, sep - pos));
+    if (std::string::npos == sep) {
+      break;
+    }
+    pos = sep + 1;
+  }
+}
+
+const std::string&
+AttrPath::str() const {
+  return path_;
+}
 
-Attributes::Attributes(const Attributes& other) : pt(other.pt) {}
+Attributes::Attributes() {
+  touch();
+}
+
+Attributes::Attributes(const Attributes& other) : pt(other.pt) {
+  touch();
+}
 
 Attributes::Attributes(const std::string& data, int format) {
   loadAttr(data, format);
@@ -26,12 +62,24 @@ Attributes::Attributes(const std::string& data, int format) {
 
 void
 Attributes::loadAttr(const std::string& data, int format) {
-  using boost::property_tree::write_json;
-  using boost::property_tree::write_ini;
-  using boost::property_tree::write_xml;
-  using boost::property_tree::write_info;
-  std::istringstream ss(data);
+  loadAttr(data.data(), data.size(), format);
+}
 
+void
+Attributes::loadAttr(const char *data, std::size_t size, int format) {
+  using boost::property_tree::read_json;
+  using boost::property_tree::read_ini;
+  using boost::property_tree::read_xml;
+  using boost::property_tree::read_info;
+
+  touch();
+  // binary data is never valid text: recognize it whatever the format
+  if ((FORMAT_BINARY == format) || detail::isBinary(data, size)) {
+    detail::readBinary(data, size, pt);
+    return;
+  }
+
+  boost::iostreams::stream<boost::iostreams::array_source> ss(data, size);
   try {
     switch (format) {
     case FORMAT_JSON:
@@ -52,14 +100,37 @@ Attributes::loadAttr(const std::string& data, int format) {
   }
 }
 
+void
+Attributes::loadAttr(std::istream& input,
+                     const std::vector<std::string>& prefixes, int format) {
+  ConfigStore selected;
+  AttrSelector selector(selected, prefixes);
+  readAttr(input, selector, format, READ_TRIM_WHITESPACE);
+  pt.swap(selected);
+  touch();
+}
+
 std::string
 Attributes::saveAttr(int format) const {
+  std::string data;
+  saveAttr(data, format);
+  return data;
+}
+
+void
+Attributes::saveAttr(std::string& data, int format) const {
   using boost::property_tree::write_json;
   using boost::property_tree::write_ini;
   using boost::property_tree::write_xml;
   using boost::property_tree::write_info;
-  std::ostringstream ss;
 
+  data.clear();
+  if (FORMAT_BINARY == format) {
+    detail::writeBinary(data, pt);
+    return;
+  }
+
+  std::ostringstream ss;
   try {
     switch (format) {
     case FORMAT_JSON:
@@ -81,17 +152,21 @@ Attributes::saveAttr(int format) const {
     BOOST_THROW_EXCEPTION(ParsingAttributeError() << errinfo_msg(e.what()));
   }
 
-  return ss.str();
+  data = ss.str();
 }
 
 void
 Attributes::swap(Attributes& from) {
   (this->pt).swap(from.pt);
+  touch();
+  from.touch();
 }
+
 Attributes&
 Attributes::operator=(const Attributes& other) {
   Attributes tmp(other);
   swap(tmp);
+  return *this;
 }
 
 bool
@@ -105,133 +180,102 @@ Attributes::operator!=(const Attributes& other) const {
 }
 
 namespace {
-template<typename T>
-/**
- * @class ptree_applier
- * @brief helper class that applies a given functor to
- * two boost::property_tree::ptree.
- * The template parameter is a functor applied to both ptree
- * (add, diff, merge etc...)
- */
-class ptree_applier : public boost::noncopyable {
-public:
-  /**
-   * @brief constructor
-   * @param one first ptree
-   * @param two second ptree
-   */
-  ptree_applier(boost::property_tree::ptree& one,
-       boost::property_tree::ptree& two)
-    : one_(one), two_(two) {
-    method_.reset(one_);
-  }
+using boost::property_tree::ptree;
 
-  /**
-   * @brief return resulting ptree
-   * @return ptree
-   */
-  boost::property_tree::ptree
-  operator() () {
-    boost::property_tree::ptree::path_type empty;
-    traverse_recursive(empty, two_);
-    return method_.getResult();
+/* leaves are identified by their key and their data */
+struct LeafHash {
+  std::size_t
+  operator()(const ptree::value_type *leaf) const {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, leaf->first);
+    boost::hash_combine(seed, leaf->second.data());
+    return seed;
   }
+};
 
-  /**
-   * @brief recursive method that applies method_
-   * @param childPath
-   * @param child
-   */
-  void
-  traverse_recursive(boost::property_tree::ptree::path_type& childPath,
-                     const boost::property_tree::ptree& child) {
-    using boost::property_tree::ptree;
-
-    method_(childPath, child);
-    for (ptree::const_iterator it = child.begin(); it != child.end(); ++it) {
-      ptree::path_type curPath = childPath / ptree::path_type(it->first);
-       traverse_recursive(curPath, it->second);
-    }
+struct LeafEqual {
+  bool
+  operator()(const ptree::value_type *a, const ptree::value_type *b) const {
+    return (a->first == b->first) && (a->second.data() == b->second.data());
   }
-
-  boost::property_tree::ptree& one_; /*< first ptree */
-  boost::property_tree::ptree& two_; /*< second ptree */
-  T method_; /*< functor applied to the ptree */
 };
 
+typedef boost::unordered_set<const ptree::value_type *, LeafHash, LeafEqual>
+LeafSet;
+
 /**
- * @class ptree_merge
- * @brief helper class that merge two boost::property::ptree
+ * @class TreeMerger
+ * @brief merge the leaves of a tree into another one, walking both trees
+ * in lockstep
+ *
+ * A leaf is added unless its parent already has a child with the same key
+ * and data. The children of a destination node are indexed the first time
+ * a leaf is merged below it, the index is then kept up to date so that
+ * each leaf costs a hash lookup.
  */
-class ptree_merge {
+class TreeMerger {
 public:
-  /**
-   * @brief default constructor
-   */
-  ptree_merge() {}
   /**
    * @brief constructor
-   * @param pt initialize resulting ptree
+   * @param steal move data out of the merged tree instead of copying it
    */
-  explicit ptree_merge(boost::property_tree::ptree& pt) : res_(pt) {}
+  explicit TreeMerger(bool steal) : steal_(steal) {}
 
   /**
-   * @brief reset resulting ptree
-   * @param pt initialize resulting ptree
+   * @brief merge src into dst
+   * @param dst destination node
+   * @param src merged node (only modified when stealing)
    */
   void
-  reset(boost::property_tree::ptree& pt) {
-    boost::property_tree::ptree tmp(pt);
-    res_.swap(tmp);
-  }
-
-  /**
-   * @brief merge a node into resulting ptree
-   * @param path node to merge path
-   * @param child node to merge
-   */
-  void
-  operator()(const boost::property_tree::ptree::path_type& path,
-             const boost::property_tree::ptree& child) {
-    using boost::property_tree::ptree;
-    using boost::algorithm::erase_tail_copy;
-
-    /* check if this is a final node */
-    if (child.empty()) {
-      /* if same node exists don't add it */
-      std::string currentPath = path.dump();
-      size_t pos = currentPath.length() - currentPath.find_last_of('.');
-      std::string parentPath = erase_tail_copy(currentPath, pos);
-      bool exists(false);
-      // check if new parent node exists before
-      boost::optional<ptree&> parent = res_.get_child_optional(parentPath);
-      if (parent) {
-        BOOST_FOREACH(ptree::value_type& v, parent.get()) {
-          std::string p =
-          boost::str(boost::format("%1%.%2%") % parentPath % v.first);
-          if ((p == path.dump()) && v.second.data() == child.data()) {
-            exists = true;
-          }
+  operator()(ptree& dst, ptree& src) {
+    Indexes::iterator indexed = indexes_.find(&dst);
+    LeafSet *leaves = (indexes_.end() == indexed) ? NULL : &indexed->second;
+    for (ptree::iterator it = src.begin(); it != src.end(); ++it) {
+      if (!it->second.empty()) {
+        // first node with the same key, as when adding through a path
+        ptree::assoc_iterator child = dst.find(it->first);
+        if (dst.not_found() != child) {
+          (*this)(child->second, it->second);
+          continue;
+        }
+        dst.push_back(ptree::value_type(it->first, ptree()));
+        if (leaves) {
+          leaves->insert(&dst.back());
         }
+        (*this)(dst.back().second, it->second);
+        continue;
       }
 
-      if (!exists) {
-        res_.add(path, child.data());
+      if (!leaves) {
+        leaves = &index(dst);
       }
+      if (leaves->count(&*it)) {
+        continue;
+      }
+      dst.push_back(ptree::value_type(it->first, ptree()));
+      if (steal_) {
+        dst.back().second.data().swap(it->second.data());
+      } else {
+        dst.back().second.data() = it->second.data();
+      }
+      leaves->insert(&dst.back());
     }
   }
 
-  /**
-   * @brief get resulting ptree
-   * @return ptree
-   */
-  boost::property_tree::ptree
-  getResult() {
-    return res_;
+private:
+  typedef boost::unordered_map<const ptree *, LeafSet> Indexes;
+
+  LeafSet&
+  index(ptree& node) {
+    LeafSet& leaves = indexes_[&node];
+    for (ptree::const_iterator it = node.begin(); it != node.end(); ++it) {
+      leaves.insert(&*it);
+    }
+    return leaves;
   }
 
-private:
-  boost::property_tree::ptree res_; /*< resulting ptree */
+  bool steal_; /**< move data out of the merged tree */
+  Indexes indexes_; /**< indexed destination nodes */
 };
 
 } /* namespace */
@@ -239,8 +283,83 @@ private:
 
 void
 Attributes::merge(Attributes& other) {
-  ptree_applier<ptree_merge> c(this->pt, other.pt);
-  pt = c();
+  if (this == &other) {
+    return;
+  }
+  TreeMerger merger(false);
+  merger(pt, other.pt);
+  touch();
+}
+
+void
+Attributes::splice(Attributes& other) {
+  if (this == &other) {
+    return;
+  }
+  TreeMerger merger(true);
+  merger(pt, other.pt);
+  other.pt.clear();
+  touch();
+  other.touch();
+}
+
+boost::property_tree::ptree *
+Attributes::find(const AttrPath& path) const {
+  using boost::property_tree::ptree;
+  if (path.cached_ && (path.version_ == version_)) {
+    return path.node_;
+  }
+
+  ptree *node = const_cast<ptree *>(&pt);
+  std::vector<std::string>::const_iterator it = path.keys_.begin();
+  for (; path.keys_.end() != it; ++it) {
+    ptree::assoc_iterator child = node->find(*it);
+    if (node->not_found() == child) {
+      return NULL;
+    }
+    node = &child->second;
+  }
+
+  if (path.cached_) {
+    path.node_ = node;
+    path.version_ = version_;
+  }
+  return node;
+}
+
+boost::property_tree::ptree&
+Attributes::force(const AttrPath& path) {
+  using boost::property_tree::ptree;
+  if (path.cached_ && (path.version_ == version_)) {
+    return *path.node_;
+  }
+
+  ptree *node = &pt;
+  bool created(false);
+  std::vector<std::string>::const_iterator it = path.keys_.begin();
+  for (; path.keys_.end() != it; ++it) {
+    ptree::assoc_iterator child = node->find(*it);
+    if (node->not_found() == child) {
+      node = &node->push_back(ptree::value_type(*it, ptree()))->second;
+      created = true;
+    } else {
+      node = &child->second;
+    }
+  }
+  if (created) {
+    touch();
+  }
+
+  if (path.cached_) {
+    path.node_ = node;
+    path.version_ = version_;
+  }
+  return *node;
+}
+
+void
+Attributes::touch() {
+  version_ = ++versions;
 }
 
 std::string
@@ -0,0 +1,283 @@
+/**
+ * @file   Binary.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compact binary encoding of attributes (FORMAT_BINARY)
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/detail/Binary.hh"
+#include <cstring>
+#include "dadi/detail/AttrValue.hh"
+#include "dadi/Exception/Attributes.hh"
+
+namespace dadi {
+namespace detail {
+
+const char BINARY_MAGIC[4] = {'\0', 'D', 'A', '\1'};
+
+namespace {
+// deeper documents are rejected instead of exhausting the stack
+const unsigned int MAX_DEPTH(256);
+
+void
+invalid(const std::string& reason) {
+  BOOST_THROW_EXCEPTION(ParsingAttributeError()
+                        << errinfo_msg("invalid binary attributes: " +
+                                       reason));
+}
+
+boost::uint64_t
+toBits(double value) {
+  boost::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double
+fromBits(boost::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void
+writeNode(BinaryWriter& writer, const ConfigStore& node) {
+  writer.string(node.data());
+  writer.count(node.size());
+  for (ConfigStore::const_iterator it = node.begin(); it != node.end(); ++it) {
+    writer.key(it->first);
+    writeNode(writer, it->second);
+  }
+}
+
+void
+readNode(BinaryReader& reader, ConfigStore& node) {
+  const char *data;
+  std::size_t size;
+  switch (reader.tag()) {
+  case AttrValue::NONE:
+    break;
+  case AttrValue::STRING:
+    reader.string(data, size);
+    node.data().assign(data, size);
+    break;
+  case AttrValue::INT:
+    node.data() = toString(reader.integer());
+    break;
+  case AttrValue::FLOAT:
+    node.data() = toString(static_cast<float>(reader.number()));
+    break;
+  case AttrValue::DOUBLE:
+    node.data() = toString(reader.number());
+    break;
+  case AttrValue::BOOL:
+    node.data() = toString(reader.boolean());
+    break;
+  }
+
+  std::size_t count = reader.count();
+  for (std::size_t i = 0; i < count; ++i) {
+    reader.string(data, size);
+    ConfigStore& child =
+      node.push_back(ConfigStore::value_type(std::string(data, size),
+                                             ConfigStore()))->second;
+    reader.enter();
+    readNode(reader, child);
+    reader.leave();
+  }
+}
+} /* namespace */
+
+bool
+isBinary(const char *data, std::size_t size) {
+  return (size >= sizeof(BINARY_MAGIC)) &&
+    (0 == std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)));
+}
+
+BinaryWriter::BinaryWriter(std::string& out) : out_(out) {
+  out_.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+}
+
+void
+BinaryWriter::none() {
+  out_.push_back(static_cast<char>(AttrValue::NONE));
+}
+
+void
+BinaryWriter::string(const std::string& data) {
+  if (data.empty()) {
+    none();
+    return;
+  }
+  out_.push_back(static_cast<char>(AttrValue::STRING));
+  key(data);
+}
+
+void
+BinaryWriter::integer(boost::int64_t value) {
+  out_.push_back(static_cast<char>(AttrValue::INT));
+  // zigzag: small negative values stay short
+  varint((static_cast<boost::uint64_t>(value) << 1) ^
+         static_cast<boost::uint64_t>(value >> 63));
+}
+
+void
+BinaryWriter::number(double value, bool single) {
+  out_.push_back(static_cast<char>(single ? AttrValue::FLOAT :
+                                   AttrValue::DOUBLE));
+  boost::uint64_t bits = toBits(value);
+  for (int i = 0; i < 8; ++i) {
+    out_.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+  }
+}
+
+void
+BinaryWriter::boolean(bool value) {
+  out_.push_back(static_cast<char>(AttrValue::BOOL));
+  out_.push_back(value ? '\1' : '\0');
+}
+
+void
+BinaryWriter::count(std::size_t count) {
+  varint(count);
+}
+
+void
+BinaryWriter::key(const std::string& key) {
+  varint(key.size());
+  out_.append(key);
+}
+
+void
+BinaryWriter::varint(boost::uint64_t value) {
+  while (value >= 0x80) {
+    out_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out_.push_back(static_cast<char>(value));
+}
+
+BinaryReader::BinaryReader(const char *data, std::size_t size)
+  : pos_(data), end_(data + size), depth_(0) {
+  if (!isBinary(data, size)) {
+    invalid("bad magic");
+  }
+  pos_ += sizeof(BINARY_MAGIC);
+}
+
+int
+BinaryReader::tag() {
+  need(1);
+  int tag = static_cast<unsigned char>(*pos_++);
+  if (tag > AttrValue::STRING) {
+    invalid("unknown tag");
+  }
+  return tag;
+}
+
+void
+BinaryReader::string(const char *& data, std::size_t& size) {
+  boost::uint64_t length = varint();
+  if (length > static_cast<boost::uint64_t>(end_ - pos_)) {
+    invalid("truncated data");
+  }
+  data = pos_;
+  size = static_cast<std::size_t>(length);
+  pos_ += size;
+}
+
+boost::int64_t
+BinaryReader::integer() {
+  boost::uint64_t value = varint();
+  return static_cast<boost::int64_t>(value >> 1) ^
+    -static_cast<boost::int64_t>(value & 1);
+}
+
+double
+BinaryReader::number() {
+  need(8);
+  boost::uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits |= static_cast<boost::uint64_t>(
+      static_cast<unsigned char>(pos_[i])) << (8 * i);
+  }
+  pos_ += 8;
+  return fromBits(bits);
+}
+
+bool
+BinaryReader::boolean() {
+  need(1);
+  return '\0' != *pos_++;
+}
+
+std::size_t
+BinaryReader::count() {
+  boost::uint64_t count = varint();
+  // each child takes two bytes at least
+  if (count > static_cast<boost::uint64_t>(end_ - pos_) / 2) {
+    invalid("truncated data");
+  }
+  return static_cast<std::size_t>(count);
+}
+
+void
+BinaryReader::enter() {
+  if (++depth_ > MAX_DEPTH) {
+    invalid("nested too deeply");
+  }
+}
+
+void
+BinaryReader::leave() {
+  --depth_;
+}
+
+void
+BinaryReader::finish() const {
+  if (pos_ != end_) {
+    invalid("trailing data");
+  }
+}
+
+boost::uint64_t
+BinaryReader::varint() {
+  boost::uint64_t value = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    need(1);
+    unsigned char byte = static_cast<unsigned char>(*pos_++);
+    value |= static_cast<boost::uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  invalid("bad varint");
+  return 0;
+}
+
+void
+BinaryReader::need(std::size_t size) const {
+  if (static_cast<std::size_t>(end_ - pos_) < size) {
+    invalid("truncated data");
+  }
+}
+
+void
+writeBinary(std::string& out, const ConfigStore& tree) {
+  BinaryWriter writer(out);
+  writeNode(writer, tree);
+}
+
+void
+readBinary(const char *data, std::size_t size, ConfigStore& tree) {
+  BinaryReader reader(data, size);
+  ConfigStore tmp;
+  readNode(reader, tmp);
+  reader.finish();
+  tree.swap(tmp);
+}
+
+} /* namespace detail */
+} /* namespace dadi */
@@ -0,0 +1,636 @@
+/**
+ * @file   FlatAttributes.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  attributes stored in a flat node array
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/FlatAttributes.hh"
+#include "dadi/detail/Binary.hh"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/version.hpp>
+
+namespace dadi {
+
+namespace {
+bool
+sameKey(const std::string& key, const char *data, std::size_t size) {
+  return (key.size() == size) && (0 == std::memcmp(key.data(), data, size));
+}
+} /* namespace */
+
+const boost::uint32_t FlatAttributes::NPOS;
+
+FlatAttributes::Path::Path(const std::string& path) : path_(path) {
+  if (path.empty()) {
+    return;
+  }
+  const char *pos = path.data();
+  const char *end = pos + path.size();
+  for (;;) {
+    const char *sep = std::find(pos, end, '.');
+    keys_.push_back(std::string(pos, sep));
+    hashes_.push_back(boost::hash<std::string>()(keys_.back()));
+    if (end == sep) {
+      break;
+    }
+    pos = sep + 1;
+  }
+}
+
+const std::string&
+FlatAttributes::Path::str() const {
+  return path_;
+}
+
+FlatAttributes::FlatAttributes() : nodes_(1) {
+  nodes_[0].key = intern(std::string());
+  nodes_[0].child = nodes_[0].last = nodes_[0].next = 0;
+}
+
+FlatAttributes::FlatAttributes(const std::string& data, int format)
+  : nodes_(1) {
+  nodes_[0].key = intern(std::string());
+  nodes_[0].child = nodes_[0].last = nodes_[0].next = 0;
+  loadAttr(data, format);
+}
+
+void
+FlatAttributes::loadAttr(const std::string& data, int format) {
+  loadAttr(data.data(), data.size(), format);
+}
+
+void
+FlatAttributes::loadAttr(const char *data, std::size_t size, int format) {
+  using boost::property_tree::read_json;
+  using boost::property_tree::read_ini;
+  using boost::property_tree::read_xml;
+  using boost::property_tree::read_info;
+
+  // binary data is never valid text: recognize it whatever the format
+  if ((FORMAT_BINARY == format) || detail::isBinary(data, size)) {
+    detail::BinaryReader reader(data, size);
+    FlatAttributes tmp;
+    tmp.readNode(reader, 0);
+    reader.finish();
+    swap(tmp);
+    return;
+  }
+
+  boost::iostreams::stream<boost::iostreams::array_source> ss(data, size);
+  ConfigStore tree;
+
+  try {
+    switch (format) {
+    case FORMAT_JSON:
+      read_json(ss, tree);
+      break;
+    case FORMAT_INI:
+      read_ini(ss, tree);
+      break;
+    case FORMAT_INFO:
+      read_info(ss, tree);
+      break;
+    case FORMAT_XML:
+    default:
+      read_xml(ss, tree, boost::property_tree::xml_parser::trim_whitespace);
+    }
+  } catch (const boost::property_tree::file_parser_error& e) {
+    BOOST_THROW_EXCEPTION(ParsingAttributeError() << errinfo_msg(e.what()));
+  }
+
+  fromTree(tree);
+}
+
+std::string
+FlatAttributes::saveAttr(int format) const {
+  std::string data;
+  saveAttr(data, format);
+  return data;
+}
+
+void
+FlatAttributes::saveAttr(std::string& data, int format) const {
+  using boost::property_tree::write_json;
+  using boost::property_tree::write_ini;
+  using boost::property_tree::write_xml;
+  using boost::property_tree::write_info;
+
+  data.clear();
+  if (FORMAT_BINARY == format) {
+    detail::BinaryWriter writer(data);
+    writeNode(writer, 0);
+    return;
+  }
+
+  std::ostringstream ss;
+  ConfigStore tree;
+  toTree(tree);
+
+  try {
+    switch (format) {
+    case FORMAT_JSON:
+      write_json(ss, tree);
+      break;
+    case FORMAT_INI:
+      write_ini(ss, tree);
+      break;
+    case FORMAT_INFO:
+      write_info(ss, tree);
+      break;
+    case FORMAT_XML:
+    default:
+#if BOOST_VERSION >= 105600
+      write_xml(ss, tree,
+                boost::property_tree::xml_writer_make_settings<std::string>(
+                  ' ', 2));
+#else
+      write_xml(ss, tree,
+                boost::property_tree::xml_writer_settings<char>(' ', 2));
+#endif
+      break;
+    }
+  } catch (const boost::property_tree::file_parser_error& e) {
+    BOOST_THROW_EXCEPTION(ParsingAttributeError() << errinfo_msg(e.what()));
+  }
+
+  data = ss.str();
+}
+
+void
+FlatAttributes::fromTree(const ConfigStore& tree) {
+  FlatAttributes tmp;
+  if (!tree.data().empty()) {
+    tmp.setString(0, tree.data());
+  }
+  tmp.fromTree(tree, 0);
+  swap(tmp);
+}
+
+void
+FlatAttributes::toTree(ConfigStore& tree) const {
+  ConfigStore tmp(render(nodes_[0].value));
+  toTree(tmp, 0);
+  tree.swap(tmp);
+}
+
+void
+FlatAttributes::swap(FlatAttributes& from) {
+  nodes_.swap(from.nodes_);
+  strings_.swap(from.strings_);
+  freeStrings_.swap(from.freeStrings_);
+  keys_.swap(from.keys_);
+  hashes_.swap(from.hashes_);
+  keyIndex_.swap(from.keyIndex_);
+}
+
+bool
+FlatAttributes::operator==(const FlatAttributes& other) const {
+  return equal(other, 0, 0);
+}
+
+bool
+FlatAttributes::operator!=(const FlatAttributes& other) const {
+  return !equal(other, 0, 0);
+}
+
+/**
+ * @class FlatAttributes::Merger
+ * @brief merge the leaves of attributes into others, walking both trees in
+ * lockstep
+ *
+ * A leaf is added unless its parent already has a child with the same key
+ * and value. The children of a destination node are indexed the first time
+ * a leaf is merged below it, the index is then kept up to date so that
+ * each leaf costs a hash lookup.
+ */
+class FlatAttributes::Merger {
+public:
+  /**
+   * @brief constructor
+   * @param dst destination attributes
+   * @param src merged attributes
+   */
+  Merger(FlatAttributes& dst, const FlatAttributes& src)
+    : dst_(dst), src_(src), keys_(src.keys_.size(), NPOS) {}
+
+  /**
+   * @brief merge a node of src into a node of dst
+   * @param node destination node
+   * @param srcNode merged node
+   */
+  void
+  operator()(boost::uint32_t node, boost::uint32_t srcNode) {
+    Indexes::iterator indexed = indexes_.find(node);
+    LeafSet *leaves = (indexes_.end() == indexed) ? NULL : &indexed->second;
+    for (boost::uint32_t it = src_.nodes_[srcNode].child; it;
+         it = src_.nodes_[it].next) {
+      const Node& src = src_.nodes_[it];
+      const boost::uint32_t key = intern(src.key);
+      if (src.child) {
+        // first node with the same key, as when adding through a path
+        boost::uint32_t child = dst_.nodes_[node].child;
+        while (child && (dst_.nodes_[child].key != key)) {
+          child = dst_.nodes_[child].next;
+        }
+        if (!child) {
+          child = dst_.append(node, key);
+          if (leaves) {
+            leaves->insert(Leaf(key, std::string()));
+          }
+        }
+        (*this)(child, it);
+        continue;
+      }
+
+      if (!leaves) {
+        leaves = &index(node);
+      }
+      Leaf leaf(key, src_.render(src.value));
+      if (!leaves->insert(leaf).second) {
+        continue;
+      }
+      boost::uint32_t child = dst_.append(node, key);
+      if (detail::AttrValue::STRING == src.value.type) {
+        dst_.setString(child, leaf.second);
+      } else {
+        dst_.nodes_[child].value = src.value;
+      }
+    }
+  }
+
+private:
+  /* leaves are identified by their key and their rendered value */
+  typedef std::pair<boost::uint32_t, std::string> Leaf;
+  typedef boost::unordered_set<Leaf> LeafSet;
+  typedef boost::unordered_map<boost::uint32_t, LeafSet> Indexes;
+
+  boost::uint32_t
+  intern(boost::uint32_t key) {
+    if (NPOS == keys_[key]) {
+      keys_[key] = dst_.intern(src_.keys_[key]);
+    }
+    return keys_[key];
+  }
+
+  LeafSet&
+  index(boost::uint32_t node) {
+    LeafSet& leaves = indexes_[node];
+    for (boost::uint32_t child = dst_.nodes_[node].child; child;
+         child = dst_.nodes_[child].next) {
+      leaves.insert(Leaf(dst_.nodes_[child].key,
+                         dst_.render(dst_.nodes_[child].value)));
+    }
+    return leaves;
+  }
+
+  FlatAttributes& dst_; /**< destination attributes */
+  const FlatAttributes& src_; /**< merged attributes */
+  std::vector<boost::uint32_t> keys_; /**< src key indexes in dst */
+  Indexes indexes_; /**< indexed destination nodes */
+};
+
+void
+FlatAttributes::merge(const FlatAttributes& other) {
+  if (this == &other) {
+    return;
+  }
+  Merger merger(*this, other);
+  merger(0, 0);
+}
+
+boost::uint32_t
+FlatAttributes::find(const std::string& path) const {
+  if (path.empty()) {
+    return 0;
+  }
+
+  boost::uint32_t node = 0;
+  const char *pos = path.data();
+  const char *end = pos + path.size();
+  for (;;) {
+    const char *sep = std::find(pos, end, '.');
+    boost::uint32_t child = nodes_[node].child;
+    while (child && !sameKey(keys_[nodes_[child].key], pos, sep - pos)) {
+      child = nodes_[child].next;
+    }
+    if (!child) {
+      return NPOS;
+    }
+    node = child;
+    if (end == sep) {
+      return node;
+    }
+    pos = sep + 1;
+  }
+}
+
+boost::uint32_t
+FlatAttributes::find(const Path& path) const {
+  boost::uint32_t node = 0;
+  for (std::size_t i = 0; i < path.keys_.size(); ++i) {
+    boost::uint32_t child = nodes_[node].child;
+    while (child && !hasKey(child, path, i)) {
+      child = nodes_[child].next;
+    }
+    if (!child) {
+      return NPOS;
+    }
+    node = child;
+  }
+  return node;
+}
+
+boost::uint32_t
+FlatAttributes::force(const std::string& path) {
+  if (path.empty()) {
+    return 0;
+  }
+
+  boost::uint32_t node = 0;
+  const char *pos = path.data();
+  const char *end = pos + path.size();
+  for (;;) {
+    const char *sep = std::find(pos, end, '.');
+    boost::uint32_t child = nodes_[node].child;
+    while (child && !sameKey(keys_[nodes_[child].key], pos, sep - pos)) {
+      child = nodes_[child].next;
+    }
+    if (!child) {
+      child = append(node, intern(std::string(pos, sep)));
+    }
+    node = child;
+    if (end == sep) {
+      return node;
+    }
+    pos = sep + 1;
+  }
+}
+
+boost::uint32_t
+FlatAttributes::force(const Path& path) {
+  boost::uint32_t node = 0;
+  for (std::size_t i = 0; i < path.keys_.size(); ++i) {
+    boost::uint32_t child = nodes_[node].child;
+    while (child && !hasKey(child, path, i)) {
+      child = nodes_[child].next;
+    }
+    if (!child) {
+      child = append(node, intern(path.keys_[i]));
+    }
+    node = child;
+  }
+  return node;
+}
+
+boost::uint32_t
+FlatAttributes::add(const std::string& path) {
+  std::string::size_type pos = path.rfind('.');
+  if (std::string::npos == pos) {
+    return append(0, intern(path));
+  }
+  boost::uint32_t parent = force(path.substr(0, pos));
+  return append(parent, intern(path.substr(pos + 1)));
+}
+
+boost::uint32_t
+FlatAttributes::append(boost::uint32_t parent, boost::uint32_t key) {
+  Node node;
+  node.key = key;
+  node.child = node.last = node.next = 0;
+  boost::uint32_t index = static_cast<boost::uint32_t>(nodes_.size());
+  nodes_.push_back(node);
+
+  Node& p = nodes_[parent];
+  if (p.last) {
+    nodes_[p.last].next = index;
+  } else {
+    p.child = index;
+  }
+  p.last = index;
+  return index;
+}
+
+boost::uint32_t
+FlatAttributes::intern(const std::string& key) {
+  KeyIndex::const_iterator it = keyIndex_.find(key);
+  if (keyIndex_.end() != it) {
+    return it->second;
+  }
+  boost::uint32_t index = static_cast<boost::uint32_t>(keys_.size());
+  keys_.push_back(key);
+  hashes_.push_back(boost::hash<std::string>()(key));
+  keyIndex_.insert(std::make_pair(key, index));
+  return index;
+}
+
+bool
+FlatAttributes::hasKey(boost::uint32_t node, const Path& path,
+                       std::size_t i) const {
+  const boost::uint32_t key = nodes_[node].key;
+  return (hashes_[key] == path.hashes_[i]) && (keys_[key] == path.keys_[i]);
+}
+
+std::string
+FlatAttributes::render(const detail::AttrValue& value) const {
+  switch (value.type) {
+  case detail::AttrValue::INT:
+    return detail::toString(value.i);
+  case detail::AttrValue::FLOAT:
+    return detail::toString(static_cast<float>(value.d));
+  case detail::AttrValue::DOUBLE:
+    return detail::toString(value.d);
+  case detail::AttrValue::BOOL:
+    return detail::toString(value.b);
+  case detail::AttrValue::STRING:
+    return strings_[value.s];
+  default:
+    return std::string();
+  }
+}
+
+void
+FlatAttributes::setString(boost::uint32_t node, const std::string& data) {
+  detail::AttrValue& value = nodes_[node].value;
+  // the string slot of a node is reused
+  if (detail::AttrValue::STRING == value.type) {
+    strings_[value.s] = data;
+    return;
+  }
+  value.type = detail::AttrValue::STRING;
+  if (!freeStrings_.empty()) {
+    value.s = freeStrings_.back();
+    freeStrings_.pop_back();
+    strings_[value.s] = data;
+    return;
+  }
+  value.s = static_cast<boost::uint32_t>(strings_.size());
+  strings_.push_back(data);
+}
+
+detail::AttrValue&
+FlatAttributes::setType(boost::uint32_t node, int type) {
+  detail::AttrValue& value = nodes_[node].value;
+  // a string overwritten by a scalar leaves its slot to the next setString
+  if (detail::AttrValue::STRING == value.type) {
+    std::string().swap(strings_[value.s]);
+    freeStrings_.push_back(value.s);
+  }
+  value.type = type;
+  return value;
+}
+
+bool
+FlatAttributes::equal(const FlatAttributes& other, boost::uint32_t node,
+                      boost::uint32_t otherNode) const {
+  const detail::AttrValue& a = nodes_[node].value;
+  const detail::AttrValue& b = other.nodes_[otherNode].value;
+  bool same;
+  if (a.type != b.type) {
+    same = (render(a) == other.render(b));
+  } else if (detail::AttrValue::STRING == a.type) {
+    same = (strings_[a.s] == other.strings_[b.s]);
+  } else if (detail::AttrValue::BOOL == a.type) {
+    same = (a.b == b.b);
+  } else if (detail::AttrValue::INT == a.type) {
+    same = (a.i == b.i);
+  } else if (detail::AttrValue::NONE == a.type) {
+    same = true;
+  } else {
+    same = (render(a) == other.render(b));
+  }
+  if (!same) {
+    return false;
+  }
+
+  boost::uint32_t child = nodes_[node].child;
+  boost::uint32_t otherChild = other.nodes_[otherNode].child;
+  for (; child && otherChild;
+       child = nodes_[child].next, otherChild = other.nodes_[otherChild].next) {
+    if ((keys_[nodes_[child].key] !=
+         other.keys_[other.nodes_[otherChild].key]) ||
+        !equal(other, child, otherChild)) {
+      return false;
+    }
+  }
+  return !child && !otherChild;
+}
+
+void
+FlatAttributes::fromTree(const ConfigStore& tree, boost::uint32_t node) {
+  BOOST_FOREACH(const ConfigStore::value_type& v, tree) {
+    boost::uint32_t child = append(node, intern(v.first));
+    if (!v.second.data().empty()) {
+      setString(child, v.second.data());
+    }
+    fromTree(v.second, child);
+  }
+}
+
+void
+FlatAttributes::toTree(ConfigStore& tree, boost::uint32_t node) const {
+  for (boost::uint32_t child = nodes_[node].child; child;
+       child = nodes_[child].next) {
+    ConfigStore& sub =
+      tree.push_back(ConfigStore::value_type(
+                       keys_[nodes_[child].key],
+                       ConfigStore(render(nodes_[child].value))))->second;
+    toTree(sub, child);
+  }
+}
+
+void
+FlatAttributes::writeNode(detail::BinaryWriter& writer,
+                          boost::uint32_t node) const {
+  const detail::AttrValue& value = nodes_[node].value;
+  switch (value.type) {
+  case detail::AttrValue::INT:
+    writer.integer(value.i);
+    break;
+  case detail::AttrValue::FLOAT:
+  case detail::AttrValue::DOUBLE:
+    writer.number(value.d, detail::AttrValue::FLOAT == value.type);
+    break;
+  case detail::AttrValue::BOOL:
+    writer.boolean(value.b);
+    break;
+  case detail::AttrValue::STRING:
+    writer.string(strings_[value.s]);
+    break;
+  default:
+    writer.none();
+  }
+
+  std::size_t count = 0;
+  for (boost::uint32_t child = nodes_[node].child; child;
+       child = nodes_[child].next) {
+    ++count;
+  }
+  writer.count(count);
+  for (boost::uint32_t child = nodes_[node].child; child;
+       child = nodes_[child].next) {
+    writer.key(keys_[nodes_[child].key]);
+    writeNode(writer, child);
+  }
+}
+
+void
+FlatAttributes::readNode(detail::BinaryReader& reader, boost::uint32_t node) {
+  const char *data;
+  std::size_t size;
+  int type = reader.tag();
+  switch (type) {
+  case detail::AttrValue::STRING:
+    reader.string(data, size);
+    setString(node, std::string(data, size));
+    break;
+  case detail::AttrValue::INT:
+    setType(node, type).i = reader.integer();
+    break;
+  case detail::AttrValue::FLOAT:
+  case detail::AttrValue::DOUBLE:
+    setType(node, type).d = reader.number();
+    break;
+  case detail::AttrValue::BOOL:
+    setType(node, type).b = reader.boolean();
+    break;
+  }
+
+  std::size_t count = reader.count();
+  for (std::size_t i = 0; i < count; ++i) {
+    reader.string(data, size);
+    boost::uint32_t child = append(node, intern(std::string(data, size)));
+    reader.enter();
+    readNode(reader, child);
+    reader.leave();
+  }
+}
+
+void
+FlatAttributes::throwUnknown(const std::string& path) {
+  BOOST_THROW_EXCEPTION(UnknownAttributeError()
+                        << errinfo_msg("No such node (" + path + ")"));
+}
+
+void
+FlatAttributes::throwInvalid(const std::string& path) {
+  BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                        << errinfo_msg("conversion of data failed (" + path +
+                                       ")"));
+}
+
+std::string
+str(const FlatAttributes& attr, int format) {
+  return attr.saveAttr(format);
+}
+
+} /* namespace dadi */
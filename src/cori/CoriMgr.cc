@@ -52,21 +52,22 @@ CoriMgr::listMetrics() {
   Attributes a;
   BOOST_FOREACH(ICori *p, plugins) {
     Attributes b = p->listMetrics();
-    a.merge(b);
+    a.splice(b);
   }
 
   return a;
 }
 
 Attributes
-CoriMgr::getMetrics(const std::string& filter) {
+CoriMgr::getMetrics(const std::string& filter, int format) {
+  // binary filters are opt-in: plugins may parse the filter themselves
   const std::string& filter_ =
-  !filter.empty() ? filter : dadi::str(listMetrics());
+  !filter.empty() ? filter : dadi::str(listMetrics(), format);
 
   Attributes a;
   BOOST_FOREACH(ICori *p, plugins) {
     Attributes b = p->getMetrics(filter_);
-    a.merge(b);
+    a.splice(b);
   }
 
   return a;
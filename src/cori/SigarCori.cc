@@ -17,6 +17,20 @@
 
 namespace dadi {
 
+namespace {
+// metric paths split once, filled on every getMetrics()
+const AttrPath METRIC_UPTIME("diet.cori.metrics.metric.uptime");
+const AttrPath METRIC_RAM_TOTAL("diet.cori.metrics.metric.ram.total");
+const AttrPath METRIC_RAM_USED("diet.cori.metrics.metric.ram.used");
+const AttrPath METRIC_RAM_FREE("diet.cori.metrics.metric.ram.free");
+const AttrPath METRIC_SWAP_TOTAL("diet.cori.metrics.metric.swap.total");
+const AttrPath METRIC_SWAP_USED("diet.cori.metrics.metric.swap.used");
+const AttrPath METRIC_SWAP_FREE("diet.cori.metrics.metric.swap.free");
+const AttrPath METRIC_CPU_CORES("diet.cori.metrics.metric.cpu.core_number");
+const AttrPath METRIC_CPU_FREQ("diet.cori.metrics.metric.cpu.freq");
+const AttrPath METRIC_LOADAVG("diet.cori.metrics.metric.loadavg");
+}
+
 class SigarCori : public ICori {
 protected:
   virtual void
@@ -114,7 +128,7 @@ SigarCori::get_uptime(Attributes& pt) {
   sigar_uptime_t res;
   int status = sigar_uptime_get(handle, &res);
   if (SIGAR_OK == status) {
-    pt.putAttr("diet.cori.metrics.metric.uptime", res.uptime);
+    pt.putAttr(METRIC_UPTIME, res.uptime);
   }
 }
 
@@ -124,13 +138,13 @@ SigarCori::get_mem(Attributes& pt, std::bitset<8>& mask) {
   int status = sigar_mem_get(handle, &res);
   if (SIGAR_OK == status) {
     if (mask.test(2)) {
-      pt.putAttr("diet.cori.metrics.metric.ram.total", res.total);
+      pt.putAttr(METRIC_RAM_TOTAL, res.total);
     }
     if (mask.test(1)) {
-      pt.putAttr("diet.cori.metrics.metric.ram.used", res.used);
+      pt.putAttr(METRIC_RAM_USED, res.used);
     }
     if (mask.test(0)) {
-      pt.putAttr("diet.cori.metrics.metric.ram.free", res.free);
+      pt.putAttr(METRIC_RAM_FREE, res.free);
     }
   }
 }
@@ -142,13 +156,13 @@ SigarCori::get_swap(Attributes& pt, std::bitset<8>& mask) {
   int status = sigar_swap_get(handle, &res);
   if (SIGAR_OK == status) {
     if (mask.test(2)) {
-      pt.putAttr("diet.cori.metrics.metric.swap.total", res.total);
+      pt.putAttr(METRIC_SWAP_TOTAL, res.total);
     }
     if (mask.test(1)) {
-      pt.putAttr("diet.cori.metrics.metric.swap.used", res.used);
+      pt.putAttr(METRIC_SWAP_USED, res.used);
     }
     if (mask.test(0)) {
-      pt.putAttr("diet.cori.metrics.metric.swap.free", res.free);
+      pt.putAttr(METRIC_SWAP_FREE, res.free);
     }
   }
 }
@@ -163,10 +177,10 @@ SigarCori::get_cpu(Attributes& pt, std::bitset<8>& mask) {
     sigar_cpu_info_t res = cpuinfolist.data[0];
     unsigned int core_nb = res.total_cores * res.cores_per_socket;
     if (mask.test(1)) {
-      pt.putAttr("diet.cori.metrics.metric.cpu.core_number", core_nb);
+      pt.putAttr(METRIC_CPU_CORES, core_nb);
     }
     if (mask.test(0)) {
-      pt.putAttr("diet.cori.metrics.metric.cpu.freq", res.mhz);
+      pt.putAttr(METRIC_CPU_FREQ, res.mhz);
     }
   }
   sigar_cpu_info_list_destroy(handle, &cpuinfolist);
@@ -190,7 +204,7 @@ SigarCori::get_loadavg(Attributes& pt, unsigned int time = 1) {
     default:
       index = 0;
     }
-    pt.putAttr("diet.cori.metrics.metric.loadavg", res.loadavg[index]);
+    pt.putAttr(METRIC_LOADAVG, res.loadavg[index]);
   }
 }
 
@@ -9,9 +9,13 @@
  */
 
 #include "dadi/Logging/ArchiveStrategy.hh"
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+#include "dadi/Exception/Base.hh"
 
 namespace dadi {
 
@@ -19,34 +23,100 @@ namespace bfs = boost::filesystem;
 
 const std::string ArchiveByNumberStrategy::pTpl_ = std::string("%s.%i");
 
-ArchiveStrategy::ArchiveStrategy() {}
+namespace {
+// escape regular expression special characters
+std::string
+escape(const std::string& str) {
+  static const std::string specials(".[]{}()\\*+?|^$");
+  std::string res;
+  for (std::string::size_type i = 0; i < str.size(); ++i) {
+    if (std::string::npos != specials.find(str[i])) {
+      res += '\\';
+    }
+    res += str[i];
+  }
+  return res;
+}
+} /* namespace */
+
+ArchiveStrategy::ArchiveStrategy() : renamed_(false) {}
 
 ArchiveStrategy::~ArchiveStrategy() {}
 
+void
+ArchiveStrategy::setSuffix(const std::string& suffix) {
+  suffix_ = suffix;
+}
+
+const std::string&
+ArchiveStrategy::getSuffix() const {
+  return suffix_;
+}
+
+bool
+ArchiveStrategy::hasRenamed() const {
+  return renamed_;
+}
+
+std::string
+ArchiveStrategy::getPattern() const {
+  if (suffix_.empty()) {
+    return getNamePattern();
+  }
+  // archives are compressed afterwards, or kept as is on failure
+  return getNamePattern() + "(?:" + escape(suffix_) + ")?";
+}
+
+std::string
+ArchiveStrategy::archiveFile(const std::string& path,
+                             const std::string& file,
+                             const std::string& suffix) {
+  BOOST_THROW_EXCEPTION(NotImplementedError()
+                        << errinfo_msg("archiveFile is not implemented"));
+  return std::string();
+}
+
 /*****************************************************************************/
 
 ArchiveByNumberStrategy::ArchiveByNumberStrategy() {}
 
 ArchiveByNumberStrategy::~ArchiveByNumberStrategy() {}
 
-void
+std::string
 ArchiveByNumberStrategy::archive(const std::string& path) {
+  return archiveFile(path, path, "");
+}
+
+std::string
+ArchiveByNumberStrategy::archiveFile(const std::string& path,
+                                     const std::string& file,
+                                     const std::string& suffix) {
   std::string currentPath;
   boost::format fmtr(pTpl_);
   int n(-1);
   do {
     fmtr % path % (++n);
-    currentPath = fmtr.str();
+    currentPath = fmtr.str() + suffix_;
   } while (bfs::exists(currentPath));
 
+  renamed_ = (n > 0);
   while (n > 0) {
     fmtr % path % (--n);
-    const std::string& oldPath = fmtr.str();
+    const std::string& oldPath = fmtr.str() + suffix_;
     bfs::rename(oldPath, currentPath);
     currentPath = oldPath;
   }
 
-  bfs::rename(path, currentPath);
+  fmtr % path % 0;
+  const std::string archivePath = fmtr.str() + suffix;
+  bfs::rename(file, archivePath);
+  return archivePath;
+}
+
+std::string
+ArchiveByNumberStrategy::getNamePattern() const {
+  // .0 is the newest archive
+  return "(?<seq>\\d+)";
 }
 
 /*****************************************************************************/
@@ -64,8 +134,15 @@ ArchiveByTimestampStrategy::~ArchiveByTimestampStrategy() {}
 void
 ArchiveByTimestampStrategy::setLocal(bool local) { local_ = local; }
 
-void
+std::string
 ArchiveByTimestampStrategy::archive(const std::string& path) {
+  return archiveFile(path, path, "");
+}
+
+std::string
+ArchiveByTimestampStrategy::archiveFile(const std::string& path,
+                                        const std::string& file,
+                                        const std::string& suffix) {
   using boost::posix_time::ptime;
   using boost::posix_time::microsec_clock;
 
@@ -86,26 +163,130 @@ ArchiveByTimestampStrategy::archive(const std::string& path) {
   fmtr % path % oss.str();
 
   std::string newPath = fmtr.str();
-  if (bfs::exists(newPath)) {
+  renamed_ = bfs::exists(newPath + suffix_);
+  if (renamed_) {
     int n(-1);
     std::string currentPath;
     do {
       fmtr.parse("%s.%i");
       fmtr % newPath % (++n);
-      currentPath = fmtr.str();
+      currentPath = fmtr.str() + suffix_;
     } while (bfs::exists(currentPath));
 
     while (n > 0) {
       fmtr % newPath % (--n);
-      const std::string& oldPath = fmtr.str();
+      const std::string& oldPath = fmtr.str() + suffix_;
       bfs::rename(oldPath, currentPath);
       currentPath = oldPath;
     }
     fmtr % newPath % 0;
-    bfs::rename(newPath, fmtr.str());
+    bfs::rename(newPath + suffix_, fmtr.str() + suffix_);
+  }
+
+  bfs::rename(file, newPath + suffix);
+  return newPath + suffix;
+}
+
+std::string
+ArchiveByTimestampStrategy::getNamePattern() const {
+  static const std::string numeric("CdefgGHIjlmMsSuUVwWyY");
+  std::string pattern;
+  for (std::string::size_type i = 0; i < tpl_.size(); ++i) {
+    if ('%' != tpl_[i] || i + 1 == tpl_.size()) {
+      pattern += escape(tpl_.substr(i, 1));
+    } else if ('%' == tpl_[++i]) {
+      pattern += '%';
+    } else if (std::string::npos != numeric.find(tpl_[i])) {
+      pattern += "\\d+";
+    } else {
+      pattern += "[^.]+";
+    }
   }
+  // clashing timestamps are numbered, the greater the older
+  return "(?<key>" + pattern + ")(?:\\.(?<seq>\\d+))?";
+}
+
+/*****************************************************************************/
+
+typedef boost::lock_guard<boost::mutex> Lock;
+
+ArchiveByGenerationStrategy::ArchiveByGenerationStrategy() : next_(0) {}
+
+ArchiveByGenerationStrategy::~ArchiveByGenerationStrategy() {}
+
+std::string
+ArchiveByGenerationStrategy::archive(const std::string& path) {
+  return archiveFile(path, path, "");
+}
+
+std::string
+ArchiveByGenerationStrategy::archiveFile(const std::string& path,
+                                         const std::string& file,
+                                         const std::string& suffix) {
+  Lock lock(mutex_);
+
+  if (path_ != path) {
+    load(path);
+  }
+
+  const std::string archivePath = getArchivePath(next_++) + suffix;
+  bfs::rename(file, archivePath);
+
+  return archivePath;
+}
+
+unsigned long
+ArchiveByGenerationStrategy::getNextGeneration() const {
+  Lock lock(mutex_);
+
+  return next_;
+}
+
+void
+ArchiveByGenerationStrategy::load(const std::string& path) {
+  path_ = path;
+  next_ = 0;
+
+  bfs::path logFile = bfs::absolute(path);
+  const std::string prefix = logFile.filename().string() + ".";
+  unsigned long newest = 0;
+  bool found = false;
+  boost::system::error_code ec;
+  bfs::directory_iterator it(logFile.parent_path(), ec), end;
+  for (; !ec && it != end; it.increment(ec)) {
+    const std::string name = it->path().filename().string();
+    if (0 != name.compare(0, prefix.size(), prefix)) {
+      continue;
+    }
+    // <prefix><digits>[<suffix>]
+    std::string::size_type pos = prefix.size();
+    std::string::size_type last = name.find_first_not_of("0123456789", pos);
+    if (pos == last) {
+      continue;
+    }
+    if (std::string::npos != last && name.substr(last) != suffix_) {
+      continue;
+    }
+    try {
+      newest = std::max(newest, boost::lexical_cast<unsigned long>(
+                          name.substr(pos, last - pos)));
+      found = true;
+    } catch (const boost::bad_lexical_cast&) {}
+  }
+
+  if (found) {
+    next_ = newest + 1;
+  }
+}
+
+std::string
+ArchiveByGenerationStrategy::getNamePattern() const {
+  return "(?<key>\\d+)";
+}
 
-  bfs::rename(path, newPath);
+std::string
+ArchiveByGenerationStrategy::getArchivePath(unsigned long generation) const {
+  return path_ + "." + boost::lexical_cast<std::string>(generation);
 }
 
 } /* namespace dadi */
@@ -0,0 +1,301 @@
+/**
+ * @file   BinaryFileChannel.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  BinaryFileChannel and BinaryLogReader implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/BinaryFileChannel.hh"
+#include <cstring>
+#include <istream>
+#include "dadi/Logging/Clock.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Exception/All.hh"
+
+namespace dadi {
+
+const char BinaryFileChannel::MAGIC[8] = {
+  '\0', 'D', 'A', 'D', 'I', 'B', 'L', '\1'
+};
+
+namespace {
+/* records bigger than this are considered as corrupted */
+const boost::uint64_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+/* filenames cached by address, copied filenames each have their own */
+const std::size_t MAX_CACHED_FILES = 4096;
+
+void
+putVarint(std::string& out, boost::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+std::size_t
+varintSize(boost::uint64_t value) {
+  std::size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+boost::uint64_t
+zigzag(boost::int64_t value) {
+  return (static_cast<boost::uint64_t>(value) << 1) ^
+    static_cast<boost::uint64_t>(value >> 63);
+}
+
+boost::int64_t
+unzigzag(boost::uint64_t value) {
+  return static_cast<boost::int64_t>(value >> 1) ^
+    -static_cast<boost::int64_t>(value & 1);
+}
+
+bool
+getVarint(const std::string& buf, std::size_t& pos, boost::uint64_t& value) {
+  value = 0;
+  for (unsigned int shift = 0; (pos < buf.size()) && (shift < 64);
+       shift += 7) {
+    unsigned char c = static_cast<unsigned char>(buf[pos++]);
+    value |= static_cast<boost::uint64_t>(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+throwCorrupted(const std::string& what) {
+  BOOST_THROW_EXCEPTION(Error()
+                        << errinfo_msg("corrupted binary log: " + what));
+}
+} /* namespace */
+
+BinaryFileChannel::BinaryFileChannel() : lastSource_(-1), lastTime_(0) {}
+
+BinaryFileChannel::BinaryFileChannel(const std::string& path)
+  : FileChannel(path), lastSource_(-1), lastTime_(0) {}
+
+void
+BinaryFileChannel::log(const Message& msg) {
+  // records depend on the dictionary of the current file
+  logRecord(msg);
+}
+
+void
+BinaryFileChannel::writePreamble(std::string& out) {
+  strings_.clear();
+  files_.clear();
+  lastSource_ = -1;
+  lastTime_ = 0;
+  out.append(MAGIC, sizeof(MAGIC));
+}
+
+boost::uint32_t
+BinaryFileChannel::intern(const std::string& str, std::string& out) {
+  boost::unordered_map<std::string, boost::uint32_t>::const_iterator it =
+    strings_.find(str);
+  if (it != strings_.end()) {
+    return it->second;
+  }
+
+  boost::uint32_t index = strings_.size();
+  strings_.insert(std::make_pair(str, index));
+  putVarint(out, 1 + varintSize(index) + str.size());
+  out.push_back(static_cast<char>(REC_STRING));
+  putVarint(out, index);
+  out.append(str);
+  return index;
+}
+
+void
+BinaryFileChannel::encode(const Message& msg, std::string& out) {
+  // dictionary records must precede the message
+  const std::string& src = msg.getSource();
+  if ((lastSource_ < 0) || (src != sourceName_)) {
+    lastSource_ = intern(src, out);
+    sourceName_ = src;
+  }
+  boost::uint64_t file = 0;
+  const char *filename = msg.getFileName();
+  if (*filename) {
+    if (files_.size() >= MAX_CACHED_FILES) {
+      files_.clear();
+    }
+    const Strings::value_type *&entry = files_[filename];
+    if (!entry || (entry->first != filename)) {
+      intern(filename, out);
+      entry = &*strings_.find(filename);
+    }
+    file = entry->second + 1;
+  }
+  const Tags& tags = msg.getTags();
+  keys_.clear();
+  for (Tags::const_iterator it = tags.begin(); it != tags.end(); ++it) {
+    keys_.push_back(intern(it->first, out));
+  }
+
+  // the payload size is known beforehand, so that it is written in place
+  const boost::int64_t wall = msg.getTime().wall;
+  const boost::uint64_t delta = zigzag(wall - lastTime_);
+  const boost::uint64_t line = zigzag(msg.getLine());
+  const std::string& text = msg.getText();
+  std::size_t size = 2 + varintSize(delta) + varintSize(lastSource_) +
+    varintSize(file) + varintSize(line) + varintSize(tags.size()) +
+    text.size();
+  for (std::size_t i = 0; i < tags.size(); ++i) {
+    size += varintSize(keys_[i]) + varintSize(tags[i].second.size()) +
+      tags[i].second.size();
+  }
+
+  putVarint(out, size);
+  out.push_back(static_cast<char>(REC_MESSAGE));
+  out.push_back(static_cast<char>(msg.getPriority()));
+  putVarint(out, delta);
+  putVarint(out, lastSource_);
+  putVarint(out, file);
+  putVarint(out, line);
+  putVarint(out, tags.size());
+  for (std::size_t i = 0; i < tags.size(); ++i) {
+    putVarint(out, keys_[i]);
+    putVarint(out, tags[i].second.size());
+    out.append(tags[i].second);
+  }
+  out.append(text);
+  lastTime_ = wall;
+}
+
+/*****************************************************************************/
+
+BinaryLogReader::BinaryLogReader(std::istream& in)
+  : in_(in), lastTime_(0), magic_(false), truncated_(false) {}
+
+bool
+BinaryLogReader::next(Message& msg) {
+  for (;;) {
+    boost::uint64_t size;
+    if (!readVarint(size)) {
+      return false;
+    }
+    if (0 == size) {
+      readMagic();
+      continue;
+    }
+    if (!magic_) {
+      throwCorrupted("missing magic number");
+    }
+    if (size > MAX_RECORD_SIZE) {
+      throwCorrupted("record too big");
+    }
+
+    record_.resize(size);
+    in_.read(&record_[0], size);
+    if (static_cast<boost::uint64_t>(in_.gcount()) != size) {
+      truncated_ = true;
+      return false;
+    }
+
+    std::size_t pos = 1;
+    boost::uint64_t value;
+    if (BinaryFileChannel::REC_STRING == record_[0]) {
+      if (!getVarint(record_, pos, value) || value > strings_.size()) {
+        throwCorrupted("invalid dictionary entry");
+      }
+      if (value == strings_.size()) {
+        strings_.push_back(std::string());
+      }
+      strings_[value].assign(record_, pos, std::string::npos);
+      continue;
+    }
+    if (BinaryFileChannel::REC_MESSAGE != record_[0]) {
+      // unknown records are skipped (newer format)
+      continue;
+    }
+
+    // type, priority, then varints
+    pos = 2;
+    boost::uint64_t delta, source, file, line, count;
+    if ((size < 2) || !getVarint(record_, pos, delta) ||
+        !getVarint(record_, pos, source) || !getVarint(record_, pos, file) ||
+        !getVarint(record_, pos, line) || !getVarint(record_, pos, count) ||
+        (source >= strings_.size()) || (file > strings_.size())) {
+      throwCorrupted("invalid message");
+    }
+    int prio = record_[1];
+    if ((prio < Message::PRIO_TRACE) || (prio > Message::PRIO_FATAL)) {
+      throwCorrupted("invalid priority");
+    }
+
+    lastTime_ += unzigzag(delta);
+    Timestamp time;
+    time.wall = lastTime_;
+    msg.setTime(time);
+    msg.setPriority(static_cast<Message::Priority>(prio));
+    msg.setSource(strings_[source]);
+    if (file) {
+      msg.setFile(strings_[file - 1]);
+    } else {
+      msg.setFile("");
+    }
+    msg.setLine(static_cast<int>(unzigzag(line)));
+    msg.clearTags();
+    for (boost::uint64_t i = 0; i < count; ++i) {
+      boost::uint64_t key, length;
+      if (!getVarint(record_, pos, key) || !getVarint(record_, pos, length) ||
+          (key >= strings_.size()) || (length > record_.size() - pos)) {
+        throwCorrupted("invalid tag");
+      }
+      msg[strings_[key]].assign(record_, pos, length);
+      pos += length;
+    }
+    msg.setText(record_.substr(pos));
+    return true;
+  }
+}
+
+bool
+BinaryLogReader::isTruncated() const {
+  return truncated_;
+}
+
+bool
+BinaryLogReader::readVarint(boost::uint64_t& value) {
+  value = 0;
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    int c = in_.get();
+    if (std::char_traits<char>::eof() == c) {
+      truncated_ = (0 != shift);
+      return false;
+    }
+    value |= static_cast<boost::uint64_t>(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+  throwCorrupted("invalid size");
+  return false;
+}
+
+void
+BinaryLogReader::readMagic() {
+  char magic[sizeof(BinaryFileChannel::MAGIC)];
+  in_.read(magic + 1, sizeof(magic) - 1);
+  if ((static_cast<std::size_t>(in_.gcount()) != sizeof(magic) - 1) ||
+      (0 != std::memcmp(magic + 1, BinaryFileChannel::MAGIC + 1,
+                        sizeof(magic) - 1))) {
+    throwCorrupted("invalid magic number");
+  }
+  // a new file starts
+  strings_.clear();
+  lastTime_ = 0;
+  magic_ = true;
+}
+
+} /* namespace dadi */
@@ -8,17 +8,53 @@
  */
 
 #include "dadi/Logging/Channel.hh"
+#include <boost/thread/tss.hpp>
+#include "dadi/Logging/Message.hh"
 
 namespace dadi {
 
+const std::string Channel::ATTR_PATTERN = std::string("pattern");
+
+namespace {
+/* per-thread rendering buffer, reused across messages */
+boost::thread_specific_ptr<std::string> buffers;
+} /* namespace */
+
 Channel::Channel() {}
 
 Channel::~Channel() {}
 
 void
-Channel::open() {}
+Channel::open() {
+  setFormatter();
+}
 
 void
 Channel::close() {}
 
+void
+Channel::flush() {}
+
+void
+Channel::setFormatter() {
+  formatter_.setPattern(getAttr<std::string>(Channel::ATTR_PATTERN,
+                                             Formatter::DEFAULT_PATTERN));
+}
+
+const std::string&
+Channel::format(const Message& msg) const {
+  if (formatter_.isTextOnly()) {
+    return msg.getText();
+  }
+
+  std::string *buffer = buffers.get();
+  if (!buffer) {
+    buffer = new std::string;
+    buffers.reset(buffer);
+  }
+  buffer->clear();
+  formatter_.format(msg, *buffer);
+  return *buffer;
+}
+
 } /* namespace dadi*/
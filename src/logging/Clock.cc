@@ -0,0 +1,199 @@
+/**
+ * @file   Clock.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  cheap clock used to timestamp log messages
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/Clock.hh"
+#if defined(WIN32)
+#include <boost/date_time/posix_time/posix_time.hpp>
+#else /* WIN32 */
+#include <time.h>
+#endif /* WIN32 */
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace dadi {
+
+const long Clock::DEFAULT_TICK = 1000;
+
+namespace {
+
+const boost::int64_t NSECS_PER_SEC = 1000000000;
+
+#if defined(WIN32)
+Timestamp
+precise() {
+  static const boost::posix_time::ptime epoch(
+    boost::gregorian::date(1970, 1, 1));
+  Timestamp ts;
+  ts.wall = (boost::posix_time::microsec_clock::universal_time() - epoch)
+    .total_microseconds() * 1000;
+  ts.monotonic = ts.wall;
+  return ts;
+}
+#else /* WIN32 */
+boost::int64_t
+readClock(clockid_t id) {
+  struct timespec spec;
+  clock_gettime(id, &spec);
+  return static_cast<boost::int64_t>(spec.tv_sec) * NSECS_PER_SEC +
+    spec.tv_nsec;
+}
+
+Timestamp
+precise() {
+  Timestamp ts;
+  ts.wall = readClock(CLOCK_REALTIME);
+  ts.monotonic = readClock(CLOCK_MONOTONIC);
+  return ts;
+}
+#endif /* WIN32 */
+
+Timestamp
+coarse() {
+#if defined(CLOCK_REALTIME_COARSE) && defined(CLOCK_MONOTONIC_COARSE)
+  Timestamp ts;
+  ts.wall = readClock(CLOCK_REALTIME_COARSE);
+  ts.monotonic = readClock(CLOCK_MONOTONIC_COARSE);
+  return ts;
+#else
+  return precise();
+#endif
+}
+
+#if defined(CLOCK_REALTIME_COARSE) && defined(CLOCK_MONOTONIC_COARSE)
+boost::atomic<int> source(Clock::SOURCE_COARSE);
+#else
+boost::atomic<int> source(Clock::SOURCE_PRECISE);
+#endif
+
+/*
+ * time cached by the ticker thread, protected by a sequence lock:
+ * the sequence is odd while an update is in progress, readers retry
+ * until they read both values under the same even sequence.
+ */
+boost::atomic<unsigned long> tickSeq(0);
+boost::atomic<boost::int64_t> tickWall(0);
+boost::atomic<boost::int64_t> tickMonotonic(0);
+
+/* single writer: the ticker thread or setSource() before it starts */
+void
+publish(const Timestamp& ts) {
+  unsigned long seq = tickSeq.load(boost::memory_order_relaxed);
+  tickSeq.store(seq + 1, boost::memory_order_relaxed);
+  boost::atomic_thread_fence(boost::memory_order_release);
+  tickWall.store(ts.wall, boost::memory_order_relaxed);
+  tickMonotonic.store(ts.monotonic, boost::memory_order_relaxed);
+  tickSeq.store(seq + 2, boost::memory_order_release);
+}
+
+Timestamp
+cached() {
+  Timestamp ts;
+  unsigned long before;
+  unsigned long after;
+  do {
+    before = tickSeq.load(boost::memory_order_acquire);
+    ts.wall = tickWall.load(boost::memory_order_relaxed);
+    ts.monotonic = tickMonotonic.load(boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    after = tickSeq.load(boost::memory_order_relaxed);
+  } while ((before & 1) || (before != after));
+
+  return ts;
+}
+
+/**
+ * @class Ticker
+ * @brief thread refreshing the cached time
+ */
+class Ticker {
+public:
+  ~Ticker() {
+    stop();
+  }
+
+  void
+  start(long tick) {
+    stop();
+    publish(precise());
+    thread_.reset(new boost::thread(&Ticker::run, tick));
+  }
+
+  void
+  stop() {
+    if (thread_) {
+      thread_->interrupt();
+      thread_->join();
+      thread_.reset();
+    }
+  }
+
+private:
+  static void
+  run(long tick) {
+    try {
+      for (;;) {
+        boost::this_thread::sleep(boost::posix_time::microseconds(tick));
+        publish(precise());
+      }
+    } catch (const boost::thread_interrupted&) {}
+  }
+
+  boost::scoped_ptr<boost::thread> thread_;
+};
+
+Ticker ticker;
+boost::mutex tickerMutex;
+
+} /* namespace */
+
+Timestamp
+Clock::now() {
+  switch (source.load(boost::memory_order_acquire)) {
+  case SOURCE_COARSE:
+    return coarse();
+  case SOURCE_TICKER:
+    return cached();
+  default:
+    return precise();
+  }
+}
+
+boost::int64_t
+Clock::monotonic() {
+#if defined(WIN32)
+  return precise().monotonic;
+#else /* WIN32 */
+  return readClock(CLOCK_MONOTONIC);
+#endif /* WIN32 */
+}
+
+void
+Clock::setSource(int src, long tick) {
+  boost::lock_guard<boost::mutex> lock(tickerMutex);
+
+  if (SOURCE_TICKER == src) {
+    // cache must be valid before readers switch to it
+    ticker.start((tick > 0) ? tick : DEFAULT_TICK);
+    source.store(src, boost::memory_order_release);
+  } else {
+    source.store(src, boost::memory_order_release);
+    ticker.stop();
+  }
+}
+
+int
+Clock::getSource() {
+  return source.load(boost::memory_order_acquire);
+}
+
+} /* namespace dadi */
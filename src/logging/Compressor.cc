@@ -0,0 +1,213 @@
+/**
+ * @file   Compressor.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  compresses files with a pool of background threads
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/Compressor.hh"
+#include <fstream>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#ifdef DADI_HAVE_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+#include <boost/thread/locks.hpp>
+
+namespace dadi {
+
+namespace io = boost::iostreams;
+namespace bfs = boost::filesystem;
+typedef boost::unique_lock<boost::mutex> Lock;
+
+const int Compressor::DEFAULT_LEVEL = -1;
+
+Compressor::Compressor(int format, int level, unsigned int workers)
+  : format_(isAvailable(format) ? format : FORMAT_GZIP), level_(level),
+    extension_(getExtension(format_)), active_(0), stopped_(false) {
+  if (0 == workers) {
+    workers = 1;
+  }
+  for (unsigned int i = 0; i < workers; ++i) {
+    workers_.create_thread(boost::bind(&Compressor::run, this));
+  }
+}
+
+Compressor::~Compressor() {
+  {
+    Lock lock(mutex_);
+    stopped_ = true;
+  }
+  notEmpty_.notify_all();
+  // workers process remaining jobs before leaving
+  workers_.join_all();
+}
+
+void
+Compressor::compress(const std::string& path, const Callback& done) {
+  Job job;
+  job.path = path;
+  job.done = done;
+  {
+    Lock lock(mutex_);
+    jobs_.push_back(job);
+  }
+  notEmpty_.notify_one();
+}
+
+void
+Compressor::wait() {
+  Lock lock(mutex_);
+
+  while (!jobs_.empty() || active_) {
+    idle_.wait(lock);
+  }
+}
+
+std::size_t
+Compressor::getPending() const {
+  Lock lock(mutex_);
+
+  return jobs_.size() + active_;
+}
+
+const std::string&
+Compressor::getExtension() const {
+  return extension_;
+}
+
+bool
+Compressor::isAvailable(int format) {
+  switch (format) {
+  case FORMAT_BZIP2:
+  case FORMAT_GZIP:
+  case FORMAT_ZLIB:
+    return true;
+#ifdef DADI_HAVE_ZSTD
+  case FORMAT_ZSTD:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+std::string
+Compressor::getExtension(int format) {
+  switch (format) {
+  case FORMAT_BZIP2:
+    return ".bz2";
+  case FORMAT_GZIP:
+    return ".gz";
+  case FORMAT_ZLIB:
+    return ".z";
+  case FORMAT_ZSTD:
+    return isAvailable(FORMAT_ZSTD) ? ".zst" : ".gz";
+  default:
+    return "";
+  }
+}
+
+void
+Compressor::push(io::filtering_ostream& out, int format, int level) {
+  switch (format) {
+  case FORMAT_BZIP2:
+    // bzip2 "level" is its block size
+    out.push(io::bzip2_compressor(
+               io::bzip2_params((0 < level) ? level
+                                : io::bzip2::default_block_size)));
+    break;
+#ifdef DADI_HAVE_ZSTD
+  case FORMAT_ZSTD:
+    out.push(io::zstd_compressor(
+               io::zstd_params((0 < level) ? static_cast<unsigned int>(level)
+                               : io::zstd::default_compression)));
+    break;
+#else
+  case FORMAT_ZSTD:
+#endif
+  case FORMAT_GZIP:
+    out.push(io::gzip_compressor(
+               io::gzip_params((0 <= level) ? level
+                               : io::gzip::default_compression)));
+    break;
+  case FORMAT_ZLIB:
+    out.push(io::zlib_compressor(
+               io::zlib_params((0 <= level) ? level
+                               : io::zlib::default_compression)));
+    break;
+  case FORMAT_NONE:
+  default:
+    break;
+  }
+}
+
+std::string
+Compressor::compressFile(const std::string& path, int format, int level) {
+  const std::string target = path + getExtension(format);
+  // compress into a temporary file so that readers never see partial files
+  const std::string tmp = target + ".tmp";
+  try {
+    std::ifstream in(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    io::filtering_ostream out;
+    push(out, format, level);
+    out.push(io::file_sink(tmp, std::ios_base::out | std::ios_base::binary));
+    out.exceptions(std::ios_base::badbit);
+    io::copy(in, out);
+    bfs::rename(tmp, target);
+  } catch (...) {
+    // do not leave a partial file behind
+    boost::system::error_code ec;
+    bfs::remove(tmp, ec);
+    throw;
+  }
+  bfs::remove(path);
+
+  return target;
+}
+
+void
+Compressor::run() {
+  for (;;) {
+    Job job;
+    {
+      Lock lock(mutex_);
+      while (jobs_.empty() && !stopped_) {
+        notEmpty_.wait(lock);
+      }
+      if (jobs_.empty()) {
+        return;
+      }
+      job = jobs_.front();
+      jobs_.pop_front();
+      ++active_;
+    }
+
+    std::string result(job.path);
+    try {
+      result = compressFile(job.path, format_, level_);
+    } catch (...) {
+      // keep the original file
+    }
+    try {
+      if (job.done) {
+        job.done(result);
+      }
+    } catch (...) {}
+
+    {
+      Lock lock(mutex_);
+      --active_;
+    }
+    idle_.notify_all();
+  }
+}
+
+} /* namespace dadi */
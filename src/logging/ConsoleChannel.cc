@@ -8,23 +8,149 @@
  */
 
 #include "dadi/Logging/ConsoleChannel.hh"
+#ifndef WIN32
+#include <unistd.h>
+#endif /* WIN32 */
+#include <cerrno>
 #include <iostream>
+#include <ostream>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
 #include "dadi/Logging/Message.hh"
 
 namespace dadi {
 
 typedef boost::lock_guard<boost::mutex> Lock;
-ConsoleChannel::ConsoleChannel() : out_(std::clog) {}
 
-ConsoleChannel::ConsoleChannel(std::ostream& out) : out_(out) {}
+const std::string ConsoleChannel::ATTR_COLOR = std::string("color");
+
+namespace {
+const int STDERR_FD = 2;
+const char COLOR_RESET[] = "\033[0m";
+/* indexed by priority */
+const char *colors[] = {
+  "",
+  "\033[2m",        /* trace: dim */
+  "\033[36m",       /* debug: cyan */
+  "",               /* information */
+  "\033[33m",       /* warning: yellow */
+  "\033[31m",       /* error: red */
+  "\033[1;31m",     /* critical: bold red */
+  "\033[1;37;41m"   /* fatal: bold white on red */
+};
+
+/* per-thread line buffer, reused across messages */
+boost::thread_specific_ptr<std::string> lines;
+
+/* stream used instead of a file descriptor */
+std::ostream *
+streamOf(int fd) {
+#if defined(WIN32)
+  // no direct writes: standard streams
+  return (1 == fd) ? &std::cout : &std::cerr;
+#else /* WIN32 */
+  return NULL;
+#endif /* WIN32 */
+}
+} /* namespace */
+
+ConsoleChannel::ConsoleChannel()
+  : out_(streamOf(STDERR_FD)), fd_(STDERR_FD), color_(false) {}
+
+ConsoleChannel::ConsoleChannel(int fd, int color)
+  : out_(streamOf(fd)), fd_(fd), color_(false) {
+  setColor(color);
+}
+
+ConsoleChannel::ConsoleChannel(std::ostream& out)
+  : out_(&out), fd_(-1), color_(false) {}
+
+void
+ConsoleChannel::open() {
+  Channel::open();
+
+  const std::string& color = getAttr<std::string>(ATTR_COLOR, "never");
+  if ("always" == color) {
+    setColor(COLOR_ALWAYS);
+  } else if ("auto" == color) {
+    setColor(COLOR_AUTO);
+  } else {
+    setColor(COLOR_NEVER);
+  }
+}
+
+void
+ConsoleChannel::setColor(int color) {
+  switch (color) {
+  case COLOR_ALWAYS:
+    color_ = true;
+    break;
+  case COLOR_AUTO:
+#if defined(WIN32)
+    color_ = false;
+#else /* WIN32 */
+    color_ = !out_ && (1 == ::isatty(fd_));
+#endif /* WIN32 */
+    break;
+  default:
+    color_ = false;
+    break;
+  }
+}
+
+bool
+ConsoleChannel::isColored() const {
+  return color_;
+}
 
 void
 ConsoleChannel::log(const Message& msg) {
-  Lock lock(mutex_);
+  std::string *line = lines.get();
+  if (!line) {
+    line = new std::string;
+    lines.reset(line);
+  }
+  line->clear();
+
+  const char *color = "";
+  if (color_) {
+    int prio = msg.getPriority();
+    if (prio > 0 && prio <= Message::PRIO_FATAL) {
+      color = colors[prio];
+    }
+    line->append(color);
+  }
+  if (formatter_.isTextOnly()) {
+    line->append(msg.getText());
+  } else {
+    formatter_.format(msg, *line);
+  }
+  if (*color) {
+    line->append(COLOR_RESET);
+  }
+  line->push_back('\n');
 
-  out_ << msg.getText() << "\n";
+  if (out_) {
+    Lock lock(mutex_);
+    out_->write(line->data(), line->size());
+    return;
+  }
+
+#ifndef WIN32
+  const char *data = line->data();
+  std::size_t left = line->size();
+  while (left > 0) {
+    ssize_t written = ::write(fd_, data, left);
+    if (0 > written) {
+      if (EINTR == errno) {
+        continue;
+      }
+      break;  // like the streams we replace, fail silently
+    }
+    data += written;
+    left -= written;
+  }
+#endif /* WIN32 */
 }
 
 } /* namespace dadi */
-
@@ -0,0 +1,66 @@
+/**
+ * @file   Epoch.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  defines epochs protecting objects read on the logging path
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/Epoch.hh"
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+
+namespace dadi {
+
+Epoch::Guard::Guard(Epoch& epoch) : readers_(NULL) {
+  for (;;) {
+    const unsigned long current = epoch.epoch_.load();
+    readers_ = &epoch.readers_[current & 1];
+    readers_->fetch_add(1);
+    // only count in the slot of the current epoch, synchronize() may
+    // already be done waiting for the other one
+    if (epoch.epoch_.load() == current) {
+      break;
+    }
+    readers_->fetch_sub(1);
+  }
+}
+
+Epoch::Guard::~Guard() {
+  readers_->fetch_sub(1);
+}
+
+Epoch::Epoch() : epoch_(0) {
+  readers_[0].store(0, boost::memory_order_relaxed);
+  readers_[1].store(0, boost::memory_order_relaxed);
+}
+
+void
+Epoch::synchronize() {
+  // sequentially consistent: ordered after the publication of the object
+  const unsigned long previous = epoch_.fetch_add(1);
+  while (readers_[previous & 1].load()) {
+    boost::this_thread::yield();
+  }
+}
+
+void
+Epoch::synchronize(const std::vector<Epoch *>& epochs) {
+  // a repeated epoch starts a single new epoch
+  std::vector<Epoch *> sorted(epochs);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  std::vector<unsigned long> previous(sorted.size());
+  for (std::size_t i = 0; i < sorted.size(); ++i) {
+    previous[i] = sorted[i]->epoch_.fetch_add(1);
+  }
+  for (std::size_t i = 0; i < sorted.size(); ++i) {
+    while (sorted[i]->readers_[previous[i] & 1].load()) {
+      boost::this_thread::yield();
+    }
+  }
+}
+
+} /* namespace dadi */
@@ -8,15 +8,26 @@
  */
 
 #include "dadi/Logging/FileChannel.hh"
+#include <fcntl.h>
+#if defined(WIN32)
+#include <io.h>
+#include <sys/stat.h>
+#else /* WIN32 */
+#include <sys/uio.h>
+#include <unistd.h>
+#endif /* WIN32 */
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/iostreams/device/file.hpp>
-#include <boost/iostreams/filter/bzip2.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 #include <boost/thread/locks.hpp>
+#include "dadi/Logging/Clock.hh"
 #include "dadi/Logging/Message.hh"
 #include "dadi/Exception/All.hh"
 
@@ -25,20 +36,129 @@ namespace dadi {
 namespace io = boost::iostreams;
 typedef boost::lock_guard<boost::mutex> Lock;
 
-const std::string FileChannel::ATTR_PATH = std::string("path");
+namespace {
+/* write buffer, then line followed by a newline (if any), resuming
+ * partial writes; like the streams we replace, errors are ignored */
+void
+writeLines(int fd, const std::string& buffer, const std::string *line) {
+#if defined(WIN32)
+  // no writev(2)
+  const std::string *parts[] = {&buffer, line};
+  for (int i = 0; i < 2; ++i) {
+    if (!parts[i]) {
+      continue;
+    }
+    const char *data = parts[i]->data();
+    std::size_t size = parts[i]->size();
+    while (size > 0) {
+      int written = ::_write(fd, data, static_cast<unsigned int>(size));
+      if (0 >= written) {
+        return;
+      }
+      data += written;
+      size -= written;
+    }
+  }
+  if (line) {
+    ::_write(fd, "\n", 1);
+  }
+#else /* WIN32 */
+  struct iovec iov[3];
+  int count = 0;
+  if (!buffer.empty()) {
+    iov[count].iov_base = const_cast<char *>(buffer.data());
+    iov[count++].iov_len = buffer.size();
+  }
+  if (line) {
+    iov[count].iov_base = const_cast<char *>(line->data());
+    iov[count++].iov_len = line->size();
+    iov[count].iov_base = const_cast<char *>("\n");
+    iov[count++].iov_len = 1;
+  }
+
+  struct iovec *pIov = iov;
+  while (count > 0) {
+    ssize_t written = ::writev(fd, pIov, count);
+    if (0 > written) {
+      if (EINTR == errno) {
+        continue;
+      }
+      break;
+    }
+    // skip what has been written, resume partial writes
+    while (count > 0 && static_cast<std::size_t>(written) >= pIov->iov_len) {
+      written -= pIov->iov_len;
+      ++pIov;
+      --count;
+    }
+    if (count > 0) {
+      pIov->iov_base = static_cast<char *>(pIov->iov_base) + written;
+      pIov->iov_len -= written;
+    }
+  }
+#endif /* WIN32 */
+}
+} /* namespace */
+
+// attribute paths split once, open() reads them all
+const AttrPath KEY_PATH("path");
+const AttrPath KEY_COMPRESSION_MODE("compression_mode");
+const AttrPath KEY_ARCHIVE("archive");
+const AttrPath KEY_ARCHIVE_COMPRESSION("archive.compression");
+const AttrPath KEY_ARCHIVE_COMPRESSION_LEVEL("archive.compression_level");
+const AttrPath KEY_ARCHIVE_WORKERS("archive.workers");
+const AttrPath KEY_ROTATE("rotate");
+const AttrPath KEY_ROTATE_SIZE("rotate.size");
+const AttrPath KEY_ROTATE_TIME("rotate.time");
+const AttrPath KEY_ROTATE_INTERVAL("rotate.interval");
+const AttrPath KEY_PURGE("purge");
+const AttrPath KEY_PURGE_COUNT("purge.count");
+const AttrPath KEY_PURGE_AGE("purge.age");
+const AttrPath KEY_PURGE_SIZE("purge.size");
+const AttrPath KEY_ASYNC("async");
+const AttrPath KEY_ASYNC_QUEUE_SIZE("async.queue_size");
+const AttrPath KEY_ASYNC_OVERFLOW("async.overflow");
+const AttrPath KEY_FLUSH("flush");
+const AttrPath KEY_FSYNC("fsync");
+const AttrPath KEY_FSYNC_INTERVAL("fsync.interval");
+const AttrPath KEY_BUFFER_SIZE("buffer_size");
+const std::string FileChannel::ATTR_PATH = KEY_PATH.str();
 const std::string FileChannel::ATTR_COMPRESSION_MODE =
-  std::string("compression_mode");
-const std::string FileChannel::ATTR_ARCHIVE = std::string("archive");
-const std::string FileChannel::ATTR_ROTATE = std::string("rotate");
-const std::string FileChannel::ATTR_ROTATE_SIZE = std::string("rotate.size");
-const std::string FileChannel::ATTR_ROTATE_TIME = std::string("rotate.time");
-const std::string FileChannel::ATTR_ROTATE_INTERVAL =
-  std::string("rotate.interval");
-const std::string FileChannel::ATTR_PURGE = std::string("purge");
-const std::string FileChannel::ATTR_PURGE_COUNT = std::string("purge.count");
+  KEY_COMPRESSION_MODE.str();
+const std::string FileChannel::ATTR_ARCHIVE = KEY_ARCHIVE.str();
+const std::string FileChannel::ATTR_ARCHIVE_COMPRESSION =
+  KEY_ARCHIVE_COMPRESSION.str();
+const std::string FileChannel::ATTR_ARCHIVE_COMPRESSION_LEVEL =
+  KEY_ARCHIVE_COMPRESSION_LEVEL.str();
+const std::string FileChannel::ATTR_ARCHIVE_WORKERS = KEY_ARCHIVE_WORKERS.str();
+const std::string FileChannel::ATTR_ROTATE = KEY_ROTATE.str();
+const std::string FileChannel::ATTR_ROTATE_SIZE = KEY_ROTATE_SIZE.str();
+const std::string FileChannel::ATTR_ROTATE_TIME = KEY_ROTATE_TIME.str();
+const std::string FileChannel::ATTR_ROTATE_INTERVAL = KEY_ROTATE_INTERVAL.str();
+const std::string FileChannel::ATTR_PURGE = KEY_PURGE.str();
+const std::string FileChannel::ATTR_PURGE_COUNT = KEY_PURGE_COUNT.str();
+const std::string FileChannel::ATTR_PURGE_AGE = KEY_PURGE_AGE.str();
+const std::string FileChannel::ATTR_PURGE_SIZE = KEY_PURGE_SIZE.str();
+const std::string FileChannel::ATTR_ASYNC = KEY_ASYNC.str();
+const std::string FileChannel::ATTR_ASYNC_QUEUE_SIZE =
+  KEY_ASYNC_QUEUE_SIZE.str();
+const std::string FileChannel::ATTR_ASYNC_OVERFLOW = KEY_ASYNC_OVERFLOW.str();
+const std::string FileChannel::ATTR_FLUSH = KEY_FLUSH.str();
+const std::string FileChannel::ATTR_FSYNC = KEY_FSYNC.str();
+const std::string FileChannel::ATTR_FSYNC_INTERVAL = KEY_FSYNC_INTERVAL.str();
+const std::string FileChannel::ATTR_BUFFER_SIZE = KEY_BUFFER_SIZE.str();
 const std::string DEFAULT_ROT_SIZE("1M");
 const std::string DEFAULT_ROT_INTERVAL("24:00:00");
 const int DEFAULT_PURGE_COUNT(10);
+const std::string DEFAULT_PURGE_AGE("168:00:00");
+const std::string DEFAULT_PURGE_SIZE("100M");
+const std::size_t DEFAULT_BUFFER_SIZE(64 * 1024);
+const long DEFAULT_FSYNC_INTERVAL(1000);
+const boost::int64_t NSECS_PER_MSEC(1000000);
+// tracked file size is checked against the file system every second
+const boost::int64_t RESYNC_INTERVAL(1000 * NSECS_PER_MSEC);
+// compressed files above their size limit are checked more often
+const boost::int64_t COMPRESSED_RESYNC_INTERVAL(100 * NSECS_PER_MSEC);
 const boost::regex FileChannel::regex1(
   "\\s*"  // should be trimmed but safer
   "(?(?=.*,.*)"  // conditional base on lookahead assertion
@@ -55,85 +175,385 @@ std::map<std::string, int> FileChannel::attrMap =
   ("gz", FileChannel::COMP_GZIP)
   ("zlib", FileChannel::COMP_ZLIB)
   ("z", FileChannel::COMP_ZLIB)
+  ("zstd", FileChannel::COMP_ZSTD)
+  ("zst", FileChannel::COMP_ZSTD)
   ("number", FileChannel::AR_NUMBER)
   ("timestamp", FileChannel::AR_TIMESTAMP)
+  ("generation", FileChannel::AR_GENERATION)
   ("size", FileChannel::ROT_SIZE)
   ("interval", FileChannel::ROT_INTERVAL)
   ("time", FileChannel::ROT_TIME)
   ("count", FileChannel::PURGE_COUNT)
   ("age", FileChannel::PURGE_AGE)
   ("utc", 0)
-  ("local", 1);
-
-FileChannel::FileChannel() {}
+  ("local", 1)
+  ("block", MessageQueue::OVERFLOW_BLOCK)
+  ("drop-newest", MessageQueue::OVERFLOW_DROP_NEWEST)
+  ("drop-lowest", MessageQueue::OVERFLOW_DROP_LOWEST);
+
+FileChannel::FileChannel()
+  : staged_(0), published_(0), archiveMode_(AR_NONE), fd_(-1),
+    compressed_(false), bufferSize_(DEFAULT_BUFFER_SIZE),
+    flushMode_(FLUSH_EVERY), flushBytes_(DEFAULT_BUFFER_SIZE), flushMs_(0),
+    syncMode_(SYNC_NONE), syncMs_(DEFAULT_FSYNC_INTERVAL), pendingSince_(0),
+    lastSync_(0),
+    dirty_(false), written_(0), maxSize_(-1), deadline_(-1), resyncAt_(0),
+    open_(false) {}
 
 FileChannel::FileChannel(const std::string& path)
-  : path_(path) {}
-
-FileChannel::~FileChannel() {}
+  : path_(path), staged_(0), published_(0), archiveMode_(AR_NONE),
+    fd_(-1), compressed_(false), bufferSize_(DEFAULT_BUFFER_SIZE),
+    flushMode_(FLUSH_EVERY), flushBytes_(DEFAULT_BUFFER_SIZE), flushMs_(0),
+    syncMode_(SYNC_NONE), syncMs_(DEFAULT_FSYNC_INTERVAL), pendingSince_(0),
+    lastSync_(0),
+    dirty_(false), written_(0), maxSize_(-1), deadline_(-1), resyncAt_(0),
+    open_(false) {}
+
+FileChannel::~FileChannel() {
+  // drain pending messages while the stream is still alive
+  if (pQueue_) {
+    pQueue_->stop();
+  }
+  if (flusher_) {
+    flusher_->interrupt();
+    flusher_->join();
+  }
+  flush();
+  // wait for archives being compressed
+  pCompressor_.reset();
+}
 
 void
 FileChannel::open() {
   Lock lock(mutex_);
 
-  if (out_) {
+  if (out_.is_complete()) {
     return;
   }
 
   if (path_.empty()) {
     try {
-      path_ = getAttr<std::string>(FileChannel::ATTR_PATH);
+      path_ = getAttr<std::string>(KEY_PATH);
     } catch (const dadi::Error& e) {
       // FIXME do we need to catch each error separately?
       // FIXME add more information?
       BOOST_THROW_EXCEPTION(e);
     }
   }
-  // FIXME check that path_ does not point to a directory or throw an exception
   int cMode_ =
-    attrMap[getAttr<std::string>(FileChannel::ATTR_COMPRESSION_MODE, "")];
-  switch (cMode_) {
-  case FileChannel::COMP_ZLIB:
-    out_.push(io::zlib_compressor());
-    break;
-  case FileChannel::COMP_GZIP:
-    out_.push(io::gzip_compressor());
-    break;
-  case FileChannel::COMP_BZIP2:
-    out_.push(io::bzip2_compressor());
-    break;
-  case FileChannel::COMP_NONE:
-  default:
-    break;
-  }
+    attrMap[getAttr<std::string>(KEY_COMPRESSION_MODE, "")];
+  Compressor::push(out_, cMode_);
+  compressed_ = (FileChannel::COMP_NONE != cMode_);
 
-  out_.push(io::file_sink(path_));
+  openFile();
 
   setArchiveStrategy();
   setRotateStrategy();
+  resetRotation(Clock::now().wall);
   setPurgeStrategy();
+  setFormatter();
+  setFlushPolicy();
+  setAsyncMode();
+  // log() no longer takes mutex_ once it sees the channel open
+  open_.store(true, boost::memory_order_release);
 }
 
 void
-FileChannel::close() {}
+FileChannel::close() {
+  flush();
+}
+
+void
+FileChannel::flush() {
+  // wait for the writer thread, then write what it left buffered
+  if (pQueue_) {
+    pQueue_->flush();
+  }
+
+  Lock lock(mutex_);
+  if (out_.is_complete()) {
+    commit();
+    if (SYNC_NONE != syncMode_) {
+      sync();
+    }
+  }
+}
 
 void
 FileChannel::log(const Message& msg) {
-  open();
+  if (!open_.load(boost::memory_order_acquire)) {
+    open();
+  }
+
+  if (pQueue_) {
+    pQueue_->push(msg);
+    return;
+  }
+
+  const std::string& line = format(msg);
   /* since mutex_ is not a recursive one, we wait that open()
      ends before locking it */
   Lock lock(mutex_);
 
-  // FIXME: compressors are not flushable-friendly
-  out_ << msg.getText() << std::endl;
+  written_ += line.size() + 1;
+  append(line);
+  rotate();
+}
+
+void
+FileChannel::logRecord(const Message& msg) {
+  if (!open_.load(boost::memory_order_acquire)) {
+    open();
+  }
+
+  if (pQueue_) {
+    pQueue_->push(msg);
+    return;
+  }
+
+  Lock lock(mutex_);
+
+  if (buffer_.empty() && (FLUSH_MS == flushMode_)) {
+    pendingSince_ = Clock::now().monotonic;
+  }
+  std::size_t before = buffer_.size();
+  encode(msg, buffer_);
+  written_ += buffer_.size() - before;
+
+  if (mustCommit()) {
+    commit();
+  }
+  rotate();
+}
+
+void
+FileChannel::encode(const Message& msg, std::string& out) {
+  formatter_.format(msg, out);
+  out.push_back('\n');
+}
+
+void
+FileChannel::writePreamble(std::string& out) {}
+
+void
+FileChannel::write(const MessageQueue::Batch& batch) {
+  Lock lock(mutex_);
+
+  // coalesce the whole batch so that it is written at once
+  if (buffer_.empty() && (FLUSH_MS == flushMode_)) {
+    pendingSince_ = Clock::now().monotonic;
+  }
+  std::size_t before = buffer_.size();
+  MessageQueue::Batch::const_iterator it = batch.begin();
+  for (; it != batch.end(); ++it) {
+    encode(*it, buffer_);
+  }
+  written_ += buffer_.size() - before;
+
+  if (mustCommit()) {
+    commit();
+  }
+  rotate();
+}
+
+void
+FileChannel::append(const std::string& line) {
+  std::size_t limit = (FLUSH_BYTES == flushMode_) ? flushBytes_
+    : bufferSize_;
+  if ((FLUSH_EVERY == flushMode_) ||
+      (buffer_.size() + line.size() + 1 >= limit)) {
+    commit(&line);
+    return;
+  }
+
+  if (buffer_.empty() && (FLUSH_MS == flushMode_)) {
+    pendingSince_ = Clock::now().monotonic;
+  }
+  buffer_.append(line);
+  buffer_.push_back('\n');
+
+  if ((FLUSH_MS == flushMode_) && mustCommit()) {
+    commit();
+  }
+}
+
+void
+FileChannel::commit(const std::string *line) {
+  if (buffer_.empty() && !line) {
+    return;
+  }
+
+  if (compressed_) {
+    // FIXME: compressors are not flushable-friendly
+    out_.write(buffer_.data(), buffer_.size());
+    if (line) {
+      out_.write(line->data(), line->size());
+      out_.put('\n');
+    }
+    out_.flush();
+  } else {
+    writeLines(fd_, buffer_, line);
+  }
+  buffer_.clear();
+  dirty_ = true;
+
+  if ((SYNC_INTERVAL == syncMode_) &&
+      (Clock::now().monotonic - lastSync_ >= syncMs_ * NSECS_PER_MSEC)) {
+    sync();
+  }
+}
+
+bool
+FileChannel::mustCommit() const {
+  switch (flushMode_) {
+  case FLUSH_EVERY:
+    return true;
+  case FLUSH_BYTES:
+    return (buffer_.size() >= flushBytes_);
+  case FLUSH_MS:
+    return (buffer_.size() >= bufferSize_) ||
+      (Clock::now().monotonic - pendingSince_ >= flushMs_ * NSECS_PER_MSEC);
+  default:
+    return (buffer_.size() >= bufferSize_);
+  }
+}
+
+void
+FileChannel::sync() {
+  if (dirty_ && (0 <= fd_)) {
+#if defined(WIN32)
+    ::_commit(fd_);
+#else /* WIN32 */
+    ::fsync(fd_);
+#endif /* WIN32 */
+    dirty_ = false;
+  }
+  lastSync_ = Clock::now().monotonic;
+}
+
+void
+FileChannel::runFlusher(long period) {
+  try {
+    for (;;) {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(period));
+
+      Lock lock(mutex_);
+      if ((FLUSH_MS == flushMode_) && !buffer_.empty() && mustCommit()) {
+        commit();
+      }
+      if ((SYNC_INTERVAL == syncMode_) && dirty_ &&
+          (Clock::now().monotonic - lastSync_ >= syncMs_ * NSECS_PER_MSEC)) {
+        sync();
+      }
+    }
+  } catch (const boost::thread_interrupted&) {}
+}
+
+void
+FileChannel::rotate() {
+  if (!pRotateStrategy_ || !pArchiveStrategy_) {
+    return;
+  }
+
+  boost::int64_t now = 0;
+  bool due = false;
+  if ((0 > maxSize_) && (0 > deadline_)) {
+    // strategy can not be tracked
+    due = pRotateStrategy_->mustRotate(path_);
+  } else {
+    now = Clock::now().wall;
+    if (now >= resyncAt_) {
+      // catch up with changes made behind our back (ie: truncation)
+      resyncSize(now);
+    }
+    bool full = (0 <= maxSize_) && (written_ >= maxSize_);
+    if (full && compressed_) {
+      // we count uncompressed bytes: only the file size tells, do not
+      // stat it for every message though
+      if (now - (resyncAt_ - RESYNC_INTERVAL) >= COMPRESSED_RESYNC_INTERVAL) {
+        resyncSize(now);
+        full = (written_ >= maxSize_);
+      } else {
+        full = false;
+      }
+    }
+    due = full || ((0 <= deadline_) && (now >= deadline_));
+  }
 
-  if (pRotateStrategy_ && pArchiveStrategy_ &&
-      pRotateStrategy_->mustRotate(path_)) {
+  if (due) {
+    // the archive gets every buffered line
+    commit();
+    if (SYNC_NONE != syncMode_) {
+      sync();
+    }
     out_.pop();
-    pArchiveStrategy_->archive(path_);
-    out_.push(io::file_sink(path_));
-    purge();
+    if (pCompressor_ && (AR_NUMBER == archiveMode_ ||
+                         AR_TIMESTAMP == archiveMode_)) {
+      // these schemes rename existing archives, which must not happen
+      // while older ones are compressed: the file is set aside under a
+      // unique name, and archived once compressed
+      // the clock may be coarse: the rotation number keeps names unique
+      const std::string staging = path_ + ".rotating." +
+        boost::lexical_cast<std::string>(Clock::now().wall) + "." +
+        boost::lexical_cast<std::string>(staged_);
+      boost::filesystem::rename(path_, staging);
+      openFile();
+      pCompressor_->compress(staging, boost::bind(&FileChannel::publish,
+                                                  this, _1, staging,
+                                                  staged_++));
+      resetRotation(now ? now : Clock::now().wall);
+      return;
+    }
+    const std::string& archive = pArchiveStrategy_->archive(path_);
+    bool renamed = pArchiveStrategy_->hasRenamed();
+    openFile();
+    if (pCompressor_) {
+      pCompressor_->compress(archive, boost::bind(&FileChannel::purge, this,
+                                                  _1, renamed));
+    } else {
+      purge(archive, renamed);
+    }
+    resetRotation(now ? now : Clock::now().wall);
+  }
+}
+
+void
+FileChannel::resetRotation(boost::int64_t now) {
+  maxSize_ = pRotateStrategy_ ? pRotateStrategy_->getMaxSize() : -1;
+  deadline_ = pRotateStrategy_ ? pRotateStrategy_->getNextRotation(now) : -1;
+  resyncSize(now);
+}
+
+void
+FileChannel::resyncSize(boost::int64_t now) {
+  written_ = static_cast<long>(buffer_.size());
+  boost::system::error_code ec;
+  boost::uintmax_t size = boost::filesystem::file_size(path_, ec);
+  if (!ec) {
+    written_ += static_cast<long>(size);
   }
+  resyncAt_ = now + RESYNC_INTERVAL;
+}
+
+void
+FileChannel::openFile() {
+#if defined(WIN32)
+  fd_ = ::_open(path_.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                _S_IREAD | _S_IWRITE);
+#else /* WIN32 */
+  fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif /* WIN32 */
+  if (0 > fd_) {
+    const int error = errno;
+    // open() starts over on next call
+    out_.reset();
+    BOOST_THROW_EXCEPTION(Error() << errinfo_msg(path_ + ": " +
+                                                 std::strerror(error)));
+  }
+  dirty_ = false;
+  // the stream owns the descriptor (used directly if not compressed)
+  out_.push(io::file_descriptor_sink(fd_, io::close_handle));
+  writePreamble(buffer_);
 }
 
 long
@@ -166,13 +586,31 @@ FileChannel::setArchiveStrategy() {
     return;
   }
 
-  int aMode_ = attrMap[getAttr<std::string>(FileChannel::ATTR_ARCHIVE, "")];
+  int aMode_ = attrMap[getAttr<std::string>(KEY_ARCHIVE, "")];
   if (FileChannel::AR_NUMBER == aMode_) {
     pArchiveStrategy_.reset(new ArchiveByNumberStrategy);
   }
   if (FileChannel::AR_TIMESTAMP == aMode_) {
     pArchiveStrategy_.reset(new ArchiveByTimestampStrategy);
   }
+  if (FileChannel::AR_GENERATION == aMode_) {
+    pArchiveStrategy_.reset(new ArchiveByGenerationStrategy);
+  }
+  if (!pArchiveStrategy_) {
+    return;
+  }
+  archiveMode_ = aMode_;
+
+  int format =
+    attrMap[getAttr<std::string>(KEY_ARCHIVE_COMPRESSION, "")];
+  if (COMP_NONE != format && !pCompressor_) {
+    int level = getAttr<int>(KEY_ARCHIVE_COMPRESSION_LEVEL,
+                             Compressor::DEFAULT_LEVEL);
+    unsigned int workers =
+      getAttr<unsigned int>(KEY_ARCHIVE_WORKERS, 1);
+    pCompressor_.reset(new Compressor(format, level, workers));
+    pArchiveStrategy_->setSuffix(pCompressor_->getExtension());
+  }
 }
 
 class Weekday {
@@ -198,9 +636,9 @@ std::map<std::string, unsigned int> Weekday::dMap =
   ("monday", 1)
   ("tuesday", 2)
   ("wednesday", 3)
-  ("friday", 4)
-  ("monday", 5)
-  ("sunday", 6);
+  ("thursday", 4)
+  ("friday", 5)
+  ("saturday", 6);
 
 void
 FileChannel::setRotateStrategy() {
@@ -211,16 +649,16 @@ FileChannel::setRotateStrategy() {
     return;
   }
 
-  int rMode_ = attrMap[getAttr<std::string>(FileChannel::ATTR_ROTATE, "")];
+  int rMode_ = attrMap[getAttr<std::string>(KEY_ROTATE, "")];
   if (FileChannel::ROT_SIZE == rMode_) {
     // by default: 1Mo
-    const std::string& sz = getAttr<std::string>(FileChannel::ATTR_ROTATE_SIZE,
+    const std::string& sz = getAttr<std::string>(KEY_ROTATE_SIZE,
                                                  DEFAULT_ROT_SIZE);
     pRotateStrategy_.reset(new RotateBySizeStrategy(sz));
   }
   if (FileChannel::ROT_INTERVAL == rMode_) {
     // by default: 1 day
-    std::string s(getAttr<std::string>(FileChannel::ATTR_ROTATE_INTERVAL,
+    std::string s(getAttr<std::string>(KEY_ROTATE_INTERVAL,
                                        DEFAULT_ROT_INTERVAL));
     // FIXME: we should catch an exception when user sets a badly formatted
     // duration
@@ -228,15 +666,16 @@ FileChannel::setRotateStrategy() {
     pRotateStrategy_.reset(new RotateByIntervalStrategy(td));
   }
   if (FileChannel::ROT_TIME == rMode_) {
-    std::string s(getAttr<std::string>(FileChannel::ATTR_ROTATE_INTERVAL, ""));
+    std::string s(getAttr<std::string>(KEY_ROTATE_INTERVAL, ""));
     boost::smatch res;
     if (boost::regex_match(s, res, regex1)) {
-      bool utc = getAttr<bool>(FileChannel::ATTR_ROTATE_TIME, true);
+      bool utc = getAttr<bool>(KEY_ROTATE_TIME, true);
       time_duration td(duration_from_string(res[2].str()));
       unsigned int day = Weekday()(res[1].str());
       RotateByTimeStrategy *rPtr = new RotateByTimeStrategy(td, day);
       if (!utc) {
-        rPtr->setLocal(true);
+        // historical behaviour: local time unless rotate.time is false
+        rPtr->setUtc();
       }
       pRotateStrategy_.reset(rPtr);
     } else {
@@ -251,20 +690,166 @@ FileChannel::setPurgeStrategy() {
     return;
   }
 
-  int pMode_ = attrMap[getAttr<std::string>(FileChannel::ATTR_PURGE, "none")];
+  const std::string& mode = getAttr<std::string>(KEY_PURGE,
+                                                 "none");
+  // "size" is already mapped to ROT_SIZE
+  int pMode_ = ("size" == mode) ? static_cast<int>(FileChannel::PURGE_SIZE)
+    : attrMap[mode];
   if (FileChannel::PURGE_COUNT == pMode_) {
-    int nb = getAttr<int>(FileChannel::ATTR_PURGE_COUNT, DEFAULT_PURGE_COUNT);
+    int nb = getAttr<int>(KEY_PURGE_COUNT, DEFAULT_PURGE_COUNT);
     pPurgeStrategy_.reset(new PurgeByCountStrategy(nb));
   }
+  try {
+    if (FileChannel::PURGE_AGE == pMode_) {
+      const std::string& age =
+        getAttr<std::string>(KEY_PURGE_AGE, DEFAULT_PURGE_AGE);
+      pPurgeStrategy_.reset(new PurgeByAgeStrategy(
+                              boost::posix_time::duration_from_string(age)));
+    }
+    if (FileChannel::PURGE_SIZE == pMode_) {
+      const std::string& sz =
+        getAttr<std::string>(KEY_PURGE_SIZE, DEFAULT_PURGE_SIZE);
+      pPurgeStrategy_.reset(new PurgeBySizeStrategy(sz));
+    }
+  } catch (const std::exception& e) {
+    BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                          << errinfo_msg(e.what()));
+  }
+  // index archives before any of them is being compressed
+  if (pPurgeStrategy_) {
+    if (pArchiveStrategy_) {
+      pPurgeStrategy_->setPattern(pArchiveStrategy_->getPattern());
+    }
+    pPurgeStrategy_->load(path_);
+  }
 }
 
 
+void
+FileChannel::setFlushPolicy() {
+  bufferSize_ = getAttr<std::size_t>(KEY_BUFFER_SIZE,
+                                     DEFAULT_BUFFER_SIZE);
+  buffer_.reserve(bufferSize_);
+
+  std::string flush = getAttr<std::string>(KEY_FLUSH, "every");
+  std::string::size_type pos = flush.find(':');
+  std::string mode = flush.substr(0, pos);
+  long value = 0;
+  if (std::string::npos != pos) {
+    try {
+      value = boost::lexical_cast<long>(flush.substr(pos + 1));
+    } catch (const boost::bad_lexical_cast& e) {
+      BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                            << errinfo_msg(e.what()));
+    }
+  }
+
+  if ("bytes" == mode && value > 0) {
+    flushMode_ = FLUSH_BYTES;
+    flushBytes_ = value;
+  } else if ("ms" == mode && value > 0) {
+    flushMode_ = FLUSH_MS;
+    flushMs_ = value;
+  } else if ("never" == mode) {
+    flushMode_ = FLUSH_NEVER;
+  } else {
+    flushMode_ = FLUSH_EVERY;
+  }
+
+  std::string fsync = getAttr<std::string>(KEY_FSYNC, "none");
+  if ("interval" == fsync) {
+    syncMode_ = SYNC_INTERVAL;
+  } else if ("on-rotate" == fsync) {
+    syncMode_ = SYNC_ON_ROTATE;
+  } else {
+    syncMode_ = SYNC_NONE;
+  }
+  syncMs_ = getAttr<long>(KEY_FSYNC_INTERVAL,
+                          DEFAULT_FSYNC_INTERVAL);
+  if (syncMs_ <= 0) {
+    syncMs_ = DEFAULT_FSYNC_INTERVAL;
+  }
+  lastSync_ = Clock::now().monotonic;
+
+  // time-based policies need a thread so that idle channels get flushed
+  long period = 0;
+  if (FLUSH_MS == flushMode_) {
+    period = flushMs_;
+  }
+  if (SYNC_INTERVAL == syncMode_) {
+    period = period ? std::min(period, syncMs_) : syncMs_;
+  }
+  if (period && !flusher_) {
+    flusher_.reset(new boost::thread(boost::bind(&FileChannel::runFlusher,
+                                                 this, period)));
+  }
+}
+
+void
+FileChannel::setAsyncMode() {
+  if (pQueue_ || !getAttr<bool>(KEY_ASYNC, false)) {
+    return;
+  }
+
+  std::size_t size =
+    getAttr<std::size_t>(KEY_ASYNC_QUEUE_SIZE,
+                         MessageQueue::DEFAULT_CAPACITY);
+  int policy =
+    attrMap[getAttr<std::string>(KEY_ASYNC_OVERFLOW, "block")];
+  pQueue_.reset(new MessageQueue(boost::bind(&FileChannel::write, this, _1),
+                                 size, policy));
+  pQueue_->start();
+}
+
 // TODO: implement purgatory and cleanse logs from evil spirits
 void
-FileChannel::purge() {
-  if (pPurgeStrategy_) {
-    pPurgeStrategy_->purge(path_);
+FileChannel::purge(const std::string& archive, bool renamed) {
+  boost::lock_guard<boost::mutex> lock(purgeMutex_);
+
+  purgeArchives(archive, renamed);
+}
+
+void
+FileChannel::publish(const std::string& compressed,
+                     const std::string& staging,
+                     unsigned long ticket) {
+  boost::unique_lock<boost::mutex> lock(purgeMutex_);
+
+  // workers may complete out of order
+  while (published_ != ticket) {
+    publishable_.wait(lock);
+  }
+
+  std::string archive;
+  bool renamed = false;
+  try {
+    // an uncompressed file is archived as is (the compressor may already
+    // be released by the destructor)
+    archive = pArchiveStrategy_->archiveFile(
+      path_, compressed, compressed.substr(staging.size()));
+    renamed = pArchiveStrategy_->hasRenamed();
+  } catch (...) {
+    // left under its staging name
+  }
+  ++published_;
+  publishable_.notify_all();
+
+  if (!archive.empty()) {
+    purgeArchives(archive, renamed);
+  }
+}
+
+void
+FileChannel::purgeArchives(const std::string& archive, bool renamed) {
+  if (!pPurgeStrategy_) {
+    return;
+  }
+  if (renamed) {
+    pPurgeStrategy_->invalidate();
+  } else {
+    pPurgeStrategy_->add(archive);
   }
+  pPurgeStrategy_->purge(path_);
 }
 
 }  /* namespace dadi */
@@ -0,0 +1,228 @@
+/**
+ * @file   Formatter.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  Formatter implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/Formatter.hh"
+#include <boost/cstdint.hpp>
+#include "dadi/Logging/Message.hh"
+
+namespace dadi {
+
+const std::string Formatter::DEFAULT_PATTERN = std::string("%m");
+
+namespace {
+
+const char *priorities[] = {
+  "", "TRACE", "DEBUG", "INFORMATION", "WARNING", "ERROR", "CRITICAL", "FATAL"
+};
+
+const boost::int64_t NSECS_PER_SEC = 1000000000;
+const boost::int64_t SECS_PER_DAY = 86400;
+
+/* append v in decimal, left-padded with zeroes up to width digits */
+void
+appendUnsigned(std::string& out, boost::uint64_t v, unsigned int width = 0) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *p = end;
+  do {
+    *--p = static_cast<char>('0' + (v % 10));
+    v /= 10;
+  } while (v);
+  while (static_cast<unsigned int>(end - p) < width) {
+    *--p = '0';
+  }
+  out.append(p, end);
+}
+
+void
+appendSigned(std::string& out, boost::int64_t v) {
+  if (v < 0) {
+    out.push_back('-');
+    appendUnsigned(out, static_cast<boost::uint64_t>(-(v + 1)) + 1);
+  } else {
+    appendUnsigned(out, static_cast<boost::uint64_t>(v));
+  }
+}
+
+/* YYYY-MM-DD HH:MM:SS.uuuuuu (UTC), days to civil date from H. Hinnant */
+void
+appendTime(std::string& out, boost::int64_t wall) {
+  boost::int64_t secs = wall / NSECS_PER_SEC;
+  boost::int64_t nsecs = wall % NSECS_PER_SEC;
+  if (nsecs < 0) {
+    nsecs += NSECS_PER_SEC;
+    --secs;
+  }
+  boost::int64_t days = secs / SECS_PER_DAY;
+  boost::int64_t rem = secs % SECS_PER_DAY;
+  if (rem < 0) {
+    rem += SECS_PER_DAY;
+    --days;
+  }
+
+  days += 719468;
+  boost::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  boost::int64_t doe = days - era * 146097;
+  boost::int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  boost::int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  boost::int64_t mp = (5 * doy + 2) / 153;
+  boost::int64_t day = doy - (153 * mp + 2) / 5 + 1;
+  boost::int64_t month = (mp < 10) ? mp + 3 : mp - 9;
+  boost::int64_t year = yoe + era * 400 + ((month <= 2) ? 1 : 0);
+
+  appendSigned(out, year);
+  out.push_back('-');
+  appendUnsigned(out, month, 2);
+  out.push_back('-');
+  appendUnsigned(out, day, 2);
+  out.push_back(' ');
+  appendUnsigned(out, rem / 3600, 2);
+  out.push_back(':');
+  appendUnsigned(out, (rem / 60) % 60, 2);
+  out.push_back(':');
+  appendUnsigned(out, rem % 60, 2);
+  out.push_back('.');
+  appendUnsigned(out, nsecs / 1000, 6);
+}
+
+} /* namespace */
+
+Formatter::Formatter(const std::string& pattern) {
+  setPattern(pattern);
+}
+
+void
+Formatter::setPattern(const std::string& pattern) {
+  pattern_ = pattern;
+  segments_.clear();
+
+  std::string::size_type i = 0;
+  const std::string::size_type len = pattern.size();
+  while (i < len) {
+    std::string::size_type pos = pattern.find('%', i);
+    if (std::string::npos == pos || pos + 1 == len) {
+      addSegment(SEG_LITERAL, pattern.substr(i));
+      break;
+    }
+    if (pos > i) {
+      addSegment(SEG_LITERAL, pattern.substr(i, pos - i));
+    }
+
+    i = pos + 2;
+    switch (pattern[pos + 1]) {
+    case 'm':
+      addSegment(SEG_TEXT);
+      break;
+    case 'p':
+      addSegment(SEG_PRIORITY);
+      break;
+    case 's':
+      addSegment(SEG_SOURCE);
+      break;
+    case 'f':
+      addSegment(SEG_FILE);
+      break;
+    case 'l':
+      addSegment(SEG_LINE);
+      break;
+    case 'T':
+      addSegment(SEG_TIME);
+      break;
+    case 't':
+      addSegment(SEG_EPOCH);
+      break;
+    case 'N':
+      addSegment(SEG_MONOTONIC);
+      break;
+    case '%':
+      addSegment(SEG_LITERAL, "%");
+      break;
+    case 'X': {
+      std::string::size_type end = pattern.find('}', i);
+      if (i < len && '{' == pattern[i] && std::string::npos != end) {
+        addSegment(SEG_TAG, pattern.substr(i + 1, end - i - 1));
+        i = end + 1;
+        break;
+      }
+      addSegment(SEG_LITERAL, "%X");
+      break;
+    }
+    default:
+      addSegment(SEG_LITERAL, pattern.substr(pos, 2));
+      break;
+    }
+  }
+}
+
+const std::string&
+Formatter::getPattern() const {
+  return pattern_;
+}
+
+bool
+Formatter::isTextOnly() const {
+  return (1 == segments_.size()) && (SEG_TEXT == segments_[0].type);
+}
+
+void
+Formatter::format(const Message& msg, std::string& out) const {
+  std::vector<Segment>::const_iterator it = segments_.begin();
+  for (; it != segments_.end(); ++it) {
+    switch (it->type) {
+    case SEG_LITERAL:
+      out.append(it->value);
+      break;
+    case SEG_TEXT:
+      out.append(msg.getText());
+      break;
+    case SEG_PRIORITY: {
+      int prio = msg.getPriority();
+      if (prio > 0 && prio <= Message::PRIO_FATAL) {
+        out.append(priorities[prio]);
+      }
+      break;
+    }
+    case SEG_SOURCE:
+      out.append(msg.getSource());
+      break;
+    case SEG_FILE:
+      out.append(msg.getFileName());
+      break;
+    case SEG_LINE:
+      appendSigned(out, msg.getLine());
+      break;
+    case SEG_TIME:
+      appendTime(out, msg.getTime().wall);
+      break;
+    case SEG_EPOCH:
+      appendSigned(out, msg.getTimestamp());
+      break;
+    case SEG_MONOTONIC:
+      appendSigned(out, msg.getTime().monotonic);
+      break;
+    case SEG_TAG:
+      out.append(msg[it->value]);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void
+Formatter::addSegment(SegmentType type, const std::string& value) {
+  if (SEG_LITERAL == type && !segments_.empty() &&
+      SEG_LITERAL == segments_.back().type) {
+    segments_.back().value.append(value);
+    return;
+  }
+  segments_.push_back(Segment(type, value));
+}
+
+} /* namespace dadi */
@@ -0,0 +1,421 @@
+/**
+ * @file   LogConfigurator.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  LogConfigurator implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/LogConfigurator.hh"
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+#include "dadi/AttrReader.hh"
+#include "dadi/Config.hh"
+#include "dadi/Logging/BinaryFileChannel.hh"
+#include "dadi/Logging/ConsoleChannel.hh"
+#include "dadi/Logging/FileChannel.hh"
+#include "dadi/Logging/Logger.hh"
+#include "dadi/Logging/Message.hh"
+#include "dadi/Logging/MultiChannel.hh"
+#include "dadi/Logging/NullChannel.hh"
+#ifndef WIN32
+#include "dadi/Logging/MappedRingChannel.hh"
+#include "dadi/Logging/SyslogChannel.hh"
+#include "dadi/Logging/SyslogSocketChannel.hh"
+#endif
+#include "dadi/Exception/All.hh"
+
+namespace dadi {
+
+typedef boost::lock_guard<boost::mutex> Lock;
+
+namespace {
+/* name of the root logger in the configuration */
+const std::string ROOT = "root";
+/* quiet time after a change before the file is reloaded (ms) */
+const int SETTLE_DELAY = 100;
+
+/* copy a configuration tree into channel attributes */
+void
+putAttrs(Channel& channel, const ConfigStore& node,
+         const std::string& prefix) {
+  BOOST_FOREACH(const ConfigStore::value_type& v, node) {
+    const std::string& path = prefix.empty() ? v.first : prefix + "." + v.first;
+    if (!v.second.data().empty()) {
+      channel.putAttr(path, v.second.data());
+    }
+    putAttrs(channel, v.second, path);
+  }
+}
+
+void
+throwErrno(const std::string& what) {
+  BOOST_THROW_EXCEPTION(Error()
+                        << errinfo_msg(what + ": " + std::strerror(errno)));
+}
+} /* namespace */
+
+LogConfigurator::LogConfigurator(const std::string& key)
+  : key_(key), generation_(0), format_(FORMAT_INFO) {
+  pipe_[0] = pipe_[1] = -1;
+}
+
+LogConfigurator::~LogConfigurator() {
+  unwatch();
+}
+
+void
+LogConfigurator::configure() {
+  // copied under the Config lock, it may be reloaded meanwhile
+  ConfigStore section;
+  try {
+    section = Config::instance().get_child(key_);
+  } catch (const UnknownParameterError&) {}
+  configure(section);
+}
+
+void
+LogConfigurator::configure(const ConfigStore& section) {
+  Lock lock(mutex_);
+
+  // build everything that may fail before touching any logger
+  ChannelMap channels;
+  boost::optional<const ConfigStore&> node =
+    section.get_child_optional("channels");
+  if (node) {
+    buildChannels(*node, channels);
+  }
+
+  LoggerEntries loggers;
+  ConfigStore limits;
+  node = section.get_child_optional("loggers");
+  if (node) {
+    limits = *node;
+    BOOST_FOREACH(const ConfigStore::value_type& v, *node) {
+      LoggerEntry entry;
+      boost::optional<std::string> level =
+        v.second.get_optional<std::string>("level");
+      entry.level = level ? Logger::parseLevel(*level) : -1;
+      entry.channel = v.second.get<std::string>("channel", "");
+      if (!entry.channel.empty() &&
+          (channels.end() == channels.find(entry.channel))) {
+        BOOST_THROW_EXCEPTION(InvalidParameterError() << errinfo_msg(
+                                "unknown channel: " + entry.channel));
+      }
+      loggers[v.first] = entry;
+    }
+  }
+  // limits of dropped loggers are reset to their default
+  LoggerEntries::const_iterator it = loggers_.begin();
+  for (; loggers_.end() != it; ++it) {
+    if (loggers.end() == loggers.find(it->first)) {
+      limits.push_back(ConfigStore::value_type(it->first, ConfigStore()));
+    }
+  }
+  Logger::loadConfig(limits);
+
+  for (it = loggers.begin(); loggers.end() != it; ++it) {
+    LoggerPtr logger = Logger::getLogger(
+      (ROOT == it->first) ? Logger::root_ : it->first);
+    if (-1 != it->second.level) {
+      logger->setLevel(it->second.level);
+    }
+    if (!it->second.channel.empty()) {
+      logger->setChannel(channels[it->second.channel].channel);
+    }
+  }
+  for (it = loggers_.begin(); loggers_.end() != it; ++it) {
+    LoggerEntries::const_iterator entry = loggers.find(it->first);
+    bool level = (-1 != it->second.level) &&
+      ((loggers.end() == entry) || (-1 == entry->second.level));
+    bool channel = !it->second.channel.empty() &&
+      ((loggers.end() == entry) || entry->second.channel.empty());
+    if (!level && !channel) {
+      continue;
+    }
+
+    LoggerPtr logger = Logger::getLogger(
+      (ROOT == it->first) ? Logger::root_ : it->first);
+    // the root logger has no ancestor: it gets its default values back
+    if (level) {
+      if (ROOT == it->first) {
+        logger->setLevel(Message::PRIO_INFORMATION);
+      } else {
+        logger->resetLevel();
+      }
+    }
+    if (channel) {
+      if (ROOT == it->first) {
+        logger->setChannel(ChannelPtr());
+      } else {
+        logger->resetChannel();
+      }
+    }
+  }
+
+  // messages still queued in replaced channels are written now
+  ChannelMap::iterator c = channels_.begin();
+  for (; channels_.end() != c; ++c) {
+    ChannelMap::const_iterator kept = channels.find(c->first);
+    if ((channels.end() == kept) ||
+        (kept->second.channel != c->second.channel)) {
+      c->second.channel->flush();
+    }
+  }
+
+  channels_.swap(channels);
+  loggers_.swap(loggers);
+  generation_.fetch_add(1, boost::memory_order_release);
+}
+
+void
+LogConfigurator::buildChannels(const ConfigStore& section,
+                               ChannelMap& channels) const {
+  BOOST_FOREACH(const ConfigStore::value_type& v, section) {
+    if (channels.end() != channels.find(v.first)) {
+      BOOST_THROW_EXCEPTION(InvalidParameterError() << errinfo_msg(
+                              "duplicate channel: " + v.first));
+    }
+    ChannelEntry entry;
+    entry.type = v.second.get<std::string>("type", "");
+    entry.attrs = v.second;
+    entry.attrs.erase("type");
+
+    bool multi = ("multi" == entry.type);
+    std::vector<ChannelPtr> targets;
+    if (multi) {
+      BOOST_FOREACH(const ConfigStore::value_type& t, entry.attrs) {
+        if ("channel" != t.first) {
+          continue;
+        }
+        ChannelMap::const_iterator target = channels.find(t.second.data());
+        if (channels.end() == target) {
+          BOOST_THROW_EXCEPTION(InvalidParameterError() << errinfo_msg(
+                                  "unknown channel: " + t.second.data()));
+        }
+        targets.push_back(target->second.channel);
+      }
+    }
+
+    // an unchanged channel is kept open, a multi channel also needs its
+    // targets to be unchanged
+    ChannelMap::const_iterator current = channels_.find(v.first);
+    bool reuse = (channels_.end() != current) &&
+      (current->second.type == entry.type) &&
+      (current->second.attrs == entry.attrs);
+    if (reuse && multi) {
+      BOOST_FOREACH(const ConfigStore::value_type& t, entry.attrs) {
+        if ("channel" == t.first) {
+          ChannelMap::const_iterator target = channels_.find(t.second.data());
+          reuse = reuse && (channels_.end() != target) &&
+            (target->second.channel ==
+             channels.find(t.second.data())->second.channel);
+        }
+      }
+    }
+
+    if (reuse) {
+      entry.channel = current->second.channel;
+    } else {
+      entry.channel = createChannel(entry.type);
+      putAttrs(*entry.channel, entry.attrs, "");
+      if (multi) {
+        MultiChannel& channel = static_cast<MultiChannel&>(*entry.channel);
+        BOOST_FOREACH(ChannelPtr& target, targets) {
+          channel.addChannel(target);
+        }
+      }
+      entry.channel->open();
+    }
+    channels[v.first] = entry;
+  }
+}
+
+void
+LogConfigurator::watch(const std::string& path, Format format) {
+#ifdef __linux__
+  unwatch();
+
+  {
+    Lock lock(mutex_);
+    path_ = path;
+    format_ = format;
+  }
+  configure(readFile());
+
+  // the directory is watched, as editors often replace the file
+  boost::filesystem::path file(path);
+  std::string dir = file.parent_path().string();
+  int fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (-1 == fd) {
+    throwErrno("inotify");
+  }
+  if ((-1 == ::inotify_add_watch(fd, dir.empty() ? "." : dir.c_str(),
+                                 IN_CLOSE_WRITE | IN_MOVED_TO)) ||
+      (-1 == ::pipe2(pipe_, O_CLOEXEC))) {
+    ::close(fd);
+    throwErrno(path);
+  }
+  thread_.reset(new boost::thread(boost::bind(&LogConfigurator::run,
+                                              this, fd)));
+#else
+  BOOST_THROW_EXCEPTION(Error() << errinfo_msg(
+                          "configuration files cannot be watched: " + path));
+#endif
+}
+
+void
+LogConfigurator::unwatch() {
+#ifdef __linux__
+  if (!thread_) {
+    return;
+  }
+
+  char stop = 0;
+  while ((-1 == ::write(pipe_[1], &stop, sizeof(stop))) && (EINTR == errno)) {
+  }
+  thread_->join();
+  thread_.reset();
+  ::close(pipe_[0]);
+  ::close(pipe_[1]);
+  pipe_[0] = pipe_[1] = -1;
+#endif
+}
+
+ChannelPtr
+LogConfigurator::getChannel(const std::string& name) const {
+  Lock lock(mutex_);
+
+  ChannelMap::const_iterator it = channels_.find(name);
+  if (channels_.end() != it) {
+    return it->second.channel;
+  }
+
+  return ChannelPtr();
+}
+
+unsigned long
+LogConfigurator::getGeneration() const {
+  return generation_.load(boost::memory_order_acquire);
+}
+
+ChannelPtr
+LogConfigurator::createChannel(const std::string& type) {
+  if ("console" == type) {
+    return ChannelPtr(new ConsoleChannel);
+  } else if ("file" == type) {
+    return ChannelPtr(new FileChannel);
+  } else if ("binary_file" == type) {
+    return ChannelPtr(new BinaryFileChannel);
+  } else if ("null" == type) {
+    return ChannelPtr(new NullChannel);
+  } else if ("multi" == type) {
+    return ChannelPtr(new MultiChannel);
+#ifndef WIN32
+  } else if ("syslog" == type) {
+    return ChannelPtr(new SyslogChannel);
+  } else if ("syslog_socket" == type) {
+    return ChannelPtr(new SyslogSocketChannel);
+  } else if ("mapped_ring" == type) {
+    return ChannelPtr(new MappedRingChannel);
+#endif
+  }
+
+  BOOST_THROW_EXCEPTION(InvalidParameterError()
+                        << errinfo_msg("unknown channel type: " + type));
+  return ChannelPtr();
+}
+
+ConfigStore
+LogConfigurator::readFile() const {
+  std::ifstream in(path_.c_str());
+  if (!in) {
+    throwErrno(path_);
+  }
+  // other sections of the file are not materialized
+  ConfigStore store;
+  AttrSelector selector(store, std::vector<std::string>(1, key_));
+  readAttr(in, selector, format_);
+
+  boost::optional<ConfigStore&> section = store.get_child_optional(key_);
+  return section ? *section : ConfigStore();
+}
+
+void
+LogConfigurator::reload() {
+  std::string error;
+  try {
+    configure(readFile());
+    return;
+  } catch (const Error& e) {
+    const std::string *msg = boost::get_error_info<errinfo_msg>(e);
+    error = msg ? *msg : std::string(e.what());
+  } catch (const std::exception& e) {
+    error = e.what();
+  }
+
+  Logger::getRootLogger()->log(
+    Message("LogConfigurator", "cannot reload " + path_ + ": " + error,
+            Message::PRIO_ERROR));
+}
+
+#ifdef __linux__
+void
+LogConfigurator::run(int fd) {
+  const std::string name =
+    boost::filesystem::path(path_).filename().string();
+  std::vector<char> buffer(4096);
+  struct pollfd fds[2];
+  fds[0].fd = fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = pipe_[0];
+  fds[1].events = POLLIN;
+
+  bool changed = false;
+  for (;;) {
+    // once the file changed, wait until writes settle down
+    int res = ::poll(fds, 2, changed ? SETTLE_DELAY : -1);
+    if ((-1 == res) && (EINTR == errno)) {
+      continue;
+    }
+    if ((-1 == res) || (fds[1].revents & POLLIN)) {
+      break;
+    }
+    if (0 == res) {
+      changed = false;
+      reload();
+      continue;
+    }
+
+    ssize_t size;
+    while (0 < (size = ::read(fd, &buffer[0], buffer.size()))) {
+      for (ssize_t pos = 0; pos < size; ) {
+        struct inotify_event event;
+        std::memcpy(&event, &buffer[pos], sizeof(event));
+        const char *file = &buffer[pos + sizeof(event)];
+        if (event.len && (name == file)) {
+          changed = true;
+        }
+        pos += sizeof(event) + event.len;
+      }
+    }
+  }
+
+  ::close(fd);
+}
+#endif
+
+} /* namespace dadi */
@@ -48,6 +48,7 @@ void
 LogServiceChannel::open() {
   Lock lock(mutex_);
 
+  setFormatter();
   short ret;
   ret = lb->connect("channel connected");
   // TODO: fix this
@@ -74,7 +75,7 @@ void
 LogServiceChannel::log(const Message& msg) {
   Lock lock(mutex_);
   // TODO: implement tags (tags filters on channel side, tags on Message side)
-  lb->sendMsg("ANY", msg.getText().c_str());
+  lb->sendMsg("ANY", format(msg).c_str());
 }
 
 
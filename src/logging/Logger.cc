@@ -8,21 +8,70 @@
  */
 
 #include "dadi/Logging/Logger.hh"
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+#include "dadi/Config.hh"
+#include "dadi/Logging/Clock.hh"
 #include "dadi/Logging/Message.hh"
 
 namespace dadi {
 
 const std::string Logger::root_ = std::string();
+const long Logger::DEFAULT_SUMMARY_PERIOD = 1000;
 LoggerMap Logger::lmap_ = LoggerMap();
 boost::recursive_mutex Logger::mutex_;
+boost::mutex Logger::releaseMutex_;
+LoggerIndexPtr Logger::index_(new LoggerIndex);
+// starts at 1 so that a fresh per-thread cache is always reloaded
+boost::atomic<unsigned long> Logger::generation_(1);
+std::size_t Logger::published_ = 0;
+std::size_t Logger::stale_ = 0;
 
 typedef boost::lock_guard<boost::recursive_mutex> Lock;
 
+namespace {
+/**
+ * @struct CachedIndex
+ * @brief last Logger cache snapshot seen by a thread
+ */
+struct CachedIndex {
+  CachedIndex() : generation(0) {}
+
+  unsigned long generation; /**< snapshot version */
+  LoggerIndexPtr index; /**< snapshot */
+};
+
+boost::thread_specific_ptr<CachedIndex> cachedIndex;
+
+const char *priorities[] = {
+  "trace", "debug", "information", "warning", "error", "critical", "fatal"
+};
+
+/* logger limits read from the configuration */
+struct Limits {
+  std::string name; /**< logger name */
+  double rate; /**< messages per second */
+  unsigned long burst; /**< messages allowed at once */
+  long summary; /**< summary period (ms) */
+  /** sampling periods, by priority */
+  unsigned int periods[sizeof(priorities) / sizeof(priorities[0])];
+};
+} /* namespace */
+
 Logger::Logger(const std::string& name,
                ChannelPtr channel,
                int level)
-  : name_(name), channel_(channel), level_(level) {}
+  : name_(name), channel_(channel), pChannel_(channel.get()),
+    level_(level), channelSet_(false), levelSet_(false), filtered_(false),
+    summaryPeriod_(DEFAULT_SUMMARY_PERIOD * 1000000) {
+  for (int i = 0; i < PRIORITIES; ++i) {
+    periods_[i].store(1, boost::memory_order_relaxed);
+    counts_[i].store(0, boost::memory_order_relaxed);
+  }
+}
 
 const std::string&
 Logger::getName() const {
@@ -31,39 +80,222 @@ Logger::getName() const {
 
 void
 Logger::setChannel(ChannelPtr channel) {
-  channel_ = channel;
+  RetiredChannels retired;
+  {
+    Lock lock(mutex_);
+
+    channelSet_ = true;
+    assignChannel(channel, retired);
+    propagate(name_, retired);
+  }
+  release(retired);
+}
+
+void
+Logger::resetChannel() {
+  RetiredChannels retired;
+  {
+    Lock lock(mutex_);
+
+    if (root_ == name_) {
+      return;
+    }
+    channelSet_ = false;
+    inherit(*getParent(name_), retired);
+    propagate(name_, retired);
+  }
+  release(retired);
 }
 
 ChannelPtr
 Logger::getChannel() const {
+  Lock lock(mutex_);
+
   return channel_;
 }
 
 void
 Logger::setLevel(int level) {
-  if ((Message::PRIO_TRACE <= level) && (Message::PRIO_FATAL >= level)) {
-    level_ = level;
-  } else {
-    level_ = Message::PRIO_INFORMATION;
+  if ((Message::PRIO_TRACE > level) || (Message::PRIO_FATAL < level)) {
+    level = Message::PRIO_INFORMATION;
   }
+
+  RetiredChannels retired;
+  {
+    Lock lock(mutex_);
+
+    levelSet_ = true;
+    level_.store(level, boost::memory_order_relaxed);
+    propagate(name_, retired);
+  }
+  release(retired);
+}
+
+void
+Logger::resetLevel() {
+  RetiredChannels retired;
+  {
+    Lock lock(mutex_);
+
+    if (root_ == name_) {
+      return;
+    }
+    levelSet_ = false;
+    inherit(*getParent(name_), retired);
+    propagate(name_, retired);
+  }
+  release(retired);
 }
 
 int
 Logger::getLevel() const {
-  return level_;
+  return level_.load(boost::memory_order_relaxed);
+}
+
+void
+Logger::setRateLimit(double rate, unsigned long burst) {
+  Lock lock(mutex_);
+
+  limiter_.setRate(rate, burst);
+  updateFiltered();
+}
+
+void
+Logger::setSampling(int level, unsigned int period) {
+  Lock lock(mutex_);
+
+  if ((Message::PRIO_TRACE <= level) && (Message::PRIO_FATAL >= level)) {
+    periods_[level - Message::PRIO_TRACE].store(period ? period : 1,
+                                                boost::memory_order_relaxed);
+  }
+  updateFiltered();
+}
+
+unsigned int
+Logger::getSampling(int level) const {
+  if ((Message::PRIO_TRACE <= level) && (Message::PRIO_FATAL >= level)) {
+    return periods_[level - Message::PRIO_TRACE].load(
+      boost::memory_order_relaxed);
+  }
+  return 1;
+}
+
+void
+Logger::setSummaryPeriod(long period) {
+  summaryPeriod_.store(static_cast<boost::int64_t>(period) * 1000000,
+                       boost::memory_order_relaxed);
 }
 
 void
 Logger::log(const Message& msg) {
-  if ((msg.getPriority() >= level_) &&
-      channel_) {
-    channel_->log(msg);
+  if ((msg.getPriority() >= level_.load(boost::memory_order_relaxed)) &&
+      admit(msg.getPriority())) {
+    logAdmitted(msg);
   }
 }
 
+void
+Logger::logAdmitted(const Message& msg) {
+  Epoch::Guard guard(epoch_);
+  Channel *channel = pChannel_.load();
+  if (channel) {
+    channel->log(msg);
+  }
+}
+
+void
+Logger::updateFiltered() {
+  bool filtered = limiter_.isEnabled();
+  for (int i = 0; i < PRIORITIES; ++i) {
+    filtered = filtered || (1 < periods_[i].load(boost::memory_order_relaxed));
+  }
+  filtered_.store(filtered, boost::memory_order_relaxed);
+}
+
 bool
-Logger::is(int level) const {
-  return (level_ <= level);
+Logger::filter(int level, RateLimiter *site, const char *file, int line) {
+  // sampling does not need the time
+  if ((Message::PRIO_TRACE <= level) && (Message::PRIO_FATAL >= level)) {
+    const int i = level - Message::PRIO_TRACE;
+    const unsigned int period = periods_[i].load(boost::memory_order_relaxed);
+    if ((1 < period) &&
+        (counts_[i].fetch_add(1, boost::memory_order_relaxed) % period)) {
+      limiter_.suppress(level);
+      return false;
+    }
+  }
+
+  const boost::int64_t now = Clock::now().monotonic;
+  if (site && !site->allow(now)) {
+    site->suppress(level);
+    if (site->enlist()) {
+      // once per call site, for flush()
+      Site s = {site, file, line};
+      boost::mutex::scoped_lock lock(sitesMutex_);
+      sites_.push_back(s);
+    }
+    return false;
+  }
+  if (!limiter_.allow(now)) {
+    limiter_.suppress(level);
+    return false;
+  }
+
+  summarize(limiter_, now, "", 0);
+  if (site) {
+    summarize(*site, now, file, line);
+  }
+  return true;
+}
+
+void
+Logger::summarize(RateLimiter& limiter, boost::int64_t now,
+                  const char *file, int line) {
+  int priority;
+  unsigned long count = limiter.takeSuppressed(
+    now, summaryPeriod_.load(boost::memory_order_relaxed), priority);
+  report(count, priority, file, line);
+}
+
+void
+Logger::report(unsigned long count, int priority, const char *file,
+               int line) {
+  if (!count) {
+    return;
+  }
+  Epoch::Guard guard(epoch_);
+  Channel *channel = pChannel_.load();
+  if (channel) {
+    channel->log(Message(name_,
+                          "suppressed " +
+                          boost::lexical_cast<std::string>(count) +
+                          " messages",
+                          static_cast<Message::Priority>(priority),
+                          file, line));
+  }
+}
+
+void
+Logger::flush() {
+  // counts left when the flood stopped are not lost
+  int priority;
+  unsigned long count = limiter_.takeSuppressed(priority);
+  report(count, priority, "", 0);
+  std::vector<Site> sites;
+  {
+    boost::mutex::scoped_lock lock(sitesMutex_);
+    sites = sites_;
+  }
+  for (std::size_t i = 0; i < sites.size(); ++i) {
+    count = sites[i].limiter->takeSuppressed(priority);
+    report(count, priority, sites[i].file, sites[i].line);
+  }
+
+  Epoch::Guard guard(epoch_);
+  Channel *channel = pChannel_.load();
+  if (channel) {
+    channel->flush();
+  }
 }
 
 bool
@@ -103,56 +335,92 @@ Logger::fatal() const {
 
 LoggerPtr
 Logger::getRootLogger() {
-  Lock lock(mutex_);
-
-  return get(root_);
+  return getLogger(root_);
 }
 
 LoggerPtr
 Logger::getLogger(const std::string& name) {
+  LoggerPtr logger = lookup(name);
+  if (logger) {
+    return logger;
+  }
+
   Lock lock(mutex_);
 
+  logger = find(name);
+  if (logger) {
+    // not published yet
+    unpublished();
+    return logger;
+  }
   return get(name);
 }
 
 bool
 Logger::hasLogger(const std::string& name) {
-  Lock lock(mutex_);
+  if (lookup(name)) {
+    return true;
+  }
 
-  LoggerMap::const_iterator it = lmap_.find(name);
+  Lock lock(mutex_);
 
-  return (lmap_.end() != it) ? true : false;
+  if (find(name)) {
+    unpublished();
+    return true;
+  }
+  return false;
 }
 
 LoggerPtr
 Logger::createLogger(const std::string& name,
                      ChannelPtr channel,
                      int level = Message::PRIO_INFORMATION) {
-  Lock lock(mutex_);
+  RetiredChannels retired;
+  LoggerPtr newLogger;
+  {
+    Lock lock(mutex_);
+
+    if (find(name)) {
+      // FIXME Throw a proper exception using BOOST
+      throw std::string("Logger ") + name + std::string("already exists");
+    }
 
-  if (find(name)) {
-    // FIXME Throw a proper exception using BOOST
-    throw std::string("Logger ") + name + std::string("already exists");
+    newLogger.reset(new Logger(name, channel, level));
+    newLogger->channelSet_ = true;
+    newLogger->levelSet_ = true;
+    add(newLogger);
+    // existing descendants now follow it
+    propagate(name, retired);
   }
-
-  LoggerPtr newLogger(new Logger(name, channel, level));
-  add(newLogger);
+  release(retired);
 
   return newLogger;
 }
 
 void
 Logger::destroyLogger(const std::string& name) {
-  Lock lock(mutex_);
-
-  lmap_.erase(name);
+  RetiredChannels retired;
+  {
+    Lock lock(mutex_);
+
+    lmap_.erase(name);
+    // descendants follow their next ancestor
+    propagate(name, retired);
+    publish();
+  }
+  release(retired);
 }
 
 void
 Logger::shutdown() {
   Lock lock(mutex_);
 
+  LoggerMap::iterator it = lmap_.begin();
+  for (; lmap_.end() != it; ++it) {
+    it->second->flush();
+  }
   lmap_.clear();
+  publish();
 }
 
 void
@@ -167,6 +435,65 @@ Logger::getActiveLoggers(std::vector<std::string>& names) {
 }
 
 
+void
+Logger::loadConfig(const std::string& key) {
+  boost::optional<ConfigStore&> loggers =
+    Config::instance().get_child_optional(key);
+  if (!loggers) {
+    return;
+  }
+  loadConfig(ConfigStore(*loggers));
+}
+
+void
+Logger::loadConfig(const ConfigStore& loggers) {
+  // everything is parsed before the first logger is changed
+  std::vector<Limits> limits;
+  try {
+    BOOST_FOREACH(const ConfigStore::value_type& v, loggers) {
+      const ConfigStore& node = v.second;
+      Limits logger;
+      logger.name = ("root" == v.first) ? root_ : v.first;
+      logger.rate = node.get<double>("rate", 0.0);
+      logger.burst = node.get<unsigned long>("burst", 1);
+      logger.summary = node.get<long>("summary", DEFAULT_SUMMARY_PERIOD);
+      std::fill(logger.periods, logger.periods + PRIORITIES, 1U);
+      boost::optional<const ConfigStore&> sampling =
+        node.get_child_optional("sampling");
+      if (sampling) {
+        BOOST_FOREACH(const ConfigStore::value_type& p, *sampling) {
+          logger.periods[parseLevel(p.first) - Message::PRIO_TRACE] =
+            p.second.get_value<unsigned int>();
+        }
+      }
+      limits.push_back(logger);
+    }
+  } catch (const boost::property_tree::ptree_bad_data& e) {
+    BOOST_THROW_EXCEPTION(InvalidParameterError() << errinfo_msg(e.what()));
+  }
+
+  BOOST_FOREACH(const Limits& l, limits) {
+    LoggerPtr logger = getLogger(l.name);
+    logger->setRateLimit(l.rate, l.burst);
+    logger->setSummaryPeriod(l.summary);
+    for (int i = 0; i < PRIORITIES; ++i) {
+      logger->setSampling(i + Message::PRIO_TRACE, l.periods[i]);
+    }
+  }
+}
+
+int
+Logger::parseLevel(const std::string& name) {
+  for (int i = 0; i < PRIORITIES; ++i) {
+    if (boost::iequals(name, priorities[i])) {
+      return i + Message::PRIO_TRACE;
+    }
+  }
+  BOOST_THROW_EXCEPTION(InvalidParameterError()
+                        << errinfo_msg("invalid priority: " + name));
+  return 0;
+}
+
 LoggerPtr
 Logger::find(const std::string& name) {
   Lock lock(mutex_);
@@ -188,6 +515,8 @@ Logger::get(const std::string& name) {
   if (!logger) {
     if (root_ == name) {
       logger.reset(new Logger(name, LoggerPtr(), Message::PRIO_INFORMATION));
+      logger->channelSet_ = true;
+      logger->levelSet_ = true;
     } else {
       LoggerPtr parent = getParent(name);
       logger.reset(new Logger(name, parent->getChannel(), parent->getLevel()));
@@ -204,6 +533,108 @@ Logger::add(LoggerPtr logger) {
   Lock lock(mutex_);
 
   lmap_.insert(LoggerMap::value_type(logger->getName(), logger));
+  unpublished();
+}
+
+LoggerPtr
+Logger::lookup(const std::string& name) {
+  CachedIndex *cache = cachedIndex.get();
+  if (!cache) {
+    cache = new CachedIndex;
+    cachedIndex.reset(cache);
+  }
+
+  // only reload the snapshot when the hierarchy has changed
+  unsigned long generation = generation_.load(boost::memory_order_acquire);
+  if (cache->generation != generation) {
+    cache->index = boost::atomic_load(&index_);
+    cache->generation = generation;
+  }
+
+  LoggerIndex::const_iterator it = cache->index->find(name);
+  if (cache->index->end() != it) {
+    return it->second.lock();
+  }
+
+  return LoggerPtr();
+}
+
+void
+Logger::publish() {
+  LoggerIndexPtr index(new LoggerIndex(lmap_.begin(), lmap_.end()));
+  boost::atomic_store(&index_, index);
+  generation_.fetch_add(1, boost::memory_order_release);
+  published_ = lmap_.size();
+  stale_ = 0;
+}
+
+void
+Logger::unpublished() {
+  // rebuilding the snapshot costs O(N): amortized over as many operations
+  if (++stale_ > published_) {
+    publish();
+  }
+}
+
+void
+Logger::propagate(const std::string& name, RetiredChannels& retired) {
+  // ancestors sort before their descendants
+  const std::string& prefix = (root_ == name) ? name : name + ".";
+  LoggerMap::iterator it = lmap_.lower_bound(prefix);
+  for (; (lmap_.end() != it) && (0 == it->first.compare(0, prefix.size(),
+                                                        prefix)); ++it) {
+    Logger& logger = *it->second;
+    if ((root_ != it->first) && (!logger.levelSet_ || !logger.channelSet_)) {
+      const std::size_t count = retired.size();
+      logger.inherit(*getParent(it->first), retired);
+      if (retired.size() != count) {
+        // the descendant may be destroyed before release()
+        retired.back().owner = it->second;
+      }
+    }
+  }
+}
+
+void
+Logger::release(RetiredChannels& retired) {
+  if (retired.empty()) {
+    return;
+  }
+
+  // synchronizations of an epoch must not overlap
+  boost::lock_guard<boost::mutex> lock(releaseMutex_);
+  std::vector<Epoch *> epochs;
+  for (std::size_t i = 0; i < retired.size(); ++i) {
+    epochs.push_back(retired[i].epoch);
+  }
+  // threads may still be logging through the replaced channels
+  Epoch::synchronize(epochs);
+  retired.clear();
+}
+
+void
+Logger::inherit(const Logger& parent, RetiredChannels& retired) {
+  if (!levelSet_) {
+    level_.store(parent.level_.load(boost::memory_order_relaxed),
+                 boost::memory_order_relaxed);
+  }
+  if (!channelSet_) {
+    assignChannel(parent.channel_, retired);
+  }
+}
+
+void
+Logger::assignChannel(ChannelPtr channel, RetiredChannels& retired) {
+  if (channel == channel_) {
+    return;
+  }
+
+  Retired previous;
+  previous.epoch = &epoch_;
+  previous.channel = channel_;
+  retired.push_back(previous);
+  channel_ = channel;
+  pChannel_.store(channel.get());
 }
 
 LoggerPtr
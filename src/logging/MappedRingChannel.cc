@@ -0,0 +1,302 @@
+/**
+ * @file   MappedRingChannel.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  MappedRingChannel and MappedRingReader implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/MappedRingChannel.hh"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <boost/static_assert.hpp>
+#include <boost/thread/locks.hpp>
+#include "dadi/Logging/Message.hh"
+#include "dadi/Exception/All.hh"
+
+namespace dadi {
+
+typedef boost::lock_guard<boost::mutex> Lock;
+
+const char MappedRingChannel::MAGIC[8] = {
+  'D', 'A', 'D', 'I', 'R', 'N', 'G', '\1'
+};
+const std::size_t MappedRingChannel::HEADER_SIZE;
+const std::size_t MappedRingChannel::RECORD_HEADER_SIZE;
+const std::size_t MappedRingChannel::DEFAULT_SIZE;
+const std::string MappedRingChannel::ATTR_PATH = std::string("path");
+const std::string MappedRingChannel::ATTR_SIZE = std::string("size");
+
+namespace {
+/* rings smaller than this can not hold a meaningful record */
+const std::size_t MIN_SIZE = 256;
+const boost::uint32_t CHECK_SEED = 0x52494e47;
+
+/* file header, at the beginning of the mapping */
+struct RingHeader {
+  char magic[8];
+  boost::uint64_t capacity; /**< size of the data area */
+  boost::atomic<boost::uint64_t> head; /**< bytes reserved since creation */
+};
+
+/* record header, followed by the payload */
+struct RecordHeader {
+  boost::uint64_t pos; /**< position since creation (commit marker) */
+  boost::uint32_t size; /**< payload size */
+  boost::uint32_t check; /**< validates pos and size */
+};
+
+BOOST_STATIC_ASSERT(sizeof(boost::atomic<boost::uint64_t>) == 8);
+BOOST_STATIC_ASSERT(sizeof(RingHeader) <= MappedRingChannel::HEADER_SIZE);
+BOOST_STATIC_ASSERT(sizeof(RecordHeader) ==
+                    MappedRingChannel::RECORD_HEADER_SIZE);
+
+boost::uint64_t
+align(boost::uint64_t size) {
+  return (size + 7) & ~static_cast<boost::uint64_t>(7);
+}
+
+boost::uint32_t
+check(boost::uint64_t pos, boost::uint32_t size) {
+  return static_cast<boost::uint32_t>(pos) ^
+    static_cast<boost::uint32_t>(pos >> 32) ^ size ^ CHECK_SEED;
+}
+
+/* copy into the data area, wrapping around */
+void
+put(char *data, boost::uint64_t capacity, boost::uint64_t pos,
+    const char *src, std::size_t size) {
+  std::size_t offset = pos % capacity;
+  std::size_t first = std::min<std::size_t>(size, capacity - offset);
+  std::memcpy(data + offset, src, first);
+  std::memcpy(data, src + first, size - first);
+}
+
+void
+throwErrno(const std::string& what) {
+  BOOST_THROW_EXCEPTION(Error()
+                        << errinfo_msg(what + ": " + std::strerror(errno)));
+}
+} /* namespace */
+
+MappedRingChannel::MappedRingChannel()
+  : size_(DEFAULT_SIZE), map_(NULL), mapSize_(0), data_(NULL), capacity_(0),
+    maxPayload_(0), open_(false) {}
+
+MappedRingChannel::MappedRingChannel(const std::string& path,
+                                     std::size_t size)
+  : path_(path), size_(size), map_(NULL), mapSize_(0), data_(NULL),
+    capacity_(0), maxPayload_(0), open_(false) {}
+
+MappedRingChannel::~MappedRingChannel() {
+  if (map_) {
+    ::munmap(map_, mapSize_);
+  }
+}
+
+void
+MappedRingChannel::open() {
+  Lock lock(mutex_);
+
+  if (open_.load(boost::memory_order_acquire)) {
+    return;
+  }
+
+  if (path_.empty()) {
+    path_ = getAttr<std::string>(ATTR_PATH);
+  }
+  size_ = getAttr<std::size_t>(ATTR_SIZE, size_);
+  if (size_ < MIN_SIZE) {
+    BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                          << errinfo_msg("ring size too small"));
+  }
+  capacity_ = align(size_);
+  mapSize_ = HEADER_SIZE + capacity_;
+
+  int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (-1 == fd) {
+    throwErrno(path_);
+  }
+
+  // an existing ring of the same size is appended to
+  struct stat st;
+  char header[sizeof(MAGIC) + sizeof(capacity_)];
+  boost::uint64_t capacity = 0;
+  bool reuse = (0 == ::fstat(fd, &st)) &&
+    (static_cast<std::size_t>(st.st_size) == mapSize_) &&
+    (static_cast<ssize_t>(sizeof(header)) ==
+     ::pread(fd, header, sizeof(header), 0)) &&
+    (0 == std::memcmp(header, MAGIC, sizeof(MAGIC)));
+  if (reuse) {
+    std::memcpy(&capacity, header + sizeof(MAGIC), sizeof(capacity));
+    reuse = (capacity == capacity_);
+  }
+  if (!reuse) {
+    // blocks are allocated now: a full disk must not crash writers later
+    int res = 0;
+    if ((0 != ::ftruncate(fd, 0)) || (0 != ::ftruncate(fd, mapSize_)) ||
+        ((0 != (res = ::posix_fallocate(fd, 0, mapSize_))) &&
+         (EINVAL != res) && (EOPNOTSUPP != res))) {
+      if (res) {
+        errno = res;
+      }
+      ::close(fd);
+      throwErrno(path_);
+    }
+  }
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  // do not take page faults while logging
+  flags |= MAP_POPULATE;
+#endif
+  void *map = ::mmap(NULL, mapSize_, PROT_READ | PROT_WRITE, flags, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == map) {
+    throwErrno(path_);
+  }
+  map_ = static_cast<char *>(map);
+  data_ = map_ + HEADER_SIZE;
+  maxPayload_ = capacity_ / 4 - RECORD_HEADER_SIZE;
+
+  RingHeader *pHeader = reinterpret_cast<RingHeader *>(map_);
+  if (!reuse) {
+    // the magic number is written last
+    pHeader->capacity = capacity_;
+    pHeader->head.store(0, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    std::memcpy(pHeader->magic, MAGIC, sizeof(MAGIC));
+  }
+
+  setFormatter();
+
+  open_.store(true, boost::memory_order_release);
+}
+
+void
+MappedRingChannel::close() {
+  flush();
+}
+
+void
+MappedRingChannel::flush() {
+  if (open_.load(boost::memory_order_acquire)) {
+    ::msync(map_, mapSize_, MS_ASYNC);
+  }
+}
+
+void
+MappedRingChannel::log(const Message& msg) {
+  if (!open_.load(boost::memory_order_acquire)) {
+    open();
+  }
+
+  const std::string& line = format(msg);
+  RecordHeader record;
+  record.size =
+    static_cast<boost::uint32_t>(std::min(line.size(), maxPayload_));
+  const boost::uint64_t size = align(RECORD_HEADER_SIZE + record.size);
+
+  RingHeader *pHeader = reinterpret_cast<RingHeader *>(map_);
+  const boost::uint64_t pos =
+    pHeader->head.fetch_add(size, boost::memory_order_relaxed);
+  record.check = check(pos, record.size);
+
+  // the position may only be stored once the record is complete
+  put(data_, capacity_, pos + sizeof(record.pos),
+      reinterpret_cast<const char *>(&record.size),
+      sizeof(record.size) + sizeof(record.check));
+  put(data_, capacity_, pos + RECORD_HEADER_SIZE, line.data(), record.size);
+  boost::atomic_thread_fence(boost::memory_order_release);
+  // positions are aligned on 8 bytes, so this one never wraps around
+  *reinterpret_cast<volatile boost::uint64_t *>(data_ + pos % capacity_) =
+    pos;
+}
+
+/*****************************************************************************/
+
+MappedRingReader::MappedRingReader(const std::string& path)
+  : pos_(0), head_(0), skipped_(0) {
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  if (!in) {
+    BOOST_THROW_EXCEPTION(Error()
+                          << errinfo_msg("cannot open ring: " + path));
+  }
+
+  char header[MappedRingChannel::HEADER_SIZE];
+  boost::uint64_t capacity;
+  in.read(header, sizeof(header));
+  std::memcpy(&capacity, header + 8, sizeof(capacity));
+  std::memcpy(&head_, header + 16, sizeof(head_));
+  if (!in || (0 != std::memcmp(header, MappedRingChannel::MAGIC,
+                               sizeof(MappedRingChannel::MAGIC))) ||
+      (0 == capacity) || (0 != capacity % 8) || (0 != head_ % 8)) {
+    BOOST_THROW_EXCEPTION(Error()
+                          << errinfo_msg("not a ring: " + path));
+  }
+
+  data_.resize(capacity);
+  in.read(&data_[0], capacity);
+  if (static_cast<boost::uint64_t>(in.gcount()) != capacity) {
+    BOOST_THROW_EXCEPTION(Error()
+                          << errinfo_msg("truncated ring: " + path));
+  }
+
+  // older records have been overwritten
+  if (head_ > capacity) {
+    pos_ = head_ - capacity;
+  }
+}
+
+bool
+MappedRingReader::next(std::string& record) {
+  const boost::uint64_t capacity = data_.size();
+
+  while (pos_ + MappedRingChannel::RECORD_HEADER_SIZE <= head_) {
+    RecordHeader header;
+    copy(pos_, reinterpret_cast<char *>(&header), sizeof(header));
+    const boost::uint64_t size =
+      align(MappedRingChannel::RECORD_HEADER_SIZE + header.size);
+    if ((header.pos == pos_) && (header.check == check(pos_, header.size))
+        && (header.size <= capacity / 4) && (pos_ + size <= head_)) {
+      record.resize(header.size);
+      if (header.size) {
+        copy(pos_ + MappedRingChannel::RECORD_HEADER_SIZE, &record[0],
+             header.size);
+      }
+      pos_ += size;
+      return true;
+    }
+    // uncommitted record or remains of an overwritten one: resync
+    pos_ += 8;
+    skipped_ += 8;
+  }
+
+  skipped_ += head_ - pos_;
+  pos_ = head_;
+  return false;
+}
+
+boost::uint64_t
+MappedRingReader::getSkipped() const {
+  return skipped_;
+}
+
+void
+MappedRingReader::copy(boost::uint64_t pos, char *dst,
+                       std::size_t size) const {
+  const std::size_t capacity = data_.size();
+  std::size_t offset = pos % capacity;
+  std::size_t first = std::min(size, capacity - offset);
+  std::memcpy(dst, &data_[offset], first);
+  std::memcpy(dst + first, &data_[0], size - first);
+}
+
+} /* namespace dadi */
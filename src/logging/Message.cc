@@ -11,21 +11,36 @@
 
 namespace dadi {
 
+namespace {
+const std::string emptyTag;
+const long NSECS_PER_SEC = 1000000000L;
+} /* namespace */
+
 Message::Message()
-  : prio_(PRIO_FATAL), line_(0) {}
+  : prio_(PRIO_FATAL), time_(Clock::now()), file_(""), line_(0) {}
 
 
 Message::Message(const std::string& src,
                  const std::string& txt,
                  Priority prio)
-  : src_(src), txt_(txt), prio_(prio) {}
+  : src_(src), txt_(txt), prio_(prio), time_(Clock::now()), file_(""),
+    line_(0) {}
 
 Message::Message(const std::string& src,
                  const std::string& txt,
                  Priority prio,
                  const std::string& file,
                  int line)
-  : src_(src), txt_(txt), prio_(prio), file_(file), line_(line) {}
+  : src_(src), txt_(txt), prio_(prio), time_(Clock::now()),
+    file_(NULL), fileName_(file), line_(line) {}
+
+Message::Message(const std::string& src,
+                 const std::string& txt,
+                 Priority prio,
+                 const char *file,
+                 int line)
+  : src_(src), txt_(txt), prio_(prio), time_(Clock::now()),
+    file_(file ? file : ""), line_(line) {}
 
 void
 Message::setSource(const std::string& src) {
@@ -59,22 +74,47 @@ Message::getPriority() const {
 
 void
 Message::setTimestamp(long timestamp) {
-  timestamp_ = timestamp;
+  time_.wall = static_cast<boost::int64_t>(timestamp) * NSECS_PER_SEC;
 }
 
 long
 Message::getTimestamp() const {
-  return timestamp_;
+  return static_cast<long>(time_.wall / NSECS_PER_SEC);
+}
+
+void
+Message::setTime(const Timestamp& time) {
+  time_ = time;
+}
+
+const Timestamp&
+Message::getTime() const {
+  return time_;
 }
 
 void
 Message::setFile(const std::string& filename) {
-  file_ = filename;
+  file_ = NULL;
+  fileName_ = filename;
+}
+
+void
+Message::setFile(const char *filename) {
+  file_ = filename ? filename : "";
 }
 
 const std::string&
 Message::getFile() const {
-  return file_;
+  if (file_) {
+    // buffer is reused by recycled messages
+    fileName_.assign(file_);
+  }
+  return fileName_;
+}
+
+const char *
+Message::getFileName() const {
+  return file_ ? file_ : fileName_.c_str();
 }
 
 void
@@ -89,12 +129,37 @@ Message::getLine() const {
 
 std::string&
 Message::operator[](const std::string& key) {
-  return tags_[key];
+  Tags::iterator it = tags_.begin();
+  for (; it != tags_.end(); ++it) {
+    if (it->first == key) {
+      return it->second;
+    }
+  }
+
+  tags_.push_back(Tag(key, std::string()));
+  return tags_.back().second;
 }
 
 const std::string&
 Message::operator[](const std::string& key) const {
-  return tags_[key];
+  Tags::const_iterator it = tags_.begin();
+  for (; it != tags_.end(); ++it) {
+    if (it->first == key) {
+      return it->second;
+    }
+  }
+
+  return emptyTag;
+}
+
+const Tags&
+Message::getTags() const {
+  return tags_;
+}
+
+void
+Message::clearTags() {
+  tags_.clear();
 }
 
 } /* namespace dadi */
@@ -0,0 +1,245 @@
+/**
+ * @file   MessageQueue.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  bounded message queue drained by a background thread
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/MessageQueue.hh"
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace dadi {
+
+typedef boost::unique_lock<boost::mutex> Lock;
+
+const std::size_t MessageQueue::DEFAULT_CAPACITY = 8192;
+
+namespace {
+
+inline int
+laneOf(int priority) {
+  return std::max(0, std::min(priority,
+                              static_cast<int>(Message::PRIO_FATAL)));
+}
+
+/* evicted messages were the oldest of their lane: the first entries of a
+ * lane in order are the skipped ones */
+void
+mergeLanes(MessageQueue::Batch *lanes, std::size_t *skipped,
+           const std::deque<unsigned char>& order,
+           MessageQueue::Batch& batch) {
+  std::deque<unsigned char>::const_iterator it = order.begin();
+  for (; it != order.end(); ++it) {
+    if (skipped[*it]) {
+      --skipped[*it];
+    } else {
+      batch.push_back(lanes[*it].front());
+      lanes[*it].pop_front();
+    }
+  }
+}
+
+} /* namespace */
+
+MessageQueue::MessageQueue(const Consumer& consumer,
+                           std::size_t capacity,
+                           int policy)
+  : consumer_(consumer), capacity_(capacity ? capacity : DEFAULT_CAPACITY),
+    policy_(policy), size_(0), pushed_(0), processed_(0), dropped_(0),
+    evicted_(0), running_(false), stopped_(false) {
+  std::fill(skipped_, skipped_ + LANES, 0);
+}
+
+MessageQueue::~MessageQueue() {
+  stop();
+}
+
+void
+MessageQueue::start() {
+  Lock lock(mutex_);
+
+  if (running_) {
+    return;
+  }
+
+  running_ = true;
+  stopped_ = false;
+  thread_.reset(new boost::thread(boost::bind(&MessageQueue::run, this)));
+}
+
+void
+MessageQueue::stop() {
+  {
+    Lock lock(mutex_);
+    stopped_ = true;
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  notEmpty_.notify_one();
+  // blocked producers give up
+  notFull_.notify_all();
+  // the writer drains the remaining messages before leaving
+  thread_->join();
+  thread_.reset();
+}
+
+bool
+MessageQueue::push(const Message& msg) {
+  Lock lock(mutex_);
+
+  if (stopped_) {
+    // nothing would ever drain msg
+    ++dropped_;
+    return false;
+  }
+
+  if (size_ >= capacity_) {
+    switch (policy_) {
+    case OVERFLOW_DROP_NEWEST:
+      ++dropped_;
+      return false;
+    case OVERFLOW_DROP_LOWEST:
+      if (!evict(msg.getPriority())) {
+        ++dropped_;
+        return false;
+      }
+      break;
+    case OVERFLOW_BLOCK:
+    default:
+      while (running_ && size_ >= capacity_) {
+        notFull_.wait(lock);
+      }
+      if (stopped_) {
+        ++dropped_;
+        return false;
+      }
+    }
+  }
+
+  if (OVERFLOW_DROP_LOWEST == policy_) {
+    const int lane = laneOf(msg.getPriority());
+    lanes_[lane].push_back(msg);
+    order_.push_back(static_cast<unsigned char>(lane));
+  } else {
+    queue_.push_back(msg);
+  }
+  ++size_;
+  ++pushed_;
+  notEmpty_.notify_one();
+
+  return true;
+}
+
+void
+MessageQueue::flush() {
+  Lock lock(mutex_);
+
+  unsigned long target = pushed_;
+  while (running_ && processed_ < target) {
+    drained_.wait(lock);
+  }
+}
+
+std::size_t
+MessageQueue::getCapacity() const {
+  return capacity_;
+}
+
+std::size_t
+MessageQueue::getSize() const {
+  Lock lock(mutex_);
+
+  return size_;
+}
+
+unsigned long
+MessageQueue::getDropped() const {
+  Lock lock(mutex_);
+
+  return dropped_;
+}
+
+unsigned long
+MessageQueue::getEvicted() const {
+  Lock lock(mutex_);
+
+  return evicted_;
+}
+
+bool
+MessageQueue::evict(int priority) {
+  const int upper = laneOf(priority);
+  for (int lane = 0; lane < upper; ++lane) {
+    if (!lanes_[lane].empty()) {
+      // its entry in order_ is skipped when the lanes are drained
+      lanes_[lane].pop_front();
+      ++skipped_[lane];
+      --size_;
+      ++processed_;
+      ++evicted_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+MessageQueue::run() {
+  Batch batch;
+  Batch lanes[LANES];
+  std::size_t skipped[LANES];
+  std::deque<unsigned char> order;
+
+  for (;;) {
+    {
+      Lock lock(mutex_);
+      while (running_ && 0 == size_) {
+        notEmpty_.wait(lock);
+      }
+      if (0 == size_) {
+        // stop() has been called and everything is drained
+        break;
+      }
+      size_ = 0;
+      if (OVERFLOW_DROP_LOWEST == policy_) {
+        for (int lane = 0; lane < LANES; ++lane) {
+          lanes[lane].swap(lanes_[lane]);
+          skipped[lane] = skipped_[lane];
+          skipped_[lane] = 0;
+        }
+        order.swap(order_);
+      } else {
+        batch.swap(queue_);
+      }
+    }
+    notFull_.notify_all();
+    if (OVERFLOW_DROP_LOWEST == policy_) {
+      // the batch is rebuilt out of the lock
+      mergeLanes(lanes, skipped, order, batch);
+      order.clear();
+    }
+
+    try {
+      consumer_(batch);
+    } catch (...) {
+      // an exception must not kill the writer thread
+    }
+
+    {
+      Lock lock(mutex_);
+      processed_ += batch.size();
+    }
+    batch.clear();
+    drained_.notify_all();
+  }
+
+  drained_.notify_all();
+}
+
+} /* namespace dadi */
@@ -0,0 +1,99 @@
+/**
+ * @file   MessageStream.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  per-thread reusable message builder
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/MessageStream.hh"
+#include <vector>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace dadi {
+
+namespace io = boost::iostreams;
+
+struct MessageStream::Level : public boost::noncopyable {
+  Level() : os(io::back_inserter(text)) {}
+
+  std::string text; /**< formatted text */
+  io::stream<io::back_insert_device<std::string> > os; /**< appends to text */
+  Message msg; /**< recycled message */
+};
+
+namespace {
+/**
+ * @struct Arena
+ * @brief stack of levels owned by a thread
+ */
+struct Arena : public boost::noncopyable {
+  Arena() : depth(0) {}
+
+  ~Arena() {
+    std::vector<MessageStream::Level *>::iterator it = levels.begin();
+    for (; it != levels.end(); ++it) {
+      delete *it;
+    }
+  }
+
+  std::vector<MessageStream::Level *> levels; /**< allocated levels */
+  std::size_t depth; /**< levels in use */
+};
+
+boost::thread_specific_ptr<Arena> arenas;
+} /* namespace */
+
+MessageStream::MessageStream(const std::string& src,
+                             Message::Priority prio,
+                             const char *file,
+                             int line) {
+  Arena *arena = arenas.get();
+  if (!arena) {
+    arena = new Arena;
+    arenas.reset(arena);
+  }
+
+  if (arena->levels.size() == arena->depth) {
+    arena->levels.push_back(new Level);
+  }
+  level_ = arena->levels[arena->depth++];
+
+  // reset formatting state left by the previous message
+  std::ostream& os = level_->os;
+  os.clear();
+  os.flags(std::ios_base::skipws | std::ios_base::dec);
+  os.precision(6);
+  os.width(0);
+  os.fill(' ');
+  level_->text.clear();
+
+  Message& msg = level_->msg;
+  msg.setSource(src);
+  msg.setPriority(prio);
+  msg.setTime(Clock::now());
+  msg.setFile(file);
+  msg.setLine(line);
+  msg.clearTags();
+}
+
+MessageStream::~MessageStream() {
+  --(arenas.get()->depth);
+}
+
+std::ostream&
+MessageStream::stream() {
+  return level_->os;
+}
+
+const Message&
+MessageStream::message() {
+  level_->os.flush();
+  level_->msg.setText(level_->text);
+  return level_->msg;
+}
+
+} /* namespace dadi */
@@ -9,38 +9,124 @@
  */
 
 #include "dadi/Logging/MultiChannel.hh"
+#include <boost/bind.hpp>
 #include <boost/thread/locks.hpp>
+#include "dadi/Logging/Clock.hh"
 #include "dadi/Logging/Message.hh"
 
 typedef boost::lock_guard<boost::mutex> Lock;
 
 namespace dadi {
 
-MultiChannel::MultiChannel() {}
+MultiChannel::Sink::Sink(ChannelPtr channel)
+  : channel(channel), delivered(0), dropped(0), time(0) {}
+
+MultiChannel::Sink::~Sink() {
+  if (queue) {
+    queue->stop();
+  }
+}
+
+void
+MultiChannel::Sink::log(const Message& msg) {
+  if (queue) {
+    if (!queue->push(msg)) {
+      dropped.fetch_add(1, boost::memory_order_relaxed);
+    }
+    return;
+  }
+
+  boost::int64_t start = Clock::monotonic();
+  channel->log(msg);
+  time.fetch_add(Clock::monotonic() - start, boost::memory_order_relaxed);
+  delivered.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void
+MultiChannel::Sink::write(const MessageQueue::Batch& batch) {
+  boost::int64_t start = Clock::monotonic();
+  MessageQueue::Batch::const_iterator it = batch.begin();
+  for (; it != batch.end(); ++it) {
+    channel->log(*it);
+  }
+  time.fetch_add(Clock::monotonic() - start, boost::memory_order_relaxed);
+  delivered.fetch_add(batch.size(), boost::memory_order_relaxed);
+}
+
+void
+MultiChannel::Sink::flush() {
+  if (queue) {
+    queue->flush();
+  }
+  channel->flush();
+}
+
+/*****************************************************************************/
+
+MultiChannel::MultiChannel() : sinks_(new Sinks), pSinks_(sinks_.get()) {}
 
 MultiChannel::~MultiChannel() {}
 
 void
 MultiChannel::addChannel(ChannelPtr channel) {
+  if (!channel) {
+    return;
+  }
+
   Lock lock(mutex_);
+  boost::shared_ptr<Sinks> sinks(new Sinks(*sinks_));
+  sinks->push_back(SinkPtr(new Sink(channel)));
+  publish(sinks);
+}
 
-  if (channel) {
-    channels_.push_back(channel);
+void
+MultiChannel::addChannel(ChannelPtr channel, std::size_t capacity,
+                         int policy) {
+  if (!channel) {
+    return;
   }
+
+  SinkPtr sink(new Sink(channel));
+  sink->queue.reset(new MessageQueue(boost::bind(&Sink::write, sink.get(), _1),
+                                     capacity, policy));
+  sink->queue->start();
+
+  Lock lock(mutex_);
+  boost::shared_ptr<Sinks> sinks(new Sinks(*sinks_));
+  sinks->push_back(sink);
+  publish(sinks);
 }
 
 void
 MultiChannel::removeChannel(ChannelPtr channel) {
   Lock lock(mutex_);
+  boost::shared_ptr<Sinks> sinks(new Sinks);
+  Sinks removed;
+  sinks->reserve(sinks_->size());
+  Sinks::const_iterator it = sinks_->begin();
+  for (; it != sinks_->end(); ++it) {
+    if ((*it)->channel != channel) {
+      sinks->push_back(*it);
+    } else {
+      removed.push_back(*it);
+    }
+  }
+  publish(sinks);
 
-  channels_.remove(channel);
+  // no thread logs through removed sinks anymore: drain them here
+  for (it = removed.begin(); it != removed.end(); ++it) {
+    if ((*it)->queue) {
+      (*it)->queue->stop();
+    }
+  }
 }
 
 void
 MultiChannel::log(const Message& msg) {
-  Lock lock(mutex_);
-  Channels::iterator it = channels_.begin();
-  for (;it != channels_.end(); ++it) {
+  Epoch::Guard guard(epoch_);
+  const Sinks *sinks = pSinks_.load();
+  Sinks::const_iterator it = sinks->begin();
+  for (; it != sinks->end(); ++it) {
     (*it)->log(msg);
   }
 }
@@ -51,9 +137,54 @@ MultiChannel::open() {}
 void
 MultiChannel::close() {}
 
+void
+MultiChannel::flush() {
+  // channels may block: not done under a guard
+  SinksPtr sinks;
+  {
+    Lock lock(mutex_);
+    sinks = sinks_;
+  }
+  Sinks::const_iterator it = sinks->begin();
+  for (; it != sinks->end(); ++it) {
+    (*it)->flush();
+  }
+}
+
 int
 MultiChannel::getCount() const {
-  return channels_.size();
+  Lock lock(mutex_);
+
+  return sinks_->size();
+}
+
+MultiChannel::Statistics
+MultiChannel::getStatistics(ChannelPtr channel) const {
+  Lock lock(mutex_);
+
+  Statistics stats;
+  Sinks::const_iterator it = sinks_->begin();
+  for (; it != sinks_->end(); ++it) {
+    if ((*it)->channel == channel) {
+      stats.delivered += (*it)->delivered.load(boost::memory_order_relaxed);
+      stats.dropped += (*it)->dropped.load(boost::memory_order_relaxed);
+      if ((*it)->queue) {
+        // evicted messages are lost as well
+        stats.dropped += (*it)->queue->getEvicted();
+      }
+      stats.time += (*it)->time.load(boost::memory_order_relaxed);
+    }
+  }
+  return stats;
+}
+
+void
+MultiChannel::publish(const SinksPtr& sinks) {
+  SinksPtr previous = sinks_;
+  sinks_ = sinks;
+  pSinks_.store(sinks.get());
+  // released once no thread logs through it
+  epoch_.synchronize();
 }
 
 } /* namespace dadi */
@@ -8,42 +8,233 @@
  */
 
 #include "dadi/Logging/PurgeStrategy.hh"
+#include <algorithm>
+#include <cctype>
+#include <ctime>
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
+#include "dadi/Logging/Clock.hh"
 
 namespace dadi {
 
 namespace bfs = boost::filesystem;
 
-boost::format PurgeStrategy::regexTpl("");
+namespace {
+const boost::int64_t NSECS_PER_SEC = 1000000000;
+const std::string DEFAULT_PATTERN("(?<seq>\\d+)(?:\\.[[:alnum:]]+)?");
+const std::string STAGING_TAG("rotating.");
+// case insensitive
+const boost::regex regSz("(?i)(?<nb>\\d+)(?<mul>k|m|g)?", boost::regex::perl);
 
-PurgeStrategy::PurgeStrategy() {}
+// compare names, sequences of digits being compared as numbers
+bool
+lessNatural(const std::string& s1, const std::string& s2) {
+  std::string::size_type i = 0;
+  std::string::size_type j = 0;
+  while (i < s1.size() && j < s2.size()) {
+    if (std::isdigit(static_cast<unsigned char>(s1[i])) &&
+        std::isdigit(static_cast<unsigned char>(s2[j]))) {
+      std::string::size_type i2 = s1.find_first_not_of("0123456789", i);
+      std::string::size_type j2 = s2.find_first_not_of("0123456789", j);
+      i2 = (std::string::npos == i2) ? s1.size() : i2;
+      j2 = (std::string::npos == j2) ? s2.size() : j2;
+      if (i2 - i != j2 - j) {
+        return (i2 - i < j2 - j);
+      }
+      int cmp = s1.compare(i, i2 - i, s2, j, j2 - j);
+      if (cmp) {
+        return (cmp < 0);
+      }
+      i = i2;
+      j = j2;
+    } else {
+      if (s1[i] != s2[j]) {
+        return (s1[i] < s2[j]);
+      }
+      ++i;
+      ++j;
+    }
+  }
+  return (s1.size() - i < s2.size() - j);
+}
 
-PurgeStrategy::~PurgeStrategy() {}
+// functor: sort entries from the oldest to the newest
+class OlderThan {
+public:
+  bool
+  operator()(const ArchiveIndex::Entry& e1, const ArchiveIndex::Entry& e2) {
+    if (e1.mtime != e2.mtime) {
+      return (e1.mtime < e2.mtime);
+    }
+    // file system timestamps are coarse: rely on archive names
+    if (e1.key != e2.key) {
+      return lessNatural(e1.key, e2.key);
+    }
+    return (e1.seq > e2.seq);
+  }
+};
+} /* namespace */
+
+ArchiveIndex::ArchiveIndex()
+  : regArchive_(new boost::regex(DEFAULT_PATTERN, boost::regex::perl)),
+    totalSize_(0), loaded_(false) {}
 
 void
-PurgeStrategy::list(const std::string& basename,
-                    std::vector<std::string>& paths) {
+ArchiveIndex::setPattern(const std::string& pattern) {
+  regArchive_.reset(new boost::regex(pattern, boost::regex::perl));
+}
+
+void
+ArchiveIndex::load(const std::string& basename) {
+  entries_.clear();
+  totalSize_ = 0;
+
   const bfs::path& logFile = bfs::absolute(basename);
-  const bfs::path& logDir = logFile.parent_path();
-  const bfs::directory_iterator dir(logDir);
-  bfs::directory_iterator it(logDir), end;
-
-  regexTpl.clear();
-  regexTpl % logFile.native();
-  boost::regex reg(regexTpl.str(), boost::regex::perl);
-
-  for (; it != end; ++it) {
-    const bfs::path& p = it->path();
-    const std::string& path = p.string();
-    if (boost::regex_match(path, reg)) {
-      paths.push_back(path);
+  prefix_ = logFile.filename().string() + ".";
+  // files being compressed (.tmp) or set aside by rotations do not match
+  boost::system::error_code ec;
+  bfs::directory_iterator it(logFile.parent_path(), ec), end;
+  for (; !ec && it != end; it.increment(ec)) {
+    Entry entry;
+    if (match(*regArchive_, it->path().filename().string(), entry) &&
+        stat(it->path().string(), entry)) {
+      entries_.push_back(entry);
+      totalSize_ += entry.size;
     }
   }
+
+  std::sort(entries_.begin(), entries_.end(), OlderThan());
+  loaded_ = true;
+}
+
+void
+ArchiveIndex::invalidate() {
+  entries_.clear();
+  totalSize_ = 0;
+  loaded_ = false;
+}
+
+bool
+ArchiveIndex::isLoaded() const {
+  return loaded_;
+}
+
+void
+ArchiveIndex::add(const std::string& path) {
+  Entry entry;
+  entry.seq = -1;
+  if (!stat(path, entry)) {
+    return;
+  }
+  // sort keys only matter for archives modified within the same second
+  match(*regArchive_, bfs::path(path).filename().string(), entry);
+  entries_.push_back(entry);
+  totalSize_ += entry.size;
+}
+
+void
+ArchiveIndex::removeOldest() {
+  if (entries_.empty()) {
+    return;
+  }
+  boost::system::error_code ec;
+  bfs::remove(entries_.front().path, ec);
+  totalSize_ -= entries_.front().size;
+  entries_.pop_front();
+}
+
+std::size_t
+ArchiveIndex::getCount() const {
+  return entries_.size();
+}
+
+boost::uintmax_t
+ArchiveIndex::getTotalSize() const {
+  return totalSize_;
+}
+
+const ArchiveIndex::Entry&
+ArchiveIndex::getOldest() const {
+  return entries_.front();
+}
+
+bool
+ArchiveIndex::stat(const std::string& path, Entry& entry) {
+  boost::system::error_code ec;
+  if (!bfs::is_regular_file(path, ec)) {
+    return false;
+  }
+  entry.size = bfs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+  const std::time_t mtime = bfs::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  entry.path = path;
+  entry.mtime = static_cast<boost::int64_t>(mtime) * NSECS_PER_SEC;
+  return true;
+}
+
+bool
+ArchiveIndex::match(const boost::regex& regArchive, const std::string& name,
+                    Entry& entry) const {
+  if ((name.size() <= prefix_.size()) ||
+      (0 != name.compare(0, prefix_.size(), prefix_)) ||
+      (0 == name.compare(prefix_.size(), STAGING_TAG.size(), STAGING_TAG))) {
+    return false;
+  }
+
+  boost::smatch res;
+  if (!boost::regex_match(name.begin() + prefix_.size(), name.end(), res,
+                          regArchive)) {
+    return false;
+  }
+  entry.key = res["key"];
+  entry.seq = res["seq"].matched
+    ? boost::lexical_cast<long>(res["seq"]) : -1;
+  return true;
+}
+
+/*****************************************************************************/
+
+PurgeStrategy::PurgeStrategy() {}
+
+PurgeStrategy::~PurgeStrategy() {}
+
+void
+PurgeStrategy::load(const std::string& path) {
+  index_.load(path);
 }
 
 void
-PurgeStrategy::sort(std::vector<std::string>& paths) {}
+PurgeStrategy::setPattern(const std::string& pattern) {
+  index_.setPattern(pattern);
+  index_.invalidate();
+}
+
+void
+PurgeStrategy::add(const std::string& archive) {
+  // archives are picked up when the index is loaded
+  if (index_.isLoaded()) {
+    index_.add(archive);
+  }
+}
+
+void
+PurgeStrategy::invalidate() {
+  index_.invalidate();
+}
+
+ArchiveIndex&
+PurgeStrategy::getIndex(const std::string& path) {
+  if (!index_.isLoaded()) {
+    index_.load(path);
+  }
+  return index_;
+}
 
 /*****************************************************************************/
 PurgeByCountStrategy::PurgeByCountStrategy(unsigned int count)
@@ -51,37 +242,62 @@ PurgeByCountStrategy::PurgeByCountStrategy(unsigned int count)
 
 PurgeByCountStrategy::~PurgeByCountStrategy() {}
 
-// functor: sort files by age from the newest to the oldest
-class SortFilesByAge {
-public:
-  bool
-  operator()(const std::string& path1, const std::string& path2) {
-    std::time_t t1(bfs::last_write_time(path1));
-    std::time_t t2(bfs::last_write_time(path2));
-    return (t1 < t2);
+void
+PurgeByCountStrategy::purge(const std::string& path) {
+  ArchiveIndex& index = getIndex(path);
+  while (index.getCount() > count_) {
+    index.removeOldest();
   }
-};
+}
+
+/*****************************************************************************/
+PurgeByAgeStrategy::PurgeByAgeStrategy(
+  const boost::posix_time::time_duration& age)
+  : age_(age.total_microseconds() * 1000) {}
+
+PurgeByAgeStrategy::~PurgeByAgeStrategy() {}
 
 void
-PurgeByCountStrategy::sort(std::vector<std::string>& paths) {
-  std::sort(paths.begin(), paths.end(), SortFilesByAge());
+PurgeByAgeStrategy::purge(const std::string& path) {
+  ArchiveIndex& index = getIndex(path);
+  const boost::int64_t limit = Clock::now().wall - age_;
+  while (index.getCount() && (index.getOldest().mtime < limit)) {
+    index.removeOldest();
+  }
 }
 
-void
-PurgeByCountStrategy::purge(const std::string& path) {
-  std::vector<std::string> archives;
-  list(path, archives);
-  // no archives to delete, return early
-  if (archives.size() < count_) {
-    return;
+/*****************************************************************************/
+PurgeBySizeStrategy::PurgeBySizeStrategy(const std::string& size) {
+  boost::smatch res;
+  boost::regex_match(size, res, regSz);
+
+  size_ = boost::lexical_cast<boost::uintmax_t>(res["nb"]);
+
+  if (res["mul"].matched) {
+    char mul = res["mul"].str()[0];
+    if ('k' == mul || 'K' == mul) {
+      size_ *= 1024;
+    } else if ('m' == mul || 'M' == mul) {
+      size_ *= 1024*1024;
+    } else if ('g' == mul || 'G' == mul) {
+      size_ *= 1024*1024*1024;
+    }
   }
+}
+
+PurgeBySizeStrategy::~PurgeBySizeStrategy() {}
 
-  sort(archives);
-  std::vector<std::string>::const_iterator it = archives.begin();
-  it += count_;
-  for (; it != archives.end(); ++it) {
-    bfs::remove(*it);
+void
+PurgeBySizeStrategy::purge(const std::string& path) {
+  ArchiveIndex& index = getIndex(path);
+  while (index.getCount() && (index.getTotalSize() > size_)) {
+    index.removeOldest();
   }
 }
 
+boost::uintmax_t
+PurgeBySizeStrategy::getMaxSize() const {
+  return size_;
+}
+
 } /* namespace dadi */
@@ -0,0 +1,81 @@
+/**
+ * @file   RateLimiter.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  RateLimiter implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/RateLimiter.hh"
+
+namespace dadi {
+
+RateLimiter::RateLimiter(double rate, unsigned long burst)
+  : interval_(0), tolerance_(0), tat_(0), nextSummary_(0), enlisted_(false) {
+  for (int i = 0; i < PRIORITIES; ++i) {
+    suppressed_[i].store(0, boost::memory_order_relaxed);
+  }
+  setRate(rate, burst);
+}
+
+void
+RateLimiter::setRate(double rate, unsigned long burst) {
+  if (0 == burst) {
+    burst = 1;
+  }
+  boost::int64_t interval = 0;
+  if (rate > 0.0) {
+    interval = static_cast<boost::int64_t>(1e9 / rate);
+    if (0 == interval) {
+      interval = 1;
+    }
+  }
+
+  tat_.store(0, boost::memory_order_relaxed);
+  tolerance_.store(interval * (burst - 1), boost::memory_order_relaxed);
+  interval_.store(interval, boost::memory_order_relaxed);
+}
+
+bool
+RateLimiter::isEnabled() const {
+  return 0 != interval_.load(boost::memory_order_relaxed);
+}
+
+unsigned long
+RateLimiter::takeSuppressed(boost::int64_t now, boost::int64_t period,
+                            int& priority) {
+  bool pending = false;
+  for (int i = 0; !pending && (i < PRIORITIES); ++i) {
+    pending = (0 != suppressed_[i].load(boost::memory_order_relaxed));
+  }
+  if (!pending) {
+    return 0;
+  }
+
+  // a single thread wins the summary
+  boost::int64_t next = nextSummary_.load(boost::memory_order_relaxed);
+  if ((now < next) ||
+      !nextSummary_.compare_exchange_strong(next, now + period,
+                                            boost::memory_order_relaxed)) {
+    return 0;
+  }
+
+  return takeSuppressed(priority);
+}
+
+unsigned long
+RateLimiter::takeSuppressed(int& priority) {
+  unsigned long count = 0;
+  priority = Message::PRIO_TRACE;
+  for (int i = 0; i < PRIORITIES; ++i) {
+    unsigned long n = suppressed_[i].exchange(0, boost::memory_order_relaxed);
+    if (n) {
+      count += n;
+      priority = Message::PRIO_TRACE + i;
+    }
+  }
+  return count;
+}
+
+} /* namespace dadi */
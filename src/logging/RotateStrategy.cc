@@ -9,6 +9,7 @@
 
 #include "dadi/Logging/RotateStrategy.hh"
 #include <boost/filesystem.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/date_time/gregorian/gregorian_types.hpp>
 #include <boost/lexical_cast.hpp>
@@ -25,12 +26,37 @@ const ptime::time_duration RotateByTimeStrategy::MIDNIGHT(0, 0, 0);
 // case insensitive
 const boost::regex regSz("(?i)(?<nb>\\d+)(?<mul>k|m|g)?", boost::regex::perl);
 
+namespace {
+const boost::int64_t NSECS_PER_SEC = 1000000000;
+const ptime::ptime epoch(gtime::date(1970, 1, 1));
+
+boost::int64_t
+toNsecs(const ptime::ptime& time) {
+  return (time - epoch).total_microseconds() * 1000;
+}
+
+ptime::ptime
+fromNsecs(boost::int64_t nsecs) {
+  return epoch + ptime::microseconds(nsecs / 1000);
+}
+} /* namespace */
+
 /*****************************************************************************/
 
 RotateStrategy::RotateStrategy() {}
 
 RotateStrategy::~RotateStrategy() {}
 
+long
+RotateStrategy::getMaxSize() const {
+  return -1;
+}
+
+boost::int64_t
+RotateStrategy::getNextRotation(boost::int64_t now) const {
+  return -1;
+}
+
 /*****************************************************************************/
 
 RotateBySizeStrategy::RotateBySizeStrategy(const std::string& size) {
@@ -63,6 +89,11 @@ RotateBySizeStrategy::mustRotate(const std::string& path) {
   }
 }
 
+long
+RotateBySizeStrategy::getMaxSize() const {
+  return size_;
+}
+
 /*****************************************************************************/
 
 // always use UTC internally (and i mean it !)
@@ -85,12 +116,19 @@ RotateByIntervalStrategy::mustRotate(const std::string& path) {
   }
 }
 
+boost::int64_t
+RotateByIntervalStrategy::getNextRotation(boost::int64_t now) const {
+  // second resolution, like mustRotate
+  return (now / NSECS_PER_SEC) * NSECS_PER_SEC +
+    td_.total_microseconds() * 1000;
+}
+
 /*****************************************************************************/
 
 RotateByTimeStrategy::RotateByTimeStrategy(const ptime::time_duration& td,
                                            unsigned int day)
-  : td_(td), utc_(false), day_(day) {
-  if ((0 > day_) && (6 < day_)) {
+  : td_(td), utc_(false), day_(day), next_(-1) {
+  if (6 < day_) {
     day_ = EVERYDAY;
   }
 }
@@ -99,28 +137,54 @@ RotateByTimeStrategy::~RotateByTimeStrategy() {}
 
 bool
 RotateByTimeStrategy::mustRotate(const std::string& path) {
-  int currentDay;
-  ptime::time_duration currentTime;
-  // TODO: fugly
-  if (utc_) {
-    currentDay = gtime::day_clock::universal_day().day_of_week().as_number();
-    currentTime = ptime::second_clock::universal_time().time_of_day();
-  } else {
-    currentDay = gtime::day_clock::local_day().day_of_week().as_number();
-    currentTime = ptime::second_clock::local_time().time_of_day();
+  boost::int64_t now = toNsecs(ptime::second_clock::universal_time());
+  if (0 > next_) {
+    next_ = getNextRotation(now);
   }
 
-  if (((day_ == currentDay) || (day_ == EVERYDAY)) &&
-      (currentTime >= td_)) {
-    return true;
-  } else {
+  // fire once per scheduled boundary
+  if (now < next_) {
     return false;
   }
+  next_ = getNextRotation(now);
+  return true;
+}
+
+boost::int64_t
+RotateByTimeStrategy::getNextRotation(boost::int64_t now) const {
+  ptime::ptime utcNow = fromNsecs(now);
+  ptime::time_duration offset(0, 0, 0);
+  if (!utc_) {
+    offset = boost::date_time::c_local_adjustor<ptime::ptime>::utc_to_local(
+      utcNow) - utcNow;
+  }
+  ptime::ptime current = utcNow + offset;
+
+  ptime::ptime next(current.date(), td_);
+  if (EVERYDAY == day_) {
+    if (next <= current) {
+      next += gtime::days(1);
+    }
+  } else {
+    int today = current.date().day_of_week().as_number();
+    next += gtime::days((day_ + 7 - today) % 7);
+    if (next <= current) {
+      next += gtime::days(7);
+    }
+  }
+
+  return toNsecs(next - offset);
 }
 
 void
-RotateByTimeStrategy::setLocal(bool utc) {
+RotateByTimeStrategy::setUtc(bool utc) {
   utc_ = utc;
+  next_ = -1;
+}
+
+void
+RotateByTimeStrategy::setLocal(bool utc) {
+  setUtc(utc);
 }
 
 } /* namespace dadi */
@@ -50,6 +50,7 @@ SyslogChannel::open() {
     facility_ = tmp;
   } catch (...) {}
 
+  setFormatter();
   openlog(name_.c_str(), option_, facility_);
   open_ = true;
 }
@@ -66,7 +67,7 @@ SyslogChannel::log(const Message& msg) {
   if (!open_) {
     open();
   }
-  syslog(getPrio(msg), "%s", msg.getText().c_str());
+  syslog(getPrio(msg), "%s", format(msg).c_str());
 }
 
 
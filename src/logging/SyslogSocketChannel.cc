@@ -0,0 +1,476 @@
+/**
+ * @file   SyslogSocketChannel.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  SyslogSocketChannel implementation
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include "dadi/Logging/SyslogSocketChannel.hh"
+#include <netdb.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+#include "dadi/Logging/Message.hh"
+#include "dadi/Logging/SyslogChannel.hh"
+#include "dadi/Exception/All.hh"
+
+namespace dadi {
+
+typedef boost::lock_guard<boost::mutex> Lock;
+
+const std::string SyslogSocketChannel::ATTR_ADDRESS = std::string("address");
+const std::string SyslogSocketChannel::ATTR_FORMAT = std::string("format");
+const std::string SyslogSocketChannel::ATTR_NAME = std::string("name");
+const std::string SyslogSocketChannel::ATTR_FACILITY =
+  std::string("facility");
+const std::string SyslogSocketChannel::ATTR_HOSTNAME =
+  std::string("hostname");
+const std::string SyslogSocketChannel::ATTR_SD_ID = std::string("sd_id");
+const std::string SyslogSocketChannel::ATTR_MAX_SIZE =
+  std::string("max_size");
+const std::string SyslogSocketChannel::ATTR_ASYNC = std::string("async");
+const std::string SyslogSocketChannel::ATTR_ASYNC_QUEUE_SIZE =
+  std::string("async.queue_size");
+const std::string SyslogSocketChannel::ATTR_ASYNC_OVERFLOW =
+  std::string("async.overflow");
+
+namespace {
+const char DEFAULT_ADDRESS[] = "unix:/dev/log";
+/* example enterprise number reserved for documentation (RFC 5612) */
+const char DEFAULT_SD_ID[] = "dadi@32473";
+const std::size_t DEFAULT_MAX_SIZE = 8192;
+/* maximum number of datagrams per sendmmsg() */
+const std::size_t MAX_BATCH = 64;
+const char NILVALUE[] = "-";
+const char *months[] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* per-thread rendering state, reused across messages */
+struct Render {
+  Render() : sec5424(-1), sec3164(-1) {}
+
+  std::string line; /**< rendered message */
+  std::time_t sec5424; /**< second of stamp5424 */
+  std::string stamp5424; /**< YYYY-MM-DDTHH:MM:SS (UTC) */
+  std::time_t sec3164; /**< second of stamp3164 */
+  std::string stamp3164; /**< Mmm dd HH:MM:SS (local time) */
+};
+
+boost::thread_specific_ptr<Render> renders;
+
+Render&
+getRender() {
+  Render *render = renders.get();
+  if (!render) {
+    render = new Render;
+    renders.reset(render);
+  }
+  return *render;
+}
+
+/* header fields are printable US-ASCII without spaces, nil if empty */
+std::string
+sanitize(const std::string& field, std::size_t size) {
+  if (field.empty()) {
+    return NILVALUE;
+  }
+  std::string res(field, 0, size);
+  for (std::string::iterator it = res.begin(); it != res.end(); ++it) {
+    if ((*it < 33) || (*it > 126)) {
+      *it = '_';
+    }
+  }
+  return res;
+}
+
+/* SD-NAME: 1 to 32 printable characters except '=', ' ', ']' and '"' */
+void
+appendName(std::string& out, const std::string& name) {
+  if (name.empty()) {
+    out.push_back('_');
+    return;
+  }
+  std::string::size_type end = std::min<std::string::size_type>(name.size(),
+                                                                 32);
+  for (std::string::size_type i = 0; i < end; ++i) {
+    char c = name[i];
+    bool valid = (c > 32) && (c < 127) && ('=' != c) && (']' != c) &&
+      ('"' != c);
+    out.push_back(valid ? c : '_');
+  }
+}
+
+/* PARAM-VALUE: '"', '\' and ']' are escaped */
+void
+appendValue(std::string& out, const std::string& value) {
+  for (std::string::const_iterator it = value.begin();
+       it != value.end(); ++it) {
+    if (('"' == *it) || ('\\' == *it) || (']' == *it)) {
+      out.push_back('\\');
+    }
+    out.push_back(*it);
+  }
+}
+
+std::string
+getDefaultHostname() {
+  char buf[256];
+  if (0 != ::gethostname(buf, sizeof(buf))) {
+    return std::string();
+  }
+  buf[sizeof(buf) - 1] = '\0';
+  return std::string(buf);
+}
+
+std::string
+getDefaultName() {
+#ifdef __GLIBC__
+  return std::string(program_invocation_short_name);
+#else
+  return std::string();
+#endif
+}
+} /* namespace */
+
+SyslogSocketChannel::SyslogSocketChannel()
+  : format_(FORMAT_RFC5424), facility_(SyslogChannel::SYSLOG_USER),
+    maxSize_(DEFAULT_MAX_SIZE), fd_(-1), addrLen_(0), open_(false) {}
+
+SyslogSocketChannel::SyslogSocketChannel(const std::string& address,
+                                         int format)
+  : address_(address), format_(format),
+    facility_(SyslogChannel::SYSLOG_USER), maxSize_(DEFAULT_MAX_SIZE),
+    fd_(-1), addrLen_(0), open_(false) {}
+
+SyslogSocketChannel::~SyslogSocketChannel() {
+  if (pQueue_) {
+    pQueue_->stop();
+  }
+  if (-1 != fd_) {
+    ::close(fd_);
+  }
+}
+
+void
+SyslogSocketChannel::open() {
+  Lock lock(mutex_);
+
+  if (open_.load(boost::memory_order_acquire)) {
+    return;
+  }
+
+  if (address_.empty()) {
+    address_ = getAttr<std::string>(ATTR_ADDRESS, DEFAULT_ADDRESS);
+  }
+  const std::string& format = getAttr<std::string>(ATTR_FORMAT, "");
+  if ("rfc3164" == format) {
+    format_ = FORMAT_RFC3164;
+  } else if ("rfc5424" == format) {
+    format_ = FORMAT_RFC5424;
+  } else if (!format.empty()) {
+    BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                          << errinfo_msg("invalid syslog format: " + format));
+  }
+  facility_ = getAttr<unsigned int>(ATTR_FACILITY, facility_);
+  maxSize_ = getAttr<std::size_t>(ATTR_MAX_SIZE, maxSize_);
+  sdId_ = sanitize(getAttr<std::string>(ATTR_SD_ID, DEFAULT_SD_ID), 32);
+  const std::string& name = getAttr<std::string>(ATTR_NAME, getDefaultName());
+  const std::string& hostname =
+    getAttr<std::string>(ATTR_HOSTNAME, getDefaultHostname());
+  const std::string& pid = boost::lexical_cast<std::string>(::getpid());
+
+  // render everything that does not depend on the message once
+  pri_.clear();
+  for (int severity = 0; severity < 8; ++severity) {
+    std::string pri("<");
+    pri += boost::lexical_cast<std::string>(facility_ | severity);
+    pri += (FORMAT_RFC5424 == format_) ? ">1 " : ">";
+    pri_.push_back(pri);
+  }
+  if (FORMAT_RFC5424 == format_) {
+    // HOSTNAME APP-NAME PROCID MSGID
+    header_ = " " + sanitize(hostname, 255) + " " + sanitize(name, 48) + " "
+      + pid + " " + NILVALUE + " ";
+  } else {
+    // local daemons add the hostname themselves
+    header_ = " ";
+    if (0 == address_.compare(0, 4, "udp:")) {
+      header_ += sanitize(hostname, 255) + " ";
+    }
+    header_ += sanitize(name, 32) + "[" + pid + "]: ";
+  }
+
+  connect();
+  setFormatter();
+
+  if (getAttr<bool>(ATTR_ASYNC, false)) {
+    std::size_t size =
+      getAttr<std::size_t>(ATTR_ASYNC_QUEUE_SIZE,
+                           MessageQueue::DEFAULT_CAPACITY);
+    const std::string& overflow =
+      getAttr<std::string>(ATTR_ASYNC_OVERFLOW, "block");
+    int policy = MessageQueue::OVERFLOW_BLOCK;
+    if ("drop-newest" == overflow) {
+      policy = MessageQueue::OVERFLOW_DROP_NEWEST;
+    } else if ("drop-lowest" == overflow) {
+      policy = MessageQueue::OVERFLOW_DROP_LOWEST;
+    }
+    pQueue_.reset(new MessageQueue(
+                    boost::bind(&SyslogSocketChannel::write, this, _1),
+                    size, policy));
+    pQueue_->start();
+  }
+
+  open_.store(true, boost::memory_order_release);
+}
+
+void
+SyslogSocketChannel::close() {
+  flush();
+}
+
+void
+SyslogSocketChannel::flush() {
+  if (pQueue_) {
+    pQueue_->flush();
+  }
+}
+
+void
+SyslogSocketChannel::log(const Message& msg) {
+  if (!open_.load(boost::memory_order_acquire)) {
+    open();
+  }
+
+  if (pQueue_) {
+    pQueue_->push(msg);
+    return;
+  }
+
+  std::string& line = getRender().line;
+  line.clear();
+  render(msg, line);
+  send(line.data(), line.size());
+}
+
+int
+SyslogSocketChannel::getSeverity(const Message& msg) {
+  switch (msg.getPriority()) {
+  case Message::PRIO_TRACE:
+  case Message::PRIO_DEBUG:
+    return 7;
+  case Message::PRIO_INFORMATION:
+    return 6;
+  case Message::PRIO_WARNING:
+    return 4;
+  case Message::PRIO_ERROR:
+    return 3;
+  case Message::PRIO_CRITICAL:
+    return 2;
+  case Message::PRIO_FATAL:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+void
+SyslogSocketChannel::connect() {
+  std::memset(&addr_, 0, sizeof(addr_));
+  int family = AF_UNIX;
+
+  if (0 == address_.compare(0, 4, "udp:")) {
+    std::string::size_type pos = address_.rfind(':');
+    std::string host = address_.substr(4, pos - 4);
+    const std::string& port = address_.substr(pos + 1);
+    // [::1]:514
+    if ((host.size() > 2) && ('[' == host[0]) &&
+        (']' == host[host.size() - 1])) {
+      host = host.substr(1, host.size() - 2);
+    }
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo *res = NULL;
+    if ((pos <= 4) || host.empty() || port.empty() ||
+        (0 != ::getaddrinfo(host.c_str(), port.c_str(), &hints, &res))) {
+      BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                            << errinfo_msg("invalid syslog address: "
+                                           + address_));
+    }
+    std::memcpy(&addr_, res->ai_addr, res->ai_addrlen);
+    addrLen_ = res->ai_addrlen;
+    family = res->ai_family;
+    ::freeaddrinfo(res);
+  } else {
+    std::string path(address_);
+    if (0 == path.compare(0, 5, "unix:")) {
+      path = path.substr(5);
+    }
+    struct sockaddr_un *addr = reinterpret_cast<sockaddr_un *>(&addr_);
+    if (path.empty() || (path.size() >= sizeof(addr->sun_path))) {
+      BOOST_THROW_EXCEPTION(InvalidAttributeError()
+                            << errinfo_msg("invalid syslog address: "
+                                           + address_));
+    }
+    addr->sun_family = AF_UNIX;
+    std::memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    addrLen_ = sizeof(struct sockaddr_un);
+  }
+
+  if (-1 == fd_) {
+    fd_ = ::socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == fd_) {
+      BOOST_THROW_EXCEPTION(Error()
+                            << errinfo_msg(std::strerror(errno)));
+    }
+  }
+  // like syslog(3), a missing server is not an error: we retry on send
+  ::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr_), addrLen_);
+}
+
+void
+SyslogSocketChannel::render(const Message& msg, std::string& out) const {
+  Render& render = getRender();
+  const boost::int64_t wall = msg.getTime().wall;
+  std::time_t sec = static_cast<std::time_t>(wall / 1000000000);
+
+  out.append(pri_[getSeverity(msg)]);
+  if (FORMAT_RFC5424 == format_) {
+    if (sec != render.sec5424) {
+      struct tm tm;
+      char buf[32];
+      ::gmtime_r(&sec, &tm);
+      std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d",
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                    tm.tm_hour, tm.tm_min, tm.tm_sec);
+      render.stamp5424 = buf;
+      render.sec5424 = sec;
+    }
+    char frac[16];
+    std::snprintf(frac, sizeof(frac), ".%06dZ",
+                  static_cast<int>((wall % 1000000000) / 1000));
+    out.append(render.stamp5424);
+    out.append(frac);
+    out.append(header_);
+
+    const Tags& tags = msg.getTags();
+    if (tags.empty()) {
+      out.append(NILVALUE);
+    } else {
+      out.push_back('[');
+      out.append(sdId_);
+      for (Tags::const_iterator it = tags.begin(); it != tags.end(); ++it) {
+        out.push_back(' ');
+        appendName(out, it->first);
+        out.append("=\"");
+        appendValue(out, it->second);
+        out.push_back('"');
+      }
+      out.push_back(']');
+    }
+    out.push_back(' ');
+  } else {
+    if (sec != render.sec3164) {
+      struct tm tm;
+      char buf[32];
+      ::localtime_r(&sec, &tm);
+      std::snprintf(buf, sizeof(buf), "%s %2d %02d:%02d:%02d",
+                    months[tm.tm_mon], tm.tm_mday,
+                    tm.tm_hour, tm.tm_min, tm.tm_sec);
+      render.stamp3164 = buf;
+      render.sec3164 = sec;
+    }
+    out.append(render.stamp3164);
+    out.append(header_);
+  }
+
+  if (formatter_.isTextOnly()) {
+    out.append(msg.getText());
+  } else {
+    formatter_.format(msg, out);
+  }
+}
+
+void
+SyslogSocketChannel::send(const char *data, std::size_t size) {
+  if (size > maxSize_) {
+    size = maxSize_;
+  }
+  // the server may have been restarted: reconnect and retry once
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    ssize_t res;
+    do {
+      res = ::send(fd_, data, size, MSG_NOSIGNAL);
+    } while ((0 > res) && (EINTR == errno));
+
+    if ((0 <= res) || ((ECONNREFUSED != errno) && (ENOTCONN != errno) &&
+                       (EDESTADDRREQ != errno) && (ENOENT != errno))) {
+      return;  // like syslog(3), fail silently
+    }
+    Lock lock(mutex_);
+    ::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr_), addrLen_);
+  }
+}
+
+void
+SyslogSocketChannel::write(const MessageQueue::Batch& batch) {
+  std::vector<std::size_t> offsets;
+  offsets.reserve(batch.size() + 1);
+  batch_.clear();
+  MessageQueue::Batch::const_iterator it = batch.begin();
+  for (; it != batch.end(); ++it) {
+    offsets.push_back(batch_.size());
+    render(*it, batch_);
+  }
+  offsets.push_back(batch_.size());
+
+#ifdef __linux__
+  // one system call for up to MAX_BATCH datagrams
+  std::size_t count = batch.size();
+  std::vector<struct iovec> iov(count);
+  std::vector<struct mmsghdr> msgs(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = &batch_[0] + offsets[i];
+    iov[i].iov_len = std::min(offsets[i + 1] - offsets[i], maxSize_);
+    std::memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  std::size_t sent = 0;
+  while (sent < count) {
+    int res = ::sendmmsg(fd_, &msgs[sent],
+                         std::min(count - sent, MAX_BATCH), MSG_NOSIGNAL);
+    if (0 < res) {
+      sent += res;
+    } else if ((0 > res) && (EINTR == errno)) {
+      continue;
+    } else {
+      // reconnects, or drops the datagram
+      send(static_cast<const char *>(iov[sent].iov_base), iov[sent].iov_len);
+      ++sent;
+    }
+  }
+#else
+  for (std::size_t i = 0; i + 1 < offsets.size(); ++i) {
+    send(batch_.data() + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+#endif
+}
+
+} /* namespace dadi */
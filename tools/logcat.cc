@@ -0,0 +1,219 @@
+/**
+ * @file   tools/logcat.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  dadi-logcat: decode, filter and print binary log files
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#ifdef DADI_HAVE_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/regex.hpp>
+#include <dadi/Logging/BinaryFileChannel.hh>
+#include <dadi/Logging/Formatter.hh>
+#include <dadi/Logging/Message.hh>
+#include <dadi/Exception/All.hh>
+
+namespace io = boost::iostreams;
+namespace po = boost::program_options;
+namespace pt = boost::posix_time;
+
+namespace {
+const char *priorities[] = {
+  "trace", "debug", "information", "warning", "error", "critical", "fatal"
+};
+
+/* messages printed, all criteria are optional */
+struct Filter {
+  Filter() : priority(dadi::Message::PRIO_TRACE), hasSource(false),
+             since(0), until(0) {}
+
+  bool
+  accept(const dadi::Message& msg) const {
+    boost::int64_t wall = msg.getTime().wall;
+    return (msg.getPriority() >= priority) &&
+      (!since || (wall >= since)) && (!until || (wall < until)) &&
+      (!hasSource || boost::regex_match(msg.getSource(), source));
+  }
+
+  int priority; /**< minimum priority */
+  bool hasSource; /**< true if source is set */
+  boost::regex source; /**< sources regular expression */
+  boost::int64_t since; /**< oldest message (ns since epoch, 0: none) */
+  boost::int64_t until; /**< newest message excluded (ns, 0: none) */
+};
+
+int
+parsePriority(const std::string& value) {
+  for (int i = 0; i < 7; ++i) {
+    if (boost::starts_with(priorities[i], value) && !value.empty()) {
+      return i + dadi::Message::PRIO_TRACE;
+    }
+  }
+  int prio = boost::lexical_cast<int>(value);
+  if ((prio < dadi::Message::PRIO_TRACE) ||
+      (prio > dadi::Message::PRIO_FATAL)) {
+    throw std::runtime_error("invalid priority: " + value);
+  }
+  return prio;
+}
+
+/* YYYY-MM-DD HH:MM:SS[.ffffff] (UTC) to ns since epoch */
+boost::int64_t
+parseTime(const std::string& value) {
+  static const pt::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  pt::ptime time = pt::time_from_string(value);
+  if (time.is_special()) {
+    throw std::runtime_error("invalid time: " + value);
+  }
+  return (time - epoch).total_microseconds() * 1000;
+}
+
+/* archives are decompressed according to their extension */
+void
+pushDecompressor(io::filtering_istream& in, const std::string& path) {
+  if (boost::ends_with(path, ".bz2")) {
+    in.push(io::bzip2_decompressor());
+  } else if (boost::ends_with(path, ".gz")) {
+    in.push(io::gzip_decompressor());
+  } else if (boost::ends_with(path, ".z")) {
+    in.push(io::zlib_decompressor());
+#ifdef DADI_HAVE_ZSTD
+  } else if (boost::ends_with(path, ".zst")) {
+    in.push(io::zstd_decompressor());
+#endif
+  }
+}
+
+/* returns false if input is truncated */
+bool
+cat(std::istream& in, const Filter& filter, const dadi::Formatter& formatter,
+    std::string& line) {
+  dadi::BinaryLogReader reader(in);
+  dadi::Message msg;
+  while (reader.next(msg)) {
+    if (!filter.accept(msg)) {
+      continue;
+    }
+    line.clear();
+    formatter.format(msg, line);
+    line.push_back('\n');
+    std::cout.write(line.data(), line.size());
+  }
+  return !reader.isTruncated();
+}
+} /* namespace */
+
+int
+main(int argc, char *argv[]) {
+  Filter filter;
+  std::string pattern;
+  std::vector<std::string> files;
+
+  po::options_description desc("usage: dadi-logcat [options] [file...]\n"
+                               "options");
+  desc.add_options()
+    ("help,h", "display help message")
+    ("priority,p", po::value<std::string>(),
+     "minimum priority (trace, debug, information, warning, error, "
+     "critical, fatal)")
+    ("source,s", po::value<std::string>(),
+     "sources regular expression (whole source must match)")
+    ("since", po::value<std::string>(),
+     "oldest message time (UTC): YYYY-MM-DD HH:MM:SS[.ffffff]")
+    ("until", po::value<std::string>(),
+     "newest message time, excluded (UTC)")
+    ("format,f", po::value<std::string>(&pattern)
+     ->default_value("%T %p %s: %m"), "output pattern (see Formatter)")
+    ("file", po::value<std::vector<std::string> >(&files),
+     "binary log files (standard input if none or -)");
+  po::positional_options_description positional;
+  positional.add("file", -1);
+
+  try {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc)
+              .positional(positional).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return EXIT_SUCCESS;
+    }
+    if (vm.count("priority")) {
+      filter.priority = parsePriority(vm["priority"].as<std::string>());
+    }
+    if (vm.count("source")) {
+      filter.source = boost::regex(vm["source"].as<std::string>());
+      filter.hasSource = true;
+    }
+    if (vm.count("since")) {
+      filter.since = parseTime(vm["since"].as<std::string>());
+    }
+    if (vm.count("until")) {
+      filter.until = parseTime(vm["until"].as<std::string>());
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "dadi-logcat: " << e.what() << "\n" << desc << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (files.empty()) {
+    files.push_back("-");
+  }
+
+  dadi::Formatter formatter(pattern);
+  std::string line;
+  int res = EXIT_SUCCESS;
+  std::vector<std::string>::const_iterator it = files.begin();
+  for (; it != files.end(); ++it) {
+    try {
+      bool complete;
+      if ("-" == *it) {
+        complete = cat(std::cin, filter, formatter, line);
+      } else {
+        std::ifstream file(it->c_str(), std::ios::in | std::ios::binary);
+        if (!file) {
+          std::cerr << "dadi-logcat: cannot open " << *it << "\n";
+          res = EXIT_FAILURE;
+          continue;
+        }
+        io::filtering_istream in;
+        pushDecompressor(in, *it);
+        in.push(file);
+        complete = cat(in, filter, formatter, line);
+      }
+      if (!complete) {
+        std::cerr << "dadi-logcat: " << *it << ": truncated record\n";
+      }
+    } catch (const dadi::Error& e) {
+      const std::string *msg = boost::get_error_info<dadi::errinfo_msg>(e);
+      std::cerr << "dadi-logcat: " << *it << ": "
+                << (msg ? *msg : std::string(e.what())) << "\n";
+      res = EXIT_FAILURE;
+    } catch (const std::exception& e) {
+      std::cerr << "dadi-logcat: " << *it << ": " << e.what() << "\n";
+      res = EXIT_FAILURE;
+    }
+  }
+  std::cout.flush();
+
+  return res;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file   tools/ringcat.cc
+ * @author Haïkel Guémar <haikel.guemar@sysfera.com>
+ * @brief  dadi-ringcat: print the records of crash log rings
+ * @section License
+ *   |LICENSE|
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <dadi/Logging/MappedRingChannel.hh>
+#include <dadi/Exception/All.hh>
+
+namespace po = boost::program_options;
+
+int
+main(int argc, char *argv[]) {
+  unsigned long tail = 0;
+  std::vector<std::string> files;
+
+  po::options_description desc("usage: dadi-ringcat [options] file...\n"
+                               "options");
+  desc.add_options()
+    ("help,h", "display help message")
+    ("tail,n", po::value<unsigned long>(&tail),
+     "print only the last records")
+    ("verbose,v", "report bytes that did not belong to a record")
+    ("file", po::value<std::vector<std::string> >(&files), "ring files");
+  po::positional_options_description positional;
+  positional.add("file", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc)
+              .positional(positional).run(), vm);
+    po::notify(vm);
+  } catch (const std::exception& e) {
+    std::cerr << "dadi-ringcat: " << e.what() << "\n" << desc << "\n";
+    return EXIT_FAILURE;
+  }
+  if (vm.count("help") || files.empty()) {
+    std::cout << desc << "\n";
+    return files.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  int res = EXIT_SUCCESS;
+  std::vector<std::string> records;
+  std::vector<std::string>::const_iterator it = files.begin();
+  for (; it != files.end(); ++it) {
+    try {
+      dadi::MappedRingReader reader(*it);
+      records.clear();
+      std::string record;
+      while (reader.next(record)) {
+        records.push_back(record);
+      }
+
+      std::size_t first = 0;
+      if (tail && (records.size() > tail)) {
+        first = records.size() - tail;
+      }
+      for (std::size_t i = first; i < records.size(); ++i) {
+        std::cout << records[i] << "\n";
+      }
+      if (vm.count("verbose")) {
+        std::cerr << "dadi-ringcat: " << *it << ": " << records.size()
+                  << " records, " << reader.getSkipped()
+                  << " bytes skipped\n";
+      }
+    } catch (const dadi::Error& e) {
+      const std::string *msg = boost::get_error_info<dadi::errinfo_msg>(e);
+      std::cerr << "dadi-ringcat: "
+                << (msg ? *msg : std::string(e.what())) << "\n";
+      res = EXIT_FAILURE;
+    }
+  }
+  std::cout.flush();
+
+  return res;
+}